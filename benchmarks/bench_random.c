@@ -0,0 +1,89 @@
+// Microbenchmark: scalar random.c samplers against the batched xoshiro
+// generator and the Ziggurat samplers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "utils/random.h"
+#include "utils/random_batch.h"
+
+#define NUM_SAMPLES (1 << 24)
+#define BUFFER_SIZE 4096
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char* name, double seconds, double sum,
+                   double sum_sq) {
+    double mean = sum / NUM_SAMPLES;
+    double var = sum_sq / NUM_SAMPLES - mean * mean;
+    printf("%-32s %8.1f Msamples/s   mean %+.4f  var %.4f\n", name,
+           NUM_SAMPLES / seconds * 1e-6, mean, var);
+}
+
+typedef double (*ScalarSampler)(RandomState* state);
+
+static double exponential_unit(RandomState* state) {
+    return random_exponential(state, 1.0);
+}
+
+static double exponential_ziggurat_unit(RandomState* state) {
+    return random_exponential_ziggurat(state, 1.0);
+}
+
+static void bench_scalar(const char* name, ScalarSampler sampler) {
+    RandomState state;
+    init_random(&state, 42);
+
+    double sum = 0.0, sum_sq = 0.0;
+    double start = now_seconds();
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        double x = sampler(&state);
+        sum += x;
+        sum_sq += x * x;
+    }
+    report(name, now_seconds() - start, sum, sum_sq);
+}
+
+typedef void (*BatchSampler)(RandomBatch* batch, double* out, size_t count);
+
+static void bench_batch(const char* name, BatchSampler sampler) {
+    RandomBatch batch;
+    init_random_batch(&batch, 42);
+    double* buffer = (double*)random_batch_alloc(BUFFER_SIZE, sizeof(double));
+
+    double sum = 0.0, sum_sq = 0.0;
+    double start = now_seconds();
+    for (int i = 0; i < NUM_SAMPLES; i += BUFFER_SIZE) {
+        sampler(&batch, buffer, BUFFER_SIZE);
+        for (int j = 0; j < BUFFER_SIZE; j++) {
+            sum += buffer[j];
+            sum_sq += buffer[j] * buffer[j];
+        }
+    }
+    report(name, now_seconds() - start, sum, sum_sq);
+
+    free(buffer);
+}
+
+int main(void) {
+    printf("%d samples, %d lanes\n\n", NUM_SAMPLES, RANDOM_BATCH_LANES);
+
+    bench_scalar("random_uniform", random_uniform);
+    bench_batch("random_batch_uniform", random_batch_uniform);
+    printf("\n");
+
+    bench_scalar("random_normal (Box-Muller)", random_normal);
+    bench_scalar("random_normal_ziggurat", random_normal_ziggurat);
+    bench_batch("random_batch_normal", random_batch_normal);
+    printf("\n");
+
+    bench_scalar("random_exponential", exponential_unit);
+    bench_scalar("random_exponential_ziggurat", exponential_ziggurat_unit);
+    bench_batch("random_batch_exponential", random_batch_exponential);
+
+    return 0;
+}
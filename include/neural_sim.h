@@ -53,6 +53,62 @@ struct Network;
 struct Neuron;
 struct Dendrite;
 struct Synapse;
+struct Logger;
+struct RandomState;
+struct SimulationConfig;
+
+// Summary statistics of a simulation
+typedef struct NetworkStatistics {
+    double time;                    // Simulated time (ms)
+    size_t step_count;
+    int num_pyramidal;
+    int num_inhibitory;
+    int num_synapses;
+    long long spikes_pyramidal;     // Spikes since the start of the run
+    long long spikes_inhibitory;
+    double mean_rate_pyramidal;     // Hz per neuron
+    double mean_rate_inhibitory;
+    double mean_membrane_potential; // mV, over all neurons
+    double mean_weight;
+    double computation_time;        // Wall-clock seconds spent in ns_run
+    double output_write_time;       // Seconds spent serializing outputs
+    double output_stall_time;       // Seconds ns_run waited on output I/O
+    long long output_stalls;        // Steps that waited on output I/O
+    double load_imbalance;          // Busiest thread over mean busy time
+    // Periodic checkpoints (checkpoint_interval): those written, seconds
+    // the simulation paused for them in total and at most, and the most
+    // memory (bytes) copied on write while a forked one was written
+    long long checkpoints;
+    double checkpoint_pause_time;
+    double checkpoint_max_pause;
+    long long checkpoint_cow_bytes;
+    // Real-time runs (realtime), after the warmup: steps that completed
+    // after the next one was due, step latency from release to completion
+    // and wakeup latency from release to start in seconds, and page faults
+    // taken while paced
+    long long realtime_overruns;
+    double realtime_latency_p50;
+    double realtime_latency_p99;
+    double realtime_latency_max;
+    double realtime_wakeup_max;
+    long long realtime_page_faults;
+    // Over activity_window windows (0 when disabled): active neurons'
+    // variance over mean, overlap of successive windows' active sets, and
+    // correlation of the two populations' active counts
+    double synchrony_pyramidal;
+    double synchrony_inhibitory;
+    double overlap_pyramidal;
+    double overlap_inhibitory;
+    double ei_correlation;
+} NetworkStatistics;
+
+// Variables recorded by probes, combined as a bit mask
+typedef enum {
+    NS_PROBE_V = 1 << 0,           // Membrane potential
+    NS_PROBE_CALCIUM = 1 << 1,     // Calcium concentration
+    NS_PROBE_ADAPTATION = 1 << 2,  // Adaptation current
+    NS_PROBE_DENDRITIC = 1 << 3    // Dendritic potential
+} NSProbeVariable;
 
 // Main simulation interface
 typedef struct {
@@ -106,14 +162,69 @@ typedef struct {
  */
 NeuralSimulation* ns_init(const char* config_file, const SimulationCallbacks* callbacks);
 
+/**
+ * @brief Initialize the neural simulation from configuration text
+ * @param config_text Contents in the same key=value format as config files
+ * @param callbacks Optional callback functions
+ * @return Pointer to initialized simulation or NULL on error
+ */
+NeuralSimulation* ns_init_from_string(const char* config_text, const SimulationCallbacks* callbacks);
+
+/**
+ * @brief Initialize the neural simulation from a loaded configuration
+ * @param config Configuration; ownership passes to the simulation
+ * @param callbacks Optional callback functions
+ * @return Pointer to initialized simulation or NULL on error
+ */
+NeuralSimulation* ns_init_from_config(struct SimulationConfig* config, const SimulationCallbacks* callbacks);
+
 /**
  * @brief Run the simulation for the specified duration
+ *
+ * Blocks until the duration has been simulated or ns_stop() is called from
+ * another thread or from a callback. Progress and state callbacks fire every
+ * progress_interval and save_interval of simulated time (0 = every step).
+ * With realtime set, steps are released on the wall clock, realtime_factor
+ * times their simulated duration apart, and the run's pacing is logged.
+ *
  * @param sim Pointer to simulation instance
- * @param duration Simulation duration in seconds (-1 for config default)
+ * @param duration Simulation duration in simulation time units, the same as
+ *                 dt and simulation_time (-1 to run until simulation_time)
  * @return Error code
  */
 NeuralSimError ns_run(NeuralSimulation* sim, double duration);
 
+/**
+ * @brief Input of one batched trial
+ *
+ * Fills current (mV/ms, zeroed beforehand) with the current each neuron,
+ * by creation-order id, receives on every step of the trial.
+ */
+typedef void (*TrialStimulusCallback)(int trial, double* current,
+                                      int num_neurons, void* user_data);
+
+/**
+ * @brief Run independent trials of the network in lockstep
+ *
+ * Every trial starts from the current state and shares the connectome and
+ * weights; trial t draws its noise from random_seed + t, so trial 0 repeats
+ * what ns_run() would do. Neuron state is kept per trial side by side and
+ * updated in SIMD lanes. Spikes go to <output_dir>/trials as spike_trials,
+ * spike_ids and spike_times .npy files, and mean rates (Hz) by trial and
+ * population to rates.npy. The simulation itself does not advance.
+ * Networks with plasticity or dendrites cannot be batched.
+ *
+ * @param sim Pointer to simulation instance
+ * @param num_trials Number of trials
+ * @param duration Duration of each trial (-1 to run until simulation_time)
+ * @param stimulus Per-trial input, or NULL for none
+ * @param user_data Passed to stimulus
+ * @return Error code
+ */
+NeuralSimError ns_run_trials(NeuralSimulation* sim, int num_trials,
+                             double duration, TrialStimulusCallback stimulus,
+                             void* user_data);
+
 /**
  * @brief Pause the running simulation
  * @param sim Pointer to simulation instance
@@ -130,13 +241,59 @@ NeuralSimError ns_resume(NeuralSimulation* sim);
 
 /**
  * @brief Stop the simulation and cleanup
+ *
+ * If ns_run() is active on another thread, waits for it to return first.
+ * Called from a callback, the simulation is released when ns_run() returns.
+ * The simulation pointer is invalid afterwards.
+ *
  * @param sim Pointer to simulation instance
  * @return Error code
  */
 NeuralSimError ns_stop(NeuralSimulation* sim);
 
+/**
+ * @brief Record variables of selected neurons
+ *
+ * Samples are buffered per thread and written as NumPy columns to
+ * <output_dir>/probes/<name>_<variable>.npy (float32, one row per sample)
+ * with sample times in <name>_time.npy, the neuron ids in <name>_ids.npy
+ * and the layout in <name>.txt.
+ *
+ * @param sim Pointer to simulation instance
+ * @param name Probe name, used for its files
+ * @param neuron_ids Global neuron ids (pyramidal first, then inhibitory)
+ * @param num_ids Number of ids
+ * @param variables Mask of NSProbeVariable values
+ * @param interval Sampling interval in simulation time units
+ * @return Error code
+ */
+NeuralSimError ns_add_probe(NeuralSimulation* sim, const char* name,
+                            const int* neuron_ids, int num_ids,
+                            unsigned variables, double interval);
+
+/**
+ * @brief Record variables of selected neurons from a text spec
+ * @param sim Pointer to simulation instance
+ * @param spec "<name> <neurons> <variables> <interval>", e.g.
+ *             "exc pyramidal V,Ca 1.0" or "few 0-9,42 V 0.1"
+ * @return Error code
+ */
+NeuralSimError ns_add_probe_spec(NeuralSimulation* sim, const char* spec);
+
+/**
+ * @brief Deliver a reward signal to reward-modulated plasticity
+ * @param sim Pointer to simulation instance
+ * @param reward Reward value
+ * @return Error code
+ */
+NeuralSimError ns_deliver_reward(NeuralSimulation* sim, double reward);
+
 /**
  * @brief Save the current simulation state
+ *
+ * Written before the call returns. Periodic checkpoints (checkpoint_interval)
+ * can instead be written by a forked process while the run goes on.
+ *
  * @param sim Pointer to simulation instance
  * @param filename Optional filename (NULL for default name)
  * @return Error code
@@ -145,6 +302,10 @@ NeuralSimError ns_save_state(NeuralSimulation* sim, const char* filename);
 
 /**
  * @brief Load a previously saved simulation state
+ *
+ * Takes state files and periodic checkpoints; an incremental checkpoint is
+ * rebuilt from the chain of checkpoints it is based on, found next to it.
+ *
  * @param sim Pointer to simulation instance
  * @param filename State file to load
  * @return Error code
@@ -195,10 +356,33 @@ const char* ns_get_system_info(void);
 NeuralSimError ns_calculate_statistics(const NeuralSimulation* sim, struct NetworkStatistics* stats);
 
 /**
- * @brief Export simulation data to various formats
+ * @brief Get per-thread busy and idle time of the neuron update
+ *
+ * Busy time is spent updating neurons and applying plasticity, idle time
+ * looking for work or waiting for the other threads, both in seconds since
+ * the simulation was created.
+ *
  * @param sim Pointer to simulation instance
- * @param format Export format (CSV, HDF5, etc.)
- * @param filename Output filename
+ * @param busy Array of at least max_threads entries to fill (may be NULL)
+ * @param idle Array of at least max_threads entries to fill (may be NULL)
+ * @param max_threads Capacity of the arrays
+ * @return Number of worker threads (may exceed max_threads), or -1 on error
+ */
+int ns_get_thread_times(const NeuralSimulation* sim, double* busy,
+                        double* idle, int max_threads);
+
+/**
+ * @brief Export simulation data for NumPy
+ *
+ * Writes population sizes, the weight matrix (CSR arrays weights_indptr,
+ * weights_indices, weights_data by presynaptic row, plus a dense
+ * "weights" matrix for small networks), recorded spike trains and all
+ * probe columns. "npy" creates a directory of .npy files, "npz" an
+ * uncompressed .npz archive.
+ *
+ * @param sim Pointer to simulation instance
+ * @param format "npy" or "npz"
+ * @param filename Output directory (npy) or archive file (npz)
  * @return Error code
  */
 NeuralSimError ns_export_data(const NeuralSimulation* sim, const char* format, const char* filename);
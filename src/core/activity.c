@@ -0,0 +1,129 @@
+#include "activity.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/spike_bits.h"
+
+ActivityMonitor* create_activity_monitor(const int* first_id,
+                                         const int* count, int num_groups,
+                                         int window_steps) {
+    if (num_groups < 1 || num_groups > ACTIVITY_MAX_GROUPS ||
+        window_steps < 1) {
+        fprintf(stderr, "Invalid activity monitor\n");
+        return NULL;
+    }
+    ActivityMonitor* monitor =
+        (ActivityMonitor*)calloc(1, sizeof(ActivityMonitor));
+    if (!monitor) return NULL;
+
+    monitor->num_groups = num_groups;
+    monitor->window_steps = window_steps;
+    for (int g = 0; g < num_groups; g++) {
+        monitor->first_id[g] = first_id[g];
+        monitor->count[g] = count[g];
+        monitor->word_offset[g] = monitor->num_words;
+        monitor->num_words += spike_bits_words(count[g]);
+    }
+    size_t words = monitor->num_words > 0 ? monitor->num_words : 1;
+    monitor->bits = (uint64_t*)calloc(words, sizeof(uint64_t));
+    monitor->previous = (uint64_t*)calloc(words, sizeof(uint64_t));
+    if (!monitor->bits || !monitor->previous) {
+        fprintf(stderr, "Failed to allocate activity monitor\n");
+        destroy_activity_monitor(monitor);
+        return NULL;
+    }
+    return monitor;
+}
+
+void destroy_activity_monitor(ActivityMonitor* monitor) {
+    if (monitor) {
+        free(monitor->bits);
+        free(monitor->previous);
+        free(monitor);
+    }
+}
+
+static size_t group_words(const ActivityMonitor* monitor, int g) {
+    return spike_bits_words(monitor->count[g]);
+}
+
+// Active counts enter the sums relative to those of the first window,
+// which keeps the variances exact for large groups
+static void close_window(ActivityMonitor* monitor) {
+    ActivityTotals* totals = &monitor->totals;
+    double active[ACTIVITY_MAX_GROUPS];
+    for (int g = 0; g < monitor->num_groups; g++) {
+        const uint64_t* bits = monitor->bits + monitor->word_offset[g];
+        const uint64_t* previous = monitor->previous + monitor->word_offset[g];
+        size_t words = group_words(monitor, g);
+        double count = (double)spike_bits_count(bits, words);
+        if (totals->windows == 0) totals->shift[g] = count;
+        active[g] = count - totals->shift[g];
+        if (totals->windows > 0) {
+            double last = (double)spike_bits_count(previous, words);
+            totals->overlap[g] +=
+                (double)spike_bits_count_and(bits, previous, words);
+            totals->overlap_norm[g] += sqrt(count * last);
+        }
+    }
+    for (int a = 0; a < monitor->num_groups; a++) {
+        totals->active[a] += active[a];
+        for (int b = 0; b < monitor->num_groups; b++) {
+            totals->cross[a][b] += active[a] * active[b];
+        }
+    }
+    totals->windows++;
+
+    uint64_t* swap = monitor->previous;
+    monitor->previous = monitor->bits;
+    monitor->bits = swap;
+    memset(monitor->bits, 0, monitor->num_words * sizeof(uint64_t));
+    monitor->fill = 0;
+}
+
+void activity_record(ActivityMonitor* monitor, const int* ids, int count) {
+    for (int s = 0; s < count; s++) {
+        for (int g = 0; g < monitor->num_groups; g++) {
+            int i = ids[s] - monitor->first_id[g];
+            if (i >= 0 && i < monitor->count[g]) {
+                spike_bits_set(monitor->bits + monitor->word_offset[g], i);
+                break;
+            }
+        }
+    }
+    if (++monitor->fill == monitor->window_steps) close_window(monitor);
+}
+
+// Covariance of two groups' active counts over the windows
+static double covariance(const ActivityTotals* totals, int a, int b) {
+    double n = (double)totals->windows;
+    return totals->cross[a][b] / n -
+           (totals->active[a] / n) * (totals->active[b] / n);
+}
+
+double activity_synchrony(const ActivityMonitor* monitor, int group) {
+    const ActivityTotals* totals = &monitor->totals;
+    if (totals->windows == 0) return 0.0;
+    double mean = totals->shift[group] + totals->active[group] / totals->windows;
+    return mean > 0.0 ? covariance(totals, group, group) / mean : 0.0;
+}
+
+double activity_overlap(const ActivityMonitor* monitor, int group) {
+    const ActivityTotals* totals = &monitor->totals;
+    return totals->overlap_norm[group] > 0.0
+               ? totals->overlap[group] / totals->overlap_norm[group]
+               : 0.0;
+}
+
+double activity_correlation(const ActivityMonitor* monitor, int a, int b) {
+    const ActivityTotals* totals = &monitor->totals;
+    if (totals->windows == 0) return 0.0;
+    double var_a = covariance(totals, a, a);
+    double var_b = covariance(totals, b, b);
+    return var_a > 0.0 && var_b > 0.0
+               ? covariance(totals, a, b) / sqrt(var_a * var_b)
+               : 0.0;
+}
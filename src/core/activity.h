@@ -0,0 +1,62 @@
+#ifndef NEURAL_ACTIVITY_H
+#define NEURAL_ACTIVITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Population activity in windows of consecutive steps. Every window ORs
+// its spikes into one bit vector per group of neurons (a population), so
+// a window costs a bit set per spike and a popcount pass over N / 64
+// words at its end, whatever the rates. From the windows:
+//
+//   synchrony    variance over mean of a group's active neurons per
+//                window; 1 - p for neurons firing independently with
+//                probability p per window, above 1 when they fire together
+//   overlap      neurons active in two successive windows over the
+//                geometric mean of the two counts; p for independent
+//                firing, toward 1 when the same assembly stays active
+//   correlation  Pearson correlation of two groups' active counts over
+//                windows, e.g. how closely inhibition tracks excitation
+
+#define ACTIVITY_MAX_GROUPS 4
+
+// Accumulated over complete windows, with active counts taken relative
+// to the first window's
+typedef struct {
+    long long windows;
+    double shift[ACTIVITY_MAX_GROUPS];          // First window's counts
+    double active[ACTIVITY_MAX_GROUPS];         // Sum of active counts
+    double overlap[ACTIVITY_MAX_GROUPS];        // Sum of overlaps
+    double overlap_norm[ACTIVITY_MAX_GROUPS];   // Sum of sqrt(|a| |b|)
+    // Sums of products of two groups' counts
+    double cross[ACTIVITY_MAX_GROUPS][ACTIVITY_MAX_GROUPS];
+} ActivityTotals;
+
+typedef struct {
+    int num_groups;
+    int first_id[ACTIVITY_MAX_GROUPS];  // Groups are id ranges
+    int count[ACTIVITY_MAX_GROUPS];
+    size_t word_offset[ACTIVITY_MAX_GROUPS];  // Each starts a word
+    size_t num_words;
+    int window_steps;
+    int fill;            // Steps of the current window recorded
+    uint64_t* bits;      // Current window
+    uint64_t* previous;  // Last complete window
+    ActivityTotals totals;
+} ActivityMonitor;
+
+ActivityMonitor* create_activity_monitor(const int* first_id,
+                                         const int* count, int num_groups,
+                                         int window_steps);
+void destroy_activity_monitor(ActivityMonitor* monitor);
+
+// Records one step's spikes by global id; ids outside every group are
+// ignored
+void activity_record(ActivityMonitor* monitor, const int* ids, int count);
+
+// Statistics of the complete windows so far, 0 before there are any
+double activity_synchrony(const ActivityMonitor* monitor, int group);
+double activity_overlap(const ActivityMonitor* monitor, int group);
+double activity_correlation(const ActivityMonitor* monitor, int a, int b);
+
+#endif
@@ -0,0 +1,30 @@
+#include "background.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+BackgroundInput* create_background_input(BackgroundParams params,
+                                         double dt) {
+    BackgroundInput* bg = (BackgroundInput*)calloc(1, sizeof(BackgroundInput));
+    if (!bg) return NULL;
+
+    bg->params = params;
+    bg->current_per_spike = params.weight / dt;
+
+    // Expected external spikes per neuron per step (rate in Hz, dt in ms)
+    double lambda = params.num_sources * params.rate * dt / 1000.0;
+    if (init_poisson_sampler(&bg->sampler, lambda) != 0) {
+        fprintf(stderr, "Failed to build background Poisson sampler\n");
+        free(bg);
+        return NULL;
+    }
+
+    return bg;
+}
+
+void destroy_background_input(BackgroundInput* bg) {
+    if (bg) {
+        free_poisson_sampler(&bg->sampler);
+        free(bg);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef NEURAL_BACKGROUND_H
+#define NEURAL_BACKGROUND_H
+
+#include <stdint.h>
+
+#include "utils/random.h"
+
+typedef struct {
+    int num_sources;  // External Poisson sources per neuron (K)
+    double rate;      // Firing rate of each source (Hz)
+    double weight;    // Voltage jump per external spike (mV)
+} BackgroundParams;
+
+// External cortical background. The K independent sources of a neuron
+// superpose into one Poisson process of rate K * rate, so each neuron costs
+// a single draw per step.
+typedef struct {
+    BackgroundParams params;
+    PoissonSampler sampler;
+    double current_per_spike;  // weight / dt
+} BackgroundInput;
+
+BackgroundInput* create_background_input(BackgroundParams params, double dt);
+void destroy_background_input(BackgroundInput* bg);
+
+// Input current from this step's external spikes, drawn from the caller's
+// thread stream
+static inline double background_current(const BackgroundInput* bg,
+                                        RandomState* rng) {
+    int count = sample_poisson(&bg->sampler, rng);
+    return count * bg->current_per_spike;
+}
+
+#endif
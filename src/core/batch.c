@@ -0,0 +1,314 @@
+#include "batch.h"
+
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Zeroed array of count doubles, padded to whole cache lines
+static double* alloc_lanes(size_t count) {
+    size_t bytes = (count * sizeof(double) + BATCH_ALIGN - 1) / BATCH_ALIGN *
+                   BATCH_ALIGN;
+    double* data = aligned_alloc(BATCH_ALIGN, bytes);
+    if (data) memset(data, 0, bytes);
+    return data;
+}
+
+TrialBatch* create_trial_batch(const Network* net, int num_trials,
+                               const uint64_t* seeds) {
+    if (num_trials < 1) {
+        fprintf(stderr, "Invalid number of trials: %d\n", num_trials);
+        return NULL;
+    }
+    if (net->stdp || net->structural || net->dendrites || net->transport ||
+        net->gap_junctions) {
+        fprintf(stderr,
+                "Batched trials need a whole network of point neurons "
+                "without plasticity or gap junctions\n");
+        return NULL;
+    }
+
+    TrialBatch* batch = calloc(1, sizeof(TrialBatch));
+    if (!batch) {
+        fprintf(stderr, "Failed to allocate trial batch\n");
+        return NULL;
+    }
+    int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    int stride = (num_trials + TRIAL_LANES - 1) / TRIAL_LANES * TRIAL_LANES;
+    size_t count = (size_t)total * stride;
+    batch->net = net;
+    batch->lanes.num_trials = num_trials;
+    batch->lanes.stride = stride;
+    batch->lanes.v = alloc_lanes(count);
+    batch->lanes.adaptation = alloc_lanes(count);
+    batch->lanes.refractory = alloc_lanes(count);
+    batch->lanes.input = alloc_lanes(count);
+    batch->lanes.syn_exc = alloc_lanes(count);
+    batch->lanes.syn_inh = alloc_lanes(count);
+    batch->stimulus = alloc_lanes(count);
+    batch->input_exc = alloc_lanes(count);
+    batch->input_inh = alloc_lanes(count);
+    batch->spike_ring = calloc((size_t)(net->delay_steps + 1) * count, 1);
+    batch->streams = aligned_alloc(
+        64, (size_t)(net->num_chunks + 1) * num_trials * sizeof(RandomStream));
+    batch->scheduler = create_task_scheduler(omp_get_max_threads());
+    batch->chunk_cost = malloc((net->num_chunks + 1) * sizeof(double));
+    batch->chunk_time = calloc(net->num_chunks + 1, sizeof(double));
+    batch->spike_ids = malloc(count * sizeof(int));
+    batch->num_spikes = calloc(num_trials, sizeof(int));
+    batch->total_spikes =
+        calloc((size_t)num_trials * NUM_POPULATIONS, sizeof(long long));
+    batch->trial_list = malloc(num_trials * sizeof(int));
+    batch->mask = alloc_lanes(stride);
+    if (!batch->lanes.v || !batch->lanes.adaptation ||
+        !batch->lanes.refractory || !batch->lanes.input ||
+        !batch->lanes.syn_exc || !batch->lanes.syn_inh || !batch->stimulus ||
+        !batch->input_exc || !batch->input_inh || !batch->spike_ring ||
+        !batch->streams || !batch->scheduler ||
+        !batch->chunk_cost || !batch->chunk_time || !batch->spike_ids ||
+        !batch->num_spikes || !batch->total_spikes || !batch->trial_list ||
+        !batch->mask) {
+        fprintf(stderr, "Failed to allocate trial batch\n");
+        destroy_trial_batch(batch);
+        return NULL;
+    }
+    memcpy(batch->chunk_cost, net->chunk_cost,
+           net->num_chunks * sizeof(double));
+
+    // Chunk streams of each trial as the network would seed them
+    for (int t = 0; t < num_trials; t++) {
+        RandomStream* streams =
+            create_random_streams(net->num_chunks + 1, seeds[t]);
+        if (!streams) {
+            fprintf(stderr, "Failed to allocate trial batch\n");
+            destroy_trial_batch(batch);
+            return NULL;
+        }
+        for (int c = 0; c < net->num_chunks; c++) {
+            batch->streams[(size_t)c * num_trials + t] = streams[c];
+        }
+        free(streams);
+    }
+
+    // Every trial starts from the network's state; its pending synaptic
+    // input is added as it arrives. Padding lanes are never updated and
+    // so never spike.
+    for (int id = 0; id < total; id++) {
+        const Neuron* n = network_neuron(net, id);
+        const Population* pop =
+            &net->populations[id < net->config.num_pyramidal
+                                  ? POP_PYRAMIDAL
+                                  : POP_INHIBITORY];
+        int local = id - pop->first_id;
+        size_t row = (size_t)id * stride;
+        for (int t = 0; t < stride; t++) {
+            batch->lanes.v[row + t] = n->membrane_potential;
+            batch->lanes.adaptation[row + t] = n->adaptation_current;
+            batch->lanes.refractory[row + t] = n->refractory_time;
+            batch->lanes.input[row + t] = n->input_current;
+            batch->lanes.syn_exc[row + t] = pop->syn_exc[local];
+            batch->lanes.syn_inh[row + t] = pop->syn_inh[local];
+        }
+    }
+    batch->lanes.spiked = batch->spike_ring;
+    return batch;
+}
+
+void destroy_trial_batch(TrialBatch* batch) {
+    if (batch) {
+        free(batch->lanes.v);
+        free(batch->lanes.adaptation);
+        free(batch->lanes.refractory);
+        free(batch->lanes.input);
+        free(batch->lanes.syn_exc);
+        free(batch->lanes.syn_inh);
+        free(batch->stimulus);
+        free(batch->input_exc);
+        free(batch->input_inh);
+        free(batch->spike_ring);
+        free(batch->streams);
+        destroy_task_scheduler(batch->scheduler);
+        free(batch->chunk_cost);
+        free(batch->chunk_time);
+        free(batch->spike_ids);
+        free(batch->num_spikes);
+        free(batch->total_spikes);
+        free(batch->trial_list);
+        free(batch->mask);
+        free(batch);
+    }
+}
+
+typedef struct {
+    TrialBatch* batch;
+    const KernelContext* ctx;
+} BatchContext;
+
+// Advances one chunk of the network in every trial
+static void update_batch_chunk(void* context, int task, int thread) {
+    (void)thread;
+    const BatchContext* c = context;
+    TrialBatch* batch = c->batch;
+    const Network* net = batch->net;
+    const NeuronChunk* work = &net->chunks[task];
+    const Population* pop = &net->populations[work->population];
+    const int trials = batch->lanes.num_trials;
+    const size_t stride = batch->lanes.stride;
+    const int begin = pop->first_id + work->begin;
+    const int end = pop->first_id + work->end;
+
+    // Noise trial by trial, drawn in the order apply_external_drive()
+    // draws it for the network
+    for (int t = 0; t < trials; t++) {
+        RandomState* rng = &batch->streams[(size_t)task * trials + t].rng;
+        double* input = batch->lanes.input + t;
+        if (net->background) {
+            for (int id = begin; id < end; id++) {
+                input[(size_t)id * stride] +=
+                    background_current(net->background, rng);
+            }
+        } else {
+            for (int id = begin; id < end; id++) {
+                input[(size_t)id * stride] +=
+                    random_uniform(rng) * (2.0 * TEST_NOISE_AMPLITUDE) -
+                    TEST_NOISE_AMPLITUDE;
+            }
+        }
+    }
+    for (int id = begin; id < end; id++) {
+        double* restrict input = batch->lanes.input + (size_t)id * stride;
+        const double* restrict stimulus = batch->stimulus + (size_t)id * stride;
+#pragma omp simd
+        for (int t = 0; t < trials; t++) input[t] += stimulus[t];
+    }
+
+    pop->batch_kernel(pop, &batch->lanes, work->begin, work->end, c->ctx);
+}
+
+// Adds the synapses of src to input in the trials it spiked in (spiked,
+// listed in trial_list), reading every synapse once
+static void deliver_source(TrialBatch* batch, double* input, double scale,
+                           int src, const uint8_t* spiked, int count) {
+    const Connectivity* conn = batch->net->connectivity;
+    const int trials = batch->lanes.num_trials;
+    const size_t stride = batch->lanes.stride;
+
+    if (count >= BATCH_DENSE_FRACTION * trials) {
+        double* restrict mask = batch->mask;
+        for (int t = 0; t < trials; t++) mask[t] = spiked[t];
+        for (int k = conn_row_begin(conn, src); k < conn_row_end(conn, src);
+             k++) {
+            const double w = scale * conn->weights[k];
+            double* restrict in = input + (size_t)conn->targets[k] * stride;
+#pragma omp simd
+            for (int t = 0; t < trials; t++) in[t] += w * mask[t];
+        }
+        return;
+    }
+
+    const int* list = batch->trial_list;
+    for (int k = conn_row_begin(conn, src); k < conn_row_end(conn, src);
+         k++) {
+        const double w = scale * conn->weights[k];
+        double* in = input + (size_t)conn->targets[k] * stride;
+        for (int j = 0; j < count; j++) in[list[j]] += w;
+    }
+}
+
+// Whether any lane of a neuron spiked, checked a word of lanes at a time
+static bool any_lane(const uint8_t* spiked, size_t stride) {
+    uint64_t any = 0;
+    for (size_t t = 0; t < stride; t += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, spiked + t, sizeof(word));
+        any |= word;
+    }
+    return any != 0;
+}
+
+// Fills input_exc/input_inh with what arrives this step: input the network
+// had pending when the batch was created, then the spikes of delay_steps
+// steps ago. Both are added in the order the network adds them to a ring
+// slot, so every trial sums its input exactly as a single run would.
+static void arriving_input(TrialBatch* batch) {
+    const Network* net = batch->net;
+    const int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    const int trials = batch->lanes.num_trials;
+    const size_t stride = batch->lanes.stride;
+    const int slots = net->delay_steps + 1;
+
+    if (batch->step < slots) {
+        size_t slot = (size_t)((net->ring_head + batch->step) % slots) * total;
+        for (int id = 0; id < total; id++) {
+            const double exc = net->input_exc[slot + id];
+            const double inh = net->input_inh[slot + id];
+            if (exc == 0.0 && inh == 0.0) continue;
+            double* in_exc = batch->input_exc + (size_t)id * stride;
+            double* in_inh = batch->input_inh + (size_t)id * stride;
+            for (int t = 0; t < trials; t++) {
+                in_exc[t] += exc;
+                in_inh[t] += inh;
+            }
+        }
+    }
+
+    // Padding lanes never spike, so they are never delivered from
+    const size_t count = (size_t)total * stride;
+    const uint8_t* ring = batch->spike_ring +
+                          (size_t)((batch->ring_head + 1) % slots) * count;
+    const double w_exc = net->config.w_exc;
+    const double w_inh = fabs(net->config.w_inh);
+    for (int src = 0; src < total; src++) {
+        const uint8_t* spiked = ring + (size_t)src * stride;
+        if (!any_lane(spiked, stride)) continue;
+        int spikes = 0;
+        for (int t = 0; t < trials; t++) {
+            if (spiked[t]) batch->trial_list[spikes++] = t;
+        }
+        if (src < net->config.num_pyramidal) {
+            deliver_source(batch, batch->input_exc, w_exc, src, spiked,
+                           spikes);
+        } else {
+            deliver_source(batch, batch->input_inh, w_inh, src, spiked,
+                           spikes);
+        }
+    }
+}
+
+void update_trial_batch(TrialBatch* batch, double time) {
+    const Network* net = batch->net;
+    const int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    const int trials = batch->lanes.num_trials;
+    const size_t stride = batch->lanes.stride;
+    const int slots = net->delay_steps + 1;
+
+    arriving_input(batch);
+    batch->lanes.spiked =
+        batch->spike_ring + (size_t)batch->ring_head * total * stride;
+    KernelContext ctx = {net->config.dt, time, net->syn_decay,
+                         batch->input_exc, batch->input_inh};
+    BatchContext context = {batch, &ctx};
+    scheduler_run(batch->scheduler, net->num_chunks, batch->chunk_cost,
+                  batch->chunk_time, update_batch_chunk, &context);
+    for (int c = 0; c < net->num_chunks; c++) {
+        batch->chunk_cost[c] +=
+            CHUNK_COST_SMOOTHING * (batch->chunk_time[c] - batch->chunk_cost[c]);
+    }
+
+    memset(batch->num_spikes, 0, trials * sizeof(int));
+    for (int src = 0; src < total; src++) {
+        const uint8_t* spiked = batch->lanes.spiked + (size_t)src * stride;
+        if (!any_lane(spiked, stride)) continue;
+        int population = src < net->config.num_pyramidal ? POP_PYRAMIDAL
+                                                         : POP_INHIBITORY;
+        for (int t = 0; t < trials; t++) {
+            if (!spiked[t]) continue;
+            batch->spike_ids[(size_t)t * total + batch->num_spikes[t]++] = src;
+            batch->total_spikes[t * NUM_POPULATIONS + population]++;
+        }
+    }
+
+    batch->ring_head = (batch->ring_head + 1) % slots;
+    batch->step++;
+}
@@ -0,0 +1,82 @@
+#ifndef NEURAL_BATCH_H
+#define NEURAL_BATCH_H
+
+#include <stdint.h>
+
+#include "network.h"
+
+// Lockstep trials of one network.
+//
+// The trials of a batch share the network's connectome, weights and
+// parameters and differ only in their noise seed and external stimulus.
+// Neuron state is laid out [neuron][trial] (TrialLanes), so the neuron
+// update runs the trials of a neuron in SIMD lanes, and delivery fetches
+// each synapse of a neuron that spiked once for all trials in which it
+// spiked. Every trial starts from the network's current state, pending
+// synaptic input included; the network itself is not modified while the
+// batch runs.
+//
+// Weights are shared and read-only, so networks with plasticity or
+// dendrites, whose state would differ between trials, are rejected. A
+// trial seeded with the network's seed reproduces update_network().
+
+#define BATCH_ALIGN 64
+
+// Sources that spiked in at least this fraction of the trials are
+// delivered to all lanes under a mask rather than trial by trial
+#define BATCH_DENSE_FRACTION 0.25
+
+typedef struct {
+    const Network* net;
+    TrialLanes lanes;  // lanes.spiked points into spike_ring
+    double* stimulus;  // Current added on every step, lane layout
+
+    // Synaptic input arriving this step, lane layout. With one delay for
+    // all synapses, spikes are held back delay_steps steps and delivered
+    // on arrival, so a single slot replaces the network's delay ring.
+    double* input_exc;
+    double* input_inh;
+    uint8_t* spike_ring;  // (delay_steps + 1) slots of spiked lanes
+    int ring_head;
+    long long step;       // Steps since creation
+
+    // Neuron update over the network's chunks, with one generator per
+    // chunk and trial, [chunk * num_trials + trial]
+    RandomStream* streams;
+    TaskScheduler* scheduler;
+    double* chunk_cost;
+    double* chunk_time;
+
+    // Spikes of the last step: a row of all neurons per trial holding its
+    // storage ids in increasing order
+    int* spike_ids;
+    int* num_spikes;          // By trial
+    long long* total_spikes;  // [trial * NUM_POPULATIONS + population]
+
+    int* trial_list;  // Delivery scratch: trials a source spiked in
+    double* mask;     // Delivery scratch: 1.0 in those trials
+} TrialBatch;
+
+// num_trials trials, trial t drawing its noise from seeds[t]
+TrialBatch* create_trial_batch(const Network* net, int num_trials,
+                               const uint64_t* seeds);
+void destroy_trial_batch(TrialBatch* batch);
+
+// Current (mV/ms) neuron id (storage id) receives on every step of trial
+static inline double* trial_batch_stimulus(const TrialBatch* batch, int id,
+                                           int trial) {
+    return &batch->stimulus[(size_t)id * batch->lanes.stride + trial];
+}
+
+// Spikes of trial in the last step
+static inline const int* trial_batch_spikes(const TrialBatch* batch,
+                                            int trial) {
+    int total = batch->net->config.num_pyramidal +
+                batch->net->config.num_inhibitory;
+    return batch->spike_ids + (size_t)trial * total;
+}
+
+// Advances every trial by one step
+void update_trial_batch(TrialBatch* batch, double time);
+
+#endif
@@ -0,0 +1,207 @@
+#include "cable.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Morphology* create_morphology(const int* parent, const double* g_axial,
+                              int num_compartments, double tau,
+                              double e_leak, double soma_ratio) {
+    for (int i = 0; i < num_compartments; i++) {
+        if (parent[i] < -1 || parent[i] >= i) {
+            fprintf(stderr, "Compartment %d is not in Hines order\n", i);
+            return NULL;
+        }
+    }
+    if (num_compartments < 1 || tau <= 0.0) {
+        fprintf(stderr, "Invalid morphology parameters\n");
+        return NULL;
+    }
+
+    Morphology* morphology = calloc(1, sizeof(Morphology));
+    if (!morphology) {
+        fprintf(stderr, "Failed to allocate morphology\n");
+        return NULL;
+    }
+    morphology->num_compartments = num_compartments;
+    morphology->tau = tau;
+    morphology->e_leak = e_leak;
+    morphology->soma_ratio = soma_ratio;
+    morphology->parent = malloc(num_compartments * sizeof(int));
+    morphology->g_axial = malloc(num_compartments * sizeof(double));
+    morphology->pivot = calloc(num_compartments, sizeof(double));
+    morphology->factor = calloc(num_compartments, sizeof(double));
+    if (!morphology->parent || !morphology->g_axial || !morphology->pivot ||
+        !morphology->factor) {
+        fprintf(stderr, "Failed to allocate morphology\n");
+        destroy_morphology(morphology);
+        return NULL;
+    }
+    memcpy(morphology->parent, parent, num_compartments * sizeof(int));
+    memcpy(morphology->g_axial, g_axial, num_compartments * sizeof(double));
+    return morphology;
+}
+
+Morphology* create_branched_morphology(int num_branches,
+                                       int compartments_per_branch,
+                                       double g_axial, double tau,
+                                       double e_leak, double soma_ratio) {
+    int n = num_branches * compartments_per_branch;
+    if (n < 1) {
+        fprintf(stderr, "Invalid morphology parameters\n");
+        return NULL;
+    }
+    int* parent = malloc(n * sizeof(int));
+    double* g = malloc(n * sizeof(double));
+    if (!parent || !g) {
+        fprintf(stderr, "Failed to allocate morphology\n");
+        free(parent);
+        free(g);
+        return NULL;
+    }
+    // Branch b holds compartments [b * per_branch, (b + 1) * per_branch),
+    // proximal first
+    for (int b = 0; b < num_branches; b++) {
+        for (int c = 0; c < compartments_per_branch; c++) {
+            int i = b * compartments_per_branch + c;
+            parent[i] = c == 0 ? -1 : i - 1;
+            g[i] = g_axial;
+        }
+    }
+    Morphology* morphology =
+        create_morphology(parent, g, n, tau, e_leak, soma_ratio);
+    free(parent);
+    free(g);
+    return morphology;
+}
+
+void destroy_morphology(Morphology* morphology) {
+    if (morphology) {
+        free(morphology->parent);
+        free(morphology->g_axial);
+        free(morphology->pivot);
+        free(morphology->factor);
+        free(morphology);
+    }
+}
+
+void morphology_prepare(Morphology* morphology, double dt) {
+    int n = morphology->num_compartments;
+    const int* parent = morphology->parent;
+    const double* g = morphology->g_axial;
+    double* pivot = morphology->pivot;
+
+    double base = 1.0 / dt + 1.0 / morphology->tau;
+    for (int i = 0; i < n; i++) pivot[i] = base + g[i];
+    for (int i = 0; i < n; i++) {
+        if (parent[i] >= 0) pivot[parent[i]] += g[i];
+    }
+
+    // Children have higher indices, so a pivot is final once every
+    // compartment above it has been eliminated into its parent
+    for (int i = n - 1; i >= 0; i--) {
+        morphology->factor[i] = g[i] / pivot[i];
+        if (parent[i] >= 0) pivot[parent[i]] -= g[i] * morphology->factor[i];
+    }
+    morphology->dt = dt;
+}
+
+CableState* create_cable_state(const Morphology* morphology, int num_cells) {
+    CableState* cable = calloc(1, sizeof(CableState));
+    if (!cable) {
+        fprintf(stderr, "Failed to allocate cable state\n");
+        return NULL;
+    }
+    cable->morphology = morphology;
+    cable->num_cells = num_cells;
+    cable->stride = (num_cells + CABLE_LANES - 1) / CABLE_LANES * CABLE_LANES;
+    if (cable->stride == 0) cable->stride = CABLE_LANES;
+
+    size_t bytes =
+        (size_t)morphology->num_compartments * cable->stride * sizeof(double);
+    cable->v = aligned_alloc(CABLE_ALIGN, bytes);
+    cable->inject = aligned_alloc(CABLE_ALIGN, bytes);
+    cable->rhs = aligned_alloc(CABLE_ALIGN, bytes);
+    if (!cable->v || !cable->inject || !cable->rhs) {
+        fprintf(stderr, "Failed to allocate cable state\n");
+        destroy_cable_state(cable);
+        return NULL;
+    }
+    size_t count = (size_t)morphology->num_compartments * cable->stride;
+    for (size_t k = 0; k < count; k++) cable->v[k] = morphology->e_leak;
+    memset(cable->inject, 0, bytes);
+    memset(cable->rhs, 0, bytes);
+    return cable;
+}
+
+void destroy_cable_state(CableState* cable) {
+    if (cable) {
+        free(cable->v);
+        free(cable->inject);
+        free(cable->rhs);
+        free(cable);
+    }
+}
+
+void cable_solve(CableState* cable, int begin, int end,
+                 const double* v_soma, double* soma_current) {
+    const Morphology* m = cable->morphology;
+    const int n = m->num_compartments;
+    const size_t stride = cable->stride;
+    const double inv_dt = 1.0 / m->dt;
+    const double leak = m->e_leak / m->tau;
+
+    // Right-hand side; the soma enters as a fixed neighbour of the roots
+    for (int i = 0; i < n; i++) {
+        const double* restrict v = cable->v + i * stride;
+        double* restrict in = cable->inject + i * stride;
+        double* restrict rhs = cable->rhs + i * stride;
+        double g_soma = m->parent[i] < 0 ? m->g_axial[i] : 0.0;
+#pragma omp simd
+        for (int c = begin; c < end; c++) {
+            rhs[c] = v[c] * inv_dt + leak + in[c] + g_soma * v_soma[c];
+            in[c] = 0.0;
+        }
+    }
+
+    // Eliminate every compartment into its parent, leaves first
+    for (int i = n - 1; i >= 0; i--) {
+        int p = m->parent[i];
+        if (p < 0) continue;
+        const double f = m->factor[i];
+        const double* restrict child = cable->rhs + i * stride;
+        double* restrict rhs = cable->rhs + p * stride;
+#pragma omp simd
+        for (int c = begin; c < end; c++) rhs[c] += f * child[c];
+    }
+
+    // Back-substitute from the roots outwards
+    for (int i = 0; i < n; i++) {
+        int p = m->parent[i];
+        const double inv_pivot = 1.0 / m->pivot[i];
+        const double* restrict rhs = cable->rhs + i * stride;
+        double* restrict v = cable->v + i * stride;
+        if (p < 0) {
+#pragma omp simd
+            for (int c = begin; c < end; c++) v[c] = rhs[c] * inv_pivot;
+        } else {
+            const double g = m->g_axial[i];
+            const double* restrict vp = cable->v + p * stride;
+#pragma omp simd
+            for (int c = begin; c < end; c++) {
+                v[c] = (rhs[c] + g * vp[c]) * inv_pivot;
+            }
+        }
+    }
+
+    // Axial current out of the roots, scaled to the soma's capacitance
+    for (int i = 0; i < n; i++) {
+        if (m->parent[i] >= 0) continue;
+        const double g = m->g_axial[i] * m->soma_ratio;
+        const double* restrict v = cable->v + i * stride;
+#pragma omp simd
+        for (int c = begin; c < end; c++) {
+            soma_current[c] += g * (v[c] - v_soma[c]);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef NEURAL_CABLE_H
+#define NEURAL_CABLE_H
+
+#include <stddef.h>
+
+// Multi-compartment dendritic trees solved with the Hines algorithm.
+//
+// A morphology lists compartments in Hines order: every compartment's
+// parent comes before it, and compartments with parent -1 attach to the
+// soma. Each compartment obeys
+//
+//   dV/dt = (e_leak - V) / tau + sum over neighbours g (V_n - V) + I
+//
+// with one axial rate g per edge to the parent. Backward Euler gives a
+// tree-shaped tridiagonal system; its elimination factors depend only on
+// the morphology and dt, so they are computed once and the per-step solve
+// is a forward and a backward sweep over the right-hand side.
+//
+// All cells of a CableState share one morphology and are stored
+// compartment-major with cells as the fastest index, so every sweep step
+// is a SIMD loop over cells and streams through memory.
+
+// Cells are padded to a multiple of this so rows stay aligned
+#define CABLE_LANES 8
+#define CABLE_ALIGN 64
+
+typedef struct {
+    int num_compartments;
+    int* parent;     // Parent compartment, -1 for the soma
+    double* g_axial; // Rate to the parent (1/ms)
+    double tau;      // Leak time constant (ms)
+    double e_leak;   // Leak reversal (mV)
+    double soma_ratio;  // Compartment over soma capacitance
+
+    // Elimination factors for the step dt
+    double dt;
+    double* pivot;   // Diagonal after elimination
+    double* factor;  // g_axial / pivot, the weight of a child in its parent
+} Morphology;
+
+// num_branches unbranched dendrites of compartments_per_branch each,
+// all leaving the soma
+Morphology* create_branched_morphology(int num_branches,
+                                       int compartments_per_branch,
+                                       double g_axial, double tau,
+                                       double e_leak, double soma_ratio);
+// Tree from a parent list in Hines order, with one axial rate per
+// compartment; NULL if a parent does not precede its child
+Morphology* create_morphology(const int* parent, const double* g_axial,
+                              int num_compartments, double tau,
+                              double e_leak, double soma_ratio);
+void destroy_morphology(Morphology* morphology);
+
+// Computes the elimination factors for time step dt
+void morphology_prepare(Morphology* morphology, double dt);
+
+typedef struct {
+    const Morphology* morphology;
+    int num_cells;
+    int stride;        // num_cells rounded up to CABLE_LANES
+    double* v;         // Compartment potentials, [compartment * stride + cell]
+    double* inject;    // Input current of the step, cleared by the solve
+    double* rhs;       // Solver scratch, same layout
+} CableState;
+
+// Cells start at the leak reversal
+CableState* create_cable_state(const Morphology* morphology, int num_cells);
+void destroy_cable_state(CableState* cable);
+
+// Advances cells [begin, end) by one step of the morphology's dt with the
+// somata held at v_soma (by cell) and adds the axial current the trees
+// feed into each soma, in soma units, to soma_current
+void cable_solve(CableState* cable, int begin, int end,
+                 const double* v_soma, double* soma_current);
+
+static inline double* cable_voltage(const CableState* cable, int compartment,
+                                    int cell) {
+    return &cable->v[(size_t)compartment * cable->stride + cell];
+}
+
+static inline double* cable_inject(const CableState* cable, int compartment,
+                                   int cell) {
+    return &cable->inject[(size_t)compartment * cable->stride + cell];
+}
+
+#endif
@@ -0,0 +1,355 @@
+#include "connectivity.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+Connectivity* create_connectivity(const bool* matrix, int num_neurons,
+                                  double max_initial_weight, RandomState* rng) {
+    Connectivity* conn = (Connectivity*)calloc(1, sizeof(Connectivity));
+    if (!conn) return NULL;
+
+    conn->num_neurons = num_neurons;
+    conn->row_ptr = (int*)malloc((num_neurons + 1) * sizeof(int));
+    if (!conn->row_ptr) {
+        destroy_connectivity(conn);
+        return NULL;
+    }
+    conn->row_end = conn->row_ptr + 1;
+
+    // Count synapses per row
+    conn->row_ptr[0] = 0;
+    for (int i = 0; i < num_neurons; i++) {
+        int count = 0;
+        for (int j = 0; j < num_neurons; j++) {
+            if (matrix[i * num_neurons + j]) count++;
+        }
+        conn->row_ptr[i + 1] = conn->row_ptr[i] + count;
+    }
+    conn->num_synapses = conn->row_ptr[num_neurons];
+
+    conn->targets = (int*)malloc((conn->num_synapses + 1) * sizeof(int));
+    conn->weights = (double*)malloc((conn->num_synapses + 1) * sizeof(double));
+    if (!conn->targets || !conn->weights) {
+        destroy_connectivity(conn);
+        return NULL;
+    }
+
+    // Fill rows
+    for (int i = 0; i < num_neurons; i++) {
+        int k = conn->row_ptr[i];
+        for (int j = 0; j < num_neurons; j++) {
+            if (matrix[i * num_neurons + j]) {
+                conn->targets[k] = j;
+                conn->weights[k] = max_initial_weight * random_uniform(rng);
+                k++;
+            }
+        }
+    }
+
+    if (build_transposed_index(conn) != 0) {
+        destroy_connectivity(conn);
+        return NULL;
+    }
+
+    return conn;
+}
+
+// Ends of packed rows or columns share the offsets array
+static void free_ends(int* end, int* ptr) {
+    if (end && end != ptr + 1) free(end);
+}
+
+void destroy_connectivity(Connectivity* conn) {
+    if (conn && conn->mapping) {
+        munmap(conn->mapping, conn->mapping_size);
+        free(conn);
+    } else if (conn) {
+        free_ends(conn->row_end, conn->row_ptr);
+        free(conn->row_ptr);
+        free(conn->targets);
+        free(conn->weights);
+        free_ends(conn->col_end, conn->col_ptr);
+        free(conn->col_ptr);
+        free(conn->col_sources);
+        free(conn->col_synapse);
+        free(conn->synapse_col);
+        free(conn);
+    }
+}
+
+int build_transposed_index(Connectivity* conn) {
+    int n = conn->num_neurons;
+
+    free_ends(conn->col_end, conn->col_ptr);
+    free(conn->col_ptr);
+    free(conn->col_sources);
+    free(conn->col_synapse);
+    free(conn->synapse_col);
+    conn->synapse_col = NULL;
+
+    conn->col_ptr = (int*)calloc(n + 1, sizeof(int));
+    conn->col_end = conn->col_ptr ? conn->col_ptr + 1 : NULL;
+    conn->col_sources = (int*)malloc((conn->num_synapses + 1) * sizeof(int));
+    conn->col_synapse = (int*)malloc((conn->num_synapses + 1) * sizeof(int));
+    int* fill = (int*)malloc((n + 1) * sizeof(int));
+    if (!conn->col_ptr || !conn->col_sources || !conn->col_synapse || !fill) {
+        fprintf(stderr, "Failed to allocate transposed connectivity index\n");
+        free(fill);
+        return -1;
+    }
+
+    // Count incoming synapses per target
+    for (int i = 0; i < n; i++) {
+        for (int k = conn_row_begin(conn, i); k < conn_row_end(conn, i); k++) {
+            conn->col_ptr[conn->targets[k] + 1]++;
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        conn->col_ptr[j + 1] += conn->col_ptr[j];
+        fill[j] = conn->col_ptr[j];
+    }
+
+    // Scatter rows into columns; sources end up sorted within each column
+    for (int i = 0; i < n; i++) {
+        for (int k = conn_row_begin(conn, i); k < conn_row_end(conn, i); k++) {
+            int slot = fill[conn->targets[k]]++;
+            conn->col_sources[slot] = i;
+            conn->col_synapse[slot] = k;
+        }
+    }
+
+    free(fill);
+    return 0;
+}
+
+Connectivity* permute_connectivity(const Connectivity* conn,
+                                   const int* new_id) {
+    int n = conn->num_neurons;
+    Connectivity* out = (Connectivity*)calloc(1, sizeof(Connectivity));
+    int* old_id = (int*)malloc((n + 1) * sizeof(int));
+    int* fill = (int*)malloc((n + 1) * sizeof(int));
+    if (out) {
+        out->num_neurons = n;
+        out->num_synapses = conn->num_synapses;
+        out->row_ptr = (int*)malloc((n + 1) * sizeof(int));
+        out->row_end = out->row_ptr ? out->row_ptr + 1 : NULL;
+        out->targets = (int*)malloc((conn->num_synapses + 1) * sizeof(int));
+        out->weights =
+            (double*)malloc((conn->num_synapses + 1) * sizeof(double));
+    }
+    if (!out || !old_id || !fill || !out->row_ptr || !out->targets ||
+        !out->weights) {
+        fprintf(stderr, "Failed to allocate permuted connectivity\n");
+        destroy_connectivity(out);
+        free(old_id);
+        free(fill);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++) old_id[new_id[i]] = i;
+    out->row_ptr[0] = 0;
+    for (int r = 0; r < n; r++) {
+        int i = old_id[r];
+        out->row_ptr[r + 1] =
+            out->row_ptr[r] + conn_row_end(conn, i) - conn_row_begin(conn, i);
+        fill[r] = out->row_ptr[r];
+    }
+
+    // Walking targets in their new order through the transposed index
+    // appends to every row in increasing target order
+    for (int t = 0; t < n; t++) {
+        int old_target = old_id[t];
+        for (int k = conn_col_begin(conn, old_target);
+             k < conn_col_end(conn, old_target); k++) {
+            int slot = fill[new_id[conn->col_sources[k]]]++;
+            out->targets[slot] = t;
+            out->weights[slot] = conn->weights[conn->col_synapse[k]];
+        }
+    }
+
+    free(old_id);
+    free(fill);
+    if (build_transposed_index(out) != 0) {
+        destroy_connectivity(out);
+        return NULL;
+    }
+    return out;
+}
+
+Connectivity* restrict_connectivity(const Connectivity* conn, int begin,
+                                    int end, int* slot_map) {
+    int n = conn->num_neurons;
+    int count = 0;
+    for (int t = begin; t < end; t++) {
+        count += conn_col_end(conn, t) - conn_col_begin(conn, t);
+    }
+    Connectivity* out = (Connectivity*)calloc(1, sizeof(Connectivity));
+    int* fill = (int*)calloc(n + 1, sizeof(int));
+    if (out) {
+        out->num_neurons = n;
+        out->row_ptr = (int*)malloc((n + 1) * sizeof(int));
+        out->row_end = out->row_ptr ? out->row_ptr + 1 : NULL;
+        out->targets = (int*)malloc((count + 1) * sizeof(int));
+        out->weights = (double*)malloc((count + 1) * sizeof(double));
+    }
+    if (!out || !fill || !out->row_ptr || !out->targets || !out->weights) {
+        fprintf(stderr, "Failed to allocate restricted connectivity\n");
+        destroy_connectivity(out);
+        free(fill);
+        return NULL;
+    }
+    if (slot_map) {
+        for (int k = 0; k < conn_num_slots(conn); k++) slot_map[k] = -1;
+    }
+
+    // Rows sized by the kept columns, then filled in target order
+    for (int t = begin; t < end; t++) {
+        for (int e = conn_col_begin(conn, t); e < conn_col_end(conn, t); e++) {
+            fill[conn->col_sources[e] + 1]++;
+        }
+    }
+    out->row_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        out->row_ptr[i + 1] = out->row_ptr[i] + fill[i + 1];
+        fill[i] = out->row_ptr[i];
+    }
+    out->num_synapses = count;
+    for (int t = begin; t < end; t++) {
+        for (int e = conn_col_begin(conn, t); e < conn_col_end(conn, t); e++) {
+            int k = conn->col_synapse[e];
+            int slot = fill[conn->col_sources[e]]++;
+            out->targets[slot] = t;
+            out->weights[slot] = conn->weights[k];
+            if (slot_map) slot_map[k] = slot;
+        }
+    }
+
+    free(fill);
+    if (build_transposed_index(out) != 0) {
+        destroy_connectivity(out);
+        return NULL;
+    }
+    return out;
+}
+
+Connectivity* connectivity_with_slack(const Connectivity* conn, double slack,
+                                      int* slot_map) {
+    int n = conn->num_neurons;
+    Connectivity* out = (Connectivity*)calloc(1, sizeof(Connectivity));
+    int* fill = (int*)malloc((n + 1) * sizeof(int));
+    if (out) {
+        out->num_neurons = n;
+        out->num_synapses = conn->num_synapses;
+        out->row_ptr = (int*)malloc((n + 1) * sizeof(int));
+        out->row_end = (int*)malloc((n + 1) * sizeof(int));
+        out->col_ptr = (int*)malloc((n + 1) * sizeof(int));
+        out->col_end = (int*)malloc((n + 1) * sizeof(int));
+    }
+    if (!out || !fill || !out->row_ptr || !out->row_end || !out->col_ptr ||
+        !out->col_end) {
+        fprintf(stderr, "Failed to allocate connectivity with slack\n");
+        destroy_connectivity(out);
+        free(fill);
+        return NULL;
+    }
+
+    out->row_ptr[0] = 0;
+    out->col_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        int row = conn_row_end(conn, i) - conn_row_begin(conn, i);
+        int col = conn_col_end(conn, i) - conn_col_begin(conn, i);
+        out->row_ptr[i + 1] =
+            out->row_ptr[i] + row + conn_slack_slots(row, slack);
+        out->col_ptr[i + 1] =
+            out->col_ptr[i] + col + conn_slack_slots(col, slack);
+        out->row_end[i] = out->row_ptr[i] + row;
+        out->col_end[i] = out->col_ptr[i] + col;
+    }
+    int slots = out->row_ptr[n];
+    int entries = out->col_ptr[n];
+    out->targets = (int*)calloc(slots + 1, sizeof(int));
+    out->weights = (double*)calloc(slots + 1, sizeof(double));
+    out->synapse_col = (int*)calloc(slots + 1, sizeof(int));
+    out->col_sources = (int*)calloc(entries + 1, sizeof(int));
+    out->col_synapse = (int*)calloc(entries + 1, sizeof(int));
+    if (!out->targets || !out->weights || !out->synapse_col ||
+        !out->col_sources || !out->col_synapse) {
+        fprintf(stderr, "Failed to allocate connectivity with slack\n");
+        destroy_connectivity(out);
+        free(fill);
+        return NULL;
+    }
+    if (slot_map) {
+        for (int k = 0; k < conn_num_slots(conn); k++) slot_map[k] = -1;
+    }
+
+    // Rows filled in target order through the transposed index, then
+    // columns in source order through the rows
+    for (int i = 0; i < n; i++) fill[i] = out->row_ptr[i];
+    for (int t = 0; t < n; t++) {
+        for (int e = conn_col_begin(conn, t); e < conn_col_end(conn, t); e++) {
+            int k = conn->col_synapse[e];
+            int slot = fill[conn->col_sources[e]]++;
+            out->targets[slot] = t;
+            out->weights[slot] = conn->weights[k];
+            if (slot_map) slot_map[k] = slot;
+        }
+    }
+    for (int t = 0; t < n; t++) fill[t] = out->col_ptr[t];
+    for (int i = 0; i < n; i++) {
+        for (int k = conn_row_begin(out, i); k < conn_row_end(out, i); k++) {
+            int e = fill[out->targets[k]]++;
+            out->col_sources[e] = i;
+            out->col_synapse[e] = k;
+            out->synapse_col[k] = e;
+        }
+    }
+
+    free(fill);
+    return out;
+}
+
+int connectivity_add_synapse(Connectivity* conn, int source, int target,
+                             double weight) {
+    int k = conn->row_end[source];
+    int e = conn->col_end[target];
+    if (!conn->synapse_col || k == conn->row_ptr[source + 1] ||
+        e == conn->col_ptr[target + 1]) {
+        return -1;
+    }
+    conn->targets[k] = target;
+    conn->weights[k] = weight;
+    conn->synapse_col[k] = e;
+    conn->col_sources[e] = source;
+    conn->col_synapse[e] = k;
+    conn->row_end[source]++;
+    conn->col_end[target]++;
+    conn->num_synapses++;
+    return k;
+}
+
+int connectivity_remove_synapse(Connectivity* conn, int source, int k) {
+    // The column's last entry fills the synapse's entry
+    int target = conn->targets[k];
+    int e = conn->synapse_col[k];
+    int last_e = --conn->col_end[target];
+    conn->col_sources[e] = conn->col_sources[last_e];
+    conn->col_synapse[e] = conn->col_synapse[last_e];
+    conn->synapse_col[conn->col_synapse[e]] = e;
+
+    // And the row's last synapse fills its slot
+    int last = --conn->row_end[source];
+    conn->num_synapses--;
+    int moved = -1;
+    if (last != k) {
+        conn->targets[k] = conn->targets[last];
+        conn->weights[k] = conn->weights[last];
+        conn->synapse_col[k] = conn->synapse_col[last];
+        conn->col_synapse[conn->synapse_col[k]] = k;
+        moved = last;
+    }
+    conn->targets[last] = 0;
+    conn->weights[last] = 0.0;
+    return moved;
+}
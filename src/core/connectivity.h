@@ -0,0 +1,102 @@
+#ifndef NEURAL_CONNECTIVITY_H
+#define NEURAL_CONNECTIVITY_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utils/random.h"
+
+// Sparse connectivity in CSR form. Row i holds the outgoing synapses of
+// neuron i; the transposed index lists the same synapses by target so that
+// incoming synapses of a neuron can be visited without scanning every row.
+//
+// Rows and columns may have free slots at their ends, so that synapses can
+// be added and removed at run time (structural plasticity): row i owns
+// slots [row_ptr[i], row_ptr[i + 1]) and its synapses fill the first
+// row_end[i] - row_ptr[i] of them. Packed connectivity has no free slots
+// and row_end == row_ptr + 1.
+typedef struct Connectivity {
+    int num_neurons;
+    int num_synapses;  // Live synapses, excluding free slots
+
+    // Outgoing (row) storage
+    int* row_ptr;     // num_neurons + 1 offsets
+    int* row_end;     // End of the synapses of each row
+    int* targets;     // Postsynaptic neuron of each synapse
+    double* weights;  // Synaptic weight of each synapse
+
+    // Incoming (column) index
+    int* col_ptr;      // num_neurons + 1 offsets
+    int* col_end;      // End of the entries of each column
+    int* col_sources;  // Presynaptic neuron of each incoming entry
+    int* col_synapse;  // Index of the entry in targets/weights
+    int* synapse_col;  // Entry of each synapse in the column index, NULL
+                       // when packed
+
+    // Set when the arrays live in a mapped connectome file (connectome.h)
+    void* mapping;
+    size_t mapping_size;
+} Connectivity;
+
+Connectivity* create_connectivity(const bool* matrix, int num_neurons,
+                                  double max_initial_weight, RandomState* rng);
+void destroy_connectivity(Connectivity* conn);
+int build_transposed_index(Connectivity* conn);
+
+// Copy with neuron i renamed to new_id[i], targets increasing within each
+// row. Needs the transposed index of conn; the copy's is built as well.
+Connectivity* permute_connectivity(const Connectivity* conn,
+                                   const int* new_id);
+
+// Packed copy holding only the synapses onto targets in [begin, end),
+// targets increasing within each row. Needs the transposed index of conn.
+// slot_map, when not NULL, receives the copy's slot of every slot of conn
+// (conn_num_slots() entries), -1 for synapses left out and free slots.
+Connectivity* restrict_connectivity(const Connectivity* conn, int begin,
+                                    int end, int* slot_map);
+
+// Free slots a row or column of n synapses gets in a copy with slack
+#define CONN_MIN_SLACK 2
+static inline int conn_slack_slots(int n, double slack) {
+    return (int)ceil(n * slack) + CONN_MIN_SLACK;
+}
+
+// Copy whose rows and columns have room to grow, targets increasing
+// within each row. slot_map, when not NULL, receives the copy's slot of
+// every slot of conn (conn_num_slots() entries), -1 for free slots.
+Connectivity* connectivity_with_slack(const Connectivity* conn, double slack,
+                                      int* slot_map);
+
+// Adds a synapse to a connectivity with slack. Returns its slot, or -1 if
+// the source's row or the target's column is full.
+int connectivity_add_synapse(Connectivity* conn, int source, int target,
+                             double weight);
+
+// Removes synapse k of source's row; the row's last synapse moves into its
+// slot. Returns the slot the moved synapse came from, or -1 if k was the
+// last one.
+int connectivity_remove_synapse(Connectivity* conn, int source, int k);
+
+static inline int conn_row_begin(const Connectivity* conn, int neuron) {
+    return conn->row_ptr[neuron];
+}
+
+static inline int conn_row_end(const Connectivity* conn, int neuron) {
+    return conn->row_end[neuron];
+}
+
+static inline int conn_col_begin(const Connectivity* conn, int neuron) {
+    return conn->col_ptr[neuron];
+}
+
+static inline int conn_col_end(const Connectivity* conn, int neuron) {
+    return conn->col_end[neuron];
+}
+
+// Slots of targets/weights, free ones included
+static inline int conn_num_slots(const Connectivity* conn) {
+    return conn->row_ptr[conn->num_neurons];
+}
+
+#endif
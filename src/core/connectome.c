@@ -0,0 +1,171 @@
+#include "connectome.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Arrays follow the header in this order, each on a cache line boundary
+enum {
+    SECTION_ROW_PTR = 0,
+    SECTION_TARGETS,
+    SECTION_WEIGHTS,
+    SECTION_COL_PTR,
+    SECTION_COL_SOURCES,
+    SECTION_COL_SYNAPSE,
+    SECTION_EXTERNAL_ID,
+    NUM_SECTIONS
+};
+
+#define SECTION_ALIGN 64
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    ConnectomeKey key;
+    int32_t num_neurons;
+    int32_t num_synapses;
+    RandomState rng;
+    uint64_t offset[NUM_SECTIONS];
+    uint64_t size[NUM_SECTIONS];  // Bytes, 0 for an absent section
+} ConnectomeHeader;
+
+static bool same_key(const ConnectomeKey* a, const ConnectomeKey* b) {
+    return a->num_pyramidal == b->num_pyramidal &&
+           a->num_inhibitory == b->num_inhibitory && a->seed == b->seed &&
+           a->reorder == b->reorder &&
+           a->connection_rate == b->connection_rate;
+}
+
+int write_connectome(const char* path, const ConnectomeKey* key,
+                     const Connectivity* conn, const int* external_id,
+                     const RandomState* rng) {
+    size_t n = (size_t)conn->num_neurons;
+    size_t s = (size_t)conn->num_synapses;
+    const void* data[NUM_SECTIONS] = {
+        conn->row_ptr, conn->targets,     conn->weights,    conn->col_ptr,
+        conn->col_sources, conn->col_synapse, external_id};
+    ConnectomeHeader header = {0};
+    header.magic = CONNECTOME_MAGIC;
+    header.version = CONNECTOME_VERSION;
+    header.key = *key;
+    header.num_neurons = conn->num_neurons;
+    header.num_synapses = conn->num_synapses;
+    header.rng = *rng;
+    header.size[SECTION_ROW_PTR] = (n + 1) * sizeof(int);
+    header.size[SECTION_TARGETS] = s * sizeof(int);
+    header.size[SECTION_WEIGHTS] = s * sizeof(double);
+    header.size[SECTION_COL_PTR] = (n + 1) * sizeof(int);
+    header.size[SECTION_COL_SOURCES] = s * sizeof(int);
+    header.size[SECTION_COL_SYNAPSE] = s * sizeof(int);
+    header.size[SECTION_EXTERNAL_ID] = external_id ? n * sizeof(int) : 0;
+    uint64_t offset = sizeof(header);
+    for (int k = 0; k < NUM_SECTIONS; k++) {
+        offset = (offset + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN;
+        header.offset[k] = offset;
+        offset += header.size[k];
+    }
+
+    // Written under a temporary name and renamed, so a process mapping
+    // the file never sees it half written
+    char temp[4096];
+    snprintf(temp, sizeof(temp), "%s.%d.tmp", path, (int)getpid());
+    FILE* file = fopen(temp, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to create connectome file: %s\n", temp);
+        return -1;
+    }
+    static const char zeros[SECTION_ALIGN] = {0};
+    int status = fwrite(&header, sizeof(header), 1, file) == 1 ? 0 : -1;
+    long position = sizeof(header);
+    for (int k = 0; k < NUM_SECTIONS && status == 0; k++) {
+        size_t gap = header.offset[k] - position;
+        if (fwrite(zeros, 1, gap, file) != gap ||
+            fwrite(data[k], 1, header.size[k], file) != header.size[k]) {
+            status = -1;
+        }
+        position = header.offset[k] + header.size[k];
+    }
+    if (fclose(file) != 0) status = -1;
+    if (status == 0 && rename(temp, path) != 0) status = -1;
+    if (status != 0) {
+        fprintf(stderr, "Failed to write connectome file: %s\n", path);
+        remove(temp);
+    }
+    return status;
+}
+
+Connectivity* map_connectome(const char* path, const ConnectomeKey* key,
+                             int** external_id, RandomState* rng) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open connectome file: %s\n", path);
+        return NULL;
+    }
+    struct stat st;
+    ConnectomeHeader header;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(header) ||
+        pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        header.magic != CONNECTOME_MAGIC ||
+        header.version != CONNECTOME_VERSION) {
+        fprintf(stderr, "Not a connectome file: %s\n", path);
+        close(fd);
+        return NULL;
+    }
+    if (!same_key(&header.key, key)) {
+        fprintf(stderr,
+                "Connectome file %s was built for a different network\n",
+                path);
+        close(fd);
+        return NULL;
+    }
+    for (int k = 0; k < NUM_SECTIONS; k++) {
+        if (header.offset[k] + header.size[k] > (uint64_t)st.st_size) {
+            fprintf(stderr, "Truncated connectome file: %s\n", path);
+            close(fd);
+            return NULL;
+        }
+    }
+
+    // Writable but private: plasticity may change weights in its own copy
+    void* mapping = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Failed to map connectome file: %s\n", path);
+        return NULL;
+    }
+
+    Connectivity* conn = (Connectivity*)calloc(1, sizeof(Connectivity));
+    size_t order_size = header.size[SECTION_EXTERNAL_ID];
+    int* order = order_size ? (int*)malloc(order_size) : NULL;
+    if (!conn || (order_size && !order)) {
+        fprintf(stderr, "Failed to allocate connectome\n");
+        free(conn);
+        free(order);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+    char* base = (char*)mapping;
+    conn->num_neurons = header.num_neurons;
+    conn->num_synapses = header.num_synapses;
+    conn->row_ptr = (int*)(base + header.offset[SECTION_ROW_PTR]);
+    conn->row_end = conn->row_ptr + 1;
+    conn->targets = (int*)(base + header.offset[SECTION_TARGETS]);
+    conn->weights = (double*)(base + header.offset[SECTION_WEIGHTS]);
+    conn->col_ptr = (int*)(base + header.offset[SECTION_COL_PTR]);
+    conn->col_end = conn->col_ptr + 1;
+    conn->col_sources = (int*)(base + header.offset[SECTION_COL_SOURCES]);
+    conn->col_synapse = (int*)(base + header.offset[SECTION_COL_SYNAPSE]);
+    conn->mapping = mapping;
+    conn->mapping_size = st.st_size;
+    if (order) {
+        memcpy(order, base + header.offset[SECTION_EXTERNAL_ID], order_size);
+    }
+    *external_id = order;
+    *rng = header.rng;
+    return conn;
+}
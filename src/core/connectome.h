@@ -0,0 +1,42 @@
+#ifndef NEURAL_CONNECTOME_H
+#define NEURAL_CONNECTOME_H
+
+#include <stdint.h>
+
+#include "connectivity.h"
+#include "utils/random.h"
+
+// Connectome files hold a network's connectivity in storage order, built
+// once and then mapped by every process that simulates the network. The
+// mapping is private: pages stay shared through the page cache until a
+// process writes a weight (STDP), which copies just that page.
+
+#define CONNECTOME_MAGIC 0x4e53434fu  // "OCSN"
+#define CONNECTOME_VERSION 1
+
+// What a connectome is built from; a file only serves networks with the
+// same key
+typedef struct {
+    int32_t num_pyramidal;
+    int32_t num_inhibitory;
+    uint32_t seed;
+    int32_t reorder;
+    double connection_rate;
+} ConnectomeKey;
+
+// Writes conn, which must be packed, to path. external_id (storage id ->
+// creation-order id) is NULL for networks in creation order; rng is the
+// generator state after the build, which the rest of the network creation
+// continues from.
+int write_connectome(const char* path, const ConnectomeKey* key,
+                     const Connectivity* conn, const int* external_id,
+                     const RandomState* rng);
+
+// Maps the connectome at path, which must have been written for key. The
+// arrays of the returned connectivity point into the mapping, which
+// destroy_connectivity() unmaps. *external_id is a malloc'ed copy, NULL
+// in creation order.
+Connectivity* map_connectome(const char* path, const ConnectomeKey* key,
+                             int** external_id, RandomState* rng);
+
+#endif
@@ -15,7 +15,14 @@ Dendrite* create_dendrite(int num_synapses) {
     dendrite->coupling_strength = 1.0;
 
     dendrite->synapses = (Synapse*)malloc(num_synapses * sizeof(Synapse));
+    dendrite->active = (int*)malloc(num_synapses * sizeof(int));
     dendrite->num_synapses = num_synapses;
+    dendrite->num_active = 0;
+    dendrite->drive = 0.0;
+    if (!dendrite->synapses || !dendrite->active) {
+        destroy_dendrite(dendrite);
+        return NULL;
+    }
 
     for (int i = 0; i < num_synapses; i++) {
         Synapse* new_synapse = create_synapse(-1, -1);
@@ -23,16 +30,32 @@ Dendrite* create_dendrite(int num_synapses) {
             dendrite->synapses[i] = *new_synapse;
             free(new_synapse);
         }
+        // Silent until the first spike arrives
+        dendrite->synapses[i].is_active = false;
+        dendrite->synapses[i].conductance = 0.0;
     }
 
     return dendrite;
 }
 
 void update_dendrite(Dendrite* dendrite, double dt) {
-    // Update synapses
-    for (int i = 0; i < dendrite->num_synapses; i++) {
-        update_synapse(&dendrite->synapses[i], dt);
+    // Decay the active synapses and drop those that fell silent; the sum
+    // is rebuilt on the way so rounding cannot accumulate
+    double drive = 0.0;
+    int k = 0;
+    while (k < dendrite->num_active) {
+        Synapse* synapse = &dendrite->synapses[dendrite->active[k]];
+        update_synapse(synapse, dt);
+        if (synapse->conductance < SYNAPSE_ACTIVE_THRESHOLD) {
+            synapse->conductance = 0.0;
+            synapse->is_active = false;
+            dendrite->active[k] = dendrite->active[--dendrite->num_active];
+        } else {
+            drive += synapse->weight * synapse->conductance;
+            k++;
+        }
     }
+    dendrite->drive = drive;
 
     // Update calcium concentration
     dendrite->calcium_concentration *= (1.0 - dt / 20.0);  // τ_Ca = 20ms
@@ -53,17 +76,34 @@ void destroy_dendrite(Dendrite* dendrite) {
         if (dendrite->synapses) {
             free(dendrite->synapses);
         }
+        free(dendrite->active);
         free(dendrite);
     }
 }
 
 double compute_local_potential(Dendrite* dendrite) {
-    double potential = 0.0;
+    return dendrite->drive * dendrite->coupling_strength;
+}
+
+void dendrite_receive_spike(Dendrite* dendrite, int synapse,
+                            double conductance) {
+    Synapse* target = &dendrite->synapses[synapse];
+    if (!target->is_active) {
+        target->is_active = true;
+        dendrite->active[dendrite->num_active++] = synapse;
+    }
+    target->conductance += conductance;
+    dendrite->drive += target->weight * conductance;
+}
+
+void dendrite_rebuild_active(Dendrite* dendrite) {
+    dendrite->num_active = 0;
+    dendrite->drive = 0.0;
     for (int i = 0; i < dendrite->num_synapses; i++) {
-        if (dendrite->synapses[i].is_active) {
-            potential += dendrite->synapses[i].weight *
-                         dendrite->synapses[i].conductance;
+        const Synapse* synapse = &dendrite->synapses[i];
+        if (synapse->is_active) {
+            dendrite->active[dendrite->num_active++] = i;
+            dendrite->drive += synapse->weight * synapse->conductance;
         }
     }
-    return potential * dendrite->coupling_strength;
-}
\ No newline at end of file
+}
@@ -6,6 +6,16 @@
 
 #define MAX_SYNAPSES_PER_DENDRITE 100
 
+// Conductance below which a synapse drops out of the active set; a spike
+// adds about 1, so a silent synapse leaves after ~7 decay time constants
+#define SYNAPSE_ACTIVE_THRESHOLD 1e-3
+
+// Only the few synapses that received a spike recently carry conductance.
+// Those are kept in a compact index list, together with the running sum of
+// weight * conductance over them, so updates cost O(active synapses) and
+// reading the potential O(1). A synapse's is_active flag tells whether it
+// is in the list; weights and conductances of active synapses must not be
+// changed behind the dendrite's back.
 typedef struct Dendrite {
     double local_potential;
     double calcium_concentration;
@@ -13,6 +23,10 @@ typedef struct Dendrite {
     Synapse* synapses;
     int num_synapses;
     double coupling_strength;
+
+    int* active;        // Indices of active synapses, unordered
+    int num_active;
+    double drive;       // Sum of weight * conductance over active synapses
 } Dendrite;
 
 // Function declarations
@@ -21,4 +35,10 @@ void destroy_dendrite(Dendrite* dendrite);
 void update_dendrite(Dendrite* dendrite, double dt);
 double compute_local_potential(Dendrite* dendrite);
 
+// Adds conductance to a synapse, activating it if needed
+void dendrite_receive_spike(Dendrite* dendrite, int synapse,
+                            double conductance);
+// Rebuilds the active set from the synapses' flags, e.g. after loading
+void dendrite_rebuild_active(Dendrite* dendrite);
+
 #endif
\ No newline at end of file
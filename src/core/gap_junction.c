@@ -0,0 +1,228 @@
+#include "gap_junction.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int length;
+    int row;
+} RowLength;
+
+// Longest rows first, ties by row so the order is deterministic
+static int compare_length(const void* a, const void* b) {
+    const RowLength* x = a;
+    const RowLength* y = b;
+    if (x->length != y->length) return x->length > y->length ? -1 : 1;
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+// Partner lists of every row in CSR form
+static int build_partners(GapJunctions* gap, const int* a, const int* b,
+                          int count, int** ptr_out, int** partners_out) {
+    int n = gap->num_rows;
+    int* ptr = calloc(n + 1, sizeof(int));
+    int* partners = malloc((2 * (size_t)count + 1) * sizeof(int));
+    if (!ptr || !partners) {
+        free(ptr);
+        free(partners);
+        return -1;
+    }
+    for (int k = 0; k < count; k++) {
+        ptr[a[k] + 1]++;
+        ptr[b[k] + 1]++;
+    }
+    for (int r = 0; r < n; r++) ptr[r + 1] += ptr[r];
+    int* fill = malloc((n + 1) * sizeof(int));
+    if (!fill) {
+        free(ptr);
+        free(partners);
+        return -1;
+    }
+    memcpy(fill, ptr, n * sizeof(int));
+    for (int k = 0; k < count; k++) {
+        partners[fill[a[k]]++] = b[k];
+        partners[fill[b[k]]++] = a[k];
+    }
+    free(fill);
+    *ptr_out = ptr;
+    *partners_out = partners;
+    return 0;
+}
+
+// Sorts rows by length within each window and lays the slices out
+static int build_slices(GapJunctions* gap, const int* ptr,
+                        const int* partners, double g) {
+    const int n = gap->num_rows;
+    const int lanes = GAP_SLICE_ROWS;
+    RowLength* order = malloc((n + 1) * sizeof(RowLength));
+    if (!order) return -1;
+    for (int r = 0; r < n; r++) {
+        order[r] = (RowLength){ptr[r + 1] - ptr[r], r};
+    }
+    for (int w = 0; w < n; w += GAP_SORT_WINDOW) {
+        int size = n - w < GAP_SORT_WINDOW ? n - w : GAP_SORT_WINDOW;
+        qsort(order + w, size, sizeof(RowLength), compare_length);
+    }
+
+    gap->num_slices = (n + lanes - 1) / lanes;
+    gap->slice_row = malloc(((size_t)gap->num_slices * lanes + 1) *
+                            sizeof(int));
+    gap->slice_ptr = malloc((gap->num_slices + 1) * sizeof(int));
+    if (!gap->slice_row || !gap->slice_ptr) {
+        free(order);
+        return -1;
+    }
+    gap->slice_ptr[0] = 0;
+    for (int s = 0; s < gap->num_slices; s++) {
+        int width = 0;
+        for (int l = 0; l < lanes; l++) {
+            int slot = s * lanes + l;
+            gap->slice_row[slot] = slot < n ? order[slot].row : -1;
+            if (slot < n && order[slot].length > width) {
+                width = order[slot].length;
+            }
+        }
+        gap->slice_ptr[s + 1] = gap->slice_ptr[s] + width * lanes;
+    }
+    free(order);
+
+    // Padding points at row 0 with no conductance
+    size_t entries = (size_t)gap->slice_ptr[gap->num_slices];
+    gap->col = calloc(entries + 1, sizeof(int));
+    gap->g = calloc(entries + 1, sizeof(double));
+    if (!gap->col || !gap->g) return -1;
+    for (int s = 0; s < gap->num_slices; s++) {
+        for (int l = 0; l < lanes; l++) {
+            int r = gap->slice_row[s * lanes + l];
+            if (r < 0) continue;
+            for (int k = 0; k < ptr[r + 1] - ptr[r]; k++) {
+                size_t e = (size_t)gap->slice_ptr[s] + (size_t)k * lanes + l;
+                gap->col[e] = partners[ptr[r] + k];
+                gap->g[e] = g;
+            }
+            gap->g_total[r] = g * (ptr[r + 1] - ptr[r]);
+        }
+    }
+    return 0;
+}
+
+GapJunctions* create_gap_junctions(int first_id, int num_rows, const int* a,
+                                   const int* b, int count, double g) {
+    if (num_rows < 0 || count < 0) {
+        fprintf(stderr, "Invalid gap junctions\n");
+        return NULL;
+    }
+    for (int k = 0; k < count; k++) {
+        if (a[k] < 0 || a[k] >= num_rows || b[k] < 0 || b[k] >= num_rows) {
+            fprintf(stderr, "Gap junction %d-%d outside %d neurons\n", a[k],
+                    b[k], num_rows);
+            return NULL;
+        }
+    }
+
+    GapJunctions* gap = calloc(1, sizeof(GapJunctions));
+    if (!gap) {
+        fprintf(stderr, "Failed to allocate gap junctions\n");
+        return NULL;
+    }
+    gap->first_id = first_id;
+    gap->num_rows = num_rows;
+    gap->num_junctions = count;
+    size_t rows = (size_t)num_rows + 1;
+    gap->g_total = calloc(rows, sizeof(double));
+    gap->v = calloc(rows, sizeof(double));
+    gap->current = calloc(rows, sizeof(double));
+    gap->iterate = calloc(rows, sizeof(double));
+    gap->next = calloc(rows, sizeof(double));
+
+    int* ptr = NULL;
+    int* partners = NULL;
+    if (!gap->g_total || !gap->v || !gap->current || !gap->iterate ||
+        !gap->next || build_partners(gap, a, b, count, &ptr, &partners) != 0 ||
+        build_slices(gap, ptr, partners, g) != 0) {
+        fprintf(stderr, "Failed to allocate gap junctions\n");
+        free(ptr);
+        free(partners);
+        destroy_gap_junctions(gap);
+        return NULL;
+    }
+    free(ptr);
+    free(partners);
+    return gap;
+}
+
+void destroy_gap_junctions(GapJunctions* gap) {
+    if (gap) {
+        free(gap->slice_row);
+        free(gap->slice_ptr);
+        free(gap->col);
+        free(gap->g);
+        free(gap->g_total);
+        free(gap->v);
+        free(gap->current);
+        free(gap->iterate);
+        free(gap->next);
+        free(gap);
+    }
+}
+
+// One slice: every entry k is a gather of GAP_SLICE_ROWS partners, one
+// per lane
+static void multiply_slice(const GapJunctions* gap, int s, const double* x,
+                           double* y) {
+    double sum[GAP_SLICE_ROWS] = {0.0};
+    const int begin = gap->slice_ptr[s];
+    const int width = (gap->slice_ptr[s + 1] - begin) / GAP_SLICE_ROWS;
+    for (int k = 0; k < width; k++) {
+        const int* restrict col = gap->col + begin + k * GAP_SLICE_ROWS;
+        const double* restrict g = gap->g + begin + k * GAP_SLICE_ROWS;
+#pragma omp simd
+        for (int l = 0; l < GAP_SLICE_ROWS; l++) sum[l] += g[l] * x[col[l]];
+    }
+    const int* row = gap->slice_row + s * GAP_SLICE_ROWS;
+    for (int l = 0; l < GAP_SLICE_ROWS; l++) {
+        if (row[l] >= 0) y[row[l]] = sum[l];
+    }
+}
+
+void gap_junction_multiply(const GapJunctions* gap, const double* x,
+                           double* y) {
+    // Every row is summed by one thread in a fixed order, so results do
+    // not depend on the number of threads
+#pragma omp parallel for schedule(static) \
+    if (gap->num_slices >= GAP_PARALLEL_SLICES)
+    for (int s = 0; s < gap->num_slices; s++) {
+        multiply_slice(gap, s, x, y);
+    }
+}
+
+void gap_junction_currents(GapJunctions* gap, double dt, int iterations) {
+    const int n = gap->num_rows;
+    const double* v = gap->v;
+    if (iterations < 1) {
+        gap_junction_multiply(gap, v, gap->current);
+        for (int r = 0; r < n; r++) {
+            gap->current[r] -= gap->g_total[r] * v[r];
+        }
+        return;
+    }
+
+    // Backward Euler of the coupling alone, (1 + dt G_i) u_i - dt sum
+    // g_ij u_j = v_i, by Jacobi sweeps from u = v; the input then moves
+    // each potential to its relaxed value over the step
+    memcpy(gap->iterate, v, n * sizeof(double));
+    for (int it = 0; it < iterations; it++) {
+        gap_junction_multiply(gap, gap->iterate, gap->next);
+        for (int r = 0; r < n; r++) {
+            gap->next[r] =
+                (v[r] + dt * gap->next[r]) / (1.0 + dt * gap->g_total[r]);
+        }
+        double* swap = gap->iterate;
+        gap->iterate = gap->next;
+        gap->next = swap;
+    }
+    for (int r = 0; r < n; r++) {
+        gap->current[r] = (gap->iterate[r] - v[r]) / dt;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef NEURAL_GAP_JUNCTION_H
+#define NEURAL_GAP_JUNCTION_H
+
+#include <stddef.h>
+
+// Electrical synapses (gap junctions) between the neurons of one id range.
+// A junction of conductance g between neurons i and j feeds
+//
+//   I_i = sum over partners j of g (V_j - V_i)
+//
+// into i every step, so the coupling is a sparse matrix-vector product
+// over all potentials rather than event-driven delivery.
+//
+// The matrix is stored in SELL-C-sigma form: rows are sorted by length
+// within windows of GAP_SORT_WINDOW rows, cut into slices of
+// GAP_SLICE_ROWS, and each slice is padded to its longest row and stored
+// column-major. Entry k of the rows of a slice is then one contiguous
+// vector of GAP_SLICE_ROWS partners, and the product runs with the rows
+// as SIMD lanes; sorting keeps the padding small when row lengths vary.
+//
+// Explicit coupling is stable while dt times a neuron's total junction
+// conductance stays below 1. Relaxation iterations instead take the
+// coupled potentials at the end of the step from backward Euler:
+// waveform relaxation over a one-step window, in which every neuron's end
+// potential is recomputed from its partners' previous iterate (Jacobi).
+// Any number of iterations is stable and more approach the implicit step.
+
+#define GAP_SLICE_ROWS 8
+#define GAP_SORT_WINDOW 64
+
+// Products over at least this many slices run in parallel
+#define GAP_PARALLEL_SLICES 64
+
+typedef struct {
+    int first_id;  // Coupled neurons are ids [first_id, first_id + num_rows)
+    int num_rows;
+    int num_junctions;
+    int num_slices;
+    int* slice_row;    // Row in each slot of the slice order, -1 padding
+    // Entry k of lane l of slice s is at slice_ptr[s] + k * GAP_SLICE_ROWS + l
+    int* slice_ptr;    // num_slices + 1 starts in col and g
+    int* col;          // Partner row
+    double* g;         // Junction conductance (1/ms), 0 in padding
+    double* g_total;   // Total conductance of each row
+    double* v;         // Potentials at the start of the step, by row
+    double* current;   // Coupling input of the step (mV/ms), by row
+    double* iterate;   // Relaxation scratch, by row
+    double* next;
+} GapJunctions;
+
+// Junctions between rows a[k] and b[k] (offsets from first_id), each of
+// conductance g; a pair listed twice is coupled twice
+GapJunctions* create_gap_junctions(int first_id, int num_rows, const int* a,
+                                   const int* b, int count, double g);
+void destroy_gap_junctions(GapJunctions* gap);
+
+// y[row] = sum over partners of g * x[partner], by row
+void gap_junction_multiply(const GapJunctions* gap, const double* x,
+                           double* y);
+
+// Coupling input of a step of dt from the potentials in gap->v into
+// gap->current; iterations == 0 couples explicitly
+void gap_junction_currents(GapJunctions* gap, double dt, int iterations);
+
+#endif
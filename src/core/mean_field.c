@@ -0,0 +1,263 @@
+#include "mean_field.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// Shifts of threshold and reset, in units of the noise sigma, that make
+// the diffusion match the simulation: synaptic filtering moves them by
+// sqrt(tau_syn / tau_m) |zeta(1/2)| / sqrt(2) (Fourcaud & Brunel 2002),
+// and the white noise, whose crossings are only seen at the end of each
+// step, by its step's deviation sqrt(dt / tau_m) times the mean overshoot
+// |zeta(1/2)| / sqrt(2 pi) of a Gaussian random walk
+#define FILTER_SHIFT 1.0326
+#define STEP_SHIFT 0.5826
+
+// Below this the Siegert integrand is close to 1 / (|u| sqrt(pi)) and is
+// integrated in log(-u)
+#define SIEGERT_SPLIT (-5.0)
+#define SIEGERT_STEPS_PER_UNIT 32
+#define SIEGERT_LOG_STEPS 200
+
+// Above this the rate is below 1e-270 of the leak rate
+#define SIEGERT_MAX_THRESHOLD 25.0
+
+// exp(x^2) erfc(x), without the overflow of the product for large x
+static double erfcx(double x) {
+    if (x < 5.0) return exp(x * x) * erfc(x);
+    // Continued fraction, converged to double precision from x = 5 on
+    double f = x;
+    for (int n = 60; n >= 1; n--) f = x + 0.5 * n / f;
+    return 1.0 / (sqrt(M_PI) * f);
+}
+
+// Composite Simpson rule of f over [a, b] in steps intervals (even)
+static double simpson(double (*f)(double), double a, double b, int steps) {
+    double h = (b - a) / steps;
+    double sum = f(a) + f(b);
+    for (int i = 1; i < steps; i++) {
+        sum += (i % 2 ? 4.0 : 2.0) * f(a + i * h);
+    }
+    return sum * h / 3.0;
+}
+
+static double siegert_integrand(double u) {
+    return erfcx(-u);
+}
+
+// The integrand in s = log(-u)
+static double siegert_log_integrand(double s) {
+    double x = exp(s);
+    return erfcx(x) * x;
+}
+
+// Integral of exp(u^2) (1 + erf(u)) over [a, b]
+static double siegert_integral(double a, double b) {
+    double sum = 0.0;
+    if (a < SIEGERT_SPLIT) {
+        double hi = b < SIEGERT_SPLIT ? b : SIEGERT_SPLIT;
+        sum += simpson(siegert_log_integrand, log(-hi), log(-a),
+                       SIEGERT_LOG_STEPS);
+        a = hi;
+    }
+    if (b > a) {
+        int steps = 2 * (int)ceil((b - a) * SIEGERT_STEPS_PER_UNIT / 2.0);
+        sum += simpson(siegert_integrand, a, b, steps < 2 ? 2 : steps);
+    }
+    return sum;
+}
+
+double lif_rate(const ModelParams* params, double mu, double sigma_white,
+                double sigma_syn, double tau_syn, double dt) {
+    const NeuronParams* p = &params->base;
+    double threshold = p->v_threshold;
+    double reset = p->v_reset;
+
+    double sigma = sqrt(sigma_white * sigma_white + sigma_syn * sigma_syn);
+
+    // Without noise the neuron charges deterministically
+    if (sigma < 1e-9 * (threshold - reset)) {
+        if (mu <= threshold) return 0.0;
+        return 1.0 / (p->refractory_period +
+                      p->tau_m * log((mu - reset) / (mu - threshold)));
+    }
+
+    // Each share of the noise moves both boundaries by its part
+    double shift = (FILTER_SHIFT * sqrt(tau_syn / p->tau_m) * sigma_syn *
+                        sigma_syn +
+                    STEP_SHIFT * sqrt(dt / p->tau_m) * sigma_white *
+                        sigma_white) /
+                   (sigma * sigma);
+    double y_threshold = (threshold - mu) / sigma + shift;
+    double y_reset = (reset - mu) / sigma + shift;
+    if (y_threshold > SIEGERT_MAX_THRESHOLD) return 0.0;
+
+    return 1.0 / (p->refractory_period +
+                  p->tau_m * sqrt(M_PI) *
+                      siegert_integral(y_reset, y_threshold));
+}
+
+// Moments of the input one neuron of population target receives when
+// the populations fire at rate (1/ms): mean and white and filtered
+// variance of the free membrane potential
+typedef struct {
+    double mu;
+    double var_white;
+    double var_syn;
+} InputMoments;
+
+static InputMoments input_moments(const NetworkConfig* config, int target,
+                                  const double* rate) {
+    const PopulationConfig* pop =
+        target == POP_PYRAMIDAL ? &config->pyramidal : &config->inhibitory;
+    const double tau_m = pop->params.base.tau_m;
+    const int sizes[NUM_POPULATIONS] = {config->num_pyramidal,
+                                        config->num_inhibitory};
+    InputMoments m = {pop->params.base.v_resting, 0.0, 0.0};
+
+    // A spike's input decays by syn_decay per step from the step it
+    // arrives, so the potential integrates scale * w * dt / (1 - decay)
+    double decay = config->tau_syn > 0.0 ? exp(-config->dt / config->tau_syn)
+                                         : 0.0;
+    double tau_eff = config->dt / (1.0 - decay);
+    double w_mean = 0.5 * MAX_INITIAL_WEIGHT;
+    double w_square = MAX_INITIAL_WEIGHT * MAX_INITIAL_WEIGHT / 3.0;
+
+    for (int source = 0; source < NUM_POPULATIONS; source++) {
+        double inputs = config->connection_rate *
+                        (sizes[source] - (source == target ? 1 : 0));
+        double scale = source == POP_PYRAMIDAL ? config->w_exc
+                                               : -fabs(config->w_inh);
+        double j = scale * tau_eff;
+        m.mu += tau_m * inputs * j * w_mean * rate[source];
+        m.var_syn += tau_m * inputs * j * j * w_square * rate[source];
+    }
+
+    if (config->background.num_sources > 0) {
+        // Each external spike is a jump of weight within one step
+        double bg_rate =
+            config->background.num_sources * config->background.rate / 1000.0;
+        double j = config->background.weight;
+        m.mu += tau_m * bg_rate * j;
+        m.var_white += tau_m * bg_rate * j * j;
+    } else {
+        // A step's uniform current moves the potential by dt * U(-a, a)
+        double a = TEST_NOISE_AMPLITUDE;
+        m.var_white += tau_m * config->dt * a * a / 3.0;
+    }
+    return m;
+}
+
+static int check_config(const NetworkConfig* config) {
+    const PopulationConfig* pops[NUM_POPULATIONS] = {&config->pyramidal,
+                                                     &config->inhibitory};
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        if (pops[p]->model != MODEL_LIF) {
+            fprintf(stderr, "Mean field needs LIF populations, not %s\n",
+                    neuron_model_name(pops[p]->model));
+            return -1;
+        }
+        const NeuronParams* base = &pops[p]->params.base;
+        if (base->v_reset >= base->v_threshold || base->tau_m <= 0.0) {
+            fprintf(stderr, "Mean field needs a reset below threshold\n");
+            return -1;
+        }
+    }
+    if (config->num_dendrites > 0) {
+        fprintf(stderr, "Mean field needs point neurons\n");
+        return -1;
+    }
+    if (config->gap_junction_rate > 0.0) {
+        fprintf(stderr, "Mean field needs networks without gap junctions\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Rates (1/ms) the populations fire at when their inputs fire at rate;
+// the input moments go to result. Returns the largest |transfer - rate|.
+static double transfer(const NetworkConfig* config, const double* rate,
+                       double* out, MeanFieldResult* result) {
+    const PopulationConfig* pops[NUM_POPULATIONS] = {&config->pyramidal,
+                                                     &config->inhibitory};
+    const int sizes[NUM_POPULATIONS] = {config->num_pyramidal,
+                                        config->num_inhibitory};
+    const double tau_syn = config->tau_syn > 0.0 ? config->tau_syn : 0.0;
+    double residual = 0.0;
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        InputMoments m = input_moments(config, p, rate);
+        result->mu[p] = m.mu;
+        result->sigma[p] = sqrt(m.var_white + m.var_syn);
+        out[p] = sizes[p] > 0 ? lif_rate(&pops[p]->params, m.mu,
+                                         sqrt(m.var_white), sqrt(m.var_syn),
+                                         tau_syn, config->dt)
+                              : 0.0;
+        double change = fabs(out[p] - rate[p]);
+        if (change > residual) residual = change;
+    }
+    return residual;
+}
+
+int mean_field_rates(const NetworkConfig* config, MeanFieldResult* result) {
+    if (check_config(config) != 0) return -1;
+    const int sizes[NUM_POPULATIONS] = {config->num_pyramidal,
+                                        config->num_inhibitory};
+
+    // The rates follow d rate / dt = transfer(rate) - rate from silence
+    // in linearly implicit steps, which grow as the residual falls until
+    // they are Newton steps (pseudo-transient continuation). Of several
+    // fixed points this finds the one the network settles in from rest.
+    double rate[NUM_POPULATIONS] = {0.0, 0.0};
+    double out[NUM_POPULATIONS];
+    double step = 1.0;
+    double last_residual = 0.0;
+    result->converged = false;
+    int it;
+    for (it = 1; it <= MEAN_FIELD_MAX_ITERATIONS; it++) {
+        double residual = transfer(config, rate, out, result);
+        double f[NUM_POPULATIONS] = {out[0] - rate[0], out[1] - rate[1]};
+        if (residual < MEAN_FIELD_TOLERANCE) {
+            rate[0] = out[0];
+            rate[1] = out[1];
+            result->converged = true;
+            break;
+        }
+        if (it > 1) {
+            step = fmin(fmax(step * last_residual / residual, 0.01), 1e12);
+        }
+        last_residual = residual;
+
+        // (I / step - J) d = f, with the Jacobian J of the residual by
+        // forward differences
+        double a[NUM_POPULATIONS][NUM_POPULATIONS];
+        for (int q = 0; q < NUM_POPULATIONS; q++) {
+            double shifted[NUM_POPULATIONS] = {rate[0], rate[1]};
+            double h = 1e-7 + 1e-4 * rate[q];
+            double moved[NUM_POPULATIONS];
+            MeanFieldResult scratch;
+            shifted[q] += h;
+            transfer(config, shifted, moved, &scratch);
+            for (int p = 0; p < NUM_POPULATIONS; p++) {
+                double jacobian = (moved[p] - out[p]) / h - (p == q);
+                a[p][q] = (p == q) / step - jacobian;
+            }
+        }
+        double det = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+        if (!(fabs(det) > 0.0)) break;
+        double d0 = (a[1][1] * f[0] - a[0][1] * f[1]) / det;
+        double d1 = (a[0][0] * f[1] - a[1][0] * f[0]) / det;
+        rate[0] = fmax(rate[0] + d0, 0.0);
+        rate[1] = fmax(rate[1] + d1, 0.0);
+    }
+    result->iterations = it <= MEAN_FIELD_MAX_ITERATIONS
+                             ? it
+                             : MEAN_FIELD_MAX_ITERATIONS;
+
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        result->rate[p] = rate[p] * 1000.0;
+        // population_freq gains a population's spikes every step and
+        // then loses a fraction dt of itself
+        result->population_freq[p] =
+            sizes[p] * rate[p] * (1.0 - config->dt);
+    }
+    return 0;
+}
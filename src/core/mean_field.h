@@ -0,0 +1,47 @@
+#ifndef NEURAL_MEAN_FIELD_H
+#define NEURAL_MEAN_FIELD_H
+
+#include <stdbool.h>
+
+#include "network.h"
+#include "neuron_models.h"
+
+// Stationary population rates of a network without simulating its neurons.
+// In the diffusion approximation every neuron of a population sees the same
+// Gaussian input: recurrent spikes at the populations' rates through the
+// mean connection probability and initial weights, plus the background
+// drive or the uniform test noise. The free membrane potential then has
+// mean mu and standard deviation sigma, the rate follows from the Siegert
+// formula, and the rates solve the self-consistency of both populations.
+//
+// Only LIF populations of point neurons have a transfer function here.
+// Plasticity is ignored: the rates are those of the initial weights. The
+// synaptic filtering correction is first order in sqrt(tau_syn / tau_m),
+// so rates drift low as tau_syn approaches tau_m.
+
+// Steps toward the self-consistent rates
+#define MEAN_FIELD_MAX_ITERATIONS 200
+#define MEAN_FIELD_TOLERANCE 1e-6  // Largest rate change (1/ms) to stop
+
+typedef struct {
+    double rate[NUM_POPULATIONS];  // Hz
+    // Level population_freq_p/i of a spiking run settle around
+    double population_freq[NUM_POPULATIONS];
+    double mu[NUM_POPULATIONS];     // Mean free membrane potential (mV)
+    double sigma[NUM_POPULATIONS];  // Its standard deviation (mV)
+    int iterations;
+    bool converged;
+} MeanFieldResult;
+
+// Rate (1/ms) of a LIF neuron stepped at dt whose free membrane potential
+// has mean mu and Gaussian fluctuations: sigma_white from input within a
+// step and sigma_syn from synapses filtered with tau_syn (ms)
+double lif_rate(const ModelParams* params, double mu, double sigma_white,
+                double sigma_syn, double tau_syn, double dt);
+
+// Solves the stationary rates of the network config describes. Returns 0,
+// or -1 for a network outside the approximation. A result that did not
+// converge (e.g. an oscillating network) holds the last iterate.
+int mean_field_rates(const NetworkConfig* config, MeanFieldResult* result);
+
+#endif
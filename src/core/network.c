@@ -1,12 +1,313 @@
 #include "network.h"
 
 #include <errno.h>
+#include <math.h>
 #include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 
+// Relabels the connectivity so that connected neurons get nearby ids.
+// Neurons of a population start out identical, so only the synapses move.
+static int reorder_network(Network* net) {
+    int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    int group_end[NUM_POPULATIONS] = {net->config.num_pyramidal, total};
+    int* order = reverse_cuthill_mckee(net->connectivity, group_end,
+                                       NUM_POPULATIONS);
+    int* slot = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+    if (!order || !slot) {
+        free(order);
+        free(slot);
+        return -1;
+    }
+    for (int i = 0; i < total; i++) slot[order[i]] = i;
+
+    Connectivity* permuted = permute_connectivity(net->connectivity, slot);
+    if (!permuted) {
+        free(order);
+        free(slot);
+        return -1;
+    }
+    destroy_connectivity(net->connectivity);
+    net->connectivity = permuted;
+    net->external_id = order;
+    net->internal_id = slot;
+    return 0;
+}
+
+static ConnectomeKey connectome_key(const NetworkConfig* config) {
+    ConnectomeKey key = {config->num_pyramidal, config->num_inhibitory,
+                         config->seed, (int32_t)config->reorder,
+                         config->connection_rate};
+    return key;
+}
+
+// Draws the connections, builds their sparse form and renumbers the
+// neurons, leaving rng where the rest of the creation continues from
+static int build_connectome(Network* net, RandomState* rng) {
+    const NetworkConfig* config = &net->config;
+    int total = config->num_pyramidal + config->num_inhibitory;
+    net->connection_matrix = (bool*)calloc((size_t)total * total, sizeof(bool));
+    if (!net->connection_matrix) {
+        fprintf(stderr, "Failed to allocate connection matrix\n");
+        return -1;
+    }
+    init_random(rng, config->seed);
+    for (int i = 0; i < total; i++) {
+        for (int j = 0; j < total; j++) {
+            if (i != j && random_uniform(rng) < config->connection_rate) {
+                net->connection_matrix[i * total + j] = true;
+            }
+        }
+    }
+
+    // Build sparse connectivity for synaptic processing
+    net->connectivity =
+        create_connectivity(net->connection_matrix, total,
+                            MAX_INITIAL_WEIGHT, rng);
+    if (!net->connectivity) {
+        fprintf(stderr, "Failed to allocate synaptic connectivity\n");
+        return -1;
+    }
+
+    // Renumber before any per-synapse state exists
+    if (config->reorder != REORDER_NONE && reorder_network(net) != 0) {
+        fprintf(stderr, "Failed to reorder neurons\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Maps a connectome written by save_network_connectome() in place of
+// building it; the network has no connection matrix then
+static int load_connectome(Network* net, const char* path, RandomState* rng) {
+    ConnectomeKey key = connectome_key(&net->config);
+    net->connectivity = map_connectome(path, &key, &net->external_id, rng);
+    if (!net->connectivity) return -1;
+    if (net->external_id) {
+        int total = net->config.num_pyramidal + net->config.num_inhibitory;
+        net->internal_id = (int*)malloc(total * sizeof(int));
+        if (!net->internal_id) {
+            fprintf(stderr, "Failed to allocate neuron order\n");
+            return -1;
+        }
+        for (int i = 0; i < total; i++) {
+            net->internal_id[net->external_id[i]] = i;
+        }
+    }
+    return 0;
+}
+
+int save_network_connectome(NetworkConfig config, const char* path) {
+    Network net = {0};
+    net.config = config;
+    RandomState rng;
+    ConnectomeKey key = connectome_key(&config);
+    int status = build_connectome(&net, &rng);
+    if (status == 0) {
+        status = write_connectome(path, &key, net.connectivity,
+                                  net.external_id, &rng);
+    }
+    free(net.connection_matrix);
+    destroy_connectivity(net.connectivity);
+    free(net.external_id);
+    free(net.internal_id);
+    return status;
+}
+
+// Dendritic synapses of the pyramidal neurons in [begin, end) by
+// presynaptic neuron, for spike delivery; replaces any earlier index
+static int index_dendrite_inputs(Network* net, int begin, int end) {
+    int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    int per_neuron = net->config.num_dendrites;
+    if (end > net->config.num_pyramidal) end = net->config.num_pyramidal;
+    if (begin > end) begin = end;
+    size_t first = (size_t)begin * per_neuron;
+    size_t last = (size_t)end * per_neuron;
+
+    int* ptr = (int*)calloc(total + 1, sizeof(int));
+    if (!ptr) return -1;
+    for (size_t d = first; d < last; d++) {
+        const Dendrite* dendrite = net->dendrites[d];
+        for (int s = 0; s < dendrite->num_synapses; s++) {
+            ptr[dendrite->synapses[s].pre_neuron_id + 1]++;
+        }
+    }
+    for (int i = 0; i < total; i++) ptr[i + 1] += ptr[i];
+    int* inputs = (int*)malloc((ptr[total] + 1) * sizeof(int));
+    int* fill = (int*)malloc(total * sizeof(int));
+    if (!inputs || !fill) {
+        free(ptr);
+        free(inputs);
+        free(fill);
+        return -1;
+    }
+    memcpy(fill, ptr, total * sizeof(int));
+    for (size_t d = first; d < last; d++) {
+        for (int s = 0; s < net->dendrites[d]->num_synapses; s++) {
+            int pre = net->dendrites[d]->synapses[s].pre_neuron_id;
+            inputs[fill[pre]++] = (int)d * MAX_SYNAPSES_PER_DENDRITE + s;
+        }
+    }
+    free(fill);
+    free(net->dendrite_input_ptr);
+    free(net->dendrite_inputs);
+    net->dendrite_input_ptr = ptr;
+    net->dendrite_inputs = inputs;
+    return 0;
+}
+
+// Dendrites with a varying number of synapses, each fed by a random
+// pyramidal neuron; drawn in creation order so that reordering does not
+// change which neuron gets which
+static int create_dendrites(Network* net, RandomState* rng) {
+    const NetworkConfig* config = &net->config;
+    int per_neuron = config->num_dendrites;
+    int mean = config->synapses_per_dendrite > 0
+                   ? config->synapses_per_dendrite
+                   : 1;
+    int max = 2 * mean - 1;
+    if (max > MAX_SYNAPSES_PER_DENDRITE) max = MAX_SYNAPSES_PER_DENDRITE;
+
+    size_t count = (size_t)config->num_pyramidal * per_neuron;
+    net->dendrites = (Dendrite**)calloc(count, sizeof(Dendrite*));
+    if (!net->dendrites) return -1;
+    for (int ext = 0; ext < config->num_pyramidal; ext++) {
+        Dendrite** dendrites =
+            network_dendrites(net, network_internal_id(net, ext));
+        for (int d = 0; d < per_neuron; d++) {
+            Dendrite* dendrite = create_dendrite(random_int(rng, 1, max));
+            if (!dendrite || !dendrite->synapses) {
+                destroy_dendrite(dendrite);
+                return -1;
+            }
+            for (int s = 0; s < dendrite->num_synapses; s++) {
+                Synapse* synapse = &dendrite->synapses[s];
+                synapse->weight = 0.1 * random_uniform(rng);
+                synapse->pre_neuron_id = network_internal_id(
+                    net, random_int(rng, 0, config->num_pyramidal - 1));
+                synapse->post_neuron_id = network_internal_id(net, ext);
+            }
+            dendrites[d] = dendrite;
+        }
+    }
+
+    // Every pyramidal neuron has the same tree, one branch per dendrite
+    int per_branch = config->dendrite_compartments > 0
+                         ? config->dendrite_compartments
+                         : 1;
+    net->morphology = create_branched_morphology(
+        per_neuron, per_branch, config->dendrite_coupling,
+        config->dendrite_tau, config->pyramidal.params.base.v_resting,
+        config->dendrite_soma_ratio);
+    if (!net->morphology) return -1;
+    morphology_prepare(net->morphology, config->dt);
+    net->cable = create_cable_state(net->morphology, config->num_pyramidal);
+    net->soma_v = (double*)calloc(config->num_pyramidal, sizeof(double));
+    net->soma_current = (double*)calloc(config->num_pyramidal, sizeof(double));
+    if (!net->cable || !net->soma_v || !net->soma_current) return -1;
+
+    return index_dendrite_inputs(net, 0, config->num_pyramidal);
+}
+
+// Distal compartment of a dendrite, where its synapses inject current
+static inline int dendrite_compartment(const Network* net, int dendrite) {
+    int per_branch = net->morphology->num_compartments /
+                     net->config.num_dendrites;
+    return (dendrite + 1) * per_branch - 1;
+}
+
+// Gap junctions between pairs of inhibitory neurons, drawn in creation
+// order from a stream of their own so that the chemical connectivity and
+// the chunk streams stay as they are
+static int create_gap_network(Network* net) {
+    const NetworkConfig* config = &net->config;
+    const Population* pop = &net->populations[POP_INHIBITORY];
+    RandomState rng;
+    init_random(&rng, config->seed ^ 0x4741504A554E4354ULL);
+
+    // Two passes over the same draws: count the pairs, then list them
+    const RandomState start = rng;
+    int count = 0;
+    for (int i = 0; i < pop->count; i++) {
+        for (int j = i + 1; j < pop->count; j++) {
+            count += random_uniform(&rng) < config->gap_junction_rate;
+        }
+    }
+    int* a = (int*)malloc((count + 1) * sizeof(int));
+    int* b = (int*)malloc((count + 1) * sizeof(int));
+    if (a && b) {
+        rng = start;
+        int k = 0;
+        for (int i = 0; i < pop->count; i++) {
+            for (int j = i + 1; j < pop->count; j++) {
+                if (random_uniform(&rng) >= config->gap_junction_rate) {
+                    continue;
+                }
+                a[k] = network_internal_id(net, pop->first_id + i) -
+                       pop->first_id;
+                b[k] = network_internal_id(net, pop->first_id + j) -
+                       pop->first_id;
+                k++;
+            }
+        }
+        net->gap_junctions =
+            create_gap_junctions(pop->first_id, pop->count, a, b, count,
+                                 config->gap_junction_conductance);
+    }
+    free(a);
+    free(b);
+    return net->gap_junctions ? 0 : -1;
+}
+
+// Splits every population into chunks of about NEURON_CHUNK_COST, with one
+// generator per chunk and the scheduler that runs them
+static int build_chunks(Network* net) {
+    int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    net->chunks = (NeuronChunk*)malloc((total + 1) * sizeof(NeuronChunk));
+    net->chunk_cost = (double*)malloc((total + 1) * sizeof(double));
+    if (!net->chunks || !net->chunk_cost) return -1;
+
+    int num_chunks = 0;
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        const Population* pop = &net->populations[p];
+        double cost = 0.0;
+        int begin = 0;
+        for (int i = 0; i < pop->count; i++) {
+            cost += 1.0;
+            Dendrite** dendrites = network_dendrites(net, pop->first_id + i);
+            for (int d = 0; dendrites && d < net->config.num_dendrites; d++) {
+                cost += DENDRITE_SYNAPSE_COST * dendrites[d]->num_synapses;
+            }
+            if (dendrites) {
+                cost += COMPARTMENT_COST * net->morphology->num_compartments;
+            }
+            if (cost >= NEURON_CHUNK_COST || i == pop->count - 1) {
+                net->chunks[num_chunks] = (NeuronChunk){p, begin, i + 1};
+                net->chunk_cost[num_chunks++] = cost;
+                begin = i + 1;
+                cost = 0.0;
+            }
+        }
+    }
+    net->num_chunks = num_chunks;
+    net->num_streams = num_chunks;
+    net->chunk_begin = 0;
+    net->chunk_end = num_chunks;
+    net->owned_begin = 0;
+    net->owned_end = total;
+
+    net->chunk_spikes = (int*)calloc(num_chunks + 1, sizeof(int));
+    net->chunk_time = (double*)calloc(num_chunks + 1, sizeof(double));
+    net->streams = create_random_streams(num_chunks + 1, net->config.seed);
+    net->scheduler = create_task_scheduler(omp_get_max_threads());
+    return net->chunk_spikes && net->chunk_time && net->streams &&
+                   net->scheduler
+               ? 0
+               : -1;
+}
+
 Network* create_network(NetworkConfig config) {
     Network* net = (Network*)malloc(sizeof(Network));
     if (!net) {
@@ -15,6 +316,46 @@ Network* create_network(NetworkConfig config) {
     }
 
     net->config = config;
+    net->connection_matrix = NULL;
+    net->connectivity = NULL;
+    net->internal_id = NULL;
+    net->external_id = NULL;
+    net->stdp = NULL;
+    net->eligibility = NULL;
+    net->structural = NULL;
+    net->activity = NULL;
+    net->background = NULL;
+    net->gap_junctions = NULL;
+    net->dendrites = NULL;
+    net->morphology = NULL;
+    net->cable = NULL;
+    net->soma_v = NULL;
+    net->soma_current = NULL;
+    net->dendrite_input_ptr = NULL;
+    net->dendrite_inputs = NULL;
+    net->streams = NULL;
+    net->spike_ids = NULL;
+    net->chunks = NULL;
+    net->chunk_spikes = NULL;
+    net->block_ids = NULL;
+    net->block_spikes = NULL;
+    net->chunk_cost = NULL;
+    net->chunk_time = NULL;
+    net->chunk_cost_measured = false;
+    net->scheduler = NULL;
+    net->transport = NULL;
+    net->window_steps = 1;
+    net->window_fill = 0;
+    net->window_send = NULL;
+    net->window_send_count = 0;
+    net->window_packed = NULL;
+    net->window_recv = NULL;
+    net->window_ids = NULL;
+    net->window_offsets = NULL;
+    net->transport_failed = false;
+    net->input_exc = NULL;
+    net->input_inh = NULL;
+    memset(net->populations, 0, sizeof(net->populations));
 
     // Allocate neurons
     net->pyramidal_neurons =
@@ -34,17 +375,7 @@ Network* create_network(NetworkConfig config) {
         return NULL;
     }
 
-    // Initialize connection matrix
     int total_neurons = config.num_pyramidal + config.num_inhibitory;
-    net->connection_matrix =
-        (bool*)calloc(total_neurons * total_neurons, sizeof(bool));
-    if (!net->connection_matrix) {
-        fprintf(stderr, "Failed to allocate connection matrix\n");
-        free(net->inhibitory_neurons);
-        free(net->pyramidal_neurons);
-        free(net);
-        return NULL;
-    }
 
     // Initialize output files array
     memset(net->output_files, 0, sizeof(net->output_files));
@@ -59,6 +390,8 @@ Network* create_network(NetworkConfig config) {
     // Initialize population frequencies
     net->population_freq_p = 0.0;
     net->population_freq_i = 0.0;
+    memset(net->total_spikes, 0, sizeof(net->total_spikes));
+    memset(net->phase_time, 0, sizeof(net->phase_time));
 
     // Initialize neurons
     for (int i = 0; i < config.num_pyramidal; i++) {
@@ -68,13 +401,140 @@ Network* create_network(NetworkConfig config) {
         init_neuron(&net->inhibitory_neurons[i], true);
     }
 
-    // Create random connections
-    for (int i = 0; i < total_neurons; i++) {
-        for (int j = 0; j < total_neurons; j++) {
-            if (i != j &&
-                ((double)rand() / RAND_MAX) < config.connection_rate) {
-                net->connection_matrix[i * total_neurons + j] = true;
+    // Group neurons into homogeneous populations; an unset parameter block
+    // falls back to the model defaults
+    if (config.pyramidal.params.base.tau_m <= 0.0) {
+        default_model_params(&config.pyramidal.params, false);
+    }
+    if (config.inhibitory.params.base.tau_m <= 0.0) {
+        default_model_params(&config.inhibitory.params, true);
+    }
+    net->config = config;
+
+    if (init_population(&net->populations[POP_PYRAMIDAL], "pyramidal",
+                        net->pyramidal_neurons, config.num_pyramidal, 0,
+                        &config.pyramidal) != 0 ||
+        init_population(&net->populations[POP_INHIBITORY], "inhibitory",
+                        net->inhibitory_neurons, config.num_inhibitory,
+                        config.num_pyramidal, &config.inhibitory) != 0) {
+        fprintf(stderr, "Failed to allocate neuron populations\n");
+        destroy_network(net);
+        return NULL;
+    }
+
+    // Connections come from the network's own generator so that several
+    // networks can be built concurrently, or from a connectome file built
+    // with the same generator
+    RandomState rng;
+    int status = config.connectome_file
+                     ? load_connectome(net, config.connectome_file, &rng)
+                     : build_connectome(net, &rng);
+    if (status != 0) {
+        destroy_network(net);
+        return NULL;
+    }
+    net->spike_ids = (int*)malloc(total_neurons * sizeof(int));
+    net->num_spikes = 0;
+    net->num_chunks = 0;
+    net->num_streams = 0;
+
+    // Synaptic input ring; delays shorter than one step round up to one
+    net->delay_steps = (int)lround(config.synaptic_delay / config.dt);
+    if (net->delay_steps < 1) net->delay_steps = 1;
+    net->ring_head = 0;
+    net->syn_decay = config.tau_syn > 0.0 ? exp(-config.dt / config.tau_syn)
+                                          : 0.0;
+    size_t ring_size = (size_t)(net->delay_steps + 1) * total_neurons;
+    net->input_exc = (double*)calloc(ring_size, sizeof(double));
+    net->input_inh = (double*)calloc(ring_size, sizeof(double));
+
+    if (!net->connectivity || !net->spike_ids || !net->input_exc ||
+        !net->input_inh) {
+        fprintf(stderr, "Failed to allocate synaptic connectivity\n");
+        destroy_network(net);
+        return NULL;
+    }
+
+    if (config.num_dendrites > 0 && create_dendrites(net, &rng) != 0) {
+        fprintf(stderr, "Failed to allocate dendrites\n");
+        destroy_network(net);
+        return NULL;
+    }
+
+    if (build_chunks(net) != 0) {
+        fprintf(stderr, "Failed to allocate update chunks\n");
+        destroy_network(net);
+        return NULL;
+    }
+
+    // Rewiring needs free slots to add synapses into; a mapped connectome
+    // is copied out of its file
+    if (config.enable_structural) {
+        Connectivity* slack = connectivity_with_slack(
+            net->connectivity, config.structural.slack, NULL);
+        if (slack) {
+            destroy_connectivity(net->connectivity);
+            net->connectivity = slack;
+            net->structural = create_structural_state(
+                total_neurons, conn_num_slots(slack), config.structural,
+                config.dt, config.seed);
+        }
+        if (!net->structural) {
+            fprintf(stderr, "Failed to allocate structural plasticity\n");
+            destroy_network(net);
+            return NULL;
+        }
+    }
+
+    if (config.enable_stdp) {
+        net->stdp = create_stdp_state(total_neurons, config.stdp, config.dt);
+        if (!net->stdp) {
+            fprintf(stderr, "Failed to allocate STDP state\n");
+            destroy_network(net);
+            return NULL;
+        }
+
+        if (config.enable_reward_learning) {
+            net->eligibility = create_eligibility_state(
+                conn_num_slots(net->connectivity), config.eligibility,
+                config.dt);
+            if (!net->eligibility) {
+                fprintf(stderr, "Failed to allocate eligibility traces\n");
+                destroy_network(net);
+                return NULL;
             }
+            net->stdp->eligibility = net->eligibility;
+        }
+    }
+
+    if (config.activity_window > 0.0) {
+        int first_id[NUM_POPULATIONS];
+        int count[NUM_POPULATIONS];
+        for (int p = 0; p < NUM_POPULATIONS; p++) {
+            first_id[p] = net->populations[p].first_id;
+            count[p] = net->populations[p].count;
+        }
+        int window = (int)lround(config.activity_window / config.dt);
+        net->activity = create_activity_monitor(
+            first_id, count, NUM_POPULATIONS, window > 0 ? window : 1);
+        if (!net->activity) {
+            destroy_network(net);
+            return NULL;
+        }
+    }
+
+    if (config.gap_junction_rate > 0.0 && create_gap_network(net) != 0) {
+        destroy_network(net);
+        return NULL;
+    }
+
+    if (config.background.num_sources > 0) {
+        net->background =
+            create_background_input(config.background, config.dt);
+        if (!net->background) {
+            fprintf(stderr, "Failed to allocate background input\n");
+            destroy_network(net);
+            return NULL;
         }
     }
 
@@ -96,6 +556,49 @@ void destroy_network(Network* net) {
         free(net->pyramidal_neurons);
         free(net->inhibitory_neurons);
         free(net->connection_matrix);
+        destroy_connectivity(net->connectivity);
+        free(net->internal_id);
+        free(net->external_id);
+        destroy_stdp_state(net->stdp);
+        destroy_eligibility_state(net->eligibility);
+        destroy_structural_state(net->structural);
+        destroy_activity_monitor(net->activity);
+        destroy_background_input(net->background);
+        destroy_gap_junctions(net->gap_junctions);
+        if (net->dendrites) {
+            size_t count =
+                (size_t)net->config.num_pyramidal * net->config.num_dendrites;
+            for (size_t d = 0; d < count; d++) {
+                destroy_dendrite(net->dendrites[d]);
+            }
+            free(net->dendrites);
+        }
+        destroy_cable_state(net->cable);
+        destroy_morphology(net->morphology);
+        free(net->soma_v);
+        free(net->soma_current);
+        free(net->dendrite_input_ptr);
+        free(net->dendrite_inputs);
+        free(net->streams);
+        free(net->spike_ids);
+        free(net->chunks);
+        free(net->chunk_spikes);
+        free(net->block_ids);
+        free(net->block_spikes);
+        free(net->chunk_cost);
+        free(net->chunk_time);
+        destroy_task_scheduler(net->scheduler);
+        destroy_transport(net->transport);
+        free(net->window_send);
+        free(net->window_packed);
+        free(net->window_recv);
+        free(net->window_ids);
+        free(net->window_offsets);
+        free(net->input_exc);
+        free(net->input_inh);
+        for (int p = 0; p < NUM_POPULATIONS; p++) {
+            free_population(&net->populations[p]);
+        }
 
         for (int i = 0; i < 2; i++) {
             if (net->output_files[i]) {
@@ -107,45 +610,1064 @@ void destroy_network(Network* net) {
     }
 }
 
-void update_network(Network* net, double time) {
-// Update pyramidal neurons in parallel
-#pragma omp parallel for
-    for (int i = 0; i < net->config.num_pyramidal; i++) {
-        update_neuron(&net->pyramidal_neurons[i], net->config.dt);
-        if (check_spike(&net->pyramidal_neurons[i])) {
-#pragma omp atomic
-            net->population_freq_p += 1.0;
+static void apply_external_drive(Network* net, Population* pop, int begin,
+                                 int end, RandomState* rng) {
+    Neuron* neurons = pop->neurons;
+    if (net->background) {
+        for (int i = begin; i < end; i++) {
+            neurons[i].input_current +=
+                background_current(net->background, rng);
+        }
+    } else {
+        // Random input current (test için)
+        for (int i = begin; i < end; i++) {
+            neurons[i].input_current +=
+                random_uniform(rng) * (2.0 * TEST_NOISE_AMPLITUDE) -
+                TEST_NOISE_AMPLITUDE;
         }
     }
+}
+
+// Advances the dendrites of pyramidal neurons [begin, end) with the somata
+// held at their current potential, and adds the axial current back into
+// each soma as input for this step
+static void update_dendrites(Network* net, int begin, int end) {
+    const double dt = net->config.dt;
+    CableState* cable = net->cable;
+    for (int id = begin; id < end; id++) {
+        Dendrite** dendrites = network_dendrites(net, id);
+        for (int d = 0; d < net->config.num_dendrites; d++) {
+            update_dendrite(dendrites[d], dt);
+            *cable_inject(cable, dendrite_compartment(net, d), id) +=
+                compute_local_potential(dendrites[d]);
+        }
+        net->soma_v[id] = net->pyramidal_neurons[id].membrane_potential;
+        net->soma_current[id] = 0.0;
+    }
+
+    // One sweep over the whole chunk, neurons as SIMD lanes
+    cable_solve(cable, begin, end, net->soma_v, net->soma_current);
 
-// Update inhibitory neurons in parallel
-#pragma omp parallel for
-    for (int i = 0; i < net->config.num_inhibitory; i++) {
-        update_neuron(&net->inhibitory_neurons[i], net->config.dt);
-        if (check_spike(&net->inhibitory_neurons[i])) {
-#pragma omp atomic
-            net->population_freq_i += 1.0;
+    for (int id = begin; id < end; id++) {
+        Dendrite** dendrites = network_dendrites(net, id);
+        for (int d = 0; d < net->config.num_dendrites; d++) {
+            dendrites[d]->local_potential =
+                *cable_voltage(cable, dendrite_compartment(net, d), id);
         }
+        net->pyramidal_neurons[id].input_current += net->soma_current[id];
     }
+}
+
+typedef struct {
+    Network* net;
+    double time;  // Time of the first step
+    int steps;    // Steps every chunk advances
+} ChunkContext;
+
+// Spike buffers of step `step` of a run of `steps`: each chunk leaves its
+// spikes at the start of its own range of the ids and its count by chunk.
+// Single steps use spike_ids itself and compact it in place.
+static int* step_spike_ids(const Network* net, int steps, int step) {
+    int total_neurons = net->config.num_pyramidal + net->config.num_inhibitory;
+    return steps == 1 ? net->spike_ids
+                      : net->block_ids + (size_t)step * total_neurons;
+}
+
+static int* step_chunk_spikes(const Network* net, int steps, int step) {
+    return steps == 1 ? net->chunk_spikes
+                      : net->block_spikes + (size_t)step * net->num_chunks;
+}
+
+// Advances one chunk through the context's steps, leaving each step's
+// spikes as population indices in that step's buffers
+static void update_chunk(void* context, int task, int thread) {
+    (void)thread;
+    const ChunkContext* c = context;
+    Network* net = c->net;
+    // Tasks count from the rank's first chunk
+    int chunk = net->chunk_begin + task;
+    const NeuronChunk* work = &net->chunks[chunk];
+    Population* pop = &net->populations[work->population];
+    int total_neurons = net->config.num_pyramidal + net->config.num_inhibitory;
+    int slots = net->delay_steps + 1;
+    double time = c->time;
+
+    for (int step = 0; step < c->steps; step++) {
+        // Spikes of the block are delivered after it and are due
+        // delay_steps later, so every slot read here is already complete
+        size_t slot =
+            (size_t)((net->ring_head + step) % slots) * total_neurons;
+        KernelContext ctx = {net->config.dt, time, net->syn_decay,
+                             net->input_exc + slot, net->input_inh + slot};
+
+        apply_external_drive(net, pop, work->begin, work->end,
+                             &net->streams[chunk].rng);
+        if (net->gap_junctions && work->population == POP_INHIBITORY) {
+            const double* current = net->gap_junctions->current;
+            for (int i = work->begin; i < work->end; i++) {
+                pop->neurons[i].input_current += current[i];
+            }
+        }
+        if (net->dendrites && work->population == POP_PYRAMIDAL) {
+            update_dendrites(net, pop->first_id + work->begin,
+                             pop->first_id + work->end);
+        }
+        int* ids = step_spike_ids(net, c->steps, step);
+        step_chunk_spikes(net, c->steps, step)[chunk] =
+            pop->kernel(pop, work->begin, work->end, &ctx,
+                        ids + pop->first_id + work->begin);
+        // Accumulated like the simulation clock, so blocks see the same
+        // times as single steps
+        time += net->config.dt;
+    }
+}
+
+// Adds the synaptic input of spikes ids[0..count) to ring slot slot. A
+// partitioned network only holds the synapses onto its own neurons.
+static void deliver_spikes(Network* net, int slot, const int* ids,
+                           int count) {
+    int total_neurons = net->config.num_pyramidal + net->config.num_inhibitory;
+    double* exc = net->input_exc + (size_t)slot * total_neurons;
+    double* inh = net->input_inh + (size_t)slot * total_neurons;
+    const Connectivity* conn = net->connectivity;
+    const double w_exc = net->config.w_exc;
+    const double w_inh = fabs(net->config.w_inh);
+
+    // Every synapse of a row shares the source's sign
+    for (int s = 0; s < count; s++) {
+        int src = ids[s];
+        bool excitatory = src < net->config.num_pyramidal;
+        double* input = excitatory ? exc : inh;
+        double scale = excitatory ? w_exc : w_inh;
+        for (int k = conn_row_begin(conn, src); k < conn_row_end(conn, src);
+             k++) {
+            input[conn->targets[k]] += scale * conn->weights[k];
+        }
+    }
+
+    // Dendritic synapses see the spike at their next update
+    if (net->dendrite_inputs) {
+        for (int s = 0; s < count; s++) {
+            int src = ids[s];
+            for (int k = net->dendrite_input_ptr[src];
+                 k < net->dendrite_input_ptr[src + 1]; k++) {
+                int target = net->dendrite_inputs[k];
+                int dendrite = target / MAX_SYNAPSES_PER_DENDRITE;
+                dendrite_receive_spike(net->dendrites[dendrite],
+                                       target % MAX_SYNAPSES_PER_DENDRITE,
+                                       DENDRITE_SPIKE_CONDUCTANCE);
+            }
+        }
+    }
+}
+
+// Plasticity only touches synapses of neurons that spiked; rewiring runs
+// once every structural interval. A failed rewiring keeps the synapses
+// as they were and is tried again at the next interval.
+static void apply_plasticity(Network* net, const int* ids, int count) {
+    if (net->stdp) {
+        if (net->eligibility) eligibility_advance(net->eligibility);
+        stdp_decay_traces(net->stdp);
+        stdp_process_spikes(net->stdp, net->connectivity, ids, count,
+                            net->scheduler);
+    }
+    if (net->structural &&
+        structural_record_spikes(net->structural, ids, count)) {
+        structural_rewire(net->structural, &net->connectivity,
+                          net->eligibility);
+    }
+}
+
+// Ring slot that receives the spikes of the step `ago` steps back
+static int delivery_slot(const Network* net, int ago) {
+    int slots = net->delay_steps + 1;
+    return ((net->ring_head - ago + net->delay_steps) % slots + slots) % slots;
+}
+
+// Exchanges the window's spikes with the other ranks, dense steps as bit
+// blocks, and replays every step's delivery and plasticity in order.
+// Spikes of step j of the window are due delay_steps after it, so none is
+// late, and each step's global list is in ascending id order, the chunk
+// order of a single process.
+static void exchange_window(Network* net) {
+    int packed = transport_pack_spikes(net->window_send,
+                                       net->window_send_count,
+                                       net->owned_begin, net->owned_end,
+                                       net->window_packed);
+    int received = net->transport->exchange(net->transport,
+                                            net->window_packed, packed,
+                                            net->window_recv);
+    net->window_send_count = 0;
+    int steps = net->window_fill;
+    net->window_fill = 0;
+    const int* offsets = net->window_offsets;
+    if (received < 0 ||
+        transport_unpack_spikes(net->window_recv, received, steps,
+                                net->window_offsets, net->window_ids) < 0) {
+        net->transport_failed = true;
+        return;
+    }
+
+    for (int j = 0; j < steps; j++) {
+        const int* ids = net->window_ids + offsets[j];
+        int count = offsets[j + 1] - offsets[j];
+        deliver_spikes(net, delivery_slot(net, steps - 1 - j), ids, count);
+        apply_plasticity(net, ids, count);
+    }
+}
+
+int network_exchange_capacity(const Network* net) {
+    int total_neurons = net->config.num_pyramidal + net->config.num_inhibitory;
+    return total_neurons * net->delay_steps;
+}
+
+// Keeps only the synapses onto the rank's own neurons, so that delivery
+// and plasticity touch no others. Per-slot state follows its synapses.
+static int restrict_to_owned(Network* net) {
+    // Nothing reads the dense matrix after creation
+    free(net->connection_matrix);
+    net->connection_matrix = NULL;
+
+    const Connectivity* conn = net->connectivity;
+    int* slot_map = (int*)malloc((conn_num_slots(conn) + 1) * sizeof(int));
+    Connectivity* owned =
+        slot_map ? restrict_connectivity(conn, net->owned_begin,
+                                         net->owned_end, slot_map)
+                 : NULL;
+    // Rewiring needs its free slots back
+    if (owned && net->structural) {
+        int* slack_map =
+            (int*)malloc((conn_num_slots(owned) + 1) * sizeof(int));
+        Connectivity* slack =
+            slack_map ? connectivity_with_slack(
+                            owned, net->structural->params.slack, slack_map)
+                      : NULL;
+        for (int k = 0; slack && k < conn_num_slots(conn); k++) {
+            if (slot_map[k] >= 0) slot_map[k] = slack_map[slot_map[k]];
+        }
+        free(slack_map);
+        destroy_connectivity(owned);
+        owned = slack;
+    }
+    int slots = owned ? conn_num_slots(owned) : 0;
+    if (!owned ||
+        (net->structural && structural_resize(net->structural, slots) != 0) ||
+        (net->eligibility &&
+         eligibility_remap(net->eligibility, slot_map, slots) != 0) ||
+        (net->dendrite_inputs &&
+         index_dendrite_inputs(net, net->owned_begin, net->owned_end) != 0)) {
+        fprintf(stderr, "Failed to restrict synapses to the rank\n");
+        destroy_connectivity(owned);
+        free(slot_map);
+        return -1;
+    }
+    free(slot_map);
+    destroy_connectivity(net->connectivity);
+    net->connectivity = owned;
+    if (net->structural) {
+        structural_restrict_targets(net->structural, net->owned_begin,
+                                    net->owned_end);
+    }
+    return 0;
+}
+
+int partition_network(Network* net, SpikeTransport* transport) {
+    int ranks = transport->num_ranks;
+    if (net->gap_junctions) {
+        fprintf(stderr, "Gap junctions need the whole network in one "
+                        "process\n");
+        return -1;
+    }
+    if (transport->capacity < network_exchange_capacity(net) ||
+        ranks > net->num_chunks || net->window_fill != 0) {
+        fprintf(stderr, "Cannot split %d chunks over %d ranks\n",
+                net->num_chunks, ranks);
+        return -1;
+    }
+
+    // Contiguous chunk ranges of about equal estimated cost
+    int* split = (int*)malloc((ranks + 1) * sizeof(int));
+    if (!split) return -1;
+    split_by_cost(net->chunk_cost, net->num_chunks, ranks, split);
+    int begin = split[transport->rank];
+    int end = split[transport->rank + 1];
+    free(split);
+    if (begin == end) {
+        fprintf(stderr, "Rank %d received no neurons\n", transport->rank);
+        return -1;
+    }
+
+    int total = ranks * transport->capacity;
+    int steps = net->delay_steps;
+    net->window_send =
+        (SpikeRecord*)malloc((transport->capacity + 1) * sizeof(SpikeRecord));
+    net->window_packed =
+        (SpikeRecord*)malloc((transport->capacity + 1) * sizeof(SpikeRecord));
+    net->window_recv = (SpikeRecord*)malloc((total + 1) * sizeof(SpikeRecord));
+    net->window_ids = (int*)malloc((total + 1) * sizeof(int));
+    net->window_offsets = (int*)malloc((steps + 1) * sizeof(int));
+    if (!net->window_send || !net->window_packed || !net->window_recv ||
+        !net->window_ids || !net->window_offsets) {
+        fprintf(stderr, "Failed to allocate spike exchange buffers\n");
+        return -1;
+    }
+
+    const NeuronChunk* first = &net->chunks[begin];
+    const NeuronChunk* last = &net->chunks[end - 1];
+    net->chunk_begin = begin;
+    net->chunk_end = end;
+    net->owned_begin = net->populations[first->population].first_id +
+                       first->begin;
+    net->owned_end = net->populations[last->population].first_id + last->end;
+    if (restrict_to_owned(net) != 0) return -1;
+    net->window_steps = steps;
+    net->transport = transport;
+    return 0;
+}
+
+// Gap junction input of the step from the inhibitory potentials at its
+// start
+static void update_gap_junctions(Network* net) {
+    GapJunctions* gap = net->gap_junctions;
+    const Neuron* neurons = net->populations[POP_INHIBITORY].neurons;
+    for (int r = 0; r < gap->num_rows; r++) {
+        gap->v[r] = neurons[r].membrane_potential;
+    }
+    gap_junction_currents(gap, net->config.dt,
+                          net->config.gap_junction_iterations);
+}
+
+// Runs the rank's chunks for the context's steps on the scheduler; blocks
+// of several steps never have gap junctions
+static void run_chunks(Network* net, ChunkContext* context) {
+    double phase_start = omp_get_wtime();
+    if (net->gap_junctions) update_gap_junctions(net);
+    int first = net->chunk_begin;
+    scheduler_run(net->scheduler, net->chunk_end - first,
+                  net->chunk_cost + first, net->chunk_time + first,
+                  update_chunk, context);
+
+    // Measured times steer the next split; the first replaces the estimate
+    double blend = net->chunk_cost_measured ? CHUNK_COST_SMOOTHING : 1.0;
+    for (int c = first; c < net->chunk_end; c++) {
+        double per_step = net->chunk_time[c] / context->steps;
+        net->chunk_cost[c] += blend * (per_step - net->chunk_cost[c]);
+    }
+    net->chunk_cost_measured = true;
+    net->phase_time[PHASE_NEURONS] += omp_get_wtime() - phase_start;
+}
+
+// Collects one step's spikes from the chunk buffers into spike_ids, in
+// chunk order so the list is deterministic, then delivers them and applies
+// plasticity (or queues them for the exchange) and advances the ring
+static void finish_step(Network* net, const int* ids, const int* counts) {
+    double phase_start = omp_get_wtime();
+    int num_spikes = 0;
+    int pop_spikes[NUM_POPULATIONS] = {0};
+    for (int c = net->chunk_begin; c < net->chunk_end; c++) {
+        const NeuronChunk* work = &net->chunks[c];
+        const Population* pop = &net->populations[work->population];
+        const int* chunk = ids + pop->first_id + work->begin;
+        int count = counts[c];
+        for (int s = 0; s < count; s++) {
+            net->spike_ids[num_spikes++] = pop->first_id + chunk[s];
+        }
+        pop_spikes[work->population] += count;
+    }
+    net->num_spikes = num_spikes;
+    net->population_freq_p += pop_spikes[POP_PYRAMIDAL];
+    net->population_freq_i += pop_spikes[POP_INHIBITORY];
+    net->total_spikes[POP_PYRAMIDAL] += pop_spikes[POP_PYRAMIDAL];
+    net->total_spikes[POP_INHIBITORY] += pop_spikes[POP_INHIBITORY];
+    if (net->activity) {
+        activity_record(net->activity, net->spike_ids, num_spikes);
+    }
+
+    if (net->transport) {
+        // Own spikes wait for the end of the window
+        for (int s = 0; s < num_spikes; s++) {
+            net->window_send[net->window_send_count++] =
+                (SpikeRecord){net->spike_ids[s], net->window_fill};
+        }
+        if (++net->window_fill == net->window_steps) exchange_window(net);
+        net->phase_time[PHASE_DELIVERY] += omp_get_wtime() - phase_start;
+    } else {
+        deliver_spikes(net, delivery_slot(net, 0), net->spike_ids,
+                       num_spikes);
+        double now = omp_get_wtime();
+        net->phase_time[PHASE_DELIVERY] += now - phase_start;
+        phase_start = now;
+
+        apply_plasticity(net, net->spike_ids, num_spikes);
+        net->phase_time[PHASE_PLASTICITY] += omp_get_wtime() - phase_start;
+    }
+
+    net->ring_head = (net->ring_head + 1) % (net->delay_steps + 1);
 
     // Decay population frequencies
     net->population_freq_p *= (1.0 - net->config.dt);
     net->population_freq_i *= (1.0 - net->config.dt);
 }
 
+void update_network(Network* net, double time) {
+    ChunkContext context = {net, time, 1};
+    run_chunks(net, &context);
+    finish_step(net, net->spike_ids, net->chunk_spikes);
+}
+
+int update_network_block(Network* net, double time, int max_steps,
+                         StepFunction on_step, void* context) {
+    int steps = max_steps < net->delay_steps ? max_steps : net->delay_steps;
+    if (net->gap_junctions && steps > 1) steps = 1;
+    // A block may not run past the exchange its later steps depend on
+    if (net->transport && steps > net->window_steps - net->window_fill) {
+        steps = net->window_steps - net->window_fill;
+    }
+    if (steps < 1) return 0;
+    if (steps == 1) {
+        update_network(net, time);
+        if (on_step) on_step(context, 0);
+        return 1;
+    }
+
+    if (!net->block_ids) {
+        int total_neurons =
+            net->config.num_pyramidal + net->config.num_inhibitory;
+        net->block_ids = (int*)malloc((size_t)net->delay_steps *
+                                      total_neurons * sizeof(int));
+        net->block_spikes = (int*)malloc((size_t)net->delay_steps *
+                                         net->num_chunks * sizeof(int));
+        if (!net->block_ids || !net->block_spikes) {
+            fprintf(stderr, "Failed to allocate block spike buffers\n");
+            free(net->block_ids);
+            free(net->block_spikes);
+            net->block_ids = NULL;
+            net->block_spikes = NULL;
+            return -1;
+        }
+    }
+
+    ChunkContext chunks = {net, time, steps};
+    run_chunks(net, &chunks);
+    for (int step = 0; step < steps; step++) {
+        finish_step(net, step_spike_ids(net, steps, step),
+                    step_chunk_spikes(net, steps, step));
+        if (on_step) on_step(context, step);
+    }
+    return steps;
+}
+
+double deliver_reward(Network* net, double reward) {
+    // Weights only move when a reward arrives; without reward learning the
+    // signal has nowhere to go
+    if (!net->eligibility) return 0.0;
+
+    return eligibility_commit_reward(net->eligibility, net->connectivity,
+                                     reward, net->config.stdp.w_min,
+                                     net->config.stdp.w_max);
+}
+
 void save_network_state(Network* net, double time) {
+    write_network_state(net->config.output_dir, time, net->population_freq_p,
+                        net->population_freq_i);
+}
+
+void write_network_state(const char* output_dir, double time, double freq_p,
+                         double freq_i) {
     char filename[256];
     snprintf(filename, sizeof(filename), "%s/network_state_%.3f.txt",
-             net->config.output_dir, time);
+             output_dir, time);
 
     FILE* file = fopen(filename, "w");
     if (!file) return;
 
     fprintf(file, "Time: %.3f\n", time);
-    fprintf(file, "Population frequency (pyramidal): %.3f Hz\n",
-            net->population_freq_p);
-    fprintf(file, "Population frequency (inhibitory): %.3f Hz\n",
-            net->population_freq_i);
+    fprintf(file, "Population frequency (pyramidal): %.3f Hz\n", freq_p);
+    fprintf(file, "Population frequency (inhibitory): %.3f Hz\n", freq_i);
 
     fclose(file);
 }
+
+#define CHECKPOINT_MAGIC "NSCKPT01"
+
+typedef struct {
+    char magic[8];
+    int num_pyramidal;
+    int num_inhibitory;
+    int num_synapses;
+    int delay_steps;
+    int ring_head;
+    int has_stdp;
+    int has_eligibility;
+    int has_structural;
+    int activity_window;  // Steps per activity window, 0 without them
+    int num_slots;  // Synapse slots, the synapses plus free ones
+    int num_streams;
+    int reorder;
+    int num_dendrites;
+    int num_compartments;
+    int rank;
+    int num_ranks;
+    int window_fill;
+    int window_send_count;
+    double population_freq_p;
+    double population_freq_i;
+    long long total_spikes[NUM_POPULATIONS];
+} CheckpointHeader;
+
+static int write_block(FILE* file, const void* data, size_t size,
+                       size_t count) {
+    return fwrite(data, size, count, file) == count ? 0 : -1;
+}
+
+// A checkpoint read into memory. Its sections are located and checked
+// before any of them is copied into the network, so a load that fails
+// leaves the network as it was.
+typedef struct {
+    const char* data;
+    size_t size;
+    size_t offset;
+    bool failed;  // A take went past the end; all later ones fail too
+} StateReader;
+
+// Start of the next count items of size bytes, NULL past the end
+static const char* take(StateReader* reader, size_t size, size_t count) {
+    if (reader->failed || count > (reader->size - reader->offset) / size) {
+        reader->failed = true;
+        return NULL;
+    }
+    const char* items = reader->data + reader->offset;
+    reader->offset += size * count;
+    return items;
+}
+
+static int take_value(StateReader* reader, void* value, size_t size) {
+    const char* item = take(reader, size, 1);
+    if (!item) return -1;
+    memcpy(value, item, size);
+    return 0;
+}
+
+// Reads the rest of file into memory; returns a LOAD_ result
+static int read_rest(FILE* file, char** data, size_t* size) {
+    size_t capacity = 1 << 16;
+    size_t used = 0;
+    char* buffer = (char*)malloc(capacity);
+    while (buffer) {
+        used += fread(buffer + used, 1, capacity - used, file);
+        if (used < capacity) break;
+        capacity *= 2;
+        char* grown = (char*)realloc(buffer, capacity);
+        if (!grown) free(buffer);
+        buffer = grown;
+    }
+    if (!buffer) return LOAD_NO_MEMORY;
+    if (ferror(file)) {
+        free(buffer);
+        return LOAD_BAD_FILE;
+    }
+    *data = buffer;
+    *size = used;
+    return LOAD_OK;
+}
+
+// Dendrite state, prefixed by each dendrite's synapse count, then the
+// compartment potentials of the cables
+static int write_dendrites(const Network* net, FILE* file) {
+    size_t count =
+        (size_t)net->config.num_pyramidal * net->config.num_dendrites;
+    size_t cells = (size_t)net->morphology->num_compartments *
+                   net->cable->stride;
+    int status = 0;
+    for (size_t d = 0; d < count; d++) {
+        const Dendrite* dendrite = net->dendrites[d];
+        double state[3] = {dendrite->local_potential,
+                           dendrite->calcium_concentration,
+                           dendrite->nmda_conductance};
+        status |= write_block(file, &dendrite->num_synapses, sizeof(int), 1);
+        status |= write_block(file, state, sizeof(double), 3);
+        status |= write_block(file, dendrite->synapses, sizeof(Synapse),
+                              dendrite->num_synapses);
+    }
+    status |= write_block(file, net->cable->v, sizeof(double), cells);
+    return status;
+}
+
+// Locates the dendrite state; returns a LOAD_ result
+static int stage_dendrites(const Network* net, StateReader* reader,
+                           const char** dendrites) {
+    size_t count =
+        (size_t)net->config.num_pyramidal * net->config.num_dendrites;
+    *dendrites = reader->data + reader->offset;
+    for (size_t d = 0; d < count; d++) {
+        int num_synapses;
+        if (take_value(reader, &num_synapses, sizeof(int)) != 0 ||
+            !take(reader, sizeof(double), 3)) {
+            return LOAD_BAD_FILE;
+        }
+        if (num_synapses != net->dendrites[d]->num_synapses) {
+            return LOAD_MISMATCH;
+        }
+        if (!take(reader, sizeof(Synapse), num_synapses)) return LOAD_BAD_FILE;
+    }
+    size_t cells = (size_t)net->morphology->num_compartments *
+                   net->cable->stride;
+    return take(reader, sizeof(double), cells) ? LOAD_OK : LOAD_BAD_FILE;
+}
+
+static void apply_dendrites(Network* net, const char* data) {
+    size_t count =
+        (size_t)net->config.num_pyramidal * net->config.num_dendrites;
+    for (size_t d = 0; d < count; d++) {
+        Dendrite* dendrite = net->dendrites[d];
+        double state[3];
+        data += sizeof(int);
+        memcpy(state, data, sizeof(state));
+        data += sizeof(state);
+        memcpy(dendrite->synapses, data,
+               dendrite->num_synapses * sizeof(Synapse));
+        data += dendrite->num_synapses * sizeof(Synapse);
+        dendrite->local_potential = state[0];
+        dendrite->calcium_concentration = state[1];
+        dendrite->nmda_conductance = state[2];
+        dendrite_rebuild_active(dendrite);
+    }
+    size_t cells = (size_t)net->morphology->num_compartments *
+                   net->cable->stride;
+    memcpy(net->cable->v, data, cells * sizeof(double));
+}
+
+// Layout of a rewired connectivity and the rewiring state, ahead of the
+// weights
+static int write_structure(const Network* net, FILE* file) {
+    const Connectivity* conn = net->connectivity;
+    const StructuralState* structural = net->structural;
+    int n = conn->num_neurons;
+    int slots = conn_num_slots(conn);
+    int entries = conn->col_ptr[n];
+    int status = write_block(file, &entries, sizeof(int), 1);
+    status |= write_block(file, conn->row_ptr, sizeof(int), n + 1);
+    status |= write_block(file, conn->row_end, sizeof(int), n);
+    status |= write_block(file, conn->targets, sizeof(int), slots);
+    status |= write_block(file, conn->synapse_col, sizeof(int), slots);
+    status |= write_block(file, conn->col_ptr, sizeof(int), n + 1);
+    status |= write_block(file, conn->col_end, sizeof(int), n);
+    status |= write_block(file, conn->col_sources, sizeof(int), entries);
+    status |= write_block(file, conn->col_synapse, sizeof(int), entries);
+    status |= write_block(file, &structural->step, sizeof(int), 1);
+    status |= write_block(file, &structural->rng, sizeof(RandomState), 1);
+    status |= write_block(file, &structural->pruned, sizeof(long long), 1);
+    status |= write_block(file, &structural->formed, sizeof(long long), 1);
+    status |= write_block(file, structural->spikes, sizeof(int), n);
+    status |= write_block(file, structural->silent, sizeof(uint8_t), slots);
+    return status;
+}
+
+// Rewired layout and rewiring state of a checkpoint, copied aside and
+// only swapped into the network by commit_structure()
+typedef struct {
+    Connectivity* conn;
+    int slots;
+    int step;
+    RandomState rng;
+    long long pruned;
+    long long formed;
+    int* spikes;
+    uint8_t* silent;
+    double* trace;   // Eligibility of the slots, with reward learning
+    int* last_step;
+} StructureImage;
+
+static void free_structure_image(StructureImage* image) {
+    destroy_connectivity(image->conn);
+    free(image->spikes);
+    free(image->silent);
+    free(image->trace);
+    free(image->last_step);
+}
+
+// Checks the checkpoint's layout of slots slots and copies it into image,
+// sized for the per-slot state that follows; returns a LOAD_ result
+static int stage_structure(const Network* net, StateReader* reader,
+                           int num_synapses, int slots,
+                           StructureImage* image) {
+    int n = net->connectivity->num_neurons;
+    int entries;
+    if (take_value(reader, &entries, sizeof(int)) != 0 || entries < 0) {
+        return LOAD_BAD_FILE;
+    }
+    const char* row_ptr = take(reader, sizeof(int), n + 1);
+    const char* row_end = take(reader, sizeof(int), n);
+    const char* targets = take(reader, sizeof(int), slots);
+    const char* synapse_col = take(reader, sizeof(int), slots);
+    const char* col_ptr = take(reader, sizeof(int), n + 1);
+    const char* col_end = take(reader, sizeof(int), n);
+    const char* col_sources = take(reader, sizeof(int), entries);
+    const char* col_synapse = take(reader, sizeof(int), entries);
+    const char* state = take(reader, sizeof(int) + sizeof(RandomState) +
+                                         2 * sizeof(long long),
+                             1);
+    const char* spikes = take(reader, sizeof(int), n);
+    const char* silent = take(reader, sizeof(uint8_t), slots);
+    if (reader->failed) return LOAD_BAD_FILE;
+    int last_row;
+    int last_col;
+    memcpy(&last_row, row_ptr + n * sizeof(int), sizeof(int));
+    memcpy(&last_col, col_ptr + n * sizeof(int), sizeof(int));
+    if (last_row != slots || last_col != entries) return LOAD_BAD_FILE;
+
+    Connectivity* conn = (Connectivity*)calloc(1, sizeof(Connectivity));
+    if (!conn) return LOAD_NO_MEMORY;
+    image->conn = conn;
+    image->slots = slots;
+    conn->num_neurons = n;
+    conn->num_synapses = num_synapses;
+    conn->row_ptr = (int*)malloc((n + 1) * sizeof(int));
+    conn->row_end = (int*)malloc((n + 1) * sizeof(int));
+    conn->targets = (int*)malloc((slots + 1) * sizeof(int));
+    conn->weights = (double*)calloc(slots + 1, sizeof(double));
+    conn->synapse_col = (int*)malloc((slots + 1) * sizeof(int));
+    conn->col_ptr = (int*)malloc((n + 1) * sizeof(int));
+    conn->col_end = (int*)malloc((n + 1) * sizeof(int));
+    conn->col_sources = (int*)malloc((entries + 1) * sizeof(int));
+    conn->col_synapse = (int*)malloc((entries + 1) * sizeof(int));
+    image->spikes = (int*)malloc((n + 1) * sizeof(int));
+    image->silent = (uint8_t*)calloc(slots + 1, sizeof(uint8_t));
+    if (net->eligibility) {
+        image->trace = (double*)calloc(slots + 1, sizeof(double));
+        image->last_step = (int*)calloc(slots + 1, sizeof(int));
+    }
+    if (!conn->row_ptr || !conn->row_end || !conn->targets ||
+        !conn->weights || !conn->synapse_col || !conn->col_ptr ||
+        !conn->col_end || !conn->col_sources || !conn->col_synapse ||
+        !image->spikes || !image->silent ||
+        (net->eligibility && (!image->trace || !image->last_step))) {
+        return LOAD_NO_MEMORY;
+    }
+
+    memcpy(conn->row_ptr, row_ptr, (n + 1) * sizeof(int));
+    memcpy(conn->row_end, row_end, n * sizeof(int));
+    memcpy(conn->targets, targets, slots * sizeof(int));
+    memcpy(conn->synapse_col, synapse_col, slots * sizeof(int));
+    memcpy(conn->col_ptr, col_ptr, (n + 1) * sizeof(int));
+    memcpy(conn->col_end, col_end, n * sizeof(int));
+    memcpy(conn->col_sources, col_sources, entries * sizeof(int));
+    memcpy(conn->col_synapse, col_synapse, entries * sizeof(int));
+    memcpy(&image->step, state, sizeof(int));
+    state += sizeof(int);
+    memcpy(&image->rng, state, sizeof(RandomState));
+    state += sizeof(RandomState);
+    memcpy(&image->pruned, state, sizeof(long long));
+    memcpy(&image->formed, state + sizeof(long long), sizeof(long long));
+    memcpy(image->spikes, spikes, n * sizeof(int));
+    memcpy(image->silent, silent, slots);
+    return LOAD_OK;
+}
+
+// Replaces the connectivity and the per-slot state by the image's, which
+// is left empty
+static void commit_structure(Network* net, StructureImage* image) {
+    StructuralState* structural = net->structural;
+    free(structural->silent);
+    structural->silent = image->silent;
+    structural->num_slots = image->slots;
+    memcpy(structural->spikes, image->spikes,
+           structural->num_neurons * sizeof(int));
+    structural->step = image->step;
+    structural->rng = image->rng;
+    structural->pruned = image->pruned;
+    structural->formed = image->formed;
+    if (net->eligibility) {
+        EligibilityState* elig = net->eligibility;
+        free(elig->trace);
+        free(elig->last_step);
+        elig->trace = image->trace;
+        elig->last_step = image->last_step;
+        elig->last_step[image->slots] = elig->step;
+        elig->num_synapses = image->slots;
+    }
+    destroy_connectivity(net->connectivity);
+    net->connectivity = image->conn;
+    free(image->spikes);
+    memset(image, 0, sizeof(StructureImage));
+}
+
+int save_network_checkpoint(const Network* net, FILE* file) {
+    int total_neurons = net->config.num_pyramidal + net->config.num_inhibitory;
+    size_t ring_size = (size_t)(net->delay_steps + 1) * total_neurons;
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.num_pyramidal = net->config.num_pyramidal;
+    header.num_inhibitory = net->config.num_inhibitory;
+    header.num_synapses = net->connectivity->num_synapses;
+    header.delay_steps = net->delay_steps;
+    header.ring_head = net->ring_head;
+    header.has_stdp = net->stdp != NULL;
+    header.has_eligibility = net->eligibility != NULL;
+    header.has_structural = net->structural != NULL;
+    header.activity_window = net->activity ? net->activity->window_steps : 0;
+    header.num_slots = conn_num_slots(net->connectivity);
+    header.num_streams = net->num_streams;
+    header.reorder = net->config.reorder;
+    header.num_dendrites = net->dendrites ? net->config.num_dendrites : 0;
+    header.num_compartments =
+        net->morphology ? net->morphology->num_compartments : 0;
+    header.rank = net->transport ? net->transport->rank : 0;
+    header.num_ranks = net->transport ? net->transport->num_ranks : 1;
+    header.window_fill = net->window_fill;
+    header.window_send_count = net->window_send_count;
+    header.population_freq_p = net->population_freq_p;
+    header.population_freq_i = net->population_freq_i;
+    memcpy(header.total_spikes, net->total_spikes, sizeof(header.total_spikes));
+
+    int status = write_block(file, &header, sizeof(header), 1);
+    for (int t = 0; t < net->num_streams; t++) {
+        status |= write_block(file, &net->streams[t].rng, sizeof(RandomState),
+                              1);
+    }
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        const Population* pop = &net->populations[p];
+        status |= write_block(file, pop->neurons, sizeof(Neuron), pop->count);
+        status |= write_block(file, pop->syn_exc, sizeof(double), pop->count);
+        status |= write_block(file, pop->syn_inh, sizeof(double), pop->count);
+    }
+    if (net->structural) status |= write_structure(net, file);
+    status |= write_block(file, net->connectivity->weights, sizeof(double),
+                          header.num_slots);
+    status |= write_block(file, net->input_exc, sizeof(double), ring_size);
+    status |= write_block(file, net->input_inh, sizeof(double), ring_size);
+    if (net->stdp) {
+        status |= write_block(file, net->stdp->pre_trace, sizeof(double),
+                              total_neurons);
+        status |= write_block(file, net->stdp->post_trace, sizeof(double),
+                              total_neurons);
+    }
+    if (net->eligibility) {
+        status |= write_block(file, &net->eligibility->step, sizeof(int), 1);
+        status |= write_block(file, &net->eligibility->expected_reward,
+                              sizeof(double), 1);
+        status |= write_block(file, net->eligibility->trace, sizeof(double),
+                              header.num_slots);
+        status |= write_block(file, net->eligibility->last_step, sizeof(int),
+                              header.num_slots);
+    }
+    if (net->dendrites) status |= write_dendrites(net, file);
+    if (net->activity) {
+        const ActivityMonitor* activity = net->activity;
+        status |= write_block(file, &activity->fill, sizeof(int), 1);
+        status |= write_block(file, &activity->totals, sizeof(ActivityTotals),
+                              1);
+        status |= write_block(file, activity->bits, sizeof(uint64_t),
+                              activity->num_words);
+        status |= write_block(file, activity->previous, sizeof(uint64_t),
+                              activity->num_words);
+    }
+    // Own spikes of a window in progress
+    status |= write_block(file, net->window_send, sizeof(SpikeRecord),
+                          net->window_send_count);
+
+    return status;
+}
+
+// Parts of a checkpoint in its data, all located and checked before the
+// first is copied into the network
+typedef struct {
+    CheckpointHeader header;
+    const char* streams;
+    const char* neurons[NUM_POPULATIONS];
+    const char* syn_exc[NUM_POPULATIONS];
+    const char* syn_inh[NUM_POPULATIONS];
+    StructureImage structure;
+    const char* weights;
+    const char* input_exc;
+    const char* input_inh;
+    const char* pre_trace;
+    const char* post_trace;
+    int eligibility_step;
+    double expected_reward;
+    const char* trace;
+    const char* last_step;
+    const char* dendrites;
+    int activity_fill;
+    ActivityTotals activity_totals;
+    const char* activity_bits;
+    const char* activity_previous;
+    const char* window_send;
+} CheckpointSections;
+
+static int stage_checkpoint(const Network* net, StateReader* reader,
+                            CheckpointSections* sections) {
+    int total_neurons = net->config.num_pyramidal + net->config.num_inhibitory;
+    size_t ring_size = (size_t)(net->delay_steps + 1) * total_neurons;
+    CheckpointHeader* header = &sections->header;
+    if (take_value(reader, header, sizeof(CheckpointHeader)) != 0 ||
+        memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->ring_head < 0 || header->ring_head > header->delay_steps ||
+        header->num_synapses < 0 ||
+        header->num_slots < header->num_synapses ||
+        header->window_fill < 0 || header->window_send_count < 0) {
+        return LOAD_BAD_FILE;
+    }
+
+    // The checkpoint must come from a network of the same shape
+    if (header->num_pyramidal != net->config.num_pyramidal ||
+        header->num_inhibitory != net->config.num_inhibitory ||
+        header->delay_steps != net->delay_steps ||
+        header->has_stdp != (net->stdp != NULL) ||
+        header->has_eligibility != (net->eligibility != NULL) ||
+        header->has_structural != (net->structural != NULL) ||
+        header->activity_window !=
+            (net->activity ? net->activity->window_steps : 0) ||
+        // A rewired network brings its own layout, others must match
+        (!net->structural &&
+         (header->num_synapses != net->connectivity->num_synapses ||
+          header->num_slots != conn_num_slots(net->connectivity))) ||
+        header->num_streams != net->num_streams ||
+        header->reorder != (int)net->config.reorder ||
+        header->num_dendrites !=
+            (net->dendrites ? net->config.num_dendrites : 0) ||
+        header->num_compartments !=
+            (net->morphology ? net->morphology->num_compartments : 0) ||
+        header->rank != (net->transport ? net->transport->rank : 0) ||
+        header->num_ranks !=
+            (net->transport ? net->transport->num_ranks : 1) ||
+        header->window_fill >= net->window_steps ||
+        (net->transport &&
+         header->window_send_count > net->transport->capacity) ||
+        (!net->transport && header->window_send_count != 0)) {
+        return LOAD_MISMATCH;
+    }
+
+    size_t slots = (size_t)header->num_slots;
+    sections->streams = take(reader, sizeof(RandomState), net->num_streams);
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        int count = net->populations[p].count;
+        sections->neurons[p] = take(reader, sizeof(Neuron), count);
+        sections->syn_exc[p] = take(reader, sizeof(double), count);
+        sections->syn_inh[p] = take(reader, sizeof(double), count);
+    }
+    if (reader->failed) return LOAD_BAD_FILE;
+    if (net->structural) {
+        int result = stage_structure(net, reader, header->num_synapses,
+                                     header->num_slots, &sections->structure);
+        if (result != LOAD_OK) return result;
+    }
+    sections->weights = take(reader, sizeof(double), slots);
+    sections->input_exc = take(reader, sizeof(double), ring_size);
+    sections->input_inh = take(reader, sizeof(double), ring_size);
+    if (net->stdp) {
+        sections->pre_trace = take(reader, sizeof(double), total_neurons);
+        sections->post_trace = take(reader, sizeof(double), total_neurons);
+    }
+    if (net->eligibility) {
+        take_value(reader, &sections->eligibility_step, sizeof(int));
+        take_value(reader, &sections->expected_reward, sizeof(double));
+        sections->trace = take(reader, sizeof(double), slots);
+        sections->last_step = take(reader, sizeof(int), slots);
+    }
+    if (reader->failed) return LOAD_BAD_FILE;
+    if (net->dendrites) {
+        int result = stage_dendrites(net, reader, &sections->dendrites);
+        if (result != LOAD_OK) return result;
+    }
+    if (net->activity) {
+        const ActivityMonitor* activity = net->activity;
+        if (take_value(reader, &sections->activity_fill, sizeof(int)) != 0 ||
+            sections->activity_fill < 0 ||
+            sections->activity_fill >= activity->window_steps ||
+            take_value(reader, &sections->activity_totals,
+                       sizeof(ActivityTotals)) != 0) {
+            return LOAD_BAD_FILE;
+        }
+        sections->activity_bits =
+            take(reader, sizeof(uint64_t), activity->num_words);
+        sections->activity_previous =
+            take(reader, sizeof(uint64_t), activity->num_words);
+    }
+    sections->window_send =
+        take(reader, sizeof(SpikeRecord), header->window_send_count);
+    return reader->failed ? LOAD_BAD_FILE : LOAD_OK;
+}
+
+static void apply_checkpoint(Network* net, CheckpointSections* sections) {
+    const CheckpointHeader* header = &sections->header;
+    int total_neurons = net->config.num_pyramidal + net->config.num_inhibitory;
+    size_t ring_size = (size_t)(net->delay_steps + 1) * total_neurons;
+    size_t slots = (size_t)header->num_slots;
+
+    // Chunks, and with them the generator streams, only depend on the
+    // configuration, so a restored run continues identically on any
+    // number of threads
+    for (int t = 0; t < net->num_streams; t++) {
+        memcpy(&net->streams[t].rng,
+               sections->streams + t * sizeof(RandomState),
+               sizeof(RandomState));
+    }
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        Population* pop = &net->populations[p];
+        memcpy(pop->neurons, sections->neurons[p],
+               pop->count * sizeof(Neuron));
+        memcpy(pop->syn_exc, sections->syn_exc[p],
+               pop->count * sizeof(double));
+        memcpy(pop->syn_inh, sections->syn_inh[p],
+               pop->count * sizeof(double));
+    }
+    if (net->eligibility) {
+        net->eligibility->step = sections->eligibility_step;
+        net->eligibility->expected_reward = sections->expected_reward;
+    }
+    if (net->structural) commit_structure(net, &sections->structure);
+    memcpy(net->connectivity->weights, sections->weights,
+           slots * sizeof(double));
+    memcpy(net->input_exc, sections->input_exc, ring_size * sizeof(double));
+    memcpy(net->input_inh, sections->input_inh, ring_size * sizeof(double));
+    if (net->stdp) {
+        memcpy(net->stdp->pre_trace, sections->pre_trace,
+               total_neurons * sizeof(double));
+        memcpy(net->stdp->post_trace, sections->post_trace,
+               total_neurons * sizeof(double));
+    }
+    if (net->eligibility) {
+        memcpy(net->eligibility->trace, sections->trace,
+               slots * sizeof(double));
+        memcpy(net->eligibility->last_step, sections->last_step,
+               slots * sizeof(int));
+    }
+    if (net->dendrites) apply_dendrites(net, sections->dendrites);
+    if (net->activity) {
+        ActivityMonitor* activity = net->activity;
+        activity->fill = sections->activity_fill;
+        activity->totals = sections->activity_totals;
+        memcpy(activity->bits, sections->activity_bits,
+               activity->num_words * sizeof(uint64_t));
+        memcpy(activity->previous, sections->activity_previous,
+               activity->num_words * sizeof(uint64_t));
+    }
+    memcpy(net->window_send, sections->window_send,
+           header->window_send_count * sizeof(SpikeRecord));
+    net->window_fill = header->window_fill;
+    net->window_send_count = header->window_send_count;
+
+    net->ring_head = header->ring_head;
+    net->population_freq_p = header->population_freq_p;
+    net->population_freq_i = header->population_freq_i;
+    memcpy(net->total_spikes, header->total_spikes, sizeof(net->total_spikes));
+}
+
+int load_network_checkpoint(Network* net, FILE* file) {
+    char* data = NULL;
+    size_t size = 0;
+    int result = read_rest(file, &data, &size);
+    if (result != LOAD_OK) return result;
+
+    StateReader reader = {data, size, 0, false};
+    CheckpointSections sections;
+    memset(&sections, 0, sizeof(sections));
+    result = stage_checkpoint(net, &reader, &sections);
+    if (result == LOAD_OK) apply_checkpoint(net, &sections);
+    free_structure_image(&sections.structure);
+    free(data);
+    return result;
+}
@@ -3,13 +3,59 @@
 
 #include <stdbool.h>
 
+#include "activity.h"
+#include "background.h"
+#include "cable.h"
+#include "connectivity.h"
+#include "connectome.h"
 #include "dendrite.h"
+#include "gap_junction.h"
+#include "mechanisms/stdp.h"
+#include "mechanisms/structural.h"
 #include "neuron.h"
+#include "neuron_models.h"
+#include "reorder.h"
+#include "scheduler.h"
 #include "synapse.h"
+#include "utils/transport.h"
 
 #define MAX_NEURONS 505
 #define MAX_CONNECTIONS 50000
 
+enum { POP_PYRAMIDAL = 0, POP_INHIBITORY, NUM_POPULATIONS };
+
+// Phases of update_network() timed in Network.phase_time
+enum { PHASE_NEURONS = 0, PHASE_DELIVERY, PHASE_PLASTICITY, NUM_PHASES };
+
+// Neuron updates are split into chunks of about this estimated cost, in
+// point-neuron updates; measured times replace the estimate after a step
+#define NEURON_CHUNK_COST 32.0
+
+// Estimated cost of one dendritic synapse and one cable compartment
+// relative to a point neuron
+#define DENDRITE_SYNAPSE_COST 0.25
+#define COMPARTMENT_COST 0.05
+
+// Half-width of the uniform test noise current (mV/ms) neurons receive
+// without background drive
+#define TEST_NOISE_AMPLITUDE 10.0
+
+// Initial weights of the connectivity are uniform in [0, this)
+#define MAX_INITIAL_WEIGHT 0.1
+
+// Conductance a spike adds to each dendritic synapse it reaches
+#define DENDRITE_SPIKE_CONDUCTANCE 1.0
+
+// Weight of the latest measurement in the running chunk costs
+#define CHUNK_COST_SMOOTHING 0.25
+
+// Work item of the neuron update: neurons [begin, end) of a population
+typedef struct {
+    int population;
+    int begin;
+    int end;
+} NeuronChunk;
+
 typedef struct {
     int num_pyramidal;
     int num_inhibitory;
@@ -17,22 +63,212 @@ typedef struct {
     double simulation_time;
     double connection_rate;
     char* output_dir;
+    unsigned int seed;
+    ReorderMethod reorder;  // Renumbering of neurons for delivery locality
+    // Connectome file to map instead of building the connectivity, NULL
+    // to build it; see save_network_connectome()
+    char* connectome_file;
+
+    // Neuron model and parameters of each population
+    PopulationConfig pyramidal;
+    PopulationConfig inhibitory;
+
+    // Synaptic transmission
+    double tau_syn;         // Synaptic current/conductance decay (ms)
+    double w_exc;           // Scale of weights from pyramidal neurons
+    double w_inh;           // Scale of weights from inhibitory neurons
+    double synaptic_delay;  // Transmission delay (ms)
+
+    // External Poisson drive; num_sources == 0 keeps the uniform test noise
+    BackgroundParams background;
+
+    // Dendrites of every pyramidal neuron; 0 keeps point neurons. Each
+    // dendrite is an unbranched cable from the soma whose synapses drive
+    // its distal compartment.
+    int num_dendrites;
+    int synapses_per_dendrite;  // Mean; each dendrite draws 1..2*mean-1
+    int dendrite_compartments;  // Compartments per dendrite
+    double dendrite_coupling;   // Axial rate between compartments (1/ms)
+    double dendrite_tau;        // Leak time constant of a compartment (ms)
+    double dendrite_soma_ratio; // Compartment over soma capacitance
+
+    // Gap junctions between inhibitory neurons: each pair is coupled with
+    // probability gap_junction_rate (0 disables them) at the conductance
+    // (1/ms). Relaxation iterations keep strong coupling stable; 0 couples
+    // explicitly.
+    double gap_junction_rate;
+    double gap_junction_conductance;
+    int gap_junction_iterations;
+
+    // Spike-timing-dependent plasticity
+    bool enable_stdp;
+    STDPParams stdp;
+
+    // Reward-modulated (three-factor) learning on top of STDP
+    bool enable_reward_learning;
+    EligibilityParams eligibility;
+
+    // Pruning and formation of synapses at run time
+    bool enable_structural;
+    StructuralParams structural;
+
+    // Window (ms) of the synchrony and overlap statistics, 0 disables them
+    double activity_window;
 } NetworkConfig;
 
-typedef struct {
+typedef struct Network {
     NetworkConfig config;
     Neuron* pyramidal_neurons;
     Neuron* inhibitory_neurons;
-    bool* connection_matrix;
+    Population populations[NUM_POPULATIONS];
+    bool* connection_matrix;  // NULL when mapped from a connectome file
+    Connectivity* connectivity;
+    // Storage order of reordered networks, NULL in creation order
+    int* internal_id;  // Creation-order id -> storage id
+    int* external_id;  // Storage id -> creation-order id
+    STDPState* stdp;
+    EligibilityState* eligibility;
+    StructuralState* structural;
+    ActivityMonitor* activity;  // Windows of the populations' spikes
+    BackgroundInput* background;
+    GapJunctions* gap_junctions;  // Among inhibitory neurons, NULL without
+    Dendrite** dendrites;  // num_dendrites per pyramidal neuron, by id
+    Morphology* morphology;  // Shared by all pyramidal neurons
+    CableState* cable;       // One cell per pyramidal neuron, by id
+    double* soma_v;          // Soma potentials handed to the cable solve
+    double* soma_current;    // Axial current the cables feed the somata
+    // Dendritic synapses fed by each neuron (storage id), CSR rows of
+    // dendrite * MAX_SYNAPSES_PER_DENDRITE + synapse
+    int* dendrite_input_ptr;
+    int* dendrite_inputs;
+    int* spike_ids;  // Global ids of neurons that spiked this step
+    int num_spikes;
+
+    // Neuron update work items, scheduled with work stealing. Every chunk
+    // draws from its own generator, so results do not depend on which
+    // thread runs it or on the number of threads.
+    NeuronChunk* chunks;
+    int num_chunks;
+    int* chunk_spikes;   // Spikes of each chunk this step
+    double* chunk_cost;  // Cost estimate of each chunk
+    double* chunk_time;  // Measured seconds of each chunk this step
+    bool chunk_cost_measured;
+    // Spike buffers of update_network_block(), allocated on first use:
+    // delay_steps steps of all neurons and of all chunk counts
+    int* block_ids;
+    int* block_spikes;
+    RandomStream* streams;  // One generator per chunk
+    int num_streams;
+    TaskScheduler* scheduler;
+
+    // Partitioned runs: this process updates chunks [chunk_begin,
+    // chunk_end), which hold neurons [owned_begin, owned_end), and only
+    // delivers to those. Spikes are exchanged with the other ranks once
+    // every window_steps steps, the synaptic delay, so remote spikes still
+    // arrive in time.
+    int chunk_begin;
+    int chunk_end;
+    int owned_begin;
+    int owned_end;
+    SpikeTransport* transport;  // NULL when this process owns everything
+    int window_steps;
+    int window_fill;            // Steps of the current window done
+    SpikeRecord* window_send;   // Own spikes of the window
+    int window_send_count;
+    SpikeRecord* window_packed; // The same in the exchange format
+    SpikeRecord* window_recv;   // Everyone's spikes of the window
+    int* window_ids;            // Received spikes bucketed by step
+    int* window_offsets;        // window_steps + 1 bucket starts
+    bool transport_failed;
+
+    // Delay ring of synaptic input, (delay_steps + 1) slots of all neurons
+    double* input_exc;
+    double* input_inh;
+    int delay_steps;
+    int ring_head;
+    double syn_decay;
+
     double population_freq_p;
     double population_freq_i;
+    long long total_spikes[NUM_POPULATIONS];
+    double phase_time[NUM_PHASES];  // Wall-clock seconds spent per phase
     FILE* output_files[3];
 } Network;
 
+// Neuron by global id; pyramidal neurons come first
+static inline Neuron* network_neuron(const Network* net, int id) {
+    return id < net->config.num_pyramidal
+               ? &net->pyramidal_neurons[id]
+               : &net->inhibitory_neurons[id - net->config.num_pyramidal];
+}
+
+// Dendrites of a neuron by storage id, NULL for point neurons
+static inline Dendrite** network_dendrites(const Network* net, int id) {
+    return net->dendrites && id < net->config.num_pyramidal
+               ? net->dendrites + (size_t)id * net->config.num_dendrites
+               : NULL;
+}
+
+// Ids inside the network are storage ids. Everything seen from outside
+// (probes, recordings, exports) uses creation-order ids, which differ only
+// when the network was reordered.
+static inline int network_internal_id(const Network* net, int id) {
+    return net->internal_id ? net->internal_id[id] : id;
+}
+
+static inline int network_external_id(const Network* net, int id) {
+    return net->external_id ? net->external_id[id] : id;
+}
+
 Network* create_network(NetworkConfig config);
 void destroy_network(Network* net);
+
+// Builds the connectivity create_network() would build for config and
+// writes it to path, for networks that set connectome_file to share it
+int save_network_connectome(NetworkConfig config, const char* path);
 void update_network(Network* net, double time);
 void save_network_state(Network* net, double time);
+// State file from values copied out of the network
+void write_network_state(const char* output_dir, double time, double freq_p,
+                         double freq_i);
+double deliver_reward(Network* net, double reward);
+
+// Called after each step of a block, with the step's spikes in spike_ids
+// as update_network() leaves them
+typedef void (*StepFunction)(void* context, int step);
+
+// Temporal blocking: no spike reaches another neuron sooner than the
+// synaptic delay, so every chunk advances up to delay_steps steps on its
+// own thread between two synchronizations, and the block's spikes are
+// then delivered step by step in order. Results match as many
+// update_network() calls except that dendritic synapses, which have no
+// delay, see spikes at the end of the block. Gap junctions couple neurons
+// within every step, so networks with them run single steps. Runs at most
+// max_steps (fewer at the end of a partitioned run's exchange window) and
+// returns the number of steps, or -1 if the buffers cannot be allocated.
+int update_network_block(Network* net, double time, int max_steps,
+                         StepFunction on_step, void* context);
+
+// Largest number of spikes one rank can send per exchange window
+int network_exchange_capacity(const Network* net);
+// Restricts the network to the transport's rank and exchanges spikes
+// through it from the next step on; the network owns the transport after
+// a successful call. Returns 0 on success.
+int partition_network(Network* net, SpikeTransport* transport);
+
+// Results of load_network_checkpoint()
+enum {
+    LOAD_OK = 0,
+    LOAD_MISMATCH = -1,   // The checkpoint is of a network of another shape
+    LOAD_BAD_FILE = -2,   // Truncated, inconsistent or unreadable
+    LOAD_NO_MEMORY = -3
+};
+
+// Binary checkpoints of the dynamic state (neurons, synapses, plasticity).
+// Loading reads the rest of file and leaves the network unchanged unless
+// it returns LOAD_OK.
+int save_network_checkpoint(const Network* net, FILE* file);
+int load_network_checkpoint(Network* net, FILE* file);
 
 // Network state management
 void save_network_state(Network* net, double time);
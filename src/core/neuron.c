@@ -12,19 +12,21 @@ void init_neuron(Neuron* neuron, bool is_inhibitory) {
     neuron->adaptation_current = 0.0;
     neuron->refractory_time = 0.0;
     neuron->last_spike_time = -1000.0;  // Başlangıçta spike yok
+    neuron->input_current = 0.0;
     neuron->is_inhibitory = is_inhibitory;
 }
 
 void update_neuron(Neuron* neuron, double dt) {
     // Basit Integrate-and-Fire model
+    // Input accumulated for this step is consumed even while refractory
+    double input_current = neuron->input_current;
+    neuron->input_current = 0.0;
+
     if (neuron->refractory_time > 0) {
         neuron->refractory_time -= dt;
         return;
     }
 
-    // Random input current (test için)
-    double input_current = ((double)rand() / RAND_MAX) * 20.0 - 10.0;
-
     // Update membrane potential
     double tau = 20.0;  // Time constant
     double dv = (-65.0 - neuron->membrane_potential) / tau + input_current;
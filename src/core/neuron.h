@@ -33,6 +33,7 @@ typedef struct {
     double adaptation_current;     // Adaptasyon akımı
     double refractory_time;        // Refractory period
     double last_spike_time;        // Son spike zamanı
+    double input_current;          // Bu adımda biriken giriş akımı
     bool is_inhibitory;            // İnhibitör nöron mu?
 } Neuron;
 
@@ -0,0 +1,382 @@
+#include "neuron_models.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Each model supplies three pieces:
+//   <model>_consts                  parameters reduced to what the step uses
+//   <model>_hoist(params, dt)       builds the constants once per call
+//   <model>_step(k, v, w, ref, ...) advances one neuron's potential,
+//                                   adaptation and refractory time, returns
+//                                   true on spike
+// DEFINE_NEURON_KERNEL then stamps out a population loop in which the
+// constants are loop invariants and the step is inlined, so the hot loop
+// carries no model or neuron type branches. Steps compute every outcome
+// before they select, so DEFINE_BATCH_KERNEL can run the same step across
+// trials in SIMD lanes with identical results.
+
+#define DEFINE_NEURON_KERNEL(model)                                          \
+    static int model##_kernel(Population* pop, int begin, int end,          \
+                              const KernelContext* ctx, int* spikes) {      \
+        const model##_consts k = model##_hoist(&pop->params, ctx->dt);      \
+        const double syn_decay = ctx->syn_decay;                            \
+        const double time = ctx->time;                                      \
+        Neuron* restrict neurons = pop->neurons;                            \
+        double* restrict g_exc = pop->syn_exc;                              \
+        double* restrict g_inh = pop->syn_inh;                              \
+        double* restrict in_exc = ctx->input_exc + pop->first_id;           \
+        double* restrict in_inh = ctx->input_inh + pop->first_id;           \
+        int num_spikes = 0;                                                 \
+                                                                            \
+        for (int i = begin; i < end; i++) {                                 \
+            g_exc[i] = g_exc[i] * syn_decay + in_exc[i];                    \
+            g_inh[i] = g_inh[i] * syn_decay + in_inh[i];                    \
+            in_exc[i] = 0.0;                                                \
+            in_inh[i] = 0.0;                                                \
+                                                                            \
+            Neuron* n = &neurons[i];                                        \
+            double input = n->input_current;                                \
+            n->input_current = 0.0;                                         \
+            if (model##_step(&k, &n->membrane_potential,                    \
+                             &n->adaptation_current, &n->refractory_time,   \
+                             g_exc[i], g_inh[i], input)) {                  \
+                n->last_spike_time = time;                                  \
+                spikes[num_spikes++] = i;                                   \
+            }                                                               \
+        }                                                                   \
+        return num_spikes;                                                  \
+    }
+
+// Lanes of a neuron a batch kernel steps before it collects their spikes
+#define BATCH_LANE_BLOCK 64
+
+// GCC threads jumps through the selects of a step and sinks values only
+// one outcome uses into that outcome's branch, which leaves control flow
+// in the lane loop and keeps it scalar. Without these passes each select
+// is a blend of doubles, which SSE2 has. On x86-64 the kernels also get
+// an AVX2 clone, picked at load time, with twice the lanes and a blend
+// instruction; AVX2 alone does not fuse multiply-adds, so both clones
+// round alike.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define BATCH_KERNEL_ATTRIBUTES                                     \
+    __attribute__((optimize("no-thread-jumps", "no-tree-sink"), \
+                   target_clones("avx2", "default")))
+#elif defined(__GNUC__) && !defined(__clang__)
+#define BATCH_KERNEL_ATTRIBUTES \
+    __attribute__((optimize("no-thread-jumps", "no-tree-sink")))
+#else
+#define BATCH_KERNEL_ATTRIBUTES
+#endif
+
+// The lane loop only loads and stores doubles, so its masks have the width
+// of the data; spikes go to the byte lanes in a second loop.
+#define DEFINE_BATCH_KERNEL(model)                                          \
+    BATCH_KERNEL_ATTRIBUTES                                                 \
+    static int model##_batch_kernel(const Population* pop,                  \
+                                    TrialLanes* lanes, int begin, int end,  \
+                                    const KernelContext* ctx) {             \
+        const model##_consts k = model##_hoist(&pop->params, ctx->dt);      \
+        const double syn_decay = ctx->syn_decay;                            \
+        const int trials = lanes->num_trials;                               \
+        const size_t stride = lanes->stride;                                \
+        double fired[BATCH_LANE_BLOCK];                                     \
+        int num_spikes = 0;                                                 \
+                                                                            \
+        for (int i = pop->first_id + begin; i < pop->first_id + end; i++) { \
+            for (int t0 = 0; t0 < trials; t0 += BATCH_LANE_BLOCK) {         \
+                const size_t row = (size_t)i * stride + t0;                 \
+                const int count = trials - t0 < BATCH_LANE_BLOCK            \
+                                      ? trials - t0                         \
+                                      : BATCH_LANE_BLOCK;                   \
+                double* restrict v = lanes->v + row;                        \
+                double* restrict w = lanes->adaptation + row;               \
+                double* restrict ref = lanes->refractory + row;             \
+                double* restrict ext = lanes->input + row;                  \
+                double* restrict g_exc = lanes->syn_exc + row;              \
+                double* restrict g_inh = lanes->syn_inh + row;              \
+                double* restrict in_exc = ctx->input_exc + row;             \
+                double* restrict in_inh = ctx->input_inh + row;             \
+                uint8_t* restrict spiked = lanes->spiked + row;             \
+                                                                            \
+                _Pragma("omp simd")                                         \
+                for (int t = 0; t < count; t++) {                           \
+                    g_exc[t] = g_exc[t] * syn_decay + in_exc[t];            \
+                    g_inh[t] = g_inh[t] * syn_decay + in_inh[t];            \
+                    in_exc[t] = 0.0;                                        \
+                    in_inh[t] = 0.0;                                        \
+                    double input = ext[t];                                  \
+                    ext[t] = 0.0;                                           \
+                    bool spike = model##_step(&k, &v[t], &w[t], &ref[t],    \
+                                              g_exc[t], g_inh[t], input);   \
+                    fired[t] = spike ? 1.0 : 0.0;                           \
+                }                                                           \
+                for (int t = 0; t < count; t++) {                           \
+                    spiked[t] = fired[t] != 0.0;                            \
+                    num_spikes += spiked[t];                                \
+                }                                                           \
+            }                                                               \
+        }                                                                   \
+        return num_spikes;                                                  \
+    }
+
+// ---------------------------------------------------------------------------
+// Leaky integrate-and-fire with current-based synapses
+
+typedef struct {
+    double dt;
+    double v_rest;
+    double v_threshold;
+    double v_reset;
+    double inv_tau_m;
+    double t_ref;
+} lif_consts;
+
+static inline lif_consts lif_hoist(const ModelParams* p, double dt) {
+    lif_consts k = {dt,
+                    p->base.v_resting,
+                    p->base.v_threshold,
+                    p->base.v_reset,
+                    1.0 / p->base.tau_m,
+                    p->base.refractory_period};
+    return k;
+}
+
+static inline bool lif_step(const lif_consts* k, double* v, double* w,
+                            double* ref, double g_exc, double g_inh,
+                            double input) {
+    (void)w;
+    double v0 = *v;
+    double r0 = *ref;
+    bool active = !(r0 > 0.0);
+    double v1 =
+        v0 + k->dt * ((k->v_rest - v0) * k->inv_tau_m + g_exc - g_inh + input);
+    double r1 = r0 - k->dt;
+    bool spike = active & (v1 >= k->v_threshold);
+
+    *v = spike ? k->v_reset : active ? v1 : v0;
+    *ref = spike ? k->t_ref : active ? r0 : r1;
+    return spike;
+}
+
+DEFINE_NEURON_KERNEL(lif)
+DEFINE_BATCH_KERNEL(lif)
+
+// ---------------------------------------------------------------------------
+// Conductance-based LIF: synaptic state is a conductance (1/ms) driving the
+// membrane toward the reversal potentials
+
+typedef struct {
+    lif_consts lif;
+    double e_exc;
+    double e_inh;
+} cond_lif_consts;
+
+static inline cond_lif_consts cond_lif_hoist(const ModelParams* p,
+                                             double dt) {
+    cond_lif_consts k = {lif_hoist(p, dt), p->e_exc, p->e_inh};
+    return k;
+}
+
+static inline bool cond_lif_step(const cond_lif_consts* k, double* v,
+                                 double* w, double* ref, double g_exc,
+                                 double g_inh, double input) {
+    (void)w;
+    double v0 = *v;
+    double r0 = *ref;
+    bool active = !(r0 > 0.0);
+    double i_syn = g_exc * (k->e_exc - v0) + g_inh * (k->e_inh - v0);
+    double v1 = v0 + k->lif.dt * ((k->lif.v_rest - v0) * k->lif.inv_tau_m +
+                                  i_syn + input);
+    double r1 = r0 - k->lif.dt;
+    bool spike = active & (v1 >= k->lif.v_threshold);
+
+    *v = spike ? k->lif.v_reset : active ? v1 : v0;
+    *ref = spike ? k->lif.t_ref : active ? r0 : r1;
+    return spike;
+}
+
+DEFINE_NEURON_KERNEL(cond_lif)
+DEFINE_BATCH_KERNEL(cond_lif)
+
+// ---------------------------------------------------------------------------
+// Adaptive exponential integrate-and-fire (Brette & Gerstner 2005), with
+// the adaptation variable w kept in adaptation_current
+
+typedef struct {
+    lif_consts lif;
+    double a;
+    double b;
+    double inv_tau_w;
+    double delta_t;
+    double inv_delta_t;
+    double v_peak;
+} adex_consts;
+
+static inline adex_consts adex_hoist(const ModelParams* p, double dt) {
+    adex_consts k = {lif_hoist(p, dt), p->adex_a,          p->adex_b,
+                     1.0 / p->adex_tau_w, p->adex_delta_t,
+                     1.0 / p->adex_delta_t, p->adex_v_peak};
+    return k;
+}
+
+static inline bool adex_step(const adex_consts* k, double* v, double* w,
+                             double* ref, double g_exc, double g_inh,
+                             double input) {
+    double v0 = *v;
+    double w0 = *w;
+    double r0 = *ref;
+    bool active = !(r0 > 0.0);
+
+    // Cap the exponent so a large dt cannot overflow before the reset
+    double arg = (v0 - k->lif.v_threshold) * k->inv_delta_t;
+    double spike_current = k->delta_t * exp(arg < 20.0 ? arg : 20.0);
+
+    double dv = ((k->lif.v_rest - v0) + spike_current) * k->lif.inv_tau_m -
+                w0 + g_exc - g_inh + input;
+    double dw = (k->a * (v0 - k->lif.v_rest) - w0) * k->inv_tau_w;
+    double v1 = v0 + k->lif.dt * dv;
+    double w1 = w0 + k->lif.dt * dw;
+    double w2 = w1 + k->b;
+    double r1 = r0 - k->lif.dt;
+    bool spike = active & (v1 >= k->v_peak);
+
+    *v = spike ? k->lif.v_reset : active ? v1 : v0;
+    *w = spike ? w2 : active ? w1 : w0;
+    *ref = spike ? k->lif.t_ref : active ? r0 : r1;
+    return spike;
+}
+
+DEFINE_NEURON_KERNEL(adex)
+DEFINE_BATCH_KERNEL(adex)
+
+// ---------------------------------------------------------------------------
+// Izhikevich (2003), with the recovery variable u kept in
+// adaptation_current
+
+typedef struct {
+    double dt;
+    double a;
+    double b;
+    double c;
+    double d;
+} izhikevich_consts;
+
+static inline izhikevich_consts izhikevich_hoist(const ModelParams* p,
+                                                 double dt) {
+    izhikevich_consts k = {dt, p->izh_a, p->izh_b, p->izh_c, p->izh_d};
+    return k;
+}
+
+static inline bool izhikevich_step(const izhikevich_consts* k, double* v,
+                                   double* u, double* ref, double g_exc,
+                                   double g_inh, double input) {
+    (void)ref;
+    double v0 = *v;
+    double u0 = *u;
+
+    double dv = 0.04 * v0 * v0 + 5.0 * v0 + 140.0 - u0 + g_exc - g_inh + input;
+    double du = k->a * (k->b * v0 - u0);
+    double v1 = v0 + k->dt * dv;
+    double u1 = u0 + k->dt * du;
+    double u2 = u1 + k->d;
+    bool spike = v1 >= 30.0;
+
+    *v = spike ? k->c : v1;
+    *u = spike ? u2 : u1;
+    return spike;
+}
+
+DEFINE_NEURON_KERNEL(izhikevich)
+DEFINE_BATCH_KERNEL(izhikevich)
+
+// ---------------------------------------------------------------------------
+// Registry
+
+typedef struct {
+    const char* name;
+    PopulationKernel kernel;
+    BatchKernel batch_kernel;
+} NeuronModelInfo;
+
+static const NeuronModelInfo model_registry[NUM_NEURON_MODELS] = {
+    [MODEL_LIF] = {"lif", lif_kernel, lif_batch_kernel},
+    [MODEL_ADEX] = {"adex", adex_kernel, adex_batch_kernel},
+    [MODEL_IZHIKEVICH] = {"izhikevich", izhikevich_kernel,
+                          izhikevich_batch_kernel},
+    [MODEL_COND_LIF] = {"cond_lif", cond_lif_kernel, cond_lif_batch_kernel},
+};
+
+void default_model_params(ModelParams* params, bool is_inhibitory) {
+    memset(params, 0, sizeof(ModelParams));
+
+    params->base.v_resting = -65.0;
+    params->base.v_threshold = -55.0;
+    params->base.v_reset = -75.0;
+    params->base.g_leak = 1.0;
+    params->base.tau_m = 20.0;
+    params->base.refractory_period = 2.0;
+    params->base.c_m = 1.0;
+
+    params->adex_a = 0.05;
+    params->adex_b = 0.5;
+    params->adex_tau_w = 100.0;
+    params->adex_delta_t = 2.0;
+    params->adex_v_peak = -40.0;
+
+    // Regular spiking pyramidal cells, fast spiking interneurons
+    params->izh_a = is_inhibitory ? 0.1 : 0.02;
+    params->izh_b = 0.2;
+    params->izh_c = -65.0;
+    params->izh_d = is_inhibitory ? 2.0 : 8.0;
+
+    params->e_exc = 0.0;
+    params->e_inh = -80.0;
+}
+
+int neuron_model_from_name(const char* name) {
+    for (int m = 0; m < NUM_NEURON_MODELS; m++) {
+        if (strcmp(name, model_registry[m].name) == 0) return m;
+    }
+    return -1;
+}
+
+const char* neuron_model_name(NeuronModelType model) {
+    return model_registry[model].name;
+}
+
+int init_population(Population* pop, const char* name, Neuron* neurons,
+                    int count, int first_id, const PopulationConfig* config) {
+    pop->name = name;
+    pop->neurons = neurons;
+    pop->count = count;
+    pop->first_id = first_id;
+    pop->model = config->model;
+    pop->params = config->params;
+    pop->kernel = model_registry[config->model].kernel;
+    pop->batch_kernel = model_registry[config->model].batch_kernel;
+
+    pop->syn_exc = (double*)calloc(count, sizeof(double));
+    pop->syn_inh = (double*)calloc(count, sizeof(double));
+    if (!pop->syn_exc || !pop->syn_inh) {
+        free_population(pop);
+        return -1;
+    }
+
+    // Izhikevich neurons start on the u nullcline
+    if (pop->model == MODEL_IZHIKEVICH) {
+        for (int i = 0; i < count; i++) {
+            neurons[i].adaptation_current =
+                pop->params.izh_b * neurons[i].membrane_potential;
+        }
+    }
+
+    return 0;
+}
+
+void free_population(Population* pop) {
+    free(pop->syn_exc);
+    free(pop->syn_inh);
+    pop->syn_exc = NULL;
+    pop->syn_inh = NULL;
+}
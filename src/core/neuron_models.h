@@ -0,0 +1,109 @@
+#ifndef NEURAL_NEURON_MODELS_H
+#define NEURAL_NEURON_MODELS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "neuron.h"
+
+typedef enum {
+    MODEL_LIF = 0,
+    MODEL_ADEX,
+    MODEL_IZHIKEVICH,
+    MODEL_COND_LIF,
+    NUM_NEURON_MODELS
+} NeuronModelType;
+
+// Parameters of every model; a population only reads its own model's
+// fields. Voltages in mV, times in ms, currents in mV/ms.
+typedef struct {
+    NeuronParams base;
+
+    // Adaptive exponential integrate-and-fire
+    double adex_a;        // Subthreshold adaptation coupling
+    double adex_b;        // Spike-triggered adaptation jump
+    double adex_tau_w;
+    double adex_delta_t;  // Slope factor
+    double adex_v_peak;
+
+    // Izhikevich
+    double izh_a;
+    double izh_b;
+    double izh_c;
+    double izh_d;
+
+    // Reversal potentials for conductance-based synapses
+    double e_exc;
+    double e_inh;
+} ModelParams;
+
+typedef struct {
+    NeuronModelType model;
+    ModelParams params;
+} PopulationConfig;
+
+// Per-step data shared by all population kernels
+typedef struct {
+    double dt;
+    double time;
+    double syn_decay;   // exp(-dt / tau_syn)
+    double* input_exc;  // Synaptic input arriving this step, by global id
+    double* input_inh;
+} KernelContext;
+
+struct Population;
+
+// Advances neurons [begin, end) of a population by one step and writes the
+// local indices of neurons that spiked to spikes; returns the spike count
+typedef int (*PopulationKernel)(struct Population* pop, int begin, int end,
+                                const KernelContext* ctx, int* spikes);
+
+// State of lockstep trials of the same network. Every array holds stride
+// trials per neuron, [global id * stride + trial], so a batch kernel runs
+// the trials of one neuron in SIMD lanes.
+#define TRIAL_LANES 8
+
+typedef struct {
+    int num_trials;
+    int stride;  // num_trials rounded up to a multiple of TRIAL_LANES
+    double* v;
+    double* adaptation;
+    double* refractory;
+    double* input;    // External current of the step, cleared by the kernel
+    double* syn_exc;
+    double* syn_inh;
+    uint8_t* spiked;  // 1 for trials in which the neuron spiked this step
+} TrialLanes;
+
+// Advances neurons [begin, end) of a population by one step in every
+// trial; the context's inputs use the lanes' layout. Returns the number
+// of spikes summed over trials.
+typedef int (*BatchKernel)(const struct Population* pop, TrialLanes* lanes,
+                            int begin, int end, const KernelContext* ctx);
+
+// A homogeneous group of neurons sharing one model and one parameter set
+typedef struct Population {
+    const char* name;
+    Neuron* neurons;
+    int count;
+    int first_id;  // Global id of neurons[0]
+    NeuronModelType model;
+    ModelParams params;
+    PopulationKernel kernel;
+    BatchKernel batch_kernel;
+
+    // Synaptic state (currents, or conductances for MODEL_COND_LIF)
+    double* syn_exc;
+    double* syn_inh;
+} Population;
+
+void default_model_params(ModelParams* params, bool is_inhibitory);
+int neuron_model_from_name(const char* name);
+const char* neuron_model_name(NeuronModelType model);
+
+int init_population(Population* pop, const char* name, Neuron* neurons,
+                    int count, int first_id, const PopulationConfig* config);
+void free_population(Population* pop);
+
+#endif
@@ -0,0 +1,116 @@
+#include "reorder.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const method_names[] = {"none", "rcm"};
+
+int reorder_method_from_name(const char* name) {
+    for (int m = 0; m < (int)(sizeof(method_names) / sizeof(*method_names));
+         m++) {
+        if (strcmp(name, method_names[m]) == 0) return m;
+    }
+    return -1;
+}
+
+const char* reorder_method_name(ReorderMethod method) {
+    return method_names[method];
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+int* reverse_cuthill_mckee(const Connectivity* conn, const int* group_end,
+                           int num_groups) {
+    int n = conn->num_neurons;
+    int* order = malloc((n > 0 ? n : 1) * sizeof(int));
+    int* degree = malloc((n > 0 ? n : 1) * sizeof(int));
+    char* visited = calloc(n > 0 ? n : 1, 1);
+    // Unvisited neighbours of one neuron keyed (degree << 32 | id); later
+    // the reversed order
+    uint64_t* keys = malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+    int* fill = malloc(num_groups * sizeof(int));
+    if (!order || !degree || !visited || !keys || !fill) {
+        fprintf(stderr, "Failed to allocate reordering buffers\n");
+        free(order);
+        free(degree);
+        free(visited);
+        free(keys);
+        free(fill);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++) {
+        degree[i] = (conn_row_end(conn, i) - conn_row_begin(conn, i)) +
+                    (conn_col_end(conn, i) - conn_col_begin(conn, i));
+    }
+
+    // Breadth-first search from a minimum-degree neuron of every
+    // component, visiting neighbours by increasing degree; order doubles as
+    // the queue
+    int head = 0, tail = 0;
+    while (tail < n) {
+        if (head == tail) {
+            int start = -1;
+            for (int i = 0; i < n; i++) {
+                if (!visited[i] && (start < 0 || degree[i] < degree[start])) {
+                    start = i;
+                }
+            }
+            visited[start] = 1;
+            order[tail++] = start;
+        }
+        int v = order[head++];
+        int count = 0;
+        for (int k = conn_row_begin(conn, v); k < conn_row_end(conn, v); k++) {
+            int u = conn->targets[k];
+            if (!visited[u]) {
+                visited[u] = 1;
+                keys[count++] = (uint64_t)degree[u] << 32 | (uint32_t)u;
+            }
+        }
+        for (int k = conn_col_begin(conn, v); k < conn_col_end(conn, v); k++) {
+            int u = conn->col_sources[k];
+            if (!visited[u]) {
+                visited[u] = 1;
+                keys[count++] = (uint64_t)degree[u] << 32 | (uint32_t)u;
+            }
+        }
+        qsort(keys, count, sizeof(uint64_t), compare_keys);
+        for (int c = 0; c < count; c++) order[tail++] = (int)(uint32_t)keys[c];
+    }
+
+    // Reverse, then stable-partition into the groups
+    for (int g = 0; g < num_groups; g++) {
+        fill[g] = g > 0 ? group_end[g - 1] : 0;
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        int v = order[i];
+        int g = 0;
+        while (g < num_groups - 1 && v >= group_end[g]) g++;
+        keys[fill[g]++] = (uint64_t)v;
+    }
+    for (int i = 0; i < n; i++) order[i] = (int)keys[i];
+
+    free(degree);
+    free(visited);
+    free(keys);
+    free(fill);
+    return order;
+}
+
+int connectivity_bandwidth(const Connectivity* conn) {
+    int bandwidth = 0;
+    for (int i = 0; i < conn->num_neurons; i++) {
+        for (int k = conn_row_begin(conn, i); k < conn_row_end(conn, i); k++) {
+            int distance = abs(conn->targets[k] - i);
+            if (distance > bandwidth) bandwidth = distance;
+        }
+    }
+    return bandwidth;
+}
@@ -0,0 +1,29 @@
+#ifndef NEURAL_REORDER_H
+#define NEURAL_REORDER_H
+
+#include "connectivity.h"
+
+// Renumbering of neurons for locality of synaptic delivery. With neurons in
+// creation order, the targets of a spike land anywhere in the input
+// buffers; after reordering, connected neurons get nearby ids, so each
+// thread's targets fall in a narrow, cache-resident range.
+
+typedef enum {
+    REORDER_NONE = 0,  // Keep creation order
+    REORDER_RCM,       // Reverse Cuthill-McKee within each population
+} ReorderMethod;
+
+int reorder_method_from_name(const char* name);
+const char* reorder_method_name(ReorderMethod method);
+
+// Reverse Cuthill-McKee order of the connectivity graph with edge
+// directions ignored. Neurons are grouped into consecutive id ranges
+// [group_end[g - 1], group_end[g]) that keep their place, so populations
+// stay contiguous. Returns order[new id] = old id, or NULL on failure.
+int* reverse_cuthill_mckee(const Connectivity* conn, const int* group_end,
+                           int num_groups);
+
+// Largest |source - target| over all synapses
+int connectivity_bandwidth(const Connectivity* conn);
+
+#endif
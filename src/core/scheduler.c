@@ -0,0 +1,181 @@
+#include "scheduler.h"
+
+#include <omp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return (uint64_t)end << 32 | begin;
+}
+
+// Front of the thread's own range, or -1 if it is empty
+static int take_front(TaskDeque* deque) {
+    uint64_t range = __atomic_load_n(&deque->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end) return -1;
+        if (__atomic_compare_exchange_n(&deque->range, &range,
+                                        pack_range(begin + 1, end), true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return (int)begin;
+        }
+    }
+}
+
+// Back of another thread's range, or -1 if it is empty
+static int take_back(TaskDeque* deque) {
+    uint64_t range = __atomic_load_n(&deque->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end) return -1;
+        if (__atomic_compare_exchange_n(&deque->range, &range,
+                                        pack_range(begin, end - 1), true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return (int)(end - 1);
+        }
+    }
+}
+
+TaskScheduler* create_task_scheduler(int num_threads) {
+    if (num_threads < 1) num_threads = 1;
+    TaskScheduler* scheduler = calloc(1, sizeof(TaskScheduler));
+    if (!scheduler) {
+        fprintf(stderr, "Failed to allocate task scheduler\n");
+        return NULL;
+    }
+    scheduler->num_threads = num_threads;
+    scheduler->deques = aligned_alloc(64, num_threads * sizeof(TaskDeque));
+    scheduler->split = malloc((num_threads + 1) * sizeof(int));
+    scheduler->run_busy = calloc(num_threads, sizeof(double));
+    scheduler->busy_time = calloc(num_threads, sizeof(double));
+    scheduler->idle_time = calloc(num_threads, sizeof(double));
+    scheduler->steals = calloc(num_threads, sizeof(long long));
+    if (!scheduler->deques || !scheduler->split || !scheduler->run_busy ||
+        !scheduler->busy_time || !scheduler->idle_time || !scheduler->steals) {
+        fprintf(stderr, "Failed to allocate task scheduler\n");
+        destroy_task_scheduler(scheduler);
+        return NULL;
+    }
+    memset(scheduler->deques, 0, num_threads * sizeof(TaskDeque));
+    return scheduler;
+}
+
+void destroy_task_scheduler(TaskScheduler* scheduler) {
+    if (scheduler) {
+        free(scheduler->deques);
+        free(scheduler->split);
+        free(scheduler->run_busy);
+        free(scheduler->busy_time);
+        free(scheduler->idle_time);
+        free(scheduler->steals);
+        free(scheduler);
+    }
+}
+
+void split_by_cost(const double* cost, int num_tasks, int num_parts,
+                   int* split) {
+    split[0] = 0;
+    double total = 0.0;
+    if (cost) {
+        for (int i = 0; i < num_tasks; i++) total += cost[i];
+    }
+    if (!(total > 0.0)) {
+        for (int t = 1; t <= num_parts; t++) {
+            split[t] = (int)((long)num_tasks * t / num_parts);
+        }
+        return;
+    }
+
+    double acc = 0.0;
+    int i = 0;
+    for (int t = 1; t < num_parts; t++) {
+        // A task goes to the range that holds its midpoint
+        double bound = total * t / num_parts;
+        while (i < num_tasks && acc + 0.5 * cost[i] < bound) acc += cost[i++];
+        split[t] = i;
+    }
+    split[num_parts] = num_tasks;
+}
+
+void scheduler_run(TaskScheduler* scheduler, int num_tasks,
+                   const double* cost, double* elapsed, TaskFunction task,
+                   void* context) {
+    if (num_tasks <= 0) return;
+    int threads = scheduler->num_threads;
+    if (num_tasks == 1 || threads == 1) {
+        // Not worth waking a team
+        double start = omp_get_wtime();
+        for (int i = 0; i < num_tasks; i++) {
+            double t0 = omp_get_wtime();
+            task(context, i, 0);
+            if (elapsed) elapsed[i] = omp_get_wtime() - t0;
+        }
+        double wall = omp_get_wtime() - start;
+        scheduler->busy_time[0] += wall;
+        for (int t = 1; t < threads; t++) scheduler->idle_time[t] += wall;
+        return;
+    }
+    split_by_cost(cost, num_tasks, threads, scheduler->split);
+    for (int t = 0; t < threads; t++) {
+        scheduler->deques[t].range =
+            pack_range(scheduler->split[t], scheduler->split[t + 1]);
+    }
+
+    double* run_busy = scheduler->run_busy;
+    memset(run_busy, 0, threads * sizeof(double));
+    double start = omp_get_wtime();
+
+// A team smaller than requested still drains every deque by stealing
+#pragma omp parallel num_threads(threads)
+    {
+        int thread = omp_get_thread_num();
+        TaskDeque* own = &scheduler->deques[thread];
+        double work = 0.0;
+        long long steals = 0;
+
+        for (;;) {
+            int i = take_front(own);
+            if (i < 0) {
+                for (int v = 1; v < threads && i < 0; v++) {
+                    i = take_back(&scheduler->deques[(thread + v) % threads]);
+                }
+                if (i < 0) break;
+                steals++;
+            }
+            double t0 = omp_get_wtime();
+            task(context, i, thread);
+            double dt = omp_get_wtime() - t0;
+            work += dt;
+            if (elapsed) elapsed[i] = dt;
+        }
+        run_busy[thread] = work;
+        scheduler->steals[thread] += steals;
+    }
+
+    double wall = omp_get_wtime() - start;
+    for (int t = 0; t < threads; t++) {
+        scheduler->busy_time[t] += run_busy[t];
+        scheduler->idle_time[t] += wall - run_busy[t];
+    }
+}
+
+double scheduler_imbalance(const TaskScheduler* scheduler) {
+    double max = 0.0, sum = 0.0;
+    for (int t = 0; t < scheduler->num_threads; t++) {
+        double busy = scheduler->busy_time[t];
+        if (busy > max) max = busy;
+        sum += busy;
+    }
+    return sum > 0.0 ? max * scheduler->num_threads / sum : 1.0;
+}
+
+void scheduler_reset_stats(TaskScheduler* scheduler) {
+    int threads = scheduler->num_threads;
+    memset(scheduler->busy_time, 0, threads * sizeof(double));
+    memset(scheduler->idle_time, 0, threads * sizeof(double));
+    memset(scheduler->steals, 0, threads * sizeof(long long));
+}
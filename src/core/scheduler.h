@@ -0,0 +1,56 @@
+#ifndef NEURAL_SCHEDULER_H
+#define NEURAL_SCHEDULER_H
+
+#include <stdint.h>
+
+// Work-stealing execution of a fixed set of independent tasks.
+//
+// Tasks [0, num_tasks) are split into one contiguous range per thread so
+// that every range carries about the same estimated cost. Each range is a
+// deque packed into one 64-bit word: its owner takes tasks from the front,
+// and a thread whose range ran dry steals single tasks from the back of
+// the others. Owners keep their neighbouring tasks (and data) from step to
+// step, and expensive tasks only move when a thread would otherwise idle.
+
+typedef void (*TaskFunction)(void* context, int task, int thread);
+
+// One deque per thread, alone on its cache line
+typedef struct {
+    uint64_t range;  // begin | end << 32 of the tasks left
+    char pad[64 - sizeof(uint64_t)];
+} TaskDeque;
+
+typedef struct TaskScheduler {
+    int num_threads;
+    TaskDeque* deques;
+    int* split;         // Task ranges of the current run, num_threads + 1
+    double* run_busy;   // Busy time of each thread in the current run
+
+    // Per-thread totals over all runs (seconds)
+    double* busy_time;  // Running tasks
+    double* idle_time;  // Looking for work or waiting at the final barrier
+    long long* steals;
+} TaskScheduler;
+
+TaskScheduler* create_task_scheduler(int num_threads);
+void destroy_task_scheduler(TaskScheduler* scheduler);
+
+// Runs task(context, i, thread) for every i in [0, num_tasks) on a team of
+// the scheduler's threads and returns when all are done. cost weights the
+// initial split (NULL for equal costs); elapsed, if given, receives the
+// wall-clock seconds of every task.
+void scheduler_run(TaskScheduler* scheduler, int num_tasks,
+                   const double* cost, double* elapsed, TaskFunction task,
+                   void* context);
+
+// Cuts tasks [0, num_tasks) into num_parts contiguous ranges
+// [split[p], split[p + 1]) of about equal total cost (equal counts when
+// cost is NULL or all zero)
+void split_by_cost(const double* cost, int num_tasks, int num_parts,
+                   int* split);
+
+// Maximum over mean busy time of the threads, 1.0 when perfectly balanced
+double scheduler_imbalance(const TaskScheduler* scheduler);
+void scheduler_reset_stats(TaskScheduler* scheduler);
+
+#endif
@@ -5,20 +5,33 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
-#include "core/network.h"
+#include "neural_sim.h"
 #include "utils/config.h"
+#include "utils/sweep.h"
+
+// Simulated ms between progress lines of real-time runs
+#define REALTIME_PROGRESS 1000.0
 
 // Command line options structure
 typedef struct {
     char* config_file;
     char* output_dir;
+    int num_ranks;    // Worker processes, 0 keeps the configured value
+    char* transport;  // Spike transport between ranks, NULL keeps config
+    int num_trials;   // Lockstep trials instead of one run, 0 for a run
+    char* sweep_file; // Parameter sweep over the configuration, NULL if none
 } CommandLineOptions;
 
 // Function declarations
 static void parse_command_line(int argc, char** argv,
                                CommandLineOptions* options);
 static void print_usage(const char* program_name);
+static void print_progress(double progress, void* user_data);
+static void print_realtime(NeuralSimulation* sim);
+static int launch_ranks(SimulationConfig* config);
 
 int main(int argc, char** argv) {
 // Initialize OpenMP
@@ -33,6 +46,16 @@ int main(int argc, char** argv) {
     options.output_dir = "output";
     parse_command_line(argc, argv, &options);
 
+    // A sweep runs the configuration many times in its own processes
+    if (options.sweep_file) {
+        SweepSpec* spec = load_sweep_spec(options.sweep_file);
+        if (!spec) return EXIT_FAILURE;
+        int sweep_status =
+            run_sweep(spec, options.config_file, options.output_dir);
+        destroy_sweep_spec(spec);
+        return sweep_status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // Load configuration
     SimulationConfig* config = load_config(options.config_file);
     if (!config) {
@@ -42,40 +65,128 @@ int main(int argc, char** argv) {
 
     // Override output directory if specified
     if (options.output_dir) {
+        free(config->network.output_dir);
         config->network.output_dir = strdup(options.output_dir);
     }
 
-    // Create network
-    Network* network = create_network(config->network);
-    if (!network) {
-        fprintf(stderr, "Failed to create network\n");
+    if (options.num_ranks > 0) config->num_ranks = options.num_ranks;
+    if (options.transport) {
+        int kind = transport_kind_from_name(options.transport);
+        if (kind < 0) {
+            fprintf(stderr, "Unknown transport: %s\n", options.transport);
+            destroy_config(config);
+            return EXIT_FAILURE;
+        }
+        config->transport = (TransportKind)kind;
+    }
+
+    // Ranks other than 0 return here in their own process
+    int workers = launch_ranks(config);
+    if (workers < 0) {
         destroy_config(config);
         return EXIT_FAILURE;
     }
 
-    // Run simulation
-    double time = 0.0;
-    while (time < config->network.simulation_time) {
-        printf("\rSimulation progress: %.1f%%",
-               (time / config->network.simulation_time) * 100.0);
-        fflush(stdout);
+    // Create the simulation; it takes ownership of the configuration
+    SimulationCallbacks callbacks = {0};
+    if (config->rank == 0) callbacks.progress_cb = print_progress;
+    // Printing every step would eat into the step budget of paced runs
+    if (config->realtime) callbacks.progress_interval = REALTIME_PROGRESS;
+    int rank = config->rank;
+    bool realtime = config->realtime;
+    int status = EXIT_SUCCESS;
+    NeuralSimulation* sim = ns_init_from_config(config, &callbacks);
+    if (!sim) {
+        fprintf(stderr, "Failed to create network: %s\n", ns_get_last_error());
+        status = EXIT_FAILURE;
+    } else {
+        // Run simulation
+        NeuralSimError error =
+            options.num_trials > 0
+                ? ns_run_trials(sim, options.num_trials, -1, NULL, NULL)
+                : ns_run(sim, -1);
+        if (error != NS_SUCCESS) {
+            fprintf(stderr, "\nSimulation failed: %s\n",
+                    ns_get_last_error());
+            status = EXIT_FAILURE;
+        } else if (realtime && rank == 0) {
+            print_realtime(sim);
+        }
+        ns_stop(sim);
+    }
+    if (rank != 0) return status;
 
-        update_network(network, time);
-        save_network_state(network, time);
-        time += config->network.dt;
+    // Rank 0 reports for everyone
+    for (int w = 0; w < workers; w++) {
+        int child_status;
+        if (wait(&child_status) < 0 || !WIFEXITED(child_status) ||
+            WEXITSTATUS(child_status) != EXIT_SUCCESS) {
+            status = EXIT_FAILURE;
+        }
     }
-    printf("\nSimulation completed\n");
+    if (status == EXIT_SUCCESS) printf("\nSimulation completed\n");
+    return status;
+}
 
-    // Cleanup
-    destroy_network(network);
-    destroy_config(config);
-    return EXIT_SUCCESS;
+// Forks ranks 1..num_ranks-1 of a partitioned run, each with its share of
+// the cores. Returns the number of workers started in rank 0, 0 in the
+// workers, or -1 on failure.
+static int launch_ranks(SimulationConfig* config) {
+    int ranks = config->num_ranks;
+    if (ranks <= 1) return 0;
+
+    // A rendezvous name of this run only
+    if (!config->transport_name) {
+        char name[128];
+        if (config->transport == TRANSPORT_SOCKET) {
+            snprintf(name, sizeof(name), "/tmp/neuralsim_%d.sock",
+                     (int)getpid());
+        } else {
+            snprintf(name, sizeof(name), "/neuralsim_%d", (int)getpid());
+        }
+        config->transport_name = strdup(name);
+    }
+    int threads = omp_get_num_procs() / ranks;
+    omp_set_num_threads(threads > 0 ? threads : 1);
+    printf("Running %d ranks over %s, %d threads each\n", ranks,
+           transport_kind_name(config->transport), threads > 0 ? threads : 1);
+    fflush(stdout);
+
+    for (int r = 1; r < ranks; r++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "Failed to start rank %d\n", r);
+            return -1;
+        }
+        if (pid == 0) {
+            config->rank = r;
+            return 0;
+        }
+    }
+    config->rank = 0;
+    return ranks - 1;
+}
+
+static void print_progress(double progress, void* user_data) {
+    (void)user_data;
+    printf("\rSimulation progress: %.1f%%", progress * 100.0);
+    fflush(stdout);
+}
+
+static void print_realtime(NeuralSimulation* sim) {
+    NetworkStatistics stats;
+    if (ns_calculate_statistics(sim, &stats) != NS_SUCCESS) return;
+    printf("\nReal time: %lld overruns, step latency p50 %.1f us, "
+           "p99 %.1f us, max %.1f us, %lld page faults after warmup\n",
+           stats.realtime_overruns, stats.realtime_latency_p50 * 1e6,
+           stats.realtime_latency_p99 * 1e6, stats.realtime_latency_max * 1e6,
+           stats.realtime_page_faults);
 }
 
 static void parse_command_line(int argc, char** argv,
                                CommandLineOptions* options) {
     int opt;
-    while ((opt = getopt(argc, argv, "c:o:h")) != -1) {
+    while ((opt = getopt(argc, argv, "c:o:n:t:b:s:h")) != -1) {
         switch (opt) {
             case 'c':
                 options->config_file = optarg;
@@ -83,6 +194,18 @@ static void parse_command_line(int argc, char** argv,
             case 'o':
                 options->output_dir = optarg;
                 break;
+            case 'n':
+                options->num_ranks = atoi(optarg);
+                break;
+            case 't':
+                options->transport = optarg;
+                break;
+            case 'b':
+                options->num_trials = atoi(optarg);
+                break;
+            case 's':
+                options->sweep_file = optarg;
+                break;
             case 'h':
             default:
                 print_usage(argv[0]);
@@ -98,5 +221,11 @@ static void print_usage(const char* program_name) {
         "  -c <file>    Configuration file (default: "
         "config/default_config.ini)\n");
     printf("  -o <dir>     Output directory (default: output)\n");
+    printf("  -n <ranks>   Worker processes sharing the network (default: 1)\n");
+    printf("  -t <name>    Spike transport between ranks: shm or socket\n");
+    printf("  -b <trials>  Run trials in lockstep, seeds random_seed + trial,\n"
+           "               spikes in <output dir>/trials\n");
+    printf("  -s <spec>    Parameter sweep over the configuration, runs in\n"
+           "               <output dir>/run_<n>, summary in sweep.csv\n");
     printf("  -h           Show this help message\n");
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "mechanisms/eligibility.h"
+
+#include <stdlib.h>
+
+EligibilityState* create_eligibility_state(int num_synapses,
+                                           EligibilityParams params,
+                                           double dt) {
+    EligibilityState* elig =
+        (EligibilityState*)malloc(sizeof(EligibilityState));
+    if (!elig) return NULL;
+
+    elig->params = params;
+    elig->num_synapses = num_synapses;
+    elig->trace = (double*)calloc(num_synapses + 1, sizeof(double));
+    elig->last_step = (int*)calloc(num_synapses + 1, sizeof(int));
+    if (!elig->trace || !elig->last_step) {
+        destroy_eligibility_state(elig);
+        return NULL;
+    }
+
+    elig->dt = dt;
+    elig->step = 0;
+    elig->expected_reward = 0.0;
+    elig->dopamine = 0.0;
+
+    return elig;
+}
+
+void destroy_eligibility_state(EligibilityState* elig) {
+    if (elig) {
+        free(elig->trace);
+        free(elig->last_step);
+        free(elig);
+    }
+}
+
+int eligibility_remap(EligibilityState* elig, const int* slot_map,
+                      int num_synapses) {
+    double* trace = (double*)calloc(num_synapses + 1, sizeof(double));
+    int* last_step = (int*)malloc((num_synapses + 1) * sizeof(int));
+    if (!trace || !last_step) {
+        free(trace);
+        free(last_step);
+        return -1;
+    }
+    for (int k = 0; k <= num_synapses; k++) last_step[k] = elig->step;
+    for (int k = 0; slot_map && k < elig->num_synapses; k++) {
+        if (slot_map[k] < 0) continue;
+        trace[slot_map[k]] = elig->trace[k];
+        last_step[slot_map[k]] = elig->last_step[k];
+    }
+    free(elig->trace);
+    free(elig->last_step);
+    elig->trace = trace;
+    elig->last_step = last_step;
+    elig->num_synapses = num_synapses;
+    return 0;
+}
+
+void eligibility_advance(EligibilityState* elig) { elig->step++; }
+
+double eligibility_commit_reward(EligibilityState* elig, Connectivity* conn,
+                                 double reward, double w_min, double w_max) {
+    // Dopamine carries the reward prediction error
+    double dopamine = reward - elig->expected_reward;
+    elig->expected_reward +=
+        elig->params.baseline_rate * (reward - elig->expected_reward);
+    elig->dopamine = dopamine;
+
+    const double scale = elig->params.learning_rate * dopamine;
+    const double dt_over_tau = elig->dt / elig->params.tau;
+    const int step = elig->step;
+    double* restrict trace = elig->trace;
+    int* restrict last_step = elig->last_step;
+    double* restrict weights = conn->weights;
+    const int n = elig->num_synapses;
+
+    // One sweep over all synapses; traces are rebased to the current step
+#pragma omp parallel for simd schedule(static)
+    for (int k = 0; k < n; k++) {
+        double e = trace[k] * exp(-(double)(step - last_step[k]) * dt_over_tau);
+        double w = weights[k] + scale * e;
+        w = w < w_min ? w_min : w;
+        weights[k] = w > w_max ? w_max : w;
+        trace[k] = e;
+        last_step[k] = step;
+    }
+
+    return dopamine;
+}
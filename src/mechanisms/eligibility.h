@@ -0,0 +1,66 @@
+#ifndef NEURAL_ELIGIBILITY_H
+#define NEURAL_ELIGIBILITY_H
+
+#include <math.h>
+
+#include "core/connectivity.h"
+
+typedef struct {
+    double tau;            // Eligibility trace time constant (ms)
+    double learning_rate;  // Scales dopamine x eligibility into weights
+    double baseline_rate;  // Adaptation rate of the expected reward
+} EligibilityParams;
+
+// Per-synapse eligibility traces for three-factor learning. Traces are
+// decayed lazily: each entry stores its value at the step it was last
+// touched, and is brought up to date only when a spike or a reward reaches
+// it.
+typedef struct {
+    EligibilityParams params;
+    int num_synapses;
+    double* trace;     // Value at last_step
+    int* last_step;    // Step at which trace was last updated
+    double dt;
+    int step;
+    double expected_reward;
+    double dopamine;   // Last reward prediction error
+} EligibilityState;
+
+EligibilityState* create_eligibility_state(int num_synapses,
+                                           EligibilityParams params,
+                                           double dt);
+void destroy_eligibility_state(EligibilityState* elig);
+
+static inline double eligibility_decay(const EligibilityState* elig,
+                                       int steps) {
+    return exp(-(double)steps * elig->dt / elig->params.tau);
+}
+
+// Bring synapse k up to date and add dw to its trace
+static inline void eligibility_add(EligibilityState* elig, int k, double dw) {
+    int gap = elig->step - elig->last_step[k];
+    elig->trace[k] = elig->trace[k] * eligibility_decay(elig, gap) + dw;
+    elig->last_step[k] = elig->step;
+}
+
+// Synapse slot from takes over slot to (structural plasticity moved it);
+// from is left empty
+static inline void eligibility_move(EligibilityState* elig, int from,
+                                    int to) {
+    elig->trace[to] = elig->trace[from];
+    elig->last_step[to] = elig->last_step[from];
+    elig->trace[from] = 0.0;
+    elig->last_step[from] = elig->step;
+}
+
+// Re-homes the traces after the connectivity was laid out anew with
+// num_synapses slots: slot k moves to slot_map[k], -1 drops it. A NULL
+// slot_map only resizes, to be filled by the caller.
+int eligibility_remap(EligibilityState* elig, const int* slot_map,
+                      int num_synapses);
+
+void eligibility_advance(EligibilityState* elig);
+double eligibility_commit_reward(EligibilityState* elig, Connectivity* conn,
+                                 double reward, double w_min, double w_max);
+
+#endif
@@ -0,0 +1,161 @@
+#include "mechanisms/stdp.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+STDPState* create_stdp_state(int num_neurons, STDPParams params, double dt) {
+    STDPState* stdp = (STDPState*)malloc(sizeof(STDPState));
+    if (!stdp) return NULL;
+
+    stdp->params = params;
+    stdp->num_neurons = num_neurons;
+    stdp->pre_trace = (double*)calloc(num_neurons, sizeof(double));
+    stdp->post_trace = (double*)calloc(num_neurons, sizeof(double));
+    stdp->task_cost = (double*)malloc(
+        (num_neurons / STDP_SPIKE_CHUNK + 1) * sizeof(double));
+    if (!stdp->pre_trace || !stdp->post_trace || !stdp->task_cost) {
+        destroy_stdp_state(stdp);
+        return NULL;
+    }
+
+    // Trace decay factors are fixed for a given dt
+    stdp->decay_plus = exp(-dt / params.tau_plus);
+    stdp->decay_minus = exp(-dt / params.tau_minus);
+    stdp->eligibility = NULL;
+
+    return stdp;
+}
+
+void destroy_stdp_state(STDPState* stdp) {
+    if (stdp) {
+        free(stdp->pre_trace);
+        free(stdp->post_trace);
+        free(stdp->task_cost);
+        free(stdp);
+    }
+}
+
+void stdp_decay_traces(STDPState* stdp) {
+    double* restrict pre = stdp->pre_trace;
+    double* restrict post = stdp->post_trace;
+    double decay_plus = stdp->decay_plus;
+    double decay_minus = stdp->decay_minus;
+
+    for (int i = 0; i < stdp->num_neurons; i++) {
+        pre[i] *= decay_plus;
+        post[i] *= decay_minus;
+    }
+}
+
+typedef struct {
+    STDPState* stdp;
+    Connectivity* conn;
+    const int* spike_ids;
+    int num_spikes;
+} SpikeBatch;
+
+// Post before pre: a presynaptic spike depresses its outgoing row by the
+// targets' postsynaptic traces. Rows of different neurons are disjoint,
+// so tasks run in parallel.
+static void depress_rows(void* context, int task, int thread) {
+    (void)thread;
+    const SpikeBatch* batch = context;
+    const STDPState* stdp = batch->stdp;
+    Connectivity* conn = batch->conn;
+    const double a_minus = stdp->params.a_minus;
+    const double w_min = stdp->params.w_min;
+    const double* post_trace = stdp->post_trace;
+    double* weights = conn->weights;
+    EligibilityState* elig = stdp->eligibility;
+
+    int last = (task + 1) * STDP_SPIKE_CHUNK;
+    if (last > batch->num_spikes) last = batch->num_spikes;
+    for (int s = task * STDP_SPIKE_CHUNK; s < last; s++) {
+        int pre = batch->spike_ids[s];
+        int begin = conn_row_begin(conn, pre);
+        int end = conn_row_end(conn, pre);
+        if (elig) {
+            for (int k = begin; k < end; k++) {
+                eligibility_add(elig, k,
+                                -a_minus * post_trace[conn->targets[k]]);
+            }
+        } else {
+            for (int k = begin; k < end; k++) {
+                double w = weights[k] - a_minus * post_trace[conn->targets[k]];
+                weights[k] = w < w_min ? w_min : w;
+            }
+        }
+    }
+}
+
+// A postsynaptic spike potentiates its incoming column by the sources'
+// presynaptic traces, reached through the transposed index.
+static void potentiate_columns(void* context, int task, int thread) {
+    (void)thread;
+    const SpikeBatch* batch = context;
+    const STDPState* stdp = batch->stdp;
+    Connectivity* conn = batch->conn;
+    const double a_plus = stdp->params.a_plus;
+    const double w_max = stdp->params.w_max;
+    const double* pre_trace = stdp->pre_trace;
+    double* weights = conn->weights;
+    EligibilityState* elig = stdp->eligibility;
+
+    int last = (task + 1) * STDP_SPIKE_CHUNK;
+    if (last > batch->num_spikes) last = batch->num_spikes;
+    for (int s = task * STDP_SPIKE_CHUNK; s < last; s++) {
+        int post = batch->spike_ids[s];
+        int begin = conn_col_begin(conn, post);
+        int end = conn_col_end(conn, post);
+        if (elig) {
+            for (int e = begin; e < end; e++) {
+                eligibility_add(elig, conn->col_synapse[e],
+                                a_plus * pre_trace[conn->col_sources[e]]);
+            }
+        } else {
+            for (int e = begin; e < end; e++) {
+                int k = conn->col_synapse[e];
+                double w = weights[k] + a_plus * pre_trace[conn->col_sources[e]];
+                weights[k] = w > w_max ? w_max : w;
+            }
+        }
+    }
+}
+
+// Runs the spike chunks of one pass, weighted by the synapses they touch
+static void run_pass(STDPState* stdp, const SpikeBatch* batch,
+                     const int* ptr, TaskFunction pass,
+                     TaskScheduler* scheduler) {
+    int num_tasks =
+        (batch->num_spikes + STDP_SPIKE_CHUNK - 1) / STDP_SPIKE_CHUNK;
+    if (!scheduler) {
+        for (int t = 0; t < num_tasks; t++) pass((void*)batch, t, 0);
+        return;
+    }
+    for (int t = 0; t < num_tasks; t++) {
+        double cost = 0.0;
+        int last = (t + 1) * STDP_SPIKE_CHUNK;
+        if (last > batch->num_spikes) last = batch->num_spikes;
+        for (int s = t * STDP_SPIKE_CHUNK; s < last; s++) {
+            int id = batch->spike_ids[s];
+            cost += 1 + ptr[id + 1] - ptr[id];
+        }
+        stdp->task_cost[t] = cost;
+    }
+    scheduler_run(scheduler, num_tasks, stdp->task_cost, NULL, pass,
+                  (void*)batch);
+}
+
+void stdp_process_spikes(STDPState* stdp, Connectivity* conn,
+                         const int* spike_ids, int num_spikes,
+                         TaskScheduler* scheduler) {
+    SpikeBatch batch = {stdp, conn, spike_ids, num_spikes};
+    run_pass(stdp, &batch, conn->row_ptr, depress_rows, scheduler);
+    run_pass(stdp, &batch, conn->col_ptr, potentiate_columns, scheduler);
+
+    // Traces jump after both passes so simultaneous spikes do not pair
+    for (int s = 0; s < num_spikes; s++) {
+        stdp->pre_trace[spike_ids[s]] += 1.0;
+        stdp->post_trace[spike_ids[s]] += 1.0;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef NEURAL_STDP_H
+#define NEURAL_STDP_H
+
+#include "core/connectivity.h"
+#include "core/scheduler.h"
+#include "mechanisms/eligibility.h"
+
+typedef struct {
+    double a_plus;     // Potentiation amplitude
+    double a_minus;    // Depression amplitude
+    double tau_plus;   // Presynaptic trace time constant (ms)
+    double tau_minus;  // Postsynaptic trace time constant (ms)
+    double w_min;
+    double w_max;
+} STDPParams;
+
+// Spikes per plasticity task
+#define STDP_SPIKE_CHUNK 16
+
+// Event-driven STDP state. Each neuron carries one presynaptic and one
+// postsynaptic trace, so synapses are only touched when a neuron spikes.
+typedef struct {
+    STDPParams params;
+    int num_neurons;
+    double* pre_trace;
+    double* post_trace;
+    double decay_plus;   // exp(-dt / tau_plus)
+    double decay_minus;  // exp(-dt / tau_minus)
+
+    // When set, pairings are tagged into eligibility traces instead of
+    // changing weights directly (three-factor learning)
+    EligibilityState* eligibility;
+
+    double* task_cost;  // Scratch, one entry per chunk of spikes
+} STDPState;
+
+STDPState* create_stdp_state(int num_neurons, STDPParams params, double dt);
+void destroy_stdp_state(STDPState* stdp);
+void stdp_decay_traces(STDPState* stdp);
+// Without a scheduler the spikes are processed on the calling thread
+void stdp_process_spikes(STDPState* stdp, Connectivity* conn,
+                         const int* spike_ids, int num_spikes,
+                         TaskScheduler* scheduler);
+
+#endif
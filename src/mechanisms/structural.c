@@ -0,0 +1,212 @@
+#include "mechanisms/structural.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+StructuralState* create_structural_state(int num_neurons, int num_slots,
+                                         StructuralParams params, double dt,
+                                         uint64_t seed) {
+    StructuralState* structural =
+        (StructuralState*)calloc(1, sizeof(StructuralState));
+    if (!structural) return NULL;
+
+    structural->params = params;
+    structural->num_neurons = num_neurons;
+    structural->target_end = num_neurons;
+    structural->interval_steps = (int)lround(params.interval / dt);
+    if (structural->interval_steps < 1) structural->interval_steps = 1;
+    structural->spikes = (int*)calloc(num_neurons, sizeof(int));
+    structural->cumulative =
+        (long long*)malloc((num_neurons + 1) * sizeof(long long));
+    if (!structural->spikes || !structural->cumulative ||
+        structural_resize(structural, num_slots) != 0) {
+        destroy_structural_state(structural);
+        return NULL;
+    }
+    // A stream of its own, apart from the chunk streams of the same seed
+    init_random(&structural->rng, seed ^ 0x5354525543545552ULL);
+    return structural;
+}
+
+void destroy_structural_state(StructuralState* structural) {
+    if (structural) {
+        free(structural->spikes);
+        free(structural->cumulative);
+        free(structural->silent);
+        free(structural);
+    }
+}
+
+void structural_restrict_targets(StructuralState* structural, int begin,
+                                 int end) {
+    structural->target_begin = begin;
+    structural->target_end = end;
+}
+
+int structural_resize(StructuralState* structural, int num_slots) {
+    uint8_t* silent = (uint8_t*)calloc(num_slots + 1, sizeof(uint8_t));
+    if (!silent) return -1;
+    free(structural->silent);
+    structural->silent = silent;
+    structural->num_slots = num_slots;
+    return 0;
+}
+
+bool structural_record_spikes(StructuralState* structural, const int* ids,
+                              int count) {
+    for (int s = 0; s < count; s++) structural->spikes[ids[s]]++;
+    return ++structural->step >= structural->interval_steps;
+}
+
+// Lays the connectivity out anew with fresh slack; per-slot state follows
+// the synapses
+static int relayout(StructuralState* structural, Connectivity** conn,
+                    EligibilityState* elig) {
+    int old_slots = conn_num_slots(*conn);
+    int* slot_map = (int*)malloc((old_slots + 1) * sizeof(int));
+    Connectivity* out =
+        slot_map ? connectivity_with_slack(*conn, structural->params.slack,
+                                           slot_map)
+                 : NULL;
+    int slots = out ? conn_num_slots(out) : 0;
+    uint8_t* silent =
+        out ? (uint8_t*)calloc(slots + 1, sizeof(uint8_t)) : NULL;
+    if (!silent || (elig && eligibility_remap(elig, slot_map, slots) != 0)) {
+        fprintf(stderr, "Failed to lay out connectivity for rewiring\n");
+        free(silent);
+        destroy_connectivity(out);
+        free(slot_map);
+        return -1;
+    }
+
+    for (int k = 0; k < old_slots; k++) {
+        if (slot_map[k] >= 0) silent[slot_map[k]] = structural->silent[k];
+    }
+    free(structural->silent);
+    structural->silent = silent;
+    structural->num_slots = slots;
+    destroy_connectivity(*conn);
+    *conn = out;
+    structural->relayouts++;
+    free(slot_map);
+    return 0;
+}
+
+// Rows are walked backwards, so the synapse that fills a pruned slot has
+// already been checked
+static void prune(StructuralState* structural, Connectivity* conn,
+                  EligibilityState* elig) {
+    const double prune_weight = structural->params.prune_weight;
+    const int checks = structural->params.prune_checks;
+    uint8_t* silent = structural->silent;
+
+    for (int i = 0; i < conn->num_neurons; i++) {
+        for (int k = conn_row_end(conn, i) - 1; k >= conn_row_begin(conn, i);
+             k--) {
+            if (conn->weights[k] >= prune_weight) {
+                silent[k] = 0;
+                continue;
+            }
+            if (++silent[k] < checks) continue;
+
+            int moved = connectivity_remove_synapse(conn, i, k);
+            if (moved >= 0) {
+                silent[k] = silent[moved];
+                silent[moved] = 0;
+                if (elig) eligibility_move(elig, moved, k);
+            } else {
+                silent[k] = 0;
+                if (elig) {
+                    elig->trace[k] = 0.0;
+                    elig->last_step[k] = elig->step;
+                }
+            }
+            structural->pruned++;
+        }
+    }
+}
+
+// Neuron drawn in proportion to its spikes of the interval
+static int draw_active_neuron(StructuralState* structural, long long total) {
+    const long long* cumulative = structural->cumulative;
+    long long r = (long long)(random_uniform(&structural->rng) * total);
+    if (r >= total) r = total - 1;
+    int lo = 0;
+    int hi = structural->num_neurons - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cumulative[mid + 1] > r) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+static bool has_synapse(const Connectivity* conn, int source, int target) {
+    for (int k = conn_row_begin(conn, source); k < conn_row_end(conn, source);
+         k++) {
+        if (conn->targets[k] == target) return true;
+    }
+    return false;
+}
+
+static int form(StructuralState* structural, Connectivity** conn,
+                EligibilityState* elig) {
+    int n = structural->num_neurons;
+    structural->cumulative[0] = 0;
+    for (int i = 0; i < n; i++) {
+        structural->cumulative[i + 1] =
+            structural->cumulative[i] + structural->spikes[i];
+    }
+    long long total = structural->cumulative[n];
+    if (total == 0) return 0;
+
+    // The expected number of attempts, its fraction drawn
+    double expected = structural->params.formation_rate * n *
+                      structural->params.interval / 1000.0;
+    int attempts = (int)expected;
+    if (random_uniform(&structural->rng) < expected - attempts) attempts++;
+
+    for (int a = 0; a < attempts; a++) {
+        int pre = draw_active_neuron(structural, total);
+        int post = draw_active_neuron(structural, total);
+        if (pre == post || post < structural->target_begin ||
+            post >= structural->target_end || has_synapse(*conn, pre, post)) {
+            continue;
+        }
+
+        double weight = structural->params.initial_weight;
+        int k = connectivity_add_synapse(*conn, pre, post, weight);
+        if (k < 0) {
+            if (relayout(structural, conn, elig) != 0) return -1;
+            k = connectivity_add_synapse(*conn, pre, post, weight);
+        }
+        if (k < 0) continue;
+        structural->silent[k] = 0;
+        structural->formed++;
+    }
+    return 0;
+}
+
+int structural_rewire(StructuralState* structural, Connectivity** conn,
+                      EligibilityState* elig) {
+    structural->step = 0;
+    prune(structural, *conn, elig);
+    int status = form(structural, conn, elig);
+    for (int i = 0; i < structural->num_neurons; i++) {
+        structural->spikes[i] = 0;
+    }
+
+    // Heavy pruning leaves rows sparse; pack them again once the free
+    // slots are about twice what a fresh layout would leave
+    const Connectivity* c = *conn;
+    double fresh = structural->params.slack * c->num_synapses +
+                   (double)CONN_MIN_SLACK * c->num_neurons;
+    if (status == 0 && conn_num_slots(c) - c->num_synapses > 2.0 * fresh) {
+        status = relayout(structural, conn, elig);
+    }
+    return status;
+}
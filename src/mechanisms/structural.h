@@ -0,0 +1,69 @@
+#ifndef NEURAL_STRUCTURAL_H
+#define NEURAL_STRUCTURAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "core/connectivity.h"
+#include "mechanisms/eligibility.h"
+#include "utils/random.h"
+
+typedef struct {
+    double interval;        // Time between rewirings (ms)
+    double prune_weight;    // Synapses weaker than this are silent
+    int prune_checks;       // Silent rewirings in a row before pruning
+    double formation_rate;  // New synapses per neuron per second
+    double initial_weight;  // Weight of a new synapse
+    double slack;           // Free slots of a row or column per synapse
+} StructuralParams;
+
+// Structural plasticity. Every interval, synapses that were silent at
+// prune_checks rewirings in a row are pruned, and new ones form between
+// pre- and postsynaptic neurons drawn in proportion to their spikes since
+// the last rewiring, so that active neurons wire together. Synapses go
+// into and leave the free slots of the connectivity; it is only laid out
+// anew when a row or column fills up or too many slots are free.
+typedef struct {
+    StructuralParams params;
+    int num_neurons;
+    int interval_steps;
+    int step;               // Steps since the last rewiring
+    int* spikes;            // Spikes of each neuron since the last rewiring
+    long long* cumulative;  // Scratch, prefix sums of spikes
+    uint8_t* silent;        // Silent rewirings in a row of each slot
+    int num_slots;
+    int target_begin;       // New synapses only form onto these targets
+    int target_end;
+    RandomState rng;
+    long long pruned;  // Totals since creation
+    long long formed;
+    int relayouts;
+} StructuralState;
+
+StructuralState* create_structural_state(int num_neurons, int num_slots,
+                                         StructuralParams params, double dt,
+                                         uint64_t seed);
+void destroy_structural_state(StructuralState* structural);
+
+// Counts a step's spikes; returns true when a rewiring is due
+bool structural_record_spikes(StructuralState* structural, const int* ids,
+                              int count);
+
+// Prunes and forms synapses of *conn, which must have slack. When it runs
+// out of room *conn is replaced by a new layout; eligibility traces, when
+// elig is not NULL, follow their synapses. Returns 0, or -1 if a new
+// layout could not be allocated (the old one stays valid).
+int structural_rewire(StructuralState* structural, Connectivity** conn,
+                      EligibilityState* elig);
+
+// Limits formation to targets in [begin, end), for a connectivity that
+// holds only the synapses onto them. Draws are made as before, so ranks
+// of the same spikes together form what the whole network would.
+void structural_restrict_targets(StructuralState* structural, int begin,
+                                 int end);
+
+// Per-slot state for a connectivity of num_slots slots, cleared; for a
+// connectivity restored from a checkpoint
+int structural_resize(StructuralState* structural, int num_slots);
+
+#endif
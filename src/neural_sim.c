@@ -0,0 +1,1311 @@
+#include "neural_sim.h"
+
+#include <errno.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "core/batch.h"
+#include "core/network.h"
+#include "utils/checkpoint.h"
+#include "utils/config.h"
+#include "utils/live_view.h"
+#include "utils/logger.h"
+#include "utils/npy.h"
+#include "utils/output_writer.h"
+#include "utils/probe.h"
+#include "utils/random.h"
+#include "utils/realtime.h"
+
+#define STATE_MAGIC "NSSTATE1"
+
+// Networks up to this size also get a dense weight matrix on export
+#define EXPORT_DENSE_MAX 2048
+
+_Static_assert(NS_PROBE_DENDRITIC == PROBE_VARIABLE_BIT(PROBE_DENDRITIC),
+               "public probe masks must match ProbeVariable bits");
+
+// Library-private part of a simulation. The public struct must stay the
+// first member so NeuralSimulation* and SimulationInstance* convert freely.
+typedef struct {
+    NeuralSimulation sim;
+    SimulationCallbacks callbacks;
+    LiveView* live_view;
+    OutputWriter* output;  // NULL when no per-step output is enabled
+    ProbeSet* probes;
+    Checkpointer* checkpoints;  // NULL without periodic checkpoints
+    long long reported_checkpoints;  // Collected checkpoints logged so far
+    RealtimePacer* pacer;  // NULL unless runs are paced to the clock
+    long long traced_spikes[NUM_POPULATIONS];  // Totals at the last sample
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t run_thread;
+    bool in_run;           // ns_run is executing
+    bool parked;           // ns_run is blocked on a pause at a step boundary
+    bool destroy_on_exit;  // ns_stop was called from inside ns_run
+} SimulationInstance;
+
+// Sim-time header in front of the network checkpoint
+typedef struct {
+    char magic[8];
+    double current_time;
+    double end_time;
+    uint64_t step_count;
+} StateHeader;
+
+static _Thread_local char last_error[256];
+
+static NeuralSimError set_error(const SimulationInstance* inst,
+                                NeuralSimError error, const char* format,
+                                ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(last_error, sizeof(last_error), format, args);
+    va_end(args);
+
+    if (inst && inst->callbacks.error_cb) {
+        inst->callbacks.error_cb(error, last_error, inst->callbacks.user_data);
+    }
+    return error;
+}
+
+static bool flag_set(const bool* flag) {
+    return __atomic_load_n(flag, __ATOMIC_ACQUIRE);
+}
+
+static void destroy_instance(SimulationInstance* inst) {
+    NeuralSimulation* sim = &inst->sim;
+    if (sim->logger) {
+        log_message(sim->logger, LOG_INFO, "Simulation released at t=%.3f",
+                    sim->current_time);
+        destroy_logger(sim->logger);
+    }
+    destroy_live_view(inst->live_view);
+    destroy_output_writer(inst->output);
+    destroy_probe_set(inst->probes);
+    destroy_checkpointer(inst->checkpoints);
+    destroy_realtime_pacer(inst->pacer);
+    destroy_network(sim->network);
+    destroy_config(sim->config);
+    free(sim->rng);
+    pthread_cond_destroy(&inst->cond);
+    pthread_mutex_destroy(&inst->lock);
+    free(inst);
+}
+
+// Probe set, created with the first probe
+static ProbeSet* probe_set_for(SimulationInstance* inst) {
+    if (!inst->probes) {
+        const Network* net = inst->sim.network;
+        char directory[MAX_FILENAME_LENGTH];
+        snprintf(directory, sizeof(directory), "%s/probes",
+                 net->config.output_dir);
+        int threads = omp_get_max_threads();
+        if (threads > net->num_streams) threads = net->num_streams;
+        inst->probes = create_probe_set(directory, threads,
+                                        inst->sim.config->record_traces);
+    }
+    return inst->probes;
+}
+
+static void output_path(const SimulationInstance* inst, const char* name,
+                        char* path, size_t size) {
+    snprintf(path, size, "%s/%s", inst->sim.config->network.output_dir, name);
+}
+
+// Make every recording readable as complete arrays
+static void sync_recordings(SimulationInstance* inst) {
+    output_writer_sync(inst->output);
+    if (inst->probes) probe_set_flush(inst->probes);
+}
+
+NeuralSimulation* ns_init_from_config(struct SimulationConfig* config,
+                                      const SimulationCallbacks* callbacks) {
+    if (!config) {
+        set_error(NULL, NS_ERROR_PARAM, "No configuration given");
+        return NULL;
+    }
+    if (validate_config(config) != 0) {
+        set_error(NULL, NS_ERROR_CONFIG, "Invalid configuration");
+        destroy_config(config);
+        return NULL;
+    }
+
+    SimulationInstance* inst = calloc(1, sizeof(SimulationInstance));
+    if (!inst) {
+        set_error(NULL, NS_ERROR_MEMORY, "Failed to allocate simulation");
+        destroy_config(config);
+        return NULL;
+    }
+    if (callbacks) inst->callbacks = *callbacks;
+    pthread_mutex_init(&inst->lock, NULL);
+    pthread_cond_init(&inst->cond, NULL);
+
+    NeuralSimulation* sim = &inst->sim;
+    sim->config = config;
+    sim->end_time = config->network.simulation_time;
+
+    sim->rng = malloc(sizeof(RandomState));
+    if (!sim->rng) {
+        set_error(inst, NS_ERROR_MEMORY, "Failed to allocate random state");
+        destroy_instance(inst);
+        return NULL;
+    }
+    init_random(sim->rng, config->network.seed);
+
+    if (config->num_ranks > 1) {
+        // Ranks write side by side below the configured directory
+        char path[MAX_FILENAME_LENGTH];
+        mkdir(config->network.output_dir, 0755);
+        snprintf(path, sizeof(path), "%s/rank_%d", config->network.output_dir,
+                 config->rank);
+        free(config->network.output_dir);
+        config->network.output_dir = strdup(path);
+    }
+
+    sim->network = create_network(config->network);
+    if (!sim->network) {
+        set_error(inst, NS_ERROR_INIT, "Failed to create network");
+        destroy_instance(inst);
+        return NULL;
+    }
+
+    if (config->num_ranks > 1) {
+        const char* name = config->transport_name;
+        if (!name) {
+            name = config->transport == TRANSPORT_SOCKET
+                       ? "/tmp/neuralsim_spikes.sock"
+                       : "/neuralsim_spikes";
+        }
+        SpikeTransport* transport = create_transport(
+            config->transport, name, config->rank, config->num_ranks,
+            network_exchange_capacity(sim->network));
+        if (!transport || partition_network(sim->network, transport) != 0) {
+            destroy_transport(transport);
+            set_error(inst, NS_ERROR_INIT,
+                      "Failed to join rank %d of %d over %s '%s'",
+                      config->rank, config->num_ranks,
+                      transport_kind_name(config->transport), name);
+            destroy_instance(inst);
+            return NULL;
+        }
+    }
+
+    if (config->live_view) {
+        inst->live_view = create_live_view(config->live_view, sim->network);
+        if (!inst->live_view) {
+            set_error(inst, NS_ERROR_INIT, "Failed to create live view '%s'",
+                      config->live_view);
+            destroy_instance(inst);
+            return NULL;
+        }
+    }
+
+    if (config->save_interval > 0 || config->record_traces ||
+        config->record_spikes) {
+        inst->output = create_output_writer(
+            config->network.output_dir,
+            config->network.num_pyramidal + config->network.num_inhibitory,
+            config->network.dt, config->record_traces, config->record_spikes,
+            config->async_output);
+        if (!inst->output) {
+            set_error(inst, NS_ERROR_INIT, "Failed to create output writer");
+            destroy_instance(inst);
+            return NULL;
+        }
+    }
+
+    if (config->checkpoint_interval > 0.0) {
+        inst->checkpoints = create_checkpointer(
+            config->checkpoint_mode, config->checkpoint_incremental);
+        if (!inst->checkpoints) {
+            set_error(inst, NS_ERROR_INIT, "Failed to create checkpointer");
+            destroy_instance(inst);
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < config->num_probes; i++) {
+        ProbeSet* probes = probe_set_for(inst);
+        if (!probes ||
+            probe_set_add_spec(probes, sim->network, config->probes[i]) != 0) {
+            set_error(inst, NS_ERROR_CONFIG, "Invalid probe '%s'",
+                      config->probes[i]);
+            destroy_instance(inst);
+            return NULL;
+        }
+    }
+
+    // Last, so that locking memory prefaults everything allocated above
+    if (config->realtime) {
+        inst->pacer = create_realtime_pacer(
+            config->network.dt * config->realtime_factor / 1000.0,
+            config->realtime_warmup, config->realtime_lock_memory);
+        if (!inst->pacer) {
+            set_error(inst, NS_ERROR_INIT, "Failed to set up real-time pacing");
+            destroy_instance(inst);
+            return NULL;
+        }
+    }
+
+    // The network created the output directory; logging is optional
+    sim->logger = create_logger(config->network.output_dir,
+                                config->verbose ? LOG_DEBUG : LOG_INFO);
+    if (sim->logger) {
+        log_message(sim->logger, LOG_INFO,
+                    "Simulation initialized: %d pyramidal, %d inhibitory",
+                    config->network.num_pyramidal,
+                    config->network.num_inhibitory);
+    }
+
+    sim->initialized = true;
+    return sim;
+}
+
+NeuralSimulation* ns_init(const char* config_file,
+                          const SimulationCallbacks* callbacks) {
+    SimulationConfig* config =
+        config_file ? load_config(config_file) : create_default_config();
+    if (!config) {
+        set_error(NULL, NS_ERROR_CONFIG, "Failed to load configuration '%s'",
+                  config_file);
+        return NULL;
+    }
+    return ns_init_from_config(config, callbacks);
+}
+
+NeuralSimulation* ns_init_from_string(const char* config_text,
+                                      const SimulationCallbacks* callbacks) {
+    if (!config_text) {
+        set_error(NULL, NS_ERROR_PARAM, "No configuration text given");
+        return NULL;
+    }
+    SimulationConfig* config = parse_config_string(config_text);
+    if (!config) {
+        set_error(NULL, NS_ERROR_CONFIG, "Failed to parse configuration");
+        return NULL;
+    }
+    return ns_init_from_config(config, callbacks);
+}
+
+// Blocks the run loop while a pause is requested
+static void wait_while_paused(SimulationInstance* inst) {
+    NeuralSimulation* sim = &inst->sim;
+    pthread_mutex_lock(&inst->lock);
+    inst->parked = true;
+    pthread_cond_broadcast(&inst->cond);
+    while (sim->pause_requested && !sim->stop_requested) {
+        pthread_cond_wait(&inst->cond, &inst->lock);
+    }
+    inst->parked = false;
+    pthread_mutex_unlock(&inst->lock);
+}
+
+// Copies this step's observables to the output writer, which serializes
+// them while the next step computes
+static void submit_outputs(SimulationInstance* inst, int save_interval) {
+    NeuralSimulation* sim = &inst->sim;
+    const Network* net = sim->network;
+    OutputWriter* output = inst->output;
+    bool save_state = save_interval > 0 && sim->step_count % save_interval == 0;
+    if (!save_state && !output->traces && !output->spike_ids) return;
+
+    OutputSnapshot* snapshot = output_writer_acquire(output);
+    snapshot->time = sim->current_time;
+    snapshot->step = (long long)sim->step_count;
+    snapshot->save_state = save_state;
+    snapshot->population_freq[POP_PYRAMIDAL] = net->population_freq_p;
+    snapshot->population_freq[POP_INHIBITORY] = net->population_freq_i;
+
+    // Population rates (Hz) of this step for the trace pyramid
+    snapshot->has_rates = output->traces != NULL;
+    double seconds = net->config.dt / 1000.0;
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        long long spikes = net->total_spikes[p] - inst->traced_spikes[p];
+        int count = net->populations[p].count;
+        snapshot->rates[p] = count > 0 ? spikes / (count * seconds) : 0.0;
+        inst->traced_spikes[p] = net->total_spikes[p];
+    }
+
+    snapshot->num_spikes = output->spike_ids ? net->num_spikes : 0;
+    for (int s = 0; s < snapshot->num_spikes; s++) {
+        snapshot->spike_ids[s] = network_external_id(net, net->spike_ids[s]);
+    }
+    output_writer_submit(output);
+    if (save_state) sim->last_save_time = sim->current_time;
+}
+
+// Step bookkeeping after the network advanced one step
+static void complete_step(void* context, int step) {
+    (void)step;
+    SimulationInstance* inst = context;
+    NeuralSimulation* sim = &inst->sim;
+    if (inst->output) submit_outputs(inst, sim->config->save_interval);
+    sim->step_count++;
+    sim->current_time += sim->config->network.dt;
+    if (inst->live_view) {
+        live_view_publish(inst->live_view, sim->network, sim->current_time);
+    }
+}
+
+// State file contents: the sim-time header, then the network checkpoint
+static int write_state(const void* context, FILE* file) {
+    const NeuralSimulation* sim = context;
+    StateHeader header = {0};
+    memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+    header.current_time = sim->current_time;
+    header.end_time = sim->end_time;
+    header.step_count = sim->step_count;
+    return fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   save_network_checkpoint(sim->network, file) == 0
+               ? 0
+               : -1;
+}
+
+// Logs the checkpoint collected last, unless it has been reported already
+static void report_checkpoint(SimulationInstance* inst) {
+    const Checkpointer* checkpoints = inst->checkpoints;
+    long long collected = checkpoints->completed + checkpoints->failed;
+    if (collected == inst->reported_checkpoints) return;
+    inst->reported_checkpoints = collected;
+    Logger* logger = inst->sim.logger;
+    const CheckpointResult* result = &checkpoints->result;
+    if (!logger) return;
+    if (!result->ok) {
+        log_message(logger, LOG_ERROR, "Checkpoint failed after %.3f s",
+                    result->write_time);
+        return;
+    }
+    double mib = 1.0 / (1024.0 * 1024.0);
+    log_message(logger, LOG_INFO,
+                "Checkpoint %s: paused %.3f ms, wrote %.1f MiB in %.3f s, "
+                "%.1f MiB copied on write",
+                checkpoints->last, result->pause_time * 1000.0,
+                result->bytes_written * mib, result->write_time,
+                result->cow_bytes * mib);
+    if (result->blocks > 0) {
+        log_message(logger, LOG_DEBUG, "Checkpoint blocks: %lld of %lld%s",
+                    result->blocks_written, result->blocks,
+                    result->full ? " (full image)" : "");
+    }
+}
+
+// Starts a periodic checkpoint; in fork mode the run goes on while it is
+// written
+static void start_checkpoint(SimulationInstance* inst) {
+    NeuralSimulation* sim = &inst->sim;
+    char path[MAX_FILENAME_LENGTH];
+    snprintf(path, sizeof(path), "%s/checkpoint_%zu.bin",
+             sim->config->network.output_dir, sim->step_count);
+    if (checkpoint_start(inst->checkpoints, path, write_state, sim) == 0) {
+        sim->last_save_time = sim->current_time;
+    }
+    report_checkpoint(inst);
+}
+
+// Whether the caller may touch the network without racing ns_run
+static bool state_accessible(SimulationInstance* inst) {
+    pthread_mutex_lock(&inst->lock);
+    bool ok = !inst->in_run || inst->parked ||
+              pthread_equal(inst->run_thread, pthread_self());
+    pthread_mutex_unlock(&inst->lock);
+    return ok;
+}
+
+// Logs the pacing of all runs so far
+static void report_realtime(const SimulationInstance* inst) {
+    const RealtimePacer* pacer = inst->pacer;
+    Logger* logger = inst->sim.logger;
+    if (!logger) return;
+    if (pacer->steps <= pacer->warmup) {
+        log_message(logger, LOG_INFO,
+                    "Real time: %lld steps, all within the warmup",
+                    pacer->steps);
+        return;
+    }
+    const LatencyHistogram* latency = &pacer->latency;
+    const LatencyHistogram* wakeup = &pacer->wakeup;
+    log_message(logger, LOG_INFO,
+                "Real time: %lld steps of %.3f ms, %lld overruns; step "
+                "latency p50 %.1f us, p99 %.1f us, max %.1f us; wakeup p99 "
+                "%.1f us, max %.1f us; %lld page faults after warmup",
+                latency->samples, pacer->period * 1e-6, pacer->overruns,
+                latency_histogram_percentile(latency, 0.5) * 1e-3,
+                latency_histogram_percentile(latency, 0.99) * 1e-3,
+                latency->max * 1e-3,
+                latency_histogram_percentile(wakeup, 0.99) * 1e-3,
+                wakeup->max * 1e-3, pacer->page_faults);
+}
+
+NeuralSimError ns_run(NeuralSimulation* sim, double duration) {
+    if (!sim || !sim->initialized) {
+        return set_error(NULL, NS_ERROR_STATE, "Simulation not initialized");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+
+    pthread_mutex_lock(&inst->lock);
+    if (inst->in_run) {
+        pthread_mutex_unlock(&inst->lock);
+        return set_error(inst, NS_ERROR_STATE, "Simulation already running");
+    }
+    inst->in_run = true;
+    inst->run_thread = pthread_self();
+    sim->running = true;
+    sim->stop_requested = false;
+    pthread_mutex_unlock(&inst->lock);
+
+    const double dt = sim->config->network.dt;
+    // Paced runs keep the clock step by step
+    const bool blocking = sim->config->temporal_blocking && !inst->pacer;
+    const size_t start_step = sim->step_count;
+    long long blocks = 0;
+    const double start_time = sim->current_time;
+    const double end_time = duration < 0 ? sim->end_time : start_time + duration;
+    double next_progress = start_time + inst->callbacks.progress_interval;
+    double next_state = start_time + inst->callbacks.save_interval;
+    double next_checkpoint = start_time + sim->config->checkpoint_interval;
+    if (sim->logger) {
+        log_message(sim->logger, LOG_INFO, "Running from t=%.3f to t=%.3f",
+                    start_time, end_time);
+    }
+
+    NeuralSimError error = NS_SUCCESS;
+    double wall_start = omp_get_wtime();
+    if (inst->pacer) realtime_start(inst->pacer);
+    // Half a step of tolerance absorbs the rounding accumulated in time
+    while (sim->current_time < end_time - 0.5 * dt) {
+        if (flag_set(&sim->stop_requested)) break;
+        if (flag_set(&sim->pause_requested)) {
+            // The schedule starts over after a pause
+            if (inst->pacer) realtime_finish(inst->pacer);
+            wait_while_paused(inst);
+            if (inst->pacer) realtime_start(inst->pacer);
+            continue;
+        }
+        if (inst->pacer) realtime_wait(inst->pacer);
+
+        if (blocking) {
+            // Outputs and the live view are written step by step from
+            // the block's spikes; probes need the neuron state, so a
+            // block ends where one samples. Callbacks, pause and stop act
+            // between blocks.
+            int max_steps = (int)((end_time - sim->current_time) / dt + 0.5);
+            if (inst->probes) {
+                long long step = (long long)sim->step_count;
+                int due = probe_set_steps_to_sample(inst->probes, step);
+                if (due < max_steps) max_steps = due;
+            }
+            if (max_steps < 1) max_steps = 1;
+            if (update_network_block(sim->network, sim->current_time,
+                                     max_steps, complete_step, inst) < 0) {
+                error = set_error(inst, NS_ERROR_MEMORY,
+                                  "Failed to allocate block spike buffers");
+                break;
+            }
+            blocks++;
+        } else {
+            update_network(sim->network, sim->current_time);
+            complete_step(inst, 0);
+        }
+        if (sim->network->transport_failed) {
+            error = set_error(inst, NS_ERROR_RUNTIME,
+                              "Spike exchange with the other ranks failed");
+            break;
+        }
+        if (inst->probes) {
+            probe_set_sample(inst->probes, sim->network,
+                             (long long)sim->step_count, sim->current_time);
+        }
+
+        if (inst->callbacks.progress_cb &&
+            sim->current_time >= next_progress - 0.5 * dt) {
+            double progress = end_time > start_time
+                                  ? (sim->current_time - start_time) /
+                                        (end_time - start_time)
+                                  : 1.0;
+            inst->callbacks.progress_cb(progress > 1.0 ? 1.0 : progress,
+                                        inst->callbacks.user_data);
+            next_progress = sim->current_time + inst->callbacks.progress_interval;
+        }
+        if (inst->callbacks.state_cb &&
+            sim->current_time >= next_state - 0.5 * dt) {
+            inst->callbacks.state_cb(sim, inst->callbacks.user_data);
+            next_state = sim->current_time + inst->callbacks.save_interval;
+        }
+        if (flag_set(&sim->save_requested)) {
+            __atomic_store_n(&sim->save_requested, false, __ATOMIC_RELEASE);
+            ns_save_state(sim, NULL);
+        }
+        if (inst->checkpoints) {
+            if (checkpoint_collect(inst->checkpoints, false)) {
+                report_checkpoint(inst);
+            }
+            if (sim->current_time >= next_checkpoint - 0.5 * dt) {
+                start_checkpoint(inst);
+                next_checkpoint =
+                    sim->current_time + sim->config->checkpoint_interval;
+            }
+        }
+        if (inst->pacer) realtime_step_done(inst->pacer);
+    }
+    sim->computation_time += omp_get_wtime() - wall_start;
+    if (sim->logger) {
+        log_message(sim->logger, LOG_INFO,
+                    "Run finished at t=%.3f after %zu steps (%.3f s)",
+                    sim->current_time, sim->step_count,
+                    sim->computation_time);
+    }
+    if (sim->logger && blocking) {
+        log_message(sim->logger, LOG_INFO,
+                    "Temporal blocking: %zu steps in %lld blocks",
+                    sim->step_count - start_step, blocks);
+    }
+    if (inst->pacer) {
+        realtime_finish(inst->pacer);
+        report_realtime(inst);
+    }
+    sync_recordings(inst);
+    if (inst->checkpoints) {
+        // Checkpoints are complete when the run returns
+        const Checkpointer* checkpoints = inst->checkpoints;
+        checkpoint_collect(inst->checkpoints, true);
+        report_checkpoint(inst);
+        if (sim->logger) {
+            log_message(sim->logger, LOG_INFO,
+                        "Checkpoints: %lld written, %lld failed, paused "
+                        "%.3f ms in total and %.3f ms at most",
+                        checkpoints->completed, checkpoints->failed,
+                        checkpoints->total_pause * 1000.0,
+                        checkpoints->max_pause * 1000.0);
+        }
+    }
+    if (sim->logger && inst->output) {
+        OutputWriterStats io;
+        output_writer_get_stats(inst->output, &io);
+        log_message(sim->logger, LOG_INFO,
+                    "Output: %lld snapshots, %.3f s writing, simulation "
+                    "waited %.3f s in %lld stalls",
+                    io.snapshots, io.write_time, io.stall_time, io.stalls);
+    }
+    if (sim->logger) {
+        const TaskScheduler* scheduler = sim->network->scheduler;
+        long long steals = 0;
+        for (int t = 0; t < scheduler->num_threads; t++) {
+            steals += scheduler->steals[t];
+        }
+        log_message(sim->logger, LOG_INFO,
+                    "Scheduler: %d threads, %d chunks, load imbalance %.3f, "
+                    "%lld steals",
+                    scheduler->num_threads, sim->network->num_chunks,
+                    scheduler_imbalance(scheduler), steals);
+    }
+    if (sim->logger) flush_logs(sim->logger);
+
+    // Nothing may touch inst after the unlock unless we own its destruction
+    pthread_mutex_lock(&inst->lock);
+    sim->running = false;
+    inst->in_run = false;
+    bool destroy = inst->destroy_on_exit;
+    pthread_cond_broadcast(&inst->cond);
+    pthread_mutex_unlock(&inst->lock);
+
+    if (destroy) destroy_instance(inst);
+    return error;
+}
+
+typedef struct {
+    NpyWriter* trials;
+    NpyWriter* ids;
+    NpyWriter* times;
+    int32_t* trial_row;  // One step of all trials
+    int32_t* id_row;
+    double* time_row;
+} TrialRecorder;
+
+static void close_trial_recorder(TrialRecorder* rec) {
+    npy_close(rec->trials);
+    npy_close(rec->ids);
+    npy_close(rec->times);
+    free(rec->trial_row);
+    free(rec->id_row);
+    free(rec->time_row);
+}
+
+static int open_trial_recorder(TrialRecorder* rec, const char* dir,
+                               size_t capacity) {
+    char path[MAX_FILENAME_LENGTH + 32];
+    snprintf(path, sizeof(path), "%s/spike_trials.npy", dir);
+    rec->trials = npy_open(path, NPY_INT32, 1, NULL);
+    snprintf(path, sizeof(path), "%s/spike_ids.npy", dir);
+    rec->ids = npy_open(path, NPY_INT32, 1, NULL);
+    snprintf(path, sizeof(path), "%s/spike_times.npy", dir);
+    rec->times = npy_open(path, NPY_FLOAT64, 1, NULL);
+    rec->trial_row = malloc(capacity * sizeof(int32_t));
+    rec->id_row = malloc(capacity * sizeof(int32_t));
+    rec->time_row = malloc(capacity * sizeof(double));
+    return rec->trials && rec->ids && rec->times && rec->trial_row &&
+                   rec->id_row && rec->time_row
+               ? 0
+               : -1;
+}
+
+// Appends the last step's spikes of every trial, trial by trial
+static int record_trial_step(TrialRecorder* rec, const TrialBatch* batch,
+                             double time) {
+    const Network* net = batch->net;
+    int64_t count = 0;
+    for (int t = 0; t < batch->lanes.num_trials; t++) {
+        const int* spikes = trial_batch_spikes(batch, t);
+        for (int s = 0; s < batch->num_spikes[t]; s++, count++) {
+            rec->trial_row[count] = t;
+            rec->id_row[count] = network_external_id(net, spikes[s]);
+            rec->time_row[count] = time;
+        }
+    }
+    if (count == 0) return 0;
+    return npy_append(rec->trials, rec->trial_row, count) == 0 &&
+                   npy_append(rec->ids, rec->id_row, count) == 0 &&
+                   npy_append(rec->times, rec->time_row, count) == 0
+               ? 0
+               : -1;
+}
+
+// Mean rates (Hz) of every trial and population over duration ms
+static int write_trial_rates(const TrialBatch* batch, const char* dir,
+                             double duration) {
+    const Network* net = batch->net;
+    int trials = batch->lanes.num_trials;
+    double* rates = malloc((size_t)trials * NUM_POPULATIONS * sizeof(double));
+    if (!rates) return -1;
+    for (int t = 0; t < trials; t++) {
+        for (int p = 0; p < NUM_POPULATIONS; p++) {
+            int count = net->populations[p].count;
+            long long spikes = batch->total_spikes[t * NUM_POPULATIONS + p];
+            rates[t * NUM_POPULATIONS + p] =
+                count > 0 && duration > 0.0
+                    ? spikes / (count * duration / 1000.0)
+                    : 0.0;
+        }
+    }
+    char path[MAX_FILENAME_LENGTH + 32];
+    snprintf(path, sizeof(path), "%s/rates.npy", dir);
+    int64_t shape[2] = {0, NUM_POPULATIONS};
+    NpyWriter* writer = npy_open(path, NPY_FLOAT64, 2, shape);
+    int status = writer && npy_append(writer, rates, trials) == 0 ? 0 : -1;
+    if (npy_close(writer) != 0) status = -1;
+    free(rates);
+    return status;
+}
+
+// Batch of the simulation's network with each trial's stimulus applied;
+// NULL after setting the error
+static TrialBatch* create_trials(SimulationInstance* inst, int num_trials,
+                                 TrialStimulusCallback stimulus,
+                                 void* user_data, NeuralSimError* error) {
+    const Network* net = inst->sim.network;
+    const int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    uint64_t* seeds = malloc(num_trials * sizeof(uint64_t));
+    double* current = malloc(total * sizeof(double));
+    if (!seeds || !current) {
+        free(seeds);
+        free(current);
+        *error = set_error(inst, NS_ERROR_MEMORY, "Failed to allocate trials");
+        return NULL;
+    }
+    for (int t = 0; t < num_trials; t++) {
+        seeds[t] = (uint64_t)net->config.seed + (uint64_t)t;
+    }
+    TrialBatch* batch = create_trial_batch(net, num_trials, seeds);
+    free(seeds);
+    if (!batch) {
+        free(current);
+        *error = set_error(inst, NS_ERROR_CONFIG,
+                           "Cannot batch trials of this network");
+        return NULL;
+    }
+
+    for (int t = 0; stimulus && t < num_trials; t++) {
+        memset(current, 0, total * sizeof(double));
+        stimulus(t, current, total, user_data);
+        for (int id = 0; id < total; id++) {
+            *trial_batch_stimulus(batch, network_internal_id(net, id), t) =
+                current[id];
+        }
+    }
+    free(current);
+    return batch;
+}
+
+// Runs the batch for steps steps from the simulation's time and records
+// it in dir
+static NeuralSimError run_trials(SimulationInstance* inst, TrialBatch* batch,
+                                 long long steps, const char* dir) {
+    NeuralSimulation* sim = &inst->sim;
+    const Network* net = sim->network;
+    const int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    const int trials = batch->lanes.num_trials;
+
+    TrialRecorder recorder = {0};
+    if ((mkdir(dir, 0755) != 0 && errno != EEXIST) ||
+        open_trial_recorder(&recorder, dir, (size_t)total * trials) != 0) {
+        close_trial_recorder(&recorder);
+        return set_error(inst, NS_ERROR_FILE, "Cannot write trials to %s",
+                         dir);
+    }
+
+    NeuralSimError error = NS_SUCCESS;
+    double wall_start = omp_get_wtime();
+    double time = sim->current_time;
+    for (long long step = 0; step < steps; step++) {
+        if (flag_set(&sim->stop_requested)) break;
+        update_trial_batch(batch, time);
+        if (record_trial_step(&recorder, batch, time) != 0) {
+            error = set_error(inst, NS_ERROR_FILE, "Cannot write trials to %s",
+                              dir);
+            break;
+        }
+        time += net->config.dt;
+    }
+    close_trial_recorder(&recorder);
+    if (error == NS_SUCCESS &&
+        write_trial_rates(batch, dir, time - sim->current_time) != 0) {
+        error = set_error(inst, NS_ERROR_FILE, "Cannot write trials to %s",
+                          dir);
+    }
+    if (sim->logger) {
+        log_message(sim->logger, LOG_INFO,
+                    "Trials: %d in lockstep to t=%.3f (%.3f s)", trials, time,
+                    omp_get_wtime() - wall_start);
+    }
+    return error;
+}
+
+NeuralSimError ns_run_trials(NeuralSimulation* sim, int num_trials,
+                             double duration, TrialStimulusCallback stimulus,
+                             void* user_data) {
+    if (!sim || !sim->initialized) {
+        return set_error(NULL, NS_ERROR_STATE, "Simulation not initialized");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    if (num_trials < 1) {
+        return set_error(inst, NS_ERROR_PARAM, "Invalid number of trials");
+    }
+
+    pthread_mutex_lock(&inst->lock);
+    if (inst->in_run) {
+        pthread_mutex_unlock(&inst->lock);
+        return set_error(inst, NS_ERROR_STATE, "Simulation already running");
+    }
+    inst->in_run = true;
+    inst->run_thread = pthread_self();
+    pthread_mutex_unlock(&inst->lock);
+
+    if (duration < 0) duration = sim->end_time - sim->current_time;
+    long long steps = (long long)(duration / sim->network->config.dt + 0.5);
+    char dir[MAX_FILENAME_LENGTH];
+    snprintf(dir, sizeof(dir), "%s/trials", sim->network->config.output_dir);
+
+    NeuralSimError error = NS_SUCCESS;
+    TrialBatch* batch =
+        create_trials(inst, num_trials, stimulus, user_data, &error);
+    if (batch) {
+        error = run_trials(inst, batch, steps, dir);
+        destroy_trial_batch(batch);
+    }
+
+    pthread_mutex_lock(&inst->lock);
+    inst->in_run = false;
+    pthread_cond_broadcast(&inst->cond);
+    pthread_mutex_unlock(&inst->lock);
+    return error;
+}
+
+NeuralSimError ns_pause(NeuralSimulation* sim) {
+    if (!sim || !sim->initialized) {
+        return set_error(NULL, NS_ERROR_STATE, "Simulation not initialized");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    pthread_mutex_lock(&inst->lock);
+    __atomic_store_n(&sim->pause_requested, true, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&inst->lock);
+    return NS_SUCCESS;
+}
+
+NeuralSimError ns_resume(NeuralSimulation* sim) {
+    if (!sim || !sim->initialized) {
+        return set_error(NULL, NS_ERROR_STATE, "Simulation not initialized");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    pthread_mutex_lock(&inst->lock);
+    __atomic_store_n(&sim->pause_requested, false, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&inst->cond);
+    pthread_mutex_unlock(&inst->lock);
+    return NS_SUCCESS;
+}
+
+NeuralSimError ns_stop(NeuralSimulation* sim) {
+    if (!sim) {
+        return set_error(NULL, NS_ERROR_PARAM, "No simulation given");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+
+    pthread_mutex_lock(&inst->lock);
+    __atomic_store_n(&sim->stop_requested, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&inst->cond);
+    if (inst->in_run) {
+        if (pthread_equal(inst->run_thread, pthread_self())) {
+            // Called from a callback; ns_run releases the simulation
+            inst->destroy_on_exit = true;
+            pthread_mutex_unlock(&inst->lock);
+            return NS_SUCCESS;
+        }
+        while (inst->in_run) {
+            pthread_cond_wait(&inst->cond, &inst->lock);
+        }
+    }
+    pthread_mutex_unlock(&inst->lock);
+
+    destroy_instance(inst);
+    return NS_SUCCESS;
+}
+
+NeuralSimError ns_add_probe(NeuralSimulation* sim, const char* name,
+                            const int* neuron_ids, int num_ids,
+                            unsigned variables, double interval) {
+    if (!sim || !sim->initialized) {
+        return set_error(NULL, NS_ERROR_STATE, "Simulation not initialized");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    if (!state_accessible(inst)) {
+        return set_error(inst, NS_ERROR_STATE,
+                         "Probes must be added from a callback or while "
+                         "paused");
+    }
+    ProbeSet* probes = probe_set_for(inst);
+    if (!probes) {
+        return set_error(inst, NS_ERROR_FILE, "Cannot create probe directory");
+    }
+    if (probe_set_add(probes, sim->network, name, neuron_ids, num_ids,
+                      variables, interval) != 0) {
+        return set_error(inst, NS_ERROR_PARAM, "Invalid probe '%s'",
+                         name ? name : "");
+    }
+    return NS_SUCCESS;
+}
+
+NeuralSimError ns_add_probe_spec(NeuralSimulation* sim, const char* spec) {
+    if (!sim || !sim->initialized) {
+        return set_error(NULL, NS_ERROR_STATE, "Simulation not initialized");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    if (!spec) return set_error(inst, NS_ERROR_PARAM, "No probe spec given");
+    if (!state_accessible(inst)) {
+        return set_error(inst, NS_ERROR_STATE,
+                         "Probes must be added from a callback or while "
+                         "paused");
+    }
+    ProbeSet* probes = probe_set_for(inst);
+    if (!probes || probe_set_add_spec(probes, sim->network, spec) != 0) {
+        return set_error(inst, NS_ERROR_PARAM, "Invalid probe '%s'", spec);
+    }
+    return NS_SUCCESS;
+}
+
+NeuralSimError ns_deliver_reward(NeuralSimulation* sim, double reward) {
+    if (!sim || !sim->initialized) {
+        return set_error(NULL, NS_ERROR_STATE, "Simulation not initialized");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    if (!sim->network->eligibility) {
+        return set_error(inst, NS_ERROR_STATE,
+                         "Reward learning is not enabled");
+    }
+    if (!state_accessible(inst)) {
+        return set_error(inst, NS_ERROR_STATE,
+                         "Reward must be delivered from a callback or while "
+                         "paused");
+    }
+    deliver_reward(sim->network, reward);
+    return NS_SUCCESS;
+}
+
+NeuralSimError ns_save_state(NeuralSimulation* sim, const char* filename) {
+    if (!sim || !sim->initialized) {
+        return set_error(NULL, NS_ERROR_STATE, "Simulation not initialized");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    if (!state_accessible(inst)) {
+        // Picked up by the run loop at the next step boundary
+        __atomic_store_n(&sim->save_requested, true, __ATOMIC_RELEASE);
+        return NS_SUCCESS;
+    }
+
+    char default_name[MAX_FILENAME_LENGTH];
+    if (!filename) {
+        snprintf(default_name, sizeof(default_name), "%s/checkpoint_%zu.bin",
+                 sim->config->network.output_dir, sim->step_count);
+        filename = default_name;
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        return set_error(inst, NS_ERROR_FILE, "Cannot open '%s' for writing",
+                         filename);
+    }
+    bool ok = write_state(sim, file) == 0;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        return set_error(inst, NS_ERROR_FILE, "Failed to write state to '%s'",
+                         filename);
+    }
+    sim->last_save_time = sim->current_time;
+    return NS_SUCCESS;
+}
+
+NeuralSimError ns_load_state(NeuralSimulation* sim, const char* filename) {
+    if (!sim || !sim->initialized) {
+        return set_error(NULL, NS_ERROR_STATE, "Simulation not initialized");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    if (!filename) {
+        return set_error(inst, NS_ERROR_PARAM, "No state file given");
+    }
+    if (!state_accessible(inst)) {
+        return set_error(inst, NS_ERROR_STATE,
+                         "Pause the simulation before loading a state");
+    }
+
+    // Incremental checkpoints are reassembled in memory from their chain
+    char* image = NULL;
+    size_t image_size = 0;
+    FILE* file;
+    if (checkpoint_is_image(filename)) {
+        file = checkpoint_read_image(filename, &image, &image_size) == 0
+                   ? fmemopen(image, image_size, "rb")
+                   : NULL;
+    } else {
+        file = fopen(filename, "rb");
+    }
+    if (!file) {
+        free(image);
+        return set_error(inst, NS_ERROR_FILE, "Cannot open '%s'", filename);
+    }
+    StateHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, STATE_MAGIC, sizeof(header.magic)) != 0) {
+        fclose(file);
+        free(image);
+        return set_error(inst, NS_ERROR_FILE, "'%s' is not a state file",
+                         filename);
+    }
+    int result = load_network_checkpoint(sim->network, file);
+    fclose(file);
+    free(image);
+    // The network is unchanged when the load fails
+    if (result == LOAD_NO_MEMORY) {
+        return set_error(inst, NS_ERROR_MEMORY,
+                         "Failed to allocate memory to load '%s'", filename);
+    }
+    if (result == LOAD_BAD_FILE) {
+        return set_error(inst, NS_ERROR_FILE, "'%s' is truncated or corrupt",
+                         filename);
+    }
+    if (result != LOAD_OK) {
+        return set_error(inst, NS_ERROR_STATE,
+                         "State in '%s' does not match this network",
+                         filename);
+    }
+
+    sim->current_time = header.current_time;
+    sim->end_time = header.end_time;
+    sim->step_count = (size_t)header.step_count;
+    memcpy(inst->traced_spikes, sim->network->total_spikes,
+           sizeof(inst->traced_spikes));
+    return NS_SUCCESS;
+}
+
+const char* ns_get_last_error(void) { return last_error; }
+
+const char* ns_get_version(void) { return NEURAL_SIM_VERSION_STRING; }
+
+const char* ns_error_string(NeuralSimError error) {
+    switch (error) {
+        case NS_SUCCESS:
+            return "Success";
+        case NS_ERROR_MEMORY:
+            return "Out of memory";
+        case NS_ERROR_FILE:
+            return "File error";
+        case NS_ERROR_CONFIG:
+            return "Configuration error";
+        case NS_ERROR_PARAM:
+            return "Invalid parameter";
+        case NS_ERROR_STATE:
+            return "Invalid state";
+        case NS_ERROR_INIT:
+            return "Initialization error";
+        case NS_ERROR_RUNTIME:
+            return "Runtime error";
+    }
+    return "Unknown error";
+}
+
+bool ns_has_gpu_support(void) { return false; }
+
+const char* ns_get_system_info(void) {
+    static _Thread_local char info[128];
+    snprintf(info, sizeof(info), "neural_sim %s, OpenMP threads: %d, GPU: no",
+             NEURAL_SIM_VERSION_STRING, omp_get_max_threads());
+    return info;
+}
+
+NeuralSimError ns_calculate_statistics(const NeuralSimulation* sim,
+                                       struct NetworkStatistics* stats) {
+    if (!sim || !sim->initialized || !stats) {
+        return set_error(NULL, NS_ERROR_PARAM, "Invalid arguments");
+    }
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    const Network* net = sim->network;
+    memset(stats, 0, sizeof(*stats));
+    stats->time = sim->current_time;
+    stats->step_count = sim->step_count;
+    stats->num_pyramidal = net->config.num_pyramidal;
+    stats->num_inhibitory = net->config.num_inhibitory;
+    // A rank holds only the synapses onto its own neurons
+    stats->num_synapses = net->connectivity->num_synapses;
+    stats->spikes_pyramidal = net->total_spikes[POP_PYRAMIDAL];
+    stats->spikes_inhibitory = net->total_spikes[POP_INHIBITORY];
+    stats->computation_time = sim->computation_time;
+    if (inst->output) {
+        OutputWriterStats io;
+        output_writer_get_stats(inst->output, &io);
+        stats->output_write_time = io.write_time;
+        stats->output_stall_time = io.stall_time;
+        stats->output_stalls = io.stalls;
+    }
+    stats->load_imbalance = scheduler_imbalance(net->scheduler);
+    if (inst->checkpoints) {
+        stats->checkpoints = inst->checkpoints->completed;
+        stats->checkpoint_pause_time = inst->checkpoints->total_pause;
+        stats->checkpoint_max_pause = inst->checkpoints->max_pause;
+        stats->checkpoint_cow_bytes = inst->checkpoints->max_cow_bytes;
+    }
+    if (inst->pacer) {
+        const RealtimePacer* pacer = inst->pacer;
+        stats->realtime_overruns = pacer->overruns;
+        stats->realtime_latency_p50 =
+            latency_histogram_percentile(&pacer->latency, 0.5) * 1e-9;
+        stats->realtime_latency_p99 =
+            latency_histogram_percentile(&pacer->latency, 0.99) * 1e-9;
+        stats->realtime_latency_max = pacer->latency.max * 1e-9;
+        stats->realtime_wakeup_max = pacer->wakeup.max * 1e-9;
+        stats->realtime_page_faults = pacer->page_faults;
+    }
+    if (net->activity) {
+        // A rank only sees the spikes of its own neurons
+        stats->synchrony_pyramidal =
+            activity_synchrony(net->activity, POP_PYRAMIDAL);
+        stats->synchrony_inhibitory =
+            activity_synchrony(net->activity, POP_INHIBITORY);
+        stats->overlap_pyramidal =
+            activity_overlap(net->activity, POP_PYRAMIDAL);
+        stats->overlap_inhibitory =
+            activity_overlap(net->activity, POP_INHIBITORY);
+        stats->ei_correlation = activity_correlation(
+            net->activity, POP_PYRAMIDAL, POP_INHIBITORY);
+    }
+
+    // Time is in ms, rates in Hz
+    double seconds = sim->current_time / 1000.0;
+    if (seconds > 0.0) {
+        if (stats->num_pyramidal > 0) {
+            stats->mean_rate_pyramidal =
+                stats->spikes_pyramidal / (seconds * stats->num_pyramidal);
+        }
+        if (stats->num_inhibitory > 0) {
+            stats->mean_rate_inhibitory =
+                stats->spikes_inhibitory / (seconds * stats->num_inhibitory);
+        }
+    }
+
+    double v_sum = 0.0;
+    int total = 0;
+    // A rank only knows the state of its own neurons
+    for (int id = net->owned_begin; id < net->owned_end; id++) {
+        v_sum += network_neuron(net, id)->membrane_potential;
+    }
+    total = net->owned_end - net->owned_begin;
+    if (total > 0) stats->mean_membrane_potential = v_sum / total;
+
+    if (stats->num_synapses > 0) {
+        const Connectivity* conn = net->connectivity;
+        double w_sum = 0.0;
+        for (int i = 0; i < conn->num_neurons; i++) {
+            for (int s = conn_row_begin(conn, i); s < conn_row_end(conn, i);
+                 s++) {
+                w_sum += conn->weights[s];
+            }
+        }
+        stats->mean_weight = w_sum / stats->num_synapses;
+    }
+    return NS_SUCCESS;
+}
+
+int ns_get_thread_times(const NeuralSimulation* sim, double* busy,
+                        double* idle, int max_threads) {
+    if (!sim || !sim->initialized || max_threads < 0) {
+        set_error(NULL, NS_ERROR_PARAM, "Invalid arguments");
+        return -1;
+    }
+    const TaskScheduler* scheduler = sim->network->scheduler;
+    int threads = scheduler->num_threads;
+    int n = threads < max_threads ? threads : max_threads;
+    for (int t = 0; t < n; t++) {
+        if (busy) busy[t] = scheduler->busy_time[t];
+        if (idle) idle[t] = scheduler->idle_time[t];
+    }
+    return threads;
+}
+
+NeuralSimError ns_export_data(const NeuralSimulation* sim, const char* format,
+                              const char* filename) {
+    if (!sim || !sim->initialized || !format || !filename) {
+        return set_error(NULL, NS_ERROR_PARAM, "Invalid arguments");
+    }
+    // Exporting flushes the recordings, which only touches output buffers
+    SimulationInstance* inst = (SimulationInstance*)sim;
+    bool zip = strcmp(format, "npz") == 0;
+    if (!zip && strcmp(format, "npy") != 0) {
+        return set_error(inst, NS_ERROR_PARAM,
+                         "Unsupported export format '%s'", format);
+    }
+    if (!state_accessible(inst)) {
+        return set_error(inst, NS_ERROR_STATE,
+                         "Export from a callback or while paused");
+    }
+    sync_recordings(inst);
+
+    NpyArchive* archive = npy_archive_open(filename, zip);
+    if (!archive) {
+        return set_error(inst, NS_ERROR_FILE, "Cannot create '%s'", filename);
+    }
+
+    const Network* net = sim->network;
+    int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    // Weights go out packed, those of a reordered network in creation order
+    Connectivity* external = NULL;
+    if (net->external_id || net->connectivity->synapse_col) {
+        int* identity = NULL;
+        if (!net->external_id) {
+            identity = (int*)malloc(total * sizeof(int));
+            for (int i = 0; identity && i < total; i++) identity[i] = i;
+        }
+        const int* new_id = net->external_id ? net->external_id : identity;
+        external = new_id ? permute_connectivity(net->connectivity, new_id)
+                          : NULL;
+        free(identity);
+        if (!external) {
+            npy_archive_close(archive);
+            return set_error(inst, NS_ERROR_MEMORY,
+                             "Failed to map weights to creation order");
+        }
+    }
+    const Connectivity* conn = external ? external : net->connectivity;
+    int32_t sizes[NUM_POPULATIONS];
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        sizes[p] = net->populations[p].count;
+    }
+    int64_t shape[2] = {NUM_POPULATIONS, 0};
+    npy_archive_add_array(archive, "population_sizes", NPY_INT32, 1, shape,
+                          sizes);
+
+    // Weights in CSR form (rows are presynaptic neurons), as scipy expects
+    shape[0] = total + 1;
+    npy_archive_add_array(archive, "weights_indptr", NPY_INT32, 1, shape,
+                          conn->row_ptr);
+    shape[0] = conn->num_synapses;
+    npy_archive_add_array(archive, "weights_indices", NPY_INT32, 1, shape,
+                          conn->targets);
+    npy_archive_add_array(archive, "weights_data", NPY_FLOAT64, 1, shape,
+                          conn->weights);
+    if (total <= EXPORT_DENSE_MAX) {
+        double* dense = calloc((size_t)total * total, sizeof(double));
+        if (dense) {
+            for (int pre = 0; pre < total; pre++) {
+                for (int s = conn->row_ptr[pre]; s < conn->row_ptr[pre + 1];
+                     s++) {
+                    dense[(size_t)pre * total + conn->targets[s]] =
+                        conn->weights[s];
+                }
+            }
+            shape[0] = shape[1] = total;
+            npy_archive_add_array(archive, "weights", NPY_FLOAT64, 2, shape,
+                                  dense);
+            free(dense);
+        }
+    }
+    destroy_connectivity(external);
+
+    char path[MAX_FILENAME_LENGTH];
+    if (inst->output && inst->output->spike_ids) {
+        output_path(inst, "spike_times.npy", path, sizeof(path));
+        npy_archive_add_file(archive, "spike_times", path);
+        output_path(inst, "spike_ids.npy", path, sizeof(path));
+        npy_archive_add_file(archive, "spike_ids", path);
+    }
+
+    for (int p = 0; inst->probes && p < inst->probes->num_probes; p++) {
+        const Probe* probe = &inst->probes->probes[p];
+        char member[256];
+        const char* columns[NUM_PROBE_VARIABLES + 2] = {"time", "ids"};
+        int num_columns = 2;
+        for (int v = 0; v < probe->num_variables; v++) {
+            columns[num_columns++] = probe_variable_name(probe->variables[v]);
+        }
+        for (int c = 0; c < num_columns; c++) {
+            snprintf(path, sizeof(path), "%s/%s_%s.npy",
+                     inst->probes->directory, probe->name, columns[c]);
+            snprintf(member, sizeof(member), "probe_%s_%s", probe->name,
+                     columns[c]);
+            npy_archive_add_file(archive, member, path);
+        }
+    }
+
+    if (npy_archive_close(archive) != 0) {
+        return set_error(inst, NS_ERROR_FILE, "Failed to write '%s'",
+                         filename);
+    }
+    return NS_SUCCESS;
+}
+
+#ifdef NEURAL_SIM_DEBUG
+static int debug_level = 0;
+
+void ns_set_debug_level(int level) {
+    debug_level = level < 0 ? 0 : (level > 5 ? 5 : level);
+}
+
+void ns_dump_state(const NeuralSimulation* sim, const char* filename) {
+    if (!sim || !sim->initialized || !filename) return;
+    FILE* file = fopen(filename, "w");
+    if (!file) return;
+
+    const Network* net = sim->network;
+    fprintf(file, "time %.6f step %zu debug_level %d\n", sim->current_time,
+            sim->step_count, debug_level);
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        const Population* pop = &net->populations[p];
+        for (int i = 0; i < pop->count; i++) {
+            const Neuron* n = &pop->neurons[i];
+            fprintf(file, "%s %d v=%.4f ca=%.4f last_spike=%.4f\n", pop->name,
+                    network_external_id(net, pop->first_id + i),
+                    n->membrane_potential,
+                    n->calcium_concentration, n->last_spike_time);
+        }
+    }
+    fclose(file);
+}
+#endif
@@ -0,0 +1,377 @@
+#include "utils/checkpoint.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char* mode_names[NUM_CHECKPOINT_MODES] = {"blocking", "fork"};
+
+int checkpoint_mode_from_name(const char* name) {
+    for (int m = 0; m < NUM_CHECKPOINT_MODES; m++) {
+        if (strcasecmp(name, mode_names[m]) == 0) return m;
+    }
+    return -1;
+}
+
+const char* checkpoint_mode_name(CheckpointMode mode) {
+    return mode >= 0 && mode < NUM_CHECKPOINT_MODES ? mode_names[mode]
+                                                    : "unknown";
+}
+
+// Image files: this header, the hashes of all blocks, then each stored
+// block as its index followed by its bytes
+typedef struct {
+    char magic[8];
+    uint64_t size;  // Bytes of the state
+    uint32_t block_size;
+    uint32_t num_blocks;
+    uint32_t num_written;  // Blocks stored in this file
+    uint32_t reserved;
+    char base[256];  // File name of the base, empty for a full image
+} ImageHeader;
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// FNV-1a over 64-bit words with a fold of the high half; every step is
+// invertible, so a block differing in one word always hashes differently
+static uint64_t hash_block(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t words = size / sizeof(uint64_t);
+    for (size_t w = 0; w < words; w++) {
+        uint64_t word;
+        memcpy(&word, data + w * sizeof(uint64_t), sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 32;
+    }
+    for (size_t i = words * sizeof(uint64_t); i < size; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static size_t block_length(uint64_t size, uint32_t block_size, size_t b) {
+    size_t begin = b * (size_t)block_size;
+    return size - begin < block_size ? size - begin : block_size;
+}
+
+static const char* file_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Header and block hashes of an image. Returns 0 on success.
+static int read_image_index(FILE* file, ImageHeader* header,
+                            uint64_t** hashes) {
+    *hashes = NULL;
+    if (fread(header, sizeof(*header), 1, file) != 1 ||
+        memcmp(header->magic, CHECKPOINT_IMAGE_MAGIC,
+               sizeof(header->magic)) != 0 ||
+        header->block_size == 0 ||
+        header->base[sizeof(header->base) - 1] != '\0' ||
+        header->num_blocks != (header->size + header->block_size - 1) /
+                                  header->block_size ||
+        header->num_written > header->num_blocks) {
+        return -1;
+    }
+    *hashes = malloc(((size_t)header->num_blocks + 1) * sizeof(uint64_t));
+    if (!*hashes || fread(*hashes, sizeof(uint64_t), header->num_blocks,
+                          file) != header->num_blocks) {
+        free(*hashes);
+        *hashes = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Writes the image of a serialized state to file, as a delta against the
+// last checkpoint when that is an image of the same size
+static bool write_image(const Checkpointer* checkpointer, FILE* file,
+                        const char* image, size_t size,
+                        CheckpointResult* result) {
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_IMAGE_MAGIC, sizeof(header.magic));
+    header.size = size;
+    header.block_size = CHECKPOINT_BLOCK_SIZE;
+    header.num_blocks =
+        (uint32_t)((size + CHECKPOINT_BLOCK_SIZE - 1) / CHECKPOINT_BLOCK_SIZE);
+    uint64_t* hashes =
+        malloc(((size_t)header.num_blocks + 1) * sizeof(uint64_t));
+    if (!hashes) return false;
+    for (size_t b = 0; b < header.num_blocks; b++) {
+        hashes[b] = hash_block(image + b * CHECKPOINT_BLOCK_SIZE,
+                               block_length(size, header.block_size, b));
+    }
+
+    uint64_t* base_hashes = NULL;
+    const char* base = file_name(checkpointer->last);
+    if (checkpointer->last[0] && checkpointer->chain < CHECKPOINT_MAX_CHAIN &&
+        strlen(base) < sizeof(header.base)) {
+        FILE* base_file = fopen(checkpointer->last, "rb");
+        ImageHeader base_header;
+        if (base_file &&
+            read_image_index(base_file, &base_header, &base_hashes) == 0 &&
+            (base_header.size != size ||
+             base_header.block_size != header.block_size)) {
+            free(base_hashes);
+            base_hashes = NULL;
+        }
+        if (base_file) fclose(base_file);
+        if (base_hashes) strcpy(header.base, base);
+    }
+    for (size_t b = 0; b < header.num_blocks; b++) {
+        if (!base_hashes || base_hashes[b] != hashes[b]) header.num_written++;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(hashes, sizeof(uint64_t), header.num_blocks, file) ==
+                  header.num_blocks;
+    for (uint32_t b = 0; ok && b < header.num_blocks; b++) {
+        if (base_hashes && base_hashes[b] == hashes[b]) continue;
+        size_t length = block_length(size, header.block_size, b);
+        ok = fwrite(&b, sizeof(b), 1, file) == 1 &&
+             fwrite(image + (size_t)b * CHECKPOINT_BLOCK_SIZE, 1, length,
+                    file) == length;
+    }
+    result->full = base_hashes == NULL;
+    result->blocks = header.num_blocks;
+    result->blocks_written = header.num_written;
+    free(hashes);
+    free(base_hashes);
+    return ok;
+}
+
+// Writes the checkpoint to <path>.tmp and renames it into place
+static void write_checkpoint(const Checkpointer* checkpointer,
+                             const char* path, CheckpointWriter writer,
+                             const void* context, CheckpointResult* result) {
+    double start = monotonic_seconds();
+    char temporary[CHECKPOINT_PATH_MAX + 8];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE* file = fopen(temporary, "wb");
+    bool ok = file != NULL;
+    if (ok && checkpointer->incremental) {
+        // The image is serialized in memory first to be cut into blocks
+        char* image = NULL;
+        size_t size = 0;
+        FILE* memory = open_memstream(&image, &size);
+        ok = memory && writer(context, memory) == 0;
+        ok = (memory && fclose(memory) == 0) && ok;
+        ok = ok && write_image(checkpointer, file, image, size, result);
+        free(image);
+    } else if (ok) {
+        ok = writer(context, file) == 0;
+        result->full = true;
+    }
+    if (file) {
+        long end = ftell(file);
+        ok = (fclose(file) == 0) && ok;
+        result->bytes_written = end > 0 ? end : 0;
+    }
+    ok = ok && rename(temporary, path) == 0;
+    if (!ok) remove(temporary);
+    result->ok = ok;
+    result->write_time = monotonic_seconds() - start;
+}
+
+// Private memory of a process in bytes, -1 if the kernel does not say
+static long long private_bytes(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid);
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+    char line[256];
+    long long total = 0;
+    bool found = false;
+    while (fgets(line, sizeof(line), file)) {
+        long long kb;
+        if (sscanf(line, "Private_Clean: %lld kB", &kb) == 1 ||
+            sscanf(line, "Private_Dirty: %lld kB", &kb) == 1) {
+            total += kb * 1024;
+            found = true;
+        }
+    }
+    fclose(file);
+    return found ? total : -1;
+}
+
+Checkpointer* create_checkpointer(CheckpointMode mode, bool incremental) {
+    Checkpointer* checkpointer = calloc(1, sizeof(Checkpointer));
+    if (!checkpointer) {
+        fprintf(stderr, "Failed to allocate checkpointer\n");
+        return NULL;
+    }
+    checkpointer->mode = mode;
+    checkpointer->incremental = incremental;
+    // Forked writers report through memory they share with the parent
+    void* shared = mmap(NULL, sizeof(CheckpointResult),
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                        -1, 0);
+    if (shared == MAP_FAILED) {
+        fprintf(stderr, "Failed to map checkpoint results\n");
+        free(checkpointer);
+        return NULL;
+    }
+    checkpointer->shared = shared;
+    return checkpointer;
+}
+
+void destroy_checkpointer(Checkpointer* checkpointer) {
+    if (checkpointer) {
+        checkpoint_collect(checkpointer, true);
+        munmap(checkpointer->shared, sizeof(CheckpointResult));
+        free(checkpointer);
+    }
+}
+
+static void record_result(Checkpointer* checkpointer, const char* path,
+                          const CheckpointResult* result) {
+    checkpointer->result = *result;
+    checkpointer->total_pause += result->pause_time;
+    if (result->pause_time > checkpointer->max_pause) {
+        checkpointer->max_pause = result->pause_time;
+    }
+    if (!result->ok) {
+        checkpointer->failed++;
+        return;
+    }
+    checkpointer->completed++;
+    if (result->cow_bytes > checkpointer->max_cow_bytes) {
+        checkpointer->max_cow_bytes = result->cow_bytes;
+    }
+    snprintf(checkpointer->last, sizeof(checkpointer->last), "%s", path);
+    checkpointer->chain = result->full ? 0 : checkpointer->chain + 1;
+}
+
+int checkpoint_start(Checkpointer* checkpointer, const char* path,
+                     CheckpointWriter writer, const void* context) {
+    double start = monotonic_seconds();
+    if (strlen(path) >= CHECKPOINT_PATH_MAX) {
+        fprintf(stderr, "Checkpoint path too long: %s\n", path);
+        return -1;
+    }
+    // Deltas need their base complete
+    checkpoint_collect(checkpointer, true);
+
+    if (checkpointer->mode == CHECKPOINT_BLOCKING) {
+        CheckpointResult result;
+        memset(&result, 0, sizeof(result));
+        write_checkpoint(checkpointer, path, writer, context, &result);
+        result.pause_time = monotonic_seconds() - start;
+        record_result(checkpointer, path, &result);
+        return result.ok ? 0 : -1;
+    }
+
+    memset(checkpointer->shared, 0, sizeof(CheckpointResult));
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Only this thread exists in the child: no locks, no OpenMP, and
+        // _exit so the parent's buffered output is not flushed twice
+        CheckpointResult* result = checkpointer->shared;
+        pid_t parent = getppid();
+        long long before = private_bytes(parent);
+        write_checkpoint(checkpointer, path, writer, context, result);
+        long long after = private_bytes(parent);
+        result->cow_bytes = before >= 0 && after > before ? after - before : 0;
+        _exit(result->ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    if (pid < 0) {
+        fprintf(stderr, "Failed to fork checkpoint writer\n");
+        return -1;
+    }
+    checkpointer->child = pid;
+    checkpointer->pending_pause = monotonic_seconds() - start;
+    snprintf(checkpointer->pending, sizeof(checkpointer->pending), "%s",
+             path);
+    return 0;
+}
+
+int checkpoint_collect(Checkpointer* checkpointer, bool wait) {
+    if (checkpointer->child <= 0) return 0;
+    int status = 0;
+    pid_t done;
+    do {
+        done = waitpid(checkpointer->child, &status, wait ? 0 : WNOHANG);
+    } while (done < 0 && errno == EINTR);
+    if (done == 0) return 0;
+
+    CheckpointResult result = *checkpointer->shared;
+    result.ok = result.ok && done == checkpointer->child &&
+                WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+    result.pause_time = checkpointer->pending_pause;
+    checkpointer->child = 0;
+    record_result(checkpointer, checkpointer->pending, &result);
+    return 1;
+}
+
+bool checkpoint_is_image(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    char magic[8];
+    bool image = fread(magic, sizeof(magic), 1, file) == 1 &&
+                 memcmp(magic, CHECKPOINT_IMAGE_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return image;
+}
+
+static int read_image(const char* path, int depth, char** data,
+                      size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    ImageHeader header;
+    uint64_t* hashes;
+    if (read_image_index(file, &header, &hashes) != 0) {
+        fclose(file);
+        return -1;
+    }
+    free(hashes);
+
+    char* image = NULL;
+    if (header.base[0]) {
+        // The base lives next to the delta
+        char base[CHECKPOINT_PATH_MAX];
+        int dir = (int)(file_name(path) - path);
+        snprintf(base, sizeof(base), "%.*s%s", dir, path, header.base);
+        size_t base_size = 0;
+        if (depth >= CHECKPOINT_MAX_CHAIN ||
+            read_image(base, depth + 1, &image, &base_size) != 0 ||
+            base_size != header.size) {
+            free(image);
+            fclose(file);
+            return -1;
+        }
+    } else if (header.num_written == header.num_blocks) {
+        image = calloc(header.size + 1, 1);
+    }
+    bool ok = image != NULL;
+    for (uint32_t k = 0; ok && k < header.num_written; k++) {
+        uint32_t b;
+        ok = fread(&b, sizeof(b), 1, file) == 1 && b < header.num_blocks;
+        if (!ok) break;
+        size_t length = block_length(header.size, header.block_size, b);
+        ok = fread(image + (size_t)b * header.block_size, 1, length,
+                   file) == length;
+    }
+    fclose(file);
+    if (!ok) {
+        free(image);
+        return -1;
+    }
+    *data = image;
+    *size = header.size;
+    return 0;
+}
+
+int checkpoint_read_image(const char* path, char** data, size_t* size) {
+    return read_image(path, 0, data, size);
+}
@@ -0,0 +1,95 @@
+#ifndef NEURAL_CHECKPOINT_H
+#define NEURAL_CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+// Periodic checkpoints written without stalling the simulation for the
+// write. In fork mode the process forks at a step boundary and the child
+// serializes its copy-on-write snapshot of the state while the parent
+// simulates on; the parent only pauses for the fork, and for a previous
+// checkpoint still being written. Pages the parent writes meanwhile are
+// copied by the kernel; the child measures that overhead from the
+// parent's private memory before it exits.
+//
+// Incremental checkpoints store the serialized state as an image of
+// CHECKPOINT_BLOCK_SIZE blocks, writing only the blocks whose hash differs
+// from those of the previous checkpoint, which becomes the delta's base.
+// Every CHECKPOINT_MAX_CHAIN deltas a full image starts a new chain.
+// Bases are named relative to the delta's directory.
+//
+// Files appear under their name once complete; they are written to
+// <path>.tmp first.
+
+typedef enum {
+    CHECKPOINT_BLOCKING = 0,  // Written in place, the simulation waits
+    CHECKPOINT_FORK,          // Written by a forked child
+    NUM_CHECKPOINT_MODES
+} CheckpointMode;
+
+#define CHECKPOINT_BLOCK_SIZE 65536
+#define CHECKPOINT_MAX_CHAIN 16
+#define CHECKPOINT_IMAGE_MAGIC "NSIMAGE1"
+#define CHECKPOINT_PATH_MAX 4096
+
+int checkpoint_mode_from_name(const char* name);
+const char* checkpoint_mode_name(CheckpointMode mode);
+
+// Serializes the state to file; returns 0 on success
+typedef int (*CheckpointWriter)(const void* context, FILE* file);
+
+// Outcome of one checkpoint
+typedef struct {
+    bool ok;
+    bool full;              // Whole state, not a delta
+    double pause_time;      // Seconds the simulation stood still
+    double write_time;      // Seconds spent serializing and writing
+    long long blocks;       // Blocks of the image, 0 for plain state files
+    long long blocks_written;
+    long long bytes_written;
+    long long cow_bytes;    // Parent memory copied on write, 0 if unknown
+} CheckpointResult;
+
+typedef struct {
+    CheckpointMode mode;
+    bool incremental;
+    pid_t child;               // Writer in flight, 0 if none
+    CheckpointResult* shared;  // The child's result, a shared mapping
+    double pending_pause;      // Pause of the checkpoint in flight
+    char pending[CHECKPOINT_PATH_MAX];  // File it writes
+    char last[CHECKPOINT_PATH_MAX];     // Last complete checkpoint
+    int chain;                 // Deltas since the last full image
+    CheckpointResult result;   // Last collected checkpoint
+
+    // Over all collected checkpoints
+    long long completed;
+    long long failed;
+    double total_pause;
+    double max_pause;
+    long long max_cow_bytes;
+} Checkpointer;
+
+Checkpointer* create_checkpointer(CheckpointMode mode, bool incremental);
+// Waits for a checkpoint still being written
+void destroy_checkpointer(Checkpointer* checkpointer);
+
+// Checkpoints the state writer serializes to path, first collecting a
+// previous one (waiting for it if needed). In blocking mode the checkpoint
+// is complete on return. Returns 0 if it was written or started.
+int checkpoint_start(Checkpointer* checkpointer, const char* path,
+                     CheckpointWriter writer, const void* context);
+
+// Collects a finished checkpoint into checkpointer->result, waiting for
+// one in flight if wait is set. Returns 1 if one was collected, else 0.
+int checkpoint_collect(Checkpointer* checkpointer, bool wait);
+
+// Whether path holds an image rather than a plain state file
+bool checkpoint_is_image(const char* path);
+
+// Reassembles the state an image holds, following its chain of bases,
+// into a malloc'd buffer. Returns 0 on success.
+int checkpoint_read_image(const char* path, char** data, size_t* size);
+
+#endif
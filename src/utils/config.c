@@ -2,12 +2,71 @@
 
 #include <ctype.h>  // isspace için
 #include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define MAX_LINE_LENGTH 1024
 
+static bool parse_bool(const char* value) {
+    return strcmp(value, "true") == 0 || strcmp(value, "yes") == 0 ||
+           atoi(value) != 0;
+}
+
+// Numeric neuron parameters, read and written under the same keys
+typedef struct {
+    const char* key;
+    size_t offset;  // Of the double in ModelParams
+} PopulationKey;
+
+static const PopulationKey population_keys[] = {
+    {"v_rest", offsetof(ModelParams, base.v_resting)},
+    {"v_threshold", offsetof(ModelParams, base.v_threshold)},
+    {"v_reset", offsetof(ModelParams, base.v_reset)},
+    {"tau_m", offsetof(ModelParams, base.tau_m)},
+    {"refractory_period", offsetof(ModelParams, base.refractory_period)},
+    {"adex_a", offsetof(ModelParams, adex_a)},
+    {"adex_b", offsetof(ModelParams, adex_b)},
+    {"adex_tau_w", offsetof(ModelParams, adex_tau_w)},
+    {"adex_delta_t", offsetof(ModelParams, adex_delta_t)},
+    {"adex_v_peak", offsetof(ModelParams, adex_v_peak)},
+    {"izh_a", offsetof(ModelParams, izh_a)},
+    {"izh_b", offsetof(ModelParams, izh_b)},
+    {"izh_c", offsetof(ModelParams, izh_c)},
+    {"izh_d", offsetof(ModelParams, izh_d)},
+    {"e_exc", offsetof(ModelParams, e_exc)},
+    {"e_inh", offsetof(ModelParams, e_inh)},
+};
+
+#define NUM_POPULATION_KEYS \
+    (sizeof(population_keys) / sizeof(population_keys[0]))
+
+static double* population_value(ModelParams* params, size_t k) {
+    return (double*)((char*)params + population_keys[k].offset);
+}
+
+// Neuron model keys; returns false if key is not a population parameter
+static bool parse_population_key(const char* key, const char* value,
+                                 PopulationConfig* pop) {
+    if (strcmp(key, "model") == 0) {
+        int model = neuron_model_from_name(value);
+        if (model < 0) {
+            fprintf(stderr, "Unknown neuron model: %s\n", value);
+        } else {
+            pop->model = (NeuronModelType)model;
+        }
+        return true;
+    }
+    for (size_t k = 0; k < NUM_POPULATION_KEYS; k++) {
+        if (strcmp(key, population_keys[k].key) == 0) {
+            *population_value(&pop->params, k) = atof(value);
+            return true;
+        }
+    }
+    return false;
+}
+
 static void parse_line(char* line, SimulationConfig* config) {
     char* key = line;
     char* value = strchr(line, '=');
@@ -25,6 +84,23 @@ static void parse_line(char* line, SimulationConfig* config) {
     while (end > key && isspace(*end)) *end-- = '\0';
     while (isspace(*key)) key++;
 
+    // Neuron parameters: a "pyramidal_" or "inhibitory_" prefix selects one
+    // population, otherwise the value applies to both
+    if (strncmp(key, "pyramidal_", 10) == 0 &&
+        parse_population_key(key + 10, value, &config->network.pyramidal)) {
+        return;
+    }
+    if (strncmp(key, "inhibitory_", 11) == 0 &&
+        parse_population_key(key + 11, value, &config->network.inhibitory)) {
+        return;
+    }
+    const char* pop_key = strcmp(key, "neuron_model") == 0 ? "model" : key;
+    if (strcmp(key, "model") != 0 &&
+        parse_population_key(pop_key, value, &config->network.pyramidal)) {
+        parse_population_key(pop_key, value, &config->network.inhibitory);
+        return;
+    }
+
     // Parse values based on key
     if (strcmp(key, "num_pyramidal") == 0) {
         config->network.num_pyramidal = atoi(value);
@@ -36,11 +112,276 @@ static void parse_line(char* line, SimulationConfig* config) {
         config->network.simulation_time = atof(value);
     } else if (strcmp(key, "connection_rate") == 0) {
         config->network.connection_rate = atof(value);
+    } else if (strcmp(key, "reorder") == 0) {
+        int method = reorder_method_from_name(value);
+        if (method < 0) {
+            fprintf(stderr, "Unknown reorder method: %s\n", value);
+        } else {
+            config->network.reorder = (ReorderMethod)method;
+        }
     } else if (strcmp(key, "output_dir") == 0) {
+        free(config->network.output_dir);
         config->network.output_dir = strdup(value);
+    } else if (strcmp(key, "connectome_file") == 0) {
+        free(config->network.connectome_file);
+        config->network.connectome_file = value[0] ? strdup(value) : NULL;
+    } else if (strcmp(key, "save_interval") == 0) {
+        config->save_interval = atoi(value);
+    } else if (strcmp(key, "record_spikes") == 0) {
+        config->record_spikes = parse_bool(value);
+    } else if (strcmp(key, "record_traces") == 0) {
+        config->record_traces = parse_bool(value);
+    } else if (strcmp(key, "async_output") == 0) {
+        config->async_output = parse_bool(value);
+    } else if (strcmp(key, "temporal_blocking") == 0) {
+        config->temporal_blocking = parse_bool(value);
+    } else if (strcmp(key, "checkpoint_interval") == 0) {
+        config->checkpoint_interval = atof(value);
+    } else if (strcmp(key, "checkpoint_mode") == 0) {
+        int mode = checkpoint_mode_from_name(value);
+        if (mode < 0) {
+            fprintf(stderr, "Unknown checkpoint mode: %s\n", value);
+        } else {
+            config->checkpoint_mode = (CheckpointMode)mode;
+        }
+    } else if (strcmp(key, "checkpoint_incremental") == 0) {
+        config->checkpoint_incremental = parse_bool(value);
+    } else if (strcmp(key, "realtime") == 0) {
+        config->realtime = parse_bool(value);
+    } else if (strcmp(key, "realtime_factor") == 0) {
+        config->realtime_factor = atof(value);
+    } else if (strcmp(key, "realtime_warmup") == 0) {
+        config->realtime_warmup = atoi(value);
+    } else if (strcmp(key, "realtime_lock_memory") == 0) {
+        config->realtime_lock_memory = parse_bool(value);
+    } else if (strcmp(key, "probe") == 0) {
+        // May be given several times, one probe per line
+        char** probes =
+            realloc(config->probes, (config->num_probes + 1) * sizeof(char*));
+        if (probes) {
+            config->probes = probes;
+            config->probes[config->num_probes++] = strdup(value);
+        }
+    } else if (strcmp(key, "ranks") == 0) {
+        config->num_ranks = atoi(value);
+    } else if (strcmp(key, "rank") == 0) {
+        config->rank = atoi(value);
+    } else if (strcmp(key, "transport") == 0) {
+        int kind = transport_kind_from_name(value);
+        if (kind < 0) {
+            fprintf(stderr, "Unknown transport: %s\n", value);
+        } else {
+            config->transport = (TransportKind)kind;
+        }
+    } else if (strcmp(key, "transport_name") == 0) {
+        free(config->transport_name);
+        config->transport_name = value[0] ? strdup(value) : NULL;
+    } else if (strcmp(key, "live_view") == 0) {
+        free(config->live_view);
+        config->live_view = value[0] ? strdup(value) : NULL;
+    } else if (strcmp(key, "random_seed") == 0) {
+        config->network.seed = (unsigned int)strtoul(value, NULL, 10);
+        config->random_seed = atoi(value);
+    } else if (strcmp(key, "tau_syn") == 0) {
+        config->network.tau_syn = atof(value);
+    } else if (strcmp(key, "w_exc") == 0) {
+        config->network.w_exc = atof(value);
+    } else if (strcmp(key, "w_inh") == 0) {
+        config->network.w_inh = atof(value);
+    } else if (strcmp(key, "synaptic_delay") == 0) {
+        config->network.synaptic_delay = atof(value);
+    } else if (strcmp(key, "background_sources") == 0) {
+        config->network.background.num_sources = atoi(value);
+    } else if (strcmp(key, "background_rate") == 0) {
+        config->network.background.rate = atof(value);
+    } else if (strcmp(key, "background_weight") == 0) {
+        config->network.background.weight = atof(value);
+    } else if (strcmp(key, "num_dendrites") == 0) {
+        config->network.num_dendrites = atoi(value);
+    } else if (strcmp(key, "num_synapses_per_dendrite") == 0) {
+        config->network.synapses_per_dendrite = atoi(value);
+    } else if (strcmp(key, "dendrite_compartments") == 0) {
+        config->network.dendrite_compartments = atoi(value);
+    } else if (strcmp(key, "dendrite_coupling") == 0) {
+        config->network.dendrite_coupling = atof(value);
+    } else if (strcmp(key, "dendrite_tau") == 0) {
+        config->network.dendrite_tau = atof(value);
+    } else if (strcmp(key, "dendrite_soma_ratio") == 0) {
+        config->network.dendrite_soma_ratio = atof(value);
+    } else if (strcmp(key, "gap_junction_rate") == 0) {
+        config->network.gap_junction_rate = atof(value);
+    } else if (strcmp(key, "gap_junction_conductance") == 0) {
+        config->network.gap_junction_conductance = atof(value);
+    } else if (strcmp(key, "gap_junction_iterations") == 0) {
+        config->network.gap_junction_iterations = atoi(value);
+    } else if (strcmp(key, "stdp") == 0) {
+        config->network.enable_stdp = parse_bool(value);
+    } else if (strcmp(key, "stdp_a_plus") == 0) {
+        config->network.stdp.a_plus = atof(value);
+    } else if (strcmp(key, "stdp_a_minus") == 0) {
+        config->network.stdp.a_minus = atof(value);
+    } else if (strcmp(key, "stdp_tau_plus") == 0) {
+        config->network.stdp.tau_plus = atof(value);
+    } else if (strcmp(key, "stdp_tau_minus") == 0) {
+        config->network.stdp.tau_minus = atof(value);
+    } else if (strcmp(key, "stdp_w_min") == 0) {
+        config->network.stdp.w_min = atof(value);
+    } else if (strcmp(key, "stdp_w_max") == 0) {
+        config->network.stdp.w_max = atof(value);
+    } else if (strcmp(key, "reward_learning") == 0) {
+        config->network.enable_reward_learning = parse_bool(value);
+    } else if (strcmp(key, "eligibility_tau") == 0) {
+        config->network.eligibility.tau = atof(value);
+    } else if (strcmp(key, "reward_learning_rate") == 0) {
+        config->network.eligibility.learning_rate = atof(value);
+    } else if (strcmp(key, "reward_baseline_rate") == 0) {
+        config->network.eligibility.baseline_rate = atof(value);
+    } else if (strcmp(key, "structural_plasticity") == 0) {
+        config->network.enable_structural = parse_bool(value);
+    } else if (strcmp(key, "structural_interval") == 0) {
+        config->network.structural.interval = atof(value);
+    } else if (strcmp(key, "structural_prune_weight") == 0) {
+        config->network.structural.prune_weight = atof(value);
+    } else if (strcmp(key, "structural_prune_checks") == 0) {
+        config->network.structural.prune_checks = atoi(value);
+    } else if (strcmp(key, "structural_formation_rate") == 0) {
+        config->network.structural.formation_rate = atof(value);
+    } else if (strcmp(key, "structural_initial_weight") == 0) {
+        config->network.structural.initial_weight = atof(value);
+    } else if (strcmp(key, "structural_slack") == 0) {
+        config->network.structural.slack = atof(value);
+    } else if (strcmp(key, "activity_window") == 0) {
+        config->network.activity_window = atof(value);
+    } else if (strcmp(key, "homeostasis_target_rate") == 0) {
+        config->homeostasis.target_rate = atof(value);
+    } else if (strcmp(key, "homeostasis_adaptation_rate") == 0) {
+        config->homeostasis.adaptation_rate = atof(value);
+    } else if (strcmp(key, "homeostasis_energy_baseline") == 0) {
+        config->homeostasis.energy_baseline = atof(value);
+    } else if (strcmp(key, "homeostasis_recovery_rate") == 0) {
+        config->homeostasis.recovery_rate = atof(value);
+    } else if (strcmp(key, "baseline_dopamine") == 0) {
+        config->neuromodulation.baseline_da = atof(value);
+    } else if (strcmp(key, "baseline_serotonin") == 0) {
+        config->neuromodulation.baseline_5ht = atof(value);
+    } else if (strcmp(key, "baseline_noradrenaline") == 0) {
+        config->neuromodulation.baseline_na = atof(value);
+    } else if (strcmp(key, "baseline_acetylcholine") == 0) {
+        config->neuromodulation.baseline_ach = atof(value);
     }
 }
 
+// Keys that are parsed and saved, but not read by the simulation: the
+// homeostasis and neuromodulator mechanisms are not part of the network
+static const char* const inert_keys[] = {
+    "homeostasis_target_rate", "homeostasis_adaptation_rate",
+    "homeostasis_energy_baseline", "homeostasis_recovery_rate",
+    "baseline_dopamine", "baseline_serotonin", "baseline_noradrenaline",
+    "baseline_acetylcholine",
+};
+
+bool config_key_has_effect(const char* key) {
+    for (size_t k = 0; k < sizeof(inert_keys) / sizeof(inert_keys[0]); k++) {
+        if (strcmp(key, inert_keys[k]) == 0) return false;
+    }
+    return true;
+}
+
+SimulationConfig* create_default_config(void) {
+    SimulationConfig* config =
+        (SimulationConfig*)calloc(1, sizeof(SimulationConfig));
+    if (!config) return NULL;
+
+    // Set default values
+    config->network.num_pyramidal = 400;
+    config->network.num_inhibitory = 100;
+    config->network.dt = 0.1;
+    config->network.simulation_time = 1000.0;
+    config->network.connection_rate = 0.1;
+    config->network.output_dir = strdup("output");
+    config->network.seed = 1;
+    config->network.pyramidal.model = MODEL_LIF;
+    default_model_params(&config->network.pyramidal.params, false);
+    config->network.inhibitory.model = MODEL_LIF;
+    default_model_params(&config->network.inhibitory.params, true);
+    config->network.tau_syn = 5.0;
+    config->network.w_exc = 0.5;
+    config->network.w_inh = -1.0;
+    config->network.synaptic_delay = 1.0;
+    config->random_seed = 1;
+    config->network.background.num_sources = 0;
+    config->network.background.rate = 5.0;
+    config->network.background.weight = 0.1;
+    config->network.num_dendrites = 0;
+    config->network.synapses_per_dendrite = 50;
+    config->network.dendrite_compartments = 4;
+    config->network.dendrite_coupling = 0.5;
+    config->network.dendrite_tau = 10.0;
+    config->network.dendrite_soma_ratio = 0.01;
+    config->network.gap_junction_rate = 0.0;
+    config->network.gap_junction_conductance = 0.05;
+    config->network.gap_junction_iterations = 2;
+    config->network.enable_stdp = false;
+    config->network.stdp.a_plus = 0.005;
+    config->network.stdp.a_minus = 0.00525;
+    config->network.stdp.tau_plus = 20.0;
+    config->network.stdp.tau_minus = 20.0;
+    config->network.stdp.w_min = 0.0;
+    config->network.stdp.w_max = 2.0;
+    config->network.enable_reward_learning = false;
+    config->network.eligibility.tau = 1000.0;
+    config->network.eligibility.learning_rate = 1.0;
+    config->network.eligibility.baseline_rate = 0.1;
+    config->network.enable_structural = false;
+    config->network.structural.interval = 100.0;
+    config->network.structural.prune_weight = 0.005;
+    config->network.structural.prune_checks = 3;
+    config->network.structural.formation_rate = 1.0;
+    config->network.structural.initial_weight = 0.05;
+    config->network.structural.slack = 0.1;
+    config->network.activity_window = 10.0;
+
+    config->save_interval = 1;
+    config->async_output = true;
+    config->temporal_blocking = false;
+    config->checkpoint_interval = 0.0;
+    config->checkpoint_mode = CHECKPOINT_FORK;
+    config->checkpoint_incremental = false;
+    config->realtime = false;
+    config->realtime_factor = 1.0;
+    config->realtime_warmup = 100;
+    config->realtime_lock_memory = false;
+    config->num_ranks = 1;
+    config->rank = 0;
+    config->transport = TRANSPORT_SHM;
+
+    return config;
+}
+
+SimulationConfig* parse_config_string(const char* text) {
+    SimulationConfig* config = create_default_config();
+    char* copy = strdup(text);
+    if (!config || !copy) {
+        free(copy);
+        destroy_config(config);
+        return NULL;
+    }
+
+    char* saveptr = NULL;
+    for (char* line = strtok_r(copy, "\n", &saveptr); line;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        if (line[0] == '#' || line[0] == '\0') continue;
+        parse_line(line, config);
+    }
+    free(copy);
+
+    if (validate_config(config) != 0) {
+        destroy_config(config);
+        return NULL;
+    }
+    return config;
+}
+
 SimulationConfig* load_config(const char* filename) {
     FILE* file = fopen(filename, "r");
     if (!file) {
@@ -48,21 +389,12 @@ SimulationConfig* load_config(const char* filename) {
         return NULL;
     }
 
-    SimulationConfig* config =
-        (SimulationConfig*)malloc(sizeof(SimulationConfig));
+    SimulationConfig* config = create_default_config();
     if (!config) {
         fclose(file);
         return NULL;
     }
 
-    // Set default values
-    config->network.num_pyramidal = 400;
-    config->network.num_inhibitory = 100;
-    config->network.dt = 0.1;
-    config->network.simulation_time = 1000.0;
-    config->network.connection_rate = 0.1;
-    config->network.output_dir = "output";
-
     char line[256];
     while (fgets(line, sizeof(line), file)) {
         // Skip comments and empty lines
@@ -71,7 +403,10 @@ SimulationConfig* load_config(const char* filename) {
     }
 
     fclose(file);
-    validate_config(config);
+    if (validate_config(config) != 0) {
+        destroy_config(config);
+        return NULL;
+    }
     return config;
 }
 
@@ -88,27 +423,252 @@ void save_config(SimulationConfig* config, const char* filename) {
     fprintf(file, "dt=%f\n", config->network.dt);
     fprintf(file, "simulation_time=%f\n", config->network.simulation_time);
     fprintf(file, "connection_rate=%f\n", config->network.connection_rate);
+    fprintf(file, "reorder=%s\n", reorder_method_name(config->network.reorder));
     fprintf(file, "output_dir=%s\n", config->network.output_dir);
+    if (config->network.connectome_file) {
+        fprintf(file, "connectome_file=%s\n", config->network.connectome_file);
+    }
+    fprintf(file, "random_seed=%u\n", config->network.seed);
+    fprintf(file, "save_interval=%d\n", config->save_interval);
+    fprintf(file, "record_spikes=%s\n",
+            config->record_spikes ? "true" : "false");
+    fprintf(file, "record_traces=%s\n",
+            config->record_traces ? "true" : "false");
+    fprintf(file, "async_output=%s\n",
+            config->async_output ? "true" : "false");
+    fprintf(file, "temporal_blocking=%s\n",
+            config->temporal_blocking ? "true" : "false");
+    fprintf(file, "checkpoint_interval=%f\n", config->checkpoint_interval);
+    fprintf(file, "checkpoint_mode=%s\n",
+            checkpoint_mode_name(config->checkpoint_mode));
+    fprintf(file, "checkpoint_incremental=%s\n",
+            config->checkpoint_incremental ? "true" : "false");
+    fprintf(file, "realtime=%s\n", config->realtime ? "true" : "false");
+    fprintf(file, "realtime_factor=%f\n", config->realtime_factor);
+    fprintf(file, "realtime_warmup=%d\n", config->realtime_warmup);
+    fprintf(file, "realtime_lock_memory=%s\n",
+            config->realtime_lock_memory ? "true" : "false");
+    if (config->live_view) {
+        fprintf(file, "live_view=%s\n", config->live_view);
+    }
+    for (int i = 0; i < config->num_probes; i++) {
+        fprintf(file, "probe=%s\n", config->probes[i]);
+    }
+    fprintf(file, "ranks=%d\n", config->num_ranks);
+    fprintf(file, "rank=%d\n", config->rank);
+    fprintf(file, "transport=%s\n", transport_kind_name(config->transport));
+    if (config->transport_name) {
+        fprintf(file, "transport_name=%s\n", config->transport_name);
+    }
+
+    fprintf(file, "\n# Neuron models\n");
+    const PopulationConfig* pops[2] = {&config->network.pyramidal,
+                                       &config->network.inhibitory};
+    const char* prefixes[2] = {"pyramidal", "inhibitory"};
+    for (int i = 0; i < 2; i++) {
+        ModelParams params = pops[i]->params;
+        fprintf(file, "%s_model=%s\n", prefixes[i],
+                neuron_model_name(pops[i]->model));
+        for (size_t k = 0; k < NUM_POPULATION_KEYS; k++) {
+            fprintf(file, "%s_%s=%.17g\n", prefixes[i],
+                    population_keys[k].key, *population_value(&params, k));
+        }
+    }
+
+    fprintf(file, "\n# Synaptic Parameters\n");
+    fprintf(file, "tau_syn=%f\n", config->network.tau_syn);
+    fprintf(file, "w_exc=%f\n", config->network.w_exc);
+    fprintf(file, "w_inh=%f\n", config->network.w_inh);
+    fprintf(file, "synaptic_delay=%f\n", config->network.synaptic_delay);
+
+    fprintf(file, "\n# Background input\n");
+    fprintf(file, "background_sources=%d\n",
+            config->network.background.num_sources);
+    fprintf(file, "background_rate=%f\n", config->network.background.rate);
+    fprintf(file, "background_weight=%f\n",
+            config->network.background.weight);
+    fprintf(file, "num_dendrites=%d\n", config->network.num_dendrites);
+    fprintf(file, "num_synapses_per_dendrite=%d\n",
+            config->network.synapses_per_dendrite);
+    fprintf(file, "dendrite_compartments=%d\n",
+            config->network.dendrite_compartments);
+    fprintf(file, "dendrite_coupling=%f\n", config->network.dendrite_coupling);
+    fprintf(file, "dendrite_tau=%f\n", config->network.dendrite_tau);
+    fprintf(file, "dendrite_soma_ratio=%f\n",
+            config->network.dendrite_soma_ratio);
+    fprintf(file, "gap_junction_rate=%f\n", config->network.gap_junction_rate);
+    fprintf(file, "gap_junction_conductance=%f\n",
+            config->network.gap_junction_conductance);
+    fprintf(file, "gap_junction_iterations=%d\n",
+            config->network.gap_junction_iterations);
+
+    fprintf(file, "\n# Plasticity\n");
+    fprintf(file, "stdp=%s\n", config->network.enable_stdp ? "true" : "false");
+    fprintf(file, "stdp_a_plus=%f\n", config->network.stdp.a_plus);
+    fprintf(file, "stdp_a_minus=%f\n", config->network.stdp.a_minus);
+    fprintf(file, "stdp_tau_plus=%f\n", config->network.stdp.tau_plus);
+    fprintf(file, "stdp_tau_minus=%f\n", config->network.stdp.tau_minus);
+    fprintf(file, "stdp_w_min=%f\n", config->network.stdp.w_min);
+    fprintf(file, "stdp_w_max=%f\n", config->network.stdp.w_max);
+    fprintf(file, "reward_learning=%s\n",
+            config->network.enable_reward_learning ? "true" : "false");
+    fprintf(file, "eligibility_tau=%f\n", config->network.eligibility.tau);
+    fprintf(file, "reward_learning_rate=%f\n",
+            config->network.eligibility.learning_rate);
+    fprintf(file, "reward_baseline_rate=%f\n",
+            config->network.eligibility.baseline_rate);
+    fprintf(file, "structural_plasticity=%s\n",
+            config->network.enable_structural ? "true" : "false");
+    fprintf(file, "structural_interval=%f\n",
+            config->network.structural.interval);
+    fprintf(file, "structural_prune_weight=%f\n",
+            config->network.structural.prune_weight);
+    fprintf(file, "structural_prune_checks=%d\n",
+            config->network.structural.prune_checks);
+    fprintf(file, "structural_formation_rate=%f\n",
+            config->network.structural.formation_rate);
+    fprintf(file, "structural_initial_weight=%f\n",
+            config->network.structural.initial_weight);
+    fprintf(file, "structural_slack=%f\n", config->network.structural.slack);
+    fprintf(file, "activity_window=%f\n", config->network.activity_window);
+
+    fprintf(file, "\n# Homeostasis and neuromodulation\n");
+    fprintf(file, "homeostasis_target_rate=%f\n",
+            config->homeostasis.target_rate);
+    fprintf(file, "homeostasis_adaptation_rate=%f\n",
+            config->homeostasis.adaptation_rate);
+    fprintf(file, "homeostasis_energy_baseline=%f\n",
+            config->homeostasis.energy_baseline);
+    fprintf(file, "homeostasis_recovery_rate=%f\n",
+            config->homeostasis.recovery_rate);
+    fprintf(file, "baseline_dopamine=%f\n",
+            config->neuromodulation.baseline_da);
+    fprintf(file, "baseline_serotonin=%f\n",
+            config->neuromodulation.baseline_5ht);
+    fprintf(file, "baseline_noradrenaline=%f\n",
+            config->neuromodulation.baseline_na);
+    fprintf(file, "baseline_acetylcholine=%f\n",
+            config->neuromodulation.baseline_ach);
     // Add more parameters...
 
     fclose(file);
 }
 
-void validate_config(SimulationConfig* config) {
+int validate_config(SimulationConfig* config) {
     // Validate network parameters
     if (config->network.num_pyramidal <= 0) {
         fprintf(stderr, "Invalid number of pyramidal neurons\n");
-        exit(1);
+        return -1;
     }
     if (config->network.num_inhibitory <= 0) {
         fprintf(stderr, "Invalid number of inhibitory neurons\n");
-        exit(1);
+        return -1;
+    }
+    if (config->network.dt <= 0.0 || config->network.simulation_time < 0.0) {
+        fprintf(stderr, "Invalid time step or simulation time\n");
+        return -1;
+    }
+    const PopulationConfig* pops[2] = {&config->network.pyramidal,
+                                       &config->network.inhibitory};
+    for (int i = 0; i < 2; i++) {
+        const ModelParams* p = &pops[i]->params;
+        if (p->base.tau_m <= 0.0 || p->base.refractory_period < 0.0) {
+            fprintf(stderr, "Invalid neuron time constants\n");
+            return -1;
+        }
+        if (pops[i]->model == MODEL_ADEX &&
+            (p->adex_tau_w <= 0.0 || p->adex_delta_t <= 0.0)) {
+            fprintf(stderr, "Invalid AdEx parameters\n");
+            return -1;
+        }
+    }
+    if (config->network.tau_syn < 0.0 ||
+        config->network.synaptic_delay < 0.0) {
+        fprintf(stderr, "Invalid synaptic parameters\n");
+        return -1;
+    }
+    if (config->network.background.num_sources < 0 ||
+        config->network.background.rate < 0.0) {
+        fprintf(stderr, "Invalid background input parameters\n");
+        return -1;
+    }
+    if (config->network.num_dendrites < 0 ||
+        config->network.num_dendrites > MAX_DENDRITES ||
+        (config->network.num_dendrites > 0 &&
+         (config->network.synapses_per_dendrite < 1 ||
+          config->network.dendrite_compartments < 1 ||
+          config->network.dendrite_coupling < 0.0 ||
+          config->network.dendrite_tau <= 0.0 ||
+          config->network.dendrite_soma_ratio < 0.0))) {
+        fprintf(stderr, "Invalid dendrite parameters\n");
+        return -1;
+    }
+    if (config->network.gap_junction_rate < 0.0 ||
+        config->network.gap_junction_rate > 1.0 ||
+        config->network.gap_junction_conductance < 0.0 ||
+        config->network.gap_junction_iterations < 0) {
+        fprintf(stderr, "Invalid gap junction parameters\n");
+        return -1;
+    }
+    if (config->num_ranks < 1 || config->rank < 0 ||
+        config->rank >= config->num_ranks) {
+        fprintf(stderr, "Invalid rank %d of %d\n", config->rank,
+                config->num_ranks);
+        return -1;
+    }
+    if (config->network.enable_stdp &&
+        (config->network.stdp.tau_plus <= 0.0 ||
+         config->network.stdp.tau_minus <= 0.0)) {
+        fprintf(stderr, "Invalid STDP time constants\n");
+        return -1;
+    }
+    if (config->network.enable_stdp &&
+        config->network.stdp.w_min > config->network.stdp.w_max) {
+        fprintf(stderr, "Invalid STDP weight bounds\n");
+        return -1;
+    }
+    if (config->network.enable_reward_learning) {
+        if (!config->network.enable_stdp) {
+            fprintf(stderr, "Reward learning requires stdp=true\n");
+            return -1;
+        }
+        if (config->network.eligibility.tau <= 0.0) {
+            fprintf(stderr, "Invalid eligibility time constant\n");
+            return -1;
+        }
+    }
+    const StructuralParams* structural = &config->network.structural;
+    if (config->network.enable_structural &&
+        (structural->interval <= 0.0 || structural->prune_checks < 1 ||
+         structural->prune_checks > 255 || structural->formation_rate < 0.0 ||
+         structural->slack < 0.0)) {
+        fprintf(stderr, "Invalid structural plasticity parameters\n");
+        return -1;
+    }
+    if (config->checkpoint_interval < 0.0) {
+        fprintf(stderr, "Invalid checkpoint interval\n");
+        return -1;
+    }
+    if (config->realtime &&
+        (config->realtime_factor <= 0.0 || config->realtime_warmup < 0)) {
+        fprintf(stderr, "Invalid real-time pacing\n");
+        return -1;
+    }
+    if (config->network.activity_window < 0.0) {
+        fprintf(stderr, "Invalid activity window\n");
+        return -1;
     }
+    return 0;
 }
 
 void destroy_config(SimulationConfig* config) {
     if (config) {
         free(config->network.output_dir);
+        free(config->network.connectome_file);
+        free(config->live_view);
+        free(config->transport_name);
+        for (int i = 0; i < config->num_probes; i++) free(config->probes[i]);
+        free(config->probes);
         free(config);
     }
 }
@@ -6,8 +6,9 @@
 #include "../mechanisms/plasticity.h"
 #include "../mechanisms/neuromodulation.h"
 #include "../mechanisms/homeostasis.h"
+#include "checkpoint.h"
 
-typedef struct {
+typedef struct SimulationConfig {
     NetworkConfig network;
     PlasticityParams plasticity;
     NeuromodulationParams neuromodulation;
@@ -18,13 +19,46 @@ typedef struct {
     bool use_gpu;
     int random_seed;
     double simulation_duration;
-    int save_interval;
+    int save_interval;  // Steps between state files, 0 disables them
+    char* live_view;    // Shared-memory name of the live view, NULL if off
+    bool record_traces; // Multi-resolution traces in <output_dir>/traces
+    bool record_spikes; // spike_times.npy / spike_ids.npy in output_dir
+    bool async_output;  // Write outputs on a thread overlapping the next step
+    char** probes;      // Probe specs, see probe_set_add_spec()
+    int num_probes;
+    // Advance up to synaptic_delay / dt steps between synchronizations,
+    // see update_network_block()
+    bool temporal_blocking;
+
+    // Checkpoints every checkpoint_interval ms to
+    // <output_dir>/checkpoint_<step>.bin, 0 disables them; see checkpoint.h
+    double checkpoint_interval;
+    CheckpointMode checkpoint_mode;
+    bool checkpoint_incremental;
+
+    // Real-time pacing: each step takes realtime_factor times its simulated
+    // duration of wall-clock time; see realtime.h. Runs single steps.
+    bool realtime;
+    double realtime_factor;
+    int realtime_warmup;        // Steps before latencies are recorded
+    bool realtime_lock_memory;  // Lock and prefault memory while paced
+
+    // Partitioned runs: num_ranks processes on one host, each updating a
+    // share of the neurons and writing to <output_dir>/rank_<rank>
+    int num_ranks;
+    int rank;
+    TransportKind transport;
+    char* transport_name;  // Shared memory name or socket path
 } SimulationConfig;
 
+SimulationConfig* create_default_config(void);
+SimulationConfig* parse_config_string(const char* text);
 SimulationConfig* load_config(const char* filename);
 void save_config(SimulationConfig* config, const char* filename);
 void print_config(SimulationConfig* config);
-void validate_config(SimulationConfig* config);
+int validate_config(SimulationConfig* config);
+// False for keys that are accepted but change nothing in a run
+bool config_key_has_effect(const char* key);
 void destroy_config(SimulationConfig* config);
 
 #endif
\ No newline at end of file
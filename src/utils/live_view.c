@@ -0,0 +1,133 @@
+#include "utils/live_view.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Raster rows start on a cache line of their own
+static size_t raster_offset(void) {
+    return (sizeof(LiveViewHeader) + 63) & ~(size_t)63;
+}
+
+LiveView* create_live_view(const char* name, const Network* net) {
+    LiveView* view = calloc(1, sizeof(LiveView));
+    if (!view) {
+        fprintf(stderr, "Failed to allocate live view\n");
+        return NULL;
+    }
+    view->name = strdup(name);
+
+    int num_neurons = net->config.num_pyramidal + net->config.num_inhibitory;
+    uint32_t words_per_row = (uint32_t)((num_neurons + 63) / 64);
+    size_t rows = (size_t)LIVE_VIEW_TILES * LIVE_VIEW_TILE_STEPS;
+    view->size = raster_offset() + rows * words_per_row * sizeof(uint64_t);
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open shared memory %s\n", name);
+        free(view->name);
+        free(view);
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)view->size) != 0) {
+        fprintf(stderr, "Failed to size shared memory %s\n", name);
+        close(fd);
+        shm_unlink(name);
+        free(view->name);
+        free(view);
+        return NULL;
+    }
+    void* segment =
+        mmap(NULL, view->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        fprintf(stderr, "Failed to map shared memory %s\n", name);
+        shm_unlink(name);
+        free(view->name);
+        free(view);
+        return NULL;
+    }
+    memset(segment, 0, view->size);
+    view->header = segment;
+    view->raster = (uint64_t*)((char*)segment + raster_offset());
+    view->rate_decay = exp(-net->config.dt / LIVE_VIEW_RATE_TAU);
+
+    LiveViewHeader* h = view->header;
+    h->version = LIVE_VIEW_VERSION;
+    h->header_size = (uint32_t)raster_offset();
+    h->num_neurons = (uint32_t)num_neurons;
+    h->num_populations = NUM_POPULATIONS;
+    h->num_phases = NUM_PHASES;
+    h->tile_steps = LIVE_VIEW_TILE_STEPS;
+    h->num_tiles = LIVE_VIEW_TILES;
+    h->words_per_row = words_per_row;
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        h->population_size[p] = (uint32_t)net->populations[p].count;
+    }
+    h->dt = net->config.dt;
+    // Readers check the magic last, once the layout above is in place
+    __atomic_store_n(&h->magic, LIVE_VIEW_MAGIC, __ATOMIC_RELEASE);
+    return view;
+}
+
+void destroy_live_view(LiveView* view) {
+    if (!view) return;
+    // Mappings held by readers stay valid after the name is removed
+    munmap(view->header, view->size);
+    shm_unlink(view->name);
+    free(view->name);
+    free(view);
+}
+
+void live_view_publish(LiveView* view, const Network* net, double time) {
+    LiveViewHeader* h = view->header;
+    uint64_t sequence = h->sequence;
+    __atomic_store_n(&h->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    size_t rows = (size_t)h->num_tiles * h->tile_steps;
+    uint64_t* row = view->raster + (h->step % rows) * h->words_per_row;
+    memset(row, 0, h->words_per_row * sizeof(uint64_t));
+
+    // spike_ids are ordered by population, so ids below the first
+    // inhibitory id belong to the pyramidal population. Reordering keeps
+    // populations apart, so this holds for creation-order ids too.
+    int first_inhibitory = net->populations[POP_INHIBITORY].first_id;
+    int counts[NUM_POPULATIONS] = {0};
+    for (int s = 0; s < net->num_spikes; s++) {
+        int id = network_external_id(net, net->spike_ids[s]);
+        row[id >> 6] |= 1ULL << (id & 63);
+        counts[id >= first_inhibitory]++;
+    }
+
+    double seconds = net->config.dt / 1000.0;
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        int size = net->populations[p].count;
+        double rate = size > 0 ? counts[p] / (size * seconds) : 0.0;
+        h->rate[p] = rate + (h->rate[p] - rate) * view->rate_decay;
+        h->total_spikes[p] = (uint64_t)net->total_spikes[p];
+    }
+    memcpy(h->phase_time, net->phase_time, sizeof(h->phase_time));
+    h->time = time;
+    h->step++;
+
+    __atomic_store_n(&h->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+int live_view_read_header(const LiveViewHeader* shared, LiveViewHeader* out,
+                          int max_retries) {
+    for (int attempt = 0; attempt < max_retries; attempt++) {
+        uint64_t before = __atomic_load_n(&shared->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+        memcpy(out, shared, sizeof(LiveViewHeader));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shared->sequence, __ATOMIC_RELAXED) == before) {
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,72 @@
+#ifndef NEURAL_LIVE_VIEW_H
+#define NEURAL_LIVE_VIEW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/network.h"
+
+// Live view of a running simulation in a POSIX shared-memory segment.
+//
+// The segment is a LiveViewHeader followed by a spike raster. The header is
+// guarded by a seqlock: the writer makes `sequence` odd, updates the header
+// and makes it even again, so a reader copies the header and retries if the
+// sequence was odd or changed meanwhile. Readers never block the simulation
+// and need no system call once the segment is mapped.
+//
+// The raster is a ring of num_tiles * tile_steps rows, one per step, of
+// words_per_row 64-bit words with bit (id % 64) of word (id / 64) set when
+// neuron id spiked. Step s lives in row s % (num_tiles * tile_steps). A tile
+// of tile_steps rows is complete once `step` has passed its end, and stays
+// valid until the writer wraps around to it again, which a reader detects
+// by re-reading `step` after copying.
+
+#define LIVE_VIEW_MAGIC 0x315657564c534e00ULL  // "\0NSLVWV1"
+#define LIVE_VIEW_VERSION 1
+#define LIVE_VIEW_TILE_STEPS 64
+#define LIVE_VIEW_TILES 16
+
+// Time constant of the published population rates (ms)
+#define LIVE_VIEW_RATE_TAU 10.0
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;  // Raster starts at this byte offset
+    uint32_t num_neurons;
+    uint32_t num_populations;
+    uint32_t num_phases;
+    uint32_t tile_steps;
+    uint32_t num_tiles;
+    uint32_t words_per_row;
+    uint32_t population_size[NUM_POPULATIONS];
+    double dt;
+
+    // Dynamic part, guarded by the seqlock
+    uint64_t sequence;
+    uint64_t step;  // Steps published so far
+    double time;
+    double rate[NUM_POPULATIONS];  // Smoothed population rates (Hz)
+    uint64_t total_spikes[NUM_POPULATIONS];
+    double phase_time[NUM_PHASES];  // Seconds per update phase
+} LiveViewHeader;
+
+typedef struct LiveView {
+    char* name;
+    LiveViewHeader* header;
+    uint64_t* raster;
+    size_t size;
+    double rate_decay;
+} LiveView;
+
+// Writer side; name is a POSIX shared-memory name such as "/neuralsim"
+LiveView* create_live_view(const char* name, const Network* net);
+void destroy_live_view(LiveView* view);
+void live_view_publish(LiveView* view, const Network* net, double time);
+
+// Reader side: copy a consistent header from a mapped segment. Returns 0
+// on success, -1 if the writer kept it busy for max_retries attempts.
+int live_view_read_header(const LiveViewHeader* shared, LiveViewHeader* out,
+                          int max_retries);
+
+#endif
@@ -0,0 +1,407 @@
+#include "utils/npy.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static const char* npy_descr[] = {"<i4", "<i8", "<f4", "<f8"};
+static const size_t npy_sizes[] = {4, 8, 4, 8};
+
+size_t npy_type_size(NpyType type) { return npy_sizes[type]; }
+
+int npy_format_header(char* buffer, NpyType type, int ndim,
+                      const int64_t* shape) {
+    if (ndim < 0 || ndim > NPY_MAX_DIMS) return -1;
+
+    char dims[NPY_MAX_DIMS * 24 + 4];
+    int len = 0;
+    for (int d = 0; d < ndim; d++) {
+        len += snprintf(dims + len, sizeof(dims) - len, "%" PRId64 ",%s",
+                        shape[d], d + 1 < ndim ? " " : "");
+    }
+    // A 2-d shape is written "(a, b)", only 1-d keeps the trailing comma
+    if (ndim > 1) dims[--len] = '\0';
+    dims[len] = '\0';
+
+    memcpy(buffer, "\x93NUMPY\x01\x00", 8);
+    uint16_t dict_size = NPY_HEADER_SIZE - 10;
+    buffer[8] = (char)(dict_size & 0xff);
+    buffer[9] = (char)(dict_size >> 8);
+    int n = snprintf(buffer + 10, dict_size,
+                     "{'descr': '%s', 'fortran_order': False, 'shape': (%s), }",
+                     npy_descr[type], dims);
+    if (n < 0 || n >= dict_size) return -1;
+
+    // Space padding up to the newline that ends the header
+    memset(buffer + 10 + n, ' ', dict_size - n - 1);
+    buffer[NPY_HEADER_SIZE - 1] = '\n';
+    return 0;
+}
+
+NpyWriter* npy_open(const char* path, NpyType type, int ndim,
+                    const int64_t* shape) {
+    if (ndim < 1 || ndim > NPY_MAX_DIMS) return NULL;
+    NpyWriter* writer = calloc(1, sizeof(NpyWriter));
+    if (!writer) {
+        fprintf(stderr, "Failed to allocate npy writer\n");
+        return NULL;
+    }
+    writer->type = type;
+    writer->ndim = ndim;
+    writer->row_bytes = npy_type_size(type);
+    for (int d = 1; d < ndim; d++) {
+        writer->shape[d] = shape[d];
+        writer->row_bytes *= (size_t)shape[d];
+    }
+
+    writer->file = fopen(path, "wb+");
+    if (!writer->file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        free(writer);
+        return NULL;
+    }
+    if (npy_sync(writer) != 0) {
+        fclose(writer->file);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int npy_append(NpyWriter* writer, const void* rows, int64_t count) {
+    if (count <= 0) return 0;
+    if (fwrite(rows, writer->row_bytes, (size_t)count, writer->file) !=
+        (size_t)count) {
+        return -1;
+    }
+    writer->shape[0] += count;
+    return 0;
+}
+
+int npy_sync(NpyWriter* writer) {
+    char header[NPY_HEADER_SIZE];
+    if (npy_format_header(header, writer->type, writer->ndim,
+                          writer->shape) != 0) {
+        return -1;
+    }
+    // Data first, so a reader never sees a row count ahead of the rows
+    if (fflush(writer->file) != 0) return -1;
+    long end = ftell(writer->file);
+    if (fseek(writer->file, 0, SEEK_SET) != 0) return -1;
+    int status = fwrite(header, 1, sizeof(header), writer->file) ==
+                         sizeof(header)
+                     ? 0
+                     : -1;
+    if (fseek(writer->file, end > 0 ? end : (long)sizeof(header),
+              SEEK_SET) != 0) {
+        return -1;
+    }
+    if (fflush(writer->file) != 0) return -1;
+    return status;
+}
+
+int npy_close(NpyWriter* writer) {
+    if (!writer) return 0;
+    int status = npy_sync(writer);
+    if (fclose(writer->file) != 0) status = -1;
+    free(writer);
+    return status;
+}
+
+uint32_t crc32_update(uint32_t crc, const void* data, size_t size) {
+    static uint32_t table[256];
+    static int table_ready = 0;
+    if (!__atomic_load_n(&table_ready, __ATOMIC_ACQUIRE)) {
+        // Idempotent, so concurrent first calls are harmless
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        __atomic_store_n(&table_ready, 1, __ATOMIC_RELEASE);
+    }
+
+    const unsigned char* bytes = data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Stored (uncompressed) zip members; sizes are limited to 4 GiB since no
+// ZIP64 records are written
+typedef struct {
+    char* name;
+    uint32_t crc;
+    uint32_t size;
+    uint32_t offset;
+} ZipEntry;
+
+struct NpyArchive {
+    bool zip;
+    char* path;  // Directory, or the archive file
+    FILE* file;
+    ZipEntry* entries;
+    int num_entries;
+    int capacity;
+    uint16_t dos_time;
+    uint16_t dos_date;
+    int status;
+};
+
+static void put16(unsigned char* p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put32(unsigned char* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+NpyArchive* npy_archive_open(const char* path, bool zip) {
+    NpyArchive* archive = calloc(1, sizeof(NpyArchive));
+    if (!archive) {
+        fprintf(stderr, "Failed to allocate archive\n");
+        return NULL;
+    }
+    archive->zip = zip;
+    archive->path = strdup(path);
+
+    if (zip) {
+        archive->file = fopen(path, "wb+");
+        if (!archive->file) {
+            fprintf(stderr, "Failed to open %s\n", path);
+            free(archive->path);
+            free(archive);
+            return NULL;
+        }
+        time_t now = time(NULL);
+        struct tm tm;
+        localtime_r(&now, &tm);
+        archive->dos_time = (uint16_t)((tm.tm_hour << 11) | (tm.tm_min << 5) |
+                                       (tm.tm_sec / 2));
+        archive->dos_date = (uint16_t)(((tm.tm_year - 80) << 9) |
+                                       ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+    } else if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create directory %s\n", path);
+        free(archive->path);
+        free(archive);
+        return NULL;
+    }
+    return archive;
+}
+
+// Local header of a stored member; the CRC is patched once data is written
+static int zip_begin_entry(NpyArchive* archive, const char* name,
+                           uint64_t size, ZipEntry** entry_out) {
+    long offset = ftell(archive->file);
+    if (offset < 0 || size > UINT32_MAX || (uint64_t)offset > UINT32_MAX) {
+        return -1;
+    }
+    if (archive->num_entries == archive->capacity) {
+        int capacity = archive->capacity ? 2 * archive->capacity : 16;
+        ZipEntry* entries =
+            realloc(archive->entries, capacity * sizeof(ZipEntry));
+        if (!entries) return -1;
+        archive->entries = entries;
+        archive->capacity = capacity;
+    }
+    ZipEntry* entry = &archive->entries[archive->num_entries++];
+    entry->name = strdup(name);
+    entry->crc = 0;
+    entry->size = (uint32_t)size;
+    entry->offset = (uint32_t)offset;
+
+    size_t name_len = strlen(name);
+    unsigned char header[30];
+    put32(header, 0x04034b50);
+    put16(header + 4, 20);  // Version needed: 2.0
+    put16(header + 6, 0);   // Flags
+    put16(header + 8, 0);   // Stored
+    put16(header + 10, archive->dos_time);
+    put16(header + 12, archive->dos_date);
+    put32(header + 14, 0);  // CRC, patched later
+    put32(header + 18, entry->size);
+    put32(header + 22, entry->size);
+    put16(header + 26, (uint16_t)name_len);
+    put16(header + 28, 0);
+    if (fwrite(header, 1, sizeof(header), archive->file) != sizeof(header) ||
+        fwrite(name, 1, name_len, archive->file) != name_len) {
+        return -1;
+    }
+    *entry_out = entry;
+    return 0;
+}
+
+static int zip_end_entry(NpyArchive* archive, const ZipEntry* entry) {
+    unsigned char crc[4];
+    put32(crc, entry->crc);
+    long end = ftell(archive->file);
+    if (end < 0 || fseek(archive->file, entry->offset + 14, SEEK_SET) != 0 ||
+        fwrite(crc, 1, 4, archive->file) != 4 ||
+        fseek(archive->file, end, SEEK_SET) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Opens the destination of a member: a .npy file in the directory or a
+// zip entry. Data goes through write_member().
+static FILE* begin_member(NpyArchive* archive, const char* name,
+                          uint64_t size, ZipEntry** entry) {
+    char member[256];
+    snprintf(member, sizeof(member), "%s.npy", name);
+    *entry = NULL;
+    if (archive->zip) {
+        return zip_begin_entry(archive, member, size, entry) == 0
+                   ? archive->file
+                   : NULL;
+    }
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", archive->path, member);
+    FILE* file = fopen(path, "wb");
+    if (!file) fprintf(stderr, "Failed to open %s\n", path);
+    return file;
+}
+
+static int write_member(FILE* file, ZipEntry* entry, const void* data,
+                        size_t size) {
+    if (entry) entry->crc = crc32_update(entry->crc, data, size);
+    return fwrite(data, 1, size, file) == size ? 0 : -1;
+}
+
+static int end_member(NpyArchive* archive, FILE* file, ZipEntry* entry,
+                      int status) {
+    if (entry) return zip_end_entry(archive, entry) == 0 ? status : -1;
+    return fclose(file) == 0 ? status : -1;
+}
+
+int npy_archive_add_array(NpyArchive* archive, const char* name,
+                          NpyType type, int ndim, const int64_t* shape,
+                          const void* data) {
+    char header[NPY_HEADER_SIZE];
+    if (npy_format_header(header, type, ndim, shape) != 0) {
+        archive->status = -1;
+        return -1;
+    }
+    uint64_t bytes = npy_type_size(type);
+    for (int d = 0; d < ndim; d++) bytes *= (uint64_t)shape[d];
+
+    ZipEntry* entry;
+    FILE* file = begin_member(archive, name, NPY_HEADER_SIZE + bytes, &entry);
+    if (!file) {
+        archive->status = -1;
+        return -1;
+    }
+    int status = write_member(file, entry, header, sizeof(header));
+    if (bytes > 0) status |= write_member(file, entry, data, (size_t)bytes);
+    status = end_member(archive, file, entry, status);
+    if (status != 0) archive->status = -1;
+    return status;
+}
+
+int npy_archive_add_file(NpyArchive* archive, const char* name,
+                         const char* npy_path) {
+    FILE* source = fopen(npy_path, "rb");
+    if (!source) {
+        archive->status = -1;
+        return -1;
+    }
+    fseek(source, 0, SEEK_END);
+    long size = ftell(source);
+    fseek(source, 0, SEEK_SET);
+
+    ZipEntry* entry;
+    FILE* file = size >= 0 ? begin_member(archive, name, (uint64_t)size,
+                                          &entry)
+                           : NULL;
+    if (!file) {
+        fclose(source);
+        archive->status = -1;
+        return -1;
+    }
+    char buffer[1 << 16];
+    long remaining = size;
+    int status = 0;
+    while (remaining > 0 && status == 0) {
+        size_t chunk = remaining < (long)sizeof(buffer) ? (size_t)remaining
+                                                        : sizeof(buffer);
+        if (fread(buffer, 1, chunk, source) != chunk) {
+            status = -1;
+            break;
+        }
+        status = write_member(file, entry, buffer, chunk);
+        remaining -= (long)chunk;
+    }
+    fclose(source);
+    status = end_member(archive, file, entry, status);
+    if (status != 0) archive->status = -1;
+    return status;
+}
+
+int npy_archive_close(NpyArchive* archive) {
+    if (!archive) return 0;
+    int status = archive->status;
+
+    if (archive->zip) {
+        long cd_offset = ftell(archive->file);
+        long cd_size = 0;
+        for (int i = 0; i < archive->num_entries; i++) {
+            const ZipEntry* entry = &archive->entries[i];
+            size_t name_len = strlen(entry->name);
+            unsigned char header[46];
+            put32(header, 0x02014b50);
+            put16(header + 4, 20);  // Made by: 2.0
+            put16(header + 6, 20);  // Needed: 2.0
+            put16(header + 8, 0);
+            put16(header + 10, 0);
+            put16(header + 12, archive->dos_time);
+            put16(header + 14, archive->dos_date);
+            put32(header + 16, entry->crc);
+            put32(header + 20, entry->size);
+            put32(header + 24, entry->size);
+            put16(header + 28, (uint16_t)name_len);
+            put16(header + 30, 0);  // Extra
+            put16(header + 32, 0);  // Comment
+            put16(header + 34, 0);  // Disk
+            put16(header + 36, 0);  // Internal attributes
+            put32(header + 38, 0);  // External attributes
+            put32(header + 42, entry->offset);
+            if (fwrite(header, 1, sizeof(header), archive->file) !=
+                    sizeof(header) ||
+                fwrite(entry->name, 1, name_len, archive->file) != name_len) {
+                status = -1;
+            }
+            cd_size += (long)(sizeof(header) + name_len);
+        }
+
+        unsigned char end[22];
+        put32(end, 0x06054b50);
+        put16(end + 4, 0);
+        put16(end + 6, 0);
+        put16(end + 8, (uint16_t)archive->num_entries);
+        put16(end + 10, (uint16_t)archive->num_entries);
+        put32(end + 12, (uint32_t)cd_size);
+        put32(end + 16, (uint32_t)cd_offset);
+        put16(end + 20, 0);
+        if (fwrite(end, 1, sizeof(end), archive->file) != sizeof(end)) {
+            status = -1;
+        }
+        if (fclose(archive->file) != 0) status = -1;
+    }
+
+    for (int i = 0; i < archive->num_entries; i++) {
+        free(archive->entries[i].name);
+    }
+    free(archive->entries);
+    free(archive->path);
+    free(archive);
+    return status;
+}
@@ -0,0 +1,58 @@
+#ifndef NEURAL_NPY_H
+#define NEURAL_NPY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// NumPy .npy files (format version 1.0) and uncompressed .npz archives.
+//
+// Every header is padded to NPY_HEADER_SIZE bytes, so array data starts
+// 64-byte aligned and np.load(mmap_mode='r') maps it directly. NpyWriter
+// appends rows along the first axis and rewrites the fixed-size header in
+// place on every sync, so a file is a valid array at any sync point while
+// the run keeps appending.
+
+#define NPY_HEADER_SIZE 128
+#define NPY_MAX_DIMS 3
+
+typedef enum { NPY_INT32 = 0, NPY_INT64, NPY_FLOAT32, NPY_FLOAT64 } NpyType;
+
+size_t npy_type_size(NpyType type);
+
+typedef struct NpyWriter {
+    FILE* file;
+    NpyType type;
+    int ndim;
+    int64_t shape[NPY_MAX_DIMS];  // shape[0] counts the rows appended
+    size_t row_bytes;
+} NpyWriter;
+
+// shape[0] is ignored; the array starts with zero rows
+NpyWriter* npy_open(const char* path, NpyType type, int ndim,
+                    const int64_t* shape);
+int npy_append(NpyWriter* writer, const void* rows, int64_t count);
+// Rewrite the header with the current row count and flush
+int npy_sync(NpyWriter* writer);
+int npy_close(NpyWriter* writer);
+
+// Format a complete header into buffer (NPY_HEADER_SIZE bytes)
+int npy_format_header(char* buffer, NpyType type, int ndim,
+                      const int64_t* shape);
+
+// Whole-array writes into a directory of .npy files or a stored .npz
+typedef struct NpyArchive NpyArchive;
+
+NpyArchive* npy_archive_open(const char* path, bool zip);
+int npy_archive_add_array(NpyArchive* archive, const char* name,
+                          NpyType type, int ndim, const int64_t* shape,
+                          const void* data);
+// Copy an existing .npy file in as member name
+int npy_archive_add_file(NpyArchive* archive, const char* name,
+                         const char* npy_path);
+// Returns 0 if every member was written
+int npy_archive_close(NpyArchive* archive);
+
+uint32_t crc32_update(uint32_t crc, const void* data, size_t size);
+
+#endif
@@ -0,0 +1,199 @@
+#include "utils/output_writer.h"
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void write_snapshot(OutputWriter* writer,
+                           const OutputSnapshot* snapshot) {
+    if (snapshot->save_state) {
+        write_network_state(writer->output_dir, snapshot->time,
+                            snapshot->population_freq[POP_PYRAMIDAL],
+                            snapshot->population_freq[POP_INHIBITORY]);
+    }
+    if (writer->traces && snapshot->has_rates) {
+        trace_pyramid_push(writer->traces, snapshot->rates);
+    }
+    if (writer->spike_ids) {
+        for (int s = 0; s < snapshot->num_spikes; s++) {
+            writer->spike_time_row[s] = snapshot->time;
+        }
+        npy_append(writer->spike_ids, snapshot->spike_ids,
+                   snapshot->num_spikes);
+        npy_append(writer->spike_times, writer->spike_time_row,
+                   snapshot->num_spikes);
+        if ((snapshot->step + 1) % SPIKE_SYNC_STEPS == 0) {
+            npy_sync(writer->spike_ids);
+            npy_sync(writer->spike_times);
+        }
+    }
+}
+
+static void* writer_main(void* arg) {
+    OutputWriter* writer = arg;
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (!writer->busy[writer->next] && !writer->stop) {
+            pthread_cond_wait(&writer->work, &writer->lock);
+        }
+        if (!writer->busy[writer->next]) break;
+        pthread_mutex_unlock(&writer->lock);
+
+        // The buffer belongs to this thread until busy is cleared
+        double start = omp_get_wtime();
+        write_snapshot(writer, &writer->buffers[writer->next]);
+        double elapsed = omp_get_wtime() - start;
+
+        pthread_mutex_lock(&writer->lock);
+        writer->stats.write_time += elapsed;
+        writer->stats.snapshots++;
+        writer->busy[writer->next] = false;
+        writer->next ^= 1;
+        pthread_cond_broadcast(&writer->space);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+OutputWriter* create_output_writer(const char* output_dir, int num_neurons,
+                                   double dt, bool record_traces,
+                                   bool record_spikes, bool threaded) {
+    OutputWriter* writer = calloc(1, sizeof(OutputWriter));
+    if (!writer) {
+        fprintf(stderr, "Failed to allocate output writer\n");
+        return NULL;
+    }
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->work, NULL);
+    pthread_cond_init(&writer->space, NULL);
+    writer->output_dir = strdup(output_dir);
+    if (num_neurons < 1) num_neurons = 1;
+    for (int b = 0; b < 2; b++) {
+        writer->buffers[b].spike_ids = malloc(num_neurons * sizeof(int));
+    }
+    writer->spike_time_row = malloc(num_neurons * sizeof(double));
+    if (!writer->output_dir || !writer->buffers[0].spike_ids ||
+        !writer->buffers[1].spike_ids || !writer->spike_time_row) {
+        fprintf(stderr, "Failed to allocate output buffers\n");
+        destroy_output_writer(writer);
+        return NULL;
+    }
+
+    char path[512];
+    if (record_traces) {
+        static const char* const channels[NUM_POPULATIONS] = {
+            "rate_pyramidal", "rate_inhibitory"};
+        snprintf(path, sizeof(path), "%s/traces", output_dir);
+        writer->traces =
+            create_trace_pyramid(path, channels, NUM_POPULATIONS, dt);
+        if (!writer->traces) {
+            destroy_output_writer(writer);
+            return NULL;
+        }
+    }
+    if (record_spikes) {
+        // Spike trains as two growing columns
+        snprintf(path, sizeof(path), "%s/spike_times.npy", output_dir);
+        writer->spike_times = npy_open(path, NPY_FLOAT64, 1, NULL);
+        snprintf(path, sizeof(path), "%s/spike_ids.npy", output_dir);
+        writer->spike_ids = npy_open(path, NPY_INT32, 1, NULL);
+        if (!writer->spike_times || !writer->spike_ids) {
+            fprintf(stderr, "Failed to create spike recording\n");
+            destroy_output_writer(writer);
+            return NULL;
+        }
+    }
+
+    if (threaded) {
+        if (pthread_create(&writer->thread, NULL, writer_main, writer) != 0) {
+            fprintf(stderr, "Failed to start output writer thread\n");
+            destroy_output_writer(writer);
+            return NULL;
+        }
+        writer->threaded = true;
+    }
+    return writer;
+}
+
+void destroy_output_writer(OutputWriter* writer) {
+    if (!writer) return;
+    if (writer->threaded) {
+        pthread_mutex_lock(&writer->lock);
+        writer->stop = true;
+        pthread_cond_signal(&writer->work);
+        pthread_mutex_unlock(&writer->lock);
+        pthread_join(writer->thread, NULL);
+    }
+    pthread_cond_destroy(&writer->space);
+    pthread_cond_destroy(&writer->work);
+    pthread_mutex_destroy(&writer->lock);
+    destroy_trace_pyramid(writer->traces);
+    npy_close(writer->spike_times);
+    npy_close(writer->spike_ids);
+    free(writer->spike_time_row);
+    free(writer->buffers[0].spike_ids);
+    free(writer->buffers[1].spike_ids);
+    free(writer->output_dir);
+    free(writer);
+}
+
+OutputSnapshot* output_writer_acquire(OutputWriter* writer) {
+    if (!writer->threaded) return &writer->buffers[0];
+
+    pthread_mutex_lock(&writer->lock);
+    if (writer->busy[writer->fill]) {
+        double start = omp_get_wtime();
+        while (writer->busy[writer->fill]) {
+            pthread_cond_wait(&writer->space, &writer->lock);
+        }
+        writer->stats.stalls++;
+        writer->stats.stall_time += omp_get_wtime() - start;
+    }
+    OutputSnapshot* snapshot = &writer->buffers[writer->fill];
+    pthread_mutex_unlock(&writer->lock);
+    return snapshot;
+}
+
+void output_writer_submit(OutputWriter* writer) {
+    if (!writer->threaded) {
+        // Writing inline stalls the simulation for the whole write
+        double start = omp_get_wtime();
+        write_snapshot(writer, &writer->buffers[0]);
+        double elapsed = omp_get_wtime() - start;
+        writer->stats.write_time += elapsed;
+        writer->stats.stall_time += elapsed;
+        writer->stats.snapshots++;
+        writer->stats.stalls++;
+        return;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->busy[writer->fill] = true;
+    writer->fill ^= 1;
+    pthread_cond_signal(&writer->work);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+void output_writer_sync(OutputWriter* writer) {
+    if (!writer) return;
+    if (writer->threaded) {
+        pthread_mutex_lock(&writer->lock);
+        while (writer->busy[0] || writer->busy[1]) {
+            pthread_cond_wait(&writer->space, &writer->lock);
+        }
+        pthread_mutex_unlock(&writer->lock);
+    }
+    // The writer thread is idle until the next submit
+    if (writer->traces) trace_pyramid_flush(writer->traces);
+    if (writer->spike_ids) {
+        npy_sync(writer->spike_ids);
+        npy_sync(writer->spike_times);
+    }
+}
+
+void output_writer_get_stats(OutputWriter* writer, OutputWriterStats* stats) {
+    pthread_mutex_lock(&writer->lock);
+    *stats = writer->stats;
+    pthread_mutex_unlock(&writer->lock);
+}
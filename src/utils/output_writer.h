@@ -0,0 +1,77 @@
+#ifndef NEURAL_OUTPUT_WRITER_H
+#define NEURAL_OUTPUT_WRITER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "core/network.h"
+#include "utils/npy.h"
+#include "utils/trace_pyramid.h"
+
+// Per-step outputs (state files, rate traces, spike trains) written on a
+// dedicated thread while the simulation computes the next step.
+//
+// The simulation copies a step's observables into one of two snapshot
+// buffers and hands it over; the writer serializes it while the other
+// buffer is filled. When both buffers are still queued the simulation
+// waits, and the stall counters in OutputWriterStats show how much of the
+// run was bound by I/O rather than by computation.
+
+// Steps between header syncs of the spike recording
+#define SPIKE_SYNC_STEPS 1024
+
+// Observables of one step
+typedef struct {
+    double time;  // Start of the step (ms)
+    long long step;
+    bool save_state;  // Write network_state_<time>.txt
+    double population_freq[NUM_POPULATIONS];
+    bool has_rates;
+    double rates[NUM_POPULATIONS];  // Trace sample (Hz)
+    int num_spikes;
+    int* spike_ids;  // Room for one id per neuron
+} OutputSnapshot;
+
+typedef struct {
+    long long snapshots;  // Snapshots written
+    long long stalls;     // Hand-offs that waited for a free buffer
+    double stall_time;    // Seconds the simulation waited on the writer
+    double write_time;    // Seconds the writer spent serializing
+} OutputWriterStats;
+
+typedef struct OutputWriter {
+    char* output_dir;
+    TracePyramid* traces;    // NULL unless rates are recorded
+    NpyWriter* spike_times;  // NULL unless spikes are recorded
+    NpyWriter* spike_ids;
+    double* spike_time_row;  // Scratch of one time per neuron
+    OutputSnapshot buffers[2];
+    int fill;      // Buffer the simulation fills next
+    int next;      // Buffer the writer serializes next
+    bool busy[2];  // Handed over and not yet written
+    bool threaded;
+    bool stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;   // A buffer was handed over or stop was set
+    pthread_cond_t space;  // A buffer was written
+    OutputWriterStats stats;
+} OutputWriter;
+
+// Without threaded, snapshots are written as they are submitted
+OutputWriter* create_output_writer(const char* output_dir, int num_neurons,
+                                   double dt, bool record_traces,
+                                   bool record_spikes, bool threaded);
+// Writes every pending snapshot first
+void destroy_output_writer(OutputWriter* writer);
+
+// Buffer for the next snapshot, waiting while both are queued
+OutputSnapshot* output_writer_acquire(OutputWriter* writer);
+// Hands the acquired buffer to the writer
+void output_writer_submit(OutputWriter* writer);
+
+// Waits for pending snapshots and makes every file readable as a whole
+void output_writer_sync(OutputWriter* writer);
+void output_writer_get_stats(OutputWriter* writer, OutputWriterStats* stats);
+
+#endif
@@ -0,0 +1,445 @@
+#include "utils/probe.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+static const char* variable_names[NUM_PROBE_VARIABLES] = {
+    "V", "Ca", "adaptation", "dendritic"};
+
+int probe_variable_from_name(const char* name) {
+    for (int v = 0; v < NUM_PROBE_VARIABLES; v++) {
+        if (strcasecmp(name, variable_names[v]) == 0) return v;
+    }
+    return -1;
+}
+
+const char* probe_variable_name(ProbeVariable variable) {
+    return variable_names[variable];
+}
+
+ProbeSet* create_probe_set(const char* directory, int num_threads,
+                           bool traces) {
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create probe directory %s\n", directory);
+        return NULL;
+    }
+    ProbeSet* set = calloc(1, sizeof(ProbeSet));
+    if (!set) {
+        fprintf(stderr, "Failed to allocate probe set\n");
+        return NULL;
+    }
+    set->directory = strdup(directory);
+    set->num_threads = num_threads > 0 ? num_threads : 1;
+    set->traces = traces;
+    return set;
+}
+
+static void free_probe(Probe* probe) {
+    npy_close(probe->time_file);
+    for (int v = 0; v < NUM_PROBE_VARIABLES; v++) {
+        npy_close(probe->files[v]);
+    }
+    destroy_trace_pyramid(probe->traces);
+    free(probe->trace_sample);
+    if (probe->buffers) {
+        for (int s = 0; s < probe->num_slices; s++) {
+            free(probe->buffers[s].data);
+        }
+    }
+    free(probe->buffers);
+    free(probe->times);
+    free(probe->row);
+    free(probe->ids);
+    free(probe->name);
+}
+
+static FILE* open_probe_file(const ProbeSet* set, const char* name,
+                             const char* suffix, const char* mode) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s%s", set->directory, name, suffix);
+    FILE* file = fopen(path, mode);
+    if (!file) fprintf(stderr, "Failed to open probe file %s\n", path);
+    return file;
+}
+
+static NpyWriter* open_probe_column(const ProbeSet* set, const char* name,
+                                    const char* suffix, NpyType type,
+                                    int ndim, int64_t columns) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s%s", set->directory, name, suffix);
+    int64_t shape[2] = {0, columns};
+    return npy_open(path, type, ndim, shape);
+}
+
+static int write_probe_header(const ProbeSet* set, const Probe* probe,
+                              double dt) {
+    FILE* file = open_probe_file(set, probe->name, ".txt", "w");
+    if (!file) return -1;
+    fprintf(file, "dt %.17g\n", dt);
+    fprintf(file, "interval %d\n", probe->interval);
+    fprintf(file, "variables");
+    for (int v = 0; v < probe->num_variables; v++) {
+        fprintf(file, " %s", variable_names[probe->variables[v]]);
+    }
+    fprintf(file, "\nneurons %d\n", probe->num_ids);
+    for (int i = 0; i < probe->num_ids; i++) {
+        fprintf(file, "%d\n", probe->ids[i]);
+    }
+    fclose(file);
+    return 0;
+}
+
+// Pyramid of the probe's samples, one channel per variable and neuron
+static int open_probe_traces(Probe* probe, const ProbeSet* set, double dt) {
+    int channels = probe->num_variables * probe->num_ids;
+    char** names = calloc(channels, sizeof(char*));
+    probe->trace_sample = malloc(channels * sizeof(double));
+    bool ok = names && probe->trace_sample;
+    for (int c = 0; ok && c < channels; c++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s_%d",
+                 variable_names[probe->variables[c / probe->num_ids]],
+                 probe->ids[c % probe->num_ids]);
+        names[c] = strdup(name);
+        ok = names[c] != NULL;
+    }
+    if (ok) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s_traces", set->directory,
+                 probe->name);
+        probe->traces = create_trace_pyramid(
+            path, (const char* const*)names, channels, dt * probe->interval);
+        ok = probe->traces != NULL;
+    }
+    for (int c = 0; names && c < channels; c++) free(names[c]);
+    free(names);
+    return ok ? 0 : -1;
+}
+
+static int init_probe(Probe* probe, const ProbeSet* set, const Network* net,
+                      const char* name, const int* ids, int num_ids,
+                      unsigned variables, double interval) {
+    int total = net->config.num_pyramidal + net->config.num_inhibitory;
+    double dt = net->config.dt;
+
+    memset(probe, 0, sizeof(Probe));
+    for (int v = 0; v < NUM_PROBE_VARIABLES; v++) {
+        if (variables & PROBE_VARIABLE_BIT(v)) {
+            probe->variables[probe->num_variables++] = v;
+        }
+    }
+    if (probe->num_variables == 0 || num_ids <= 0) return -1;
+    for (int i = 0; i < num_ids; i++) {
+        if (ids[i] < 0 || ids[i] >= total) return -1;
+    }
+
+    probe->name = strdup(name);
+    probe->num_ids = num_ids;
+    probe->ids = malloc(num_ids * sizeof(int));
+    if (!probe->name || !probe->ids) return -1;
+    memcpy(probe->ids, ids, num_ids * sizeof(int));
+    probe->interval = (int)lround(interval / dt);
+    if (probe->interval < 1) probe->interval = 1;
+
+    // Large probes get one slice per thread, small ones a single slice
+    probe->num_slices = num_ids >= PROBE_PARALLEL_MIN ? set->num_threads : 1;
+    size_t per_sample = (size_t)num_ids * probe->num_variables;
+    probe->capacity = (int)(PROBE_BUFFER_FLOATS / per_sample);
+    if (probe->capacity < 1) probe->capacity = 1;
+
+    probe->times = malloc(probe->capacity * sizeof(double));
+    probe->row = malloc(num_ids * sizeof(float));
+    probe->buffers = calloc(probe->num_slices, sizeof(ProbeBuffer));
+    if (!probe->times || !probe->row || !probe->buffers) return -1;
+    for (int s = 0; s < probe->num_slices; s++) {
+        ProbeBuffer* buffer = &probe->buffers[s];
+        buffer->begin = (int)((long)num_ids * s / probe->num_slices);
+        buffer->end = (int)((long)num_ids * (s + 1) / probe->num_slices);
+        size_t floats = (size_t)(buffer->end - buffer->begin) *
+                        probe->num_variables * probe->capacity;
+        buffer->data = malloc((floats > 0 ? floats : 1) * sizeof(float));
+        if (!buffer->data) return -1;
+    }
+
+    NpyWriter* ids_file = open_probe_column(set, name, "_ids.npy", NPY_INT32,
+                                            1, 0);
+    if (!ids_file || npy_append(ids_file, ids, num_ids) != 0 ||
+        npy_close(ids_file) != 0) {
+        return -1;
+    }
+    probe->time_file =
+        open_probe_column(set, name, "_time.npy", NPY_FLOAT64, 1, 0);
+    if (!probe->time_file) return -1;
+    for (int v = 0; v < probe->num_variables; v++) {
+        char suffix[64];
+        int variable = probe->variables[v];
+        snprintf(suffix, sizeof(suffix), "_%s.npy", variable_names[variable]);
+        probe->files[variable] =
+            open_probe_column(set, name, suffix, NPY_FLOAT32, 2, num_ids);
+        if (!probe->files[variable]) return -1;
+    }
+    if (set->traces && open_probe_traces(probe, set, dt) != 0) return -1;
+    return write_probe_header(set, probe, dt);
+}
+
+int probe_set_add(ProbeSet* set, const Network* net, const char* name,
+                  const int* ids, int num_ids, unsigned variables,
+                  double interval) {
+    if (!name || !name[0] || strchr(name, '/')) return -1;
+    for (int p = 0; p < set->num_probes; p++) {
+        if (strcmp(set->probes[p].name, name) == 0) return -1;
+    }
+
+    if (set->num_probes == set->capacity) {
+        int capacity = set->capacity ? 2 * set->capacity : 4;
+        Probe* probes = realloc(set->probes, capacity * sizeof(Probe));
+        if (!probes) return -1;
+        set->probes = probes;
+        set->capacity = capacity;
+    }
+
+    Probe* probe = &set->probes[set->num_probes];
+    if (init_probe(probe, set, net, name, ids, num_ids, variables,
+                   interval) != 0) {
+        fprintf(stderr, "Invalid probe %s\n", name);
+        free_probe(probe);
+        return -1;
+    }
+    set->num_probes++;
+    return 0;
+}
+
+// Neuron list of a spec: population name or "a-b,c" ids. Returns the count
+// or -1; *ids is allocated.
+static int parse_probe_neurons(const Network* net, const char* text,
+                               int** ids) {
+    int num_pyramidal = net->config.num_pyramidal;
+    int total = num_pyramidal + net->config.num_inhibitory;
+    int begin = -1, end = -1;
+    if (strcmp(text, "pyramidal") == 0) {
+        begin = 0;
+        end = num_pyramidal;
+    } else if (strcmp(text, "inhibitory") == 0) {
+        begin = num_pyramidal;
+        end = total;
+    } else if (strcmp(text, "all") == 0) {
+        begin = 0;
+        end = total;
+    }
+    if (begin >= 0) {
+        *ids = malloc((end - begin > 0 ? end - begin : 1) * sizeof(int));
+        if (!*ids) return -1;
+        for (int i = begin; i < end; i++) (*ids)[i - begin] = i;
+        return end - begin;
+    }
+
+    int count = 0, capacity = 16;
+    *ids = malloc(capacity * sizeof(int));
+    const char* p = text;
+    while (*ids && *p) {
+        char* next;
+        long first = strtol(p, &next, 10);
+        if (next == p) break;
+        long last = first;
+        if (*next == '-') {
+            p = next + 1;
+            last = strtol(p, &next, 10);
+            if (next == p) break;
+        }
+        if (first < 0 || last >= total || last < first) break;
+        for (long id = first; id <= last; id++) {
+            if (count == capacity) {
+                capacity *= 2;
+                int* grown = realloc(*ids, capacity * sizeof(int));
+                if (!grown) {
+                    free(*ids);
+                    *ids = NULL;
+                    return -1;
+                }
+                *ids = grown;
+            }
+            (*ids)[count++] = (int)id;
+        }
+        p = next;
+        if (*p == ',') p++;
+        else if (*p) break;
+    }
+    if (!*ids || *p) {
+        free(*ids);
+        *ids = NULL;
+        return -1;
+    }
+    return count;
+}
+
+int probe_set_add_spec(ProbeSet* set, const Network* net, const char* spec) {
+    char name[128], neurons[1024], variables[128];
+    double interval;
+    if (sscanf(spec, "%127s %1023s %127s %lf", name, neurons, variables,
+               &interval) != 4) {
+        fprintf(stderr, "Invalid probe spec: %s\n", spec);
+        return -1;
+    }
+
+    unsigned mask = 0;
+    char* save = NULL;
+    for (char* token = strtok_r(variables, ",", &save); token;
+         token = strtok_r(NULL, ",", &save)) {
+        int variable = probe_variable_from_name(token);
+        if (variable < 0) {
+            fprintf(stderr, "Unknown probe variable: %s\n", token);
+            return -1;
+        }
+        mask |= PROBE_VARIABLE_BIT(variable);
+    }
+
+    int* ids = NULL;
+    int num_ids = parse_probe_neurons(net, neurons, &ids);
+    if (num_ids < 0) {
+        fprintf(stderr, "Invalid probe neurons: %s\n", neurons);
+        return -1;
+    }
+    int result = probe_set_add(set, net, name, ids, num_ids, mask, interval);
+    free(ids);
+    return result;
+}
+
+// Mean local potential over the neuron's dendrites
+static float dendritic_potential(const Network* net, int id) {
+    Dendrite** dendrites = network_dendrites(net, id);
+    if (!dendrites) return NAN;
+    double sum = 0.0;
+    for (int d = 0; d < net->config.num_dendrites; d++) {
+        sum += dendrites[d]->local_potential;
+    }
+    return (float)(sum / net->config.num_dendrites);
+}
+
+static float read_variable(const Network* net, int id, int variable) {
+    const Neuron* neuron = network_neuron(net, id);
+    switch (variable) {
+        case PROBE_V:
+            return (float)neuron->membrane_potential;
+        case PROBE_CALCIUM:
+            return (float)neuron->calcium_concentration;
+        case PROBE_ADAPTATION:
+            return (float)neuron->adaptation_current;
+        case PROBE_DENDRITIC:
+            return dendritic_potential(net, id);
+        default:
+            return NAN;
+    }
+}
+
+static void sample_slice(Probe* probe, ProbeBuffer* buffer,
+                         const Network* net) {
+    int count = buffer->end - buffer->begin;
+    const int* ids = probe->ids + buffer->begin;
+    for (int v = 0; v < probe->num_variables; v++) {
+        int variable = probe->variables[v];
+        float* out = buffer->data +
+                     ((size_t)v * probe->capacity + probe->fill) * count;
+        for (int i = 0; i < count; i++) {
+            out[i] = read_variable(net, network_internal_id(net, ids[i]),
+                                   variable);
+        }
+    }
+}
+
+static void flush_probe(Probe* probe) {
+    if (probe->fill == 0) return;
+    npy_append(probe->time_file, probe->times, probe->fill);
+
+    // Stitch the per-thread slices back into rows of the full neuron list
+    for (int v = 0; v < probe->num_variables; v++) {
+        NpyWriter* file = probe->files[probe->variables[v]];
+        for (int s = 0; s < probe->fill; s++) {
+            for (int b = 0; b < probe->num_slices; b++) {
+                const ProbeBuffer* buffer = &probe->buffers[b];
+                int count = buffer->end - buffer->begin;
+                memcpy(probe->row + buffer->begin,
+                       buffer->data +
+                           ((size_t)v * probe->capacity + s) * count,
+                       count * sizeof(float));
+            }
+            npy_append(file, probe->row, 1);
+        }
+        npy_sync(file);
+    }
+    if (probe->traces) {
+        for (int s = 0; s < probe->fill; s++) {
+            for (int v = 0; v < probe->num_variables; v++) {
+                double* out = probe->trace_sample + (size_t)v * probe->num_ids;
+                for (int b = 0; b < probe->num_slices; b++) {
+                    const ProbeBuffer* buffer = &probe->buffers[b];
+                    int count = buffer->end - buffer->begin;
+                    const float* in =
+                        buffer->data +
+                        ((size_t)v * probe->capacity + s) * count;
+                    for (int i = 0; i < count; i++) {
+                        out[buffer->begin + i] = in[i];
+                    }
+                }
+            }
+            trace_pyramid_push(probe->traces, probe->trace_sample);
+        }
+        trace_pyramid_flush(probe->traces);
+    }
+    // Times last: a reader trusting the time count finds every column
+    npy_sync(probe->time_file);
+    probe->samples_written += probe->fill;
+    probe->fill = 0;
+}
+
+void probe_set_sample(ProbeSet* set, const Network* net, long long step,
+                      double time) {
+    for (int p = 0; p < set->num_probes; p++) {
+        Probe* probe = &set->probes[p];
+        if (step % probe->interval != 0) continue;
+
+        if (probe->num_slices > 1) {
+#pragma omp parallel for num_threads(probe->num_slices) schedule(static, 1)
+            for (int s = 0; s < probe->num_slices; s++) {
+                sample_slice(probe, &probe->buffers[s], net);
+            }
+        } else {
+            sample_slice(probe, &probe->buffers[0], net);
+        }
+        probe->times[probe->fill++] = time;
+        if (probe->fill == probe->capacity) flush_probe(probe);
+    }
+}
+
+int probe_set_steps_to_sample(const ProbeSet* set, long long step) {
+    int steps = INT_MAX;
+    for (int p = 0; p < set->num_probes; p++) {
+        int interval = set->probes[p].interval;
+        int due = interval - (int)(step % interval);
+        if (due < steps) steps = due;
+    }
+    return steps;
+}
+
+void probe_set_flush(ProbeSet* set) {
+    for (int p = 0; p < set->num_probes; p++) {
+        Probe* probe = &set->probes[p];
+        flush_probe(probe);
+    }
+}
+
+void destroy_probe_set(ProbeSet* set) {
+    if (!set) return;
+    probe_set_flush(set);
+    for (int p = 0; p < set->num_probes; p++) {
+        free_probe(&set->probes[p]);
+    }
+    free(set->probes);
+    free(set->directory);
+    free(set);
+}
@@ -0,0 +1,105 @@
+#ifndef NEURAL_PROBE_H
+#define NEURAL_PROBE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "core/network.h"
+#include "utils/npy.h"
+#include "utils/trace_pyramid.h"
+
+// Selective recording of neuron state variables.
+//
+// A probe samples chosen variables of a fixed list of neurons every
+// `interval` steps. Its neurons are split into one slice per thread and
+// every slice samples into its own preallocated buffer, so recording
+// large probes runs in parallel without sharing cache lines. Full buffers
+// are flushed as binary columns under the probe directory, in .npy files
+// whose headers are updated on every flush:
+//   <name>.txt       dt, interval, variables and neuron ids
+//   <name>_ids.npy   int32 neuron ids, the columns of the matrices
+//   <name>_time.npy  float64 sample times (ms)
+//   <name>_<var>.npy float32 matrix [sample][neuron] per variable
+// With traces on, the samples also feed a trace pyramid in <name>_traces
+// with one channel <var>_<id> per variable and neuron, for zooming into
+// long recordings without reading them whole.
+
+typedef enum {
+    PROBE_V = 0,       // Membrane potential (mV)
+    PROBE_CALCIUM,     // Calcium concentration
+    PROBE_ADAPTATION,  // Adaptation current / recovery variable
+    PROBE_DENDRITIC,   // Dendritic potential, NaN without dendrites
+    NUM_PROBE_VARIABLES
+} ProbeVariable;
+
+#define PROBE_VARIABLE_BIT(v) (1u << (v))
+
+// Floats buffered per probe before a flush
+#define PROBE_BUFFER_FLOATS (1 << 16)
+
+// Probes with fewer neurons are sampled by the calling thread only
+#define PROBE_PARALLEL_MIN 4096
+
+typedef struct {
+    float* data;  // [variable][sample][neuron of slice]
+    int begin;    // Slice of the probe's neuron list
+    int end;
+} ProbeBuffer;
+
+typedef struct {
+    char* name;
+    int* ids;
+    int num_ids;
+    int variables[NUM_PROBE_VARIABLES];
+    int num_variables;
+    int interval;  // Steps between samples
+    int capacity;  // Samples per buffer
+    int fill;      // Samples currently buffered
+    double* times;
+    ProbeBuffer* buffers;
+    int num_slices;
+    float* row;  // Scratch row of num_ids floats for flushing
+    NpyWriter* time_file;
+    NpyWriter* files[NUM_PROBE_VARIABLES];
+    TracePyramid* traces;  // NULL unless the set records traces
+    double* trace_sample;  // Scratch of one value per channel
+    long long samples_written;
+} Probe;
+
+typedef struct ProbeSet {
+    char* directory;
+    Probe* probes;
+    int num_probes;
+    int capacity;
+    int num_threads;
+    bool traces;  // Probes also write trace pyramids
+} ProbeSet;
+
+ProbeSet* create_probe_set(const char* directory, int num_threads,
+                           bool traces);
+void destroy_probe_set(ProbeSet* set);
+
+// Adds a probe on creation-order neuron ids. variables is a mask of
+// PROBE_VARIABLE_BIT() values, interval is in ms and rounded to whole
+// steps. Returns 0 on success, -1 on invalid arguments or I/O failure.
+int probe_set_add(ProbeSet* set, const Network* net, const char* name,
+                  const int* ids, int num_ids, unsigned variables,
+                  double interval);
+
+// Adds a probe from a text spec "<name> <neurons> <variables> <interval>",
+// where neurons is "pyramidal", "inhibitory", "all" or ids and ranges such
+// as "0-9,42" and variables is a comma list of V, Ca, adaptation,
+// dendritic. Example: "exc pyramidal V,Ca 1.0".
+int probe_set_add_spec(ProbeSet* set, const Network* net, const char* spec);
+
+// Records every probe due at this step
+void probe_set_sample(ProbeSet* set, const Network* net, long long step,
+                      double time);
+// Steps after step until the next one any probe records, INT_MAX if none
+int probe_set_steps_to_sample(const ProbeSet* set, long long step);
+void probe_set_flush(ProbeSet* set);
+
+int probe_variable_from_name(const char* name);
+const char* probe_variable_name(ProbeVariable variable);
+
+#endif
@@ -2,6 +2,7 @@
 #include "utils/random.h"
 
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifndef M_PI
@@ -28,21 +29,60 @@ double random_double(RandomState* state) {
 }
 
 double random_uniform(RandomState* state) {
-    return (double)pcg32(state) / (double)UINT32_MAX;
+    return (double)pcg32(state) * (1.0 / 4294967296.0);
 }
 
 double random_normal(RandomState* state) {
-    // Box-Muller transform
-    double u1 = random_uniform(state);
+    // Box-Muller transform; u1 in (0, 1] keeps log() finite
+    double u1 = 1.0 - random_uniform(state);
     double u2 = random_uniform(state);
     return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
 }
 
 double random_exponential(RandomState* state, double lambda) {
-    return -log(random_uniform(state)) / lambda;
+    return -log(1.0 - random_uniform(state)) / lambda;
+}
+
+// Uniform on the open interval (0, 1), safe to pass to log()
+static inline double random_open(RandomState* state) {
+    return ((double)pcg32(state) + 0.5) * (1.0 / 4294967296.0);
+}
+
+static void init_ptrs_constants(PoissonSampler* sampler, double lambda) {
+    sampler->slam = sqrt(lambda);
+    sampler->loglam = log(lambda);
+    sampler->b = 0.931 + 2.53 * sampler->slam;
+    sampler->a = -0.059 + 0.02483 * sampler->b;
+    sampler->inv_alpha = 1.1239 + 1.1328 / (sampler->b - 3.4);
+    sampler->vr = 0.9277 - 3.6224 / (sampler->b - 2.0);
+}
+
+// Hormann (1993) transformed rejection with squeeze
+static int sample_ptrs(const PoissonSampler* p, RandomState* state) {
+    double lambda = p->lambda;
+    for (;;) {
+        double u = random_open(state) - 0.5;
+        double v = random_open(state);
+        double us = 0.5 - fabs(u);
+        double k = floor((2.0 * p->a / us + p->b) * u + lambda + 0.43);
+
+        if (us >= 0.07 && v <= p->vr) return (int)k;
+        if (k < 0.0 || (us < 0.013 && v > us)) continue;
+
+        if (log(v) + log(p->inv_alpha) - log(p->a / (us * us) + p->b) <=
+            -lambda + k * p->loglam - lgamma(k + 1.0)) {
+            return (int)k;
+        }
+    }
 }
 
 int random_poisson(RandomState* state, double lambda) {
+    if (lambda >= POISSON_PTRS_THRESHOLD) {
+        PoissonSampler sampler = {.lambda = lambda};
+        init_ptrs_constants(&sampler, lambda);
+        return sample_ptrs(&sampler, state);
+    }
+
     double L = exp(-lambda);
     double p = 1.0;
     int k = 0;
@@ -55,6 +95,73 @@ int random_poisson(RandomState* state, double lambda) {
     return k - 1;
 }
 
+int init_poisson_sampler(PoissonSampler* sampler, double lambda) {
+    memset(sampler, 0, sizeof(PoissonSampler));
+    sampler->lambda = lambda;
+
+    if (lambda >= POISSON_PTRS_THRESHOLD) {
+        init_ptrs_constants(sampler, lambda);
+        return 0;
+    }
+
+    // Tabulate the CDF far enough into the tail that the remainder is
+    // negligible, then index it with a guide table of equal size
+    int size = (int)(lambda + 12.0 * sqrt(lambda) + 12.0);
+    sampler->cdf = (double*)malloc(size * sizeof(double));
+    sampler->guide = (int*)malloc(size * sizeof(int));
+    if (!sampler->cdf || !sampler->guide) {
+        free_poisson_sampler(sampler);
+        return -1;
+    }
+    sampler->table_size = size;
+
+    double pmf = exp(-lambda);
+    double cdf = 0.0;
+    for (int k = 0; k < size; k++) {
+        cdf += pmf;
+        sampler->cdf[k] = cdf;
+        pmf *= lambda / (k + 1);
+    }
+    sampler->cdf[size - 1] = 1.0;
+
+    int k = 0;
+    for (int g = 0; g < size; g++) {
+        while (sampler->cdf[k] <= (double)g / size) k++;
+        sampler->guide[g] = k;
+    }
+
+    return 0;
+}
+
+void free_poisson_sampler(PoissonSampler* sampler) {
+    free(sampler->cdf);
+    free(sampler->guide);
+    sampler->cdf = NULL;
+    sampler->guide = NULL;
+}
+
+int sample_poisson(const PoissonSampler* sampler, RandomState* state) {
+    if (!sampler->cdf) return sample_ptrs(sampler, state);
+
+    double u = random_open(state);
+    int k = sampler->guide[(int)(u * sampler->table_size)];
+    while (sampler->cdf[k] <= u) k++;
+    return k;
+}
+
+RandomStream* create_random_streams(int count, uint64_t seed) {
+    RandomStream* streams =
+        (RandomStream*)aligned_alloc(64, count * sizeof(RandomStream));
+    if (!streams) return NULL;
+
+    // Distinct seeds select distinct PCG streams
+    for (int i = 0; i < count; i++) {
+        init_random(&streams[i].rng,
+                    seed + 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1));
+    }
+    return streams;
+}
+
 int random_int(RandomState* state, int min, int max) {
     return min + (pcg32(state) % (max - min + 1));
 }
@@ -5,18 +5,51 @@
 #include <stdint.h>
 
 // Thread-local random state
-typedef struct {
+typedef struct RandomState {
     uint64_t state;
     uint64_t inc;
 } RandomState;
 
+// Generator padded to a cache line, for one stream per thread
+typedef struct {
+    RandomState rng;
+    char pad[64 - sizeof(RandomState)];
+} RandomStream;
+
+// Poisson sampler for a fixed rate. Small rates use an inverse-CDF table
+// with a guide index, large rates use Hormann's PTRS transformed rejection;
+// both cost O(1) expected time per draw independent of lambda.
+typedef struct {
+    double lambda;
+
+    // Table method (lambda < POISSON_PTRS_THRESHOLD)
+    double* cdf;
+    int* guide;
+    int table_size;
+
+    // PTRS constants (lambda >= POISSON_PTRS_THRESHOLD)
+    double slam;
+    double loglam;
+    double b;
+    double a;
+    double inv_alpha;
+    double vr;
+} PoissonSampler;
+
+#define POISSON_PTRS_THRESHOLD 10.0
+
 // Function declarations
 void init_random(RandomState* state, uint64_t seed);
+uint32_t pcg32(RandomState* state);
 double random_uniform(RandomState* state);
 double random_normal(RandomState* state);
 double random_exponential(RandomState* state, double lambda);
 int random_poisson(RandomState* state, double lambda);
 int random_int(RandomState* state, int min, int max);
+int init_poisson_sampler(PoissonSampler* sampler, double lambda);
+void free_poisson_sampler(PoissonSampler* sampler);
+int sample_poisson(const PoissonSampler* sampler, RandomState* state);
+RandomStream* create_random_streams(int count, uint64_t seed);
 void random_shuffle(RandomState* state, void* array, size_t n, size_t size);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include "utils/random_batch.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#define ZIG_LAYERS 256
+#define ZIG_NORM_R 3.6541528853610088
+#define ZIG_NORM_V 0.00492867323399
+#define ZIG_EXP_R 7.69711747013104972
+#define ZIG_EXP_V 0.0039496598225815571993
+
+// Samples are produced in chunks small enough to stay in L1
+#define BATCH_CHUNK 512
+
+// Layer edges x[i] (decreasing, x[LAYERS] = 0) and density at each edge
+static double zig_norm_x[ZIG_LAYERS + 1];
+static double zig_norm_f[ZIG_LAYERS + 1];
+static double zig_exp_x[ZIG_LAYERS + 1];
+static double zig_exp_f[ZIG_LAYERS + 1];
+static pthread_once_t zig_tables_once = PTHREAD_ONCE_INIT;
+
+// Source of extra random words for the rare slow path
+typedef uint64_t (*BitSource)(void* ctx);
+
+static void build_ziggurat_tables(void) {
+    // Every layer has area V: x[i+1] = f^-1(V / x[i] + f(x[i]))
+    double x = ZIG_NORM_R;
+    zig_norm_x[0] = ZIG_NORM_V / exp(-0.5 * x * x);
+    zig_norm_x[1] = x;
+    for (int i = 2; i < ZIG_LAYERS; i++) {
+        double y = ZIG_NORM_V / x + exp(-0.5 * x * x);
+        x = y < 1.0 ? sqrt(-2.0 * log(y)) : 0.0;
+        zig_norm_x[i] = x;
+    }
+    zig_norm_x[ZIG_LAYERS] = 0.0;
+
+    x = ZIG_EXP_R;
+    zig_exp_x[0] = ZIG_EXP_V / exp(-x);
+    zig_exp_x[1] = x;
+    for (int i = 2; i < ZIG_LAYERS; i++) {
+        double y = ZIG_EXP_V / x + exp(-x);
+        x = y < 1.0 ? -log(y) : 0.0;
+        zig_exp_x[i] = x;
+    }
+    zig_exp_x[ZIG_LAYERS] = 0.0;
+
+    for (int i = 0; i <= ZIG_LAYERS; i++) {
+        zig_norm_f[i] = exp(-0.5 * zig_norm_x[i] * zig_norm_x[i]);
+        zig_exp_f[i] = exp(-zig_exp_x[i]);
+    }
+}
+
+static inline void ensure_ziggurat_tables(void) {
+    pthread_once(&zig_tables_once, build_ziggurat_tables);
+}
+
+// Layer from bits 3..10, mantissa from the top 53 bits
+static inline int zig_layer(uint64_t bits) { return (int)((bits >> 3) & 0xff); }
+
+static inline double zig_unit(uint64_t bits) {
+    return (double)(bits >> 11) * 0x1.0p-53;
+}
+
+static inline double zig_open(uint64_t bits) {
+    return ((double)(bits >> 11) + 0.5) * 0x1.0p-53;
+}
+
+static double zig_normal_slow(uint64_t bits, BitSource next, void* ctx) {
+    for (;;) {
+        int i = zig_layer(bits);
+        double u = 2.0 * zig_unit(bits) - 1.0;
+        double x = u * zig_norm_x[i];
+
+        if (fabs(x) < zig_norm_x[i + 1]) return x;
+
+        if (i == 0) {
+            // Tail beyond R (Marsaglia 1964)
+            double t, y;
+            do {
+                t = -log(zig_open(next(ctx))) / ZIG_NORM_R;
+                y = -log(zig_open(next(ctx)));
+            } while (y + y < t * t);
+            return u < 0.0 ? -(ZIG_NORM_R + t) : ZIG_NORM_R + t;
+        }
+
+        double f = zig_norm_f[i + 1] +
+                   (zig_norm_f[i] - zig_norm_f[i + 1]) * zig_unit(next(ctx));
+        if (f < exp(-0.5 * x * x)) return x;
+
+        bits = next(ctx);
+    }
+}
+
+static double zig_exponential_slow(uint64_t bits, BitSource next,
+                                   void* ctx) {
+    for (;;) {
+        int i = zig_layer(bits);
+        double x = zig_unit(bits) * zig_exp_x[i];
+
+        if (x < zig_exp_x[i + 1]) return x;
+
+        // The exponential tail is itself exponential
+        if (i == 0) return ZIG_EXP_R - log(zig_open(next(ctx)));
+
+        double f = zig_exp_f[i + 1] +
+                   (zig_exp_f[i] - zig_exp_f[i + 1]) * zig_unit(next(ctx));
+        if (f < exp(-x)) return x;
+
+        bits = next(ctx);
+    }
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void init_random_batch(RandomBatch* batch, uint64_t seed) {
+    ensure_ziggurat_tables();
+
+    uint64_t sm = seed;
+    for (int l = 0; l < RANDOM_BATCH_LANES; l++) {
+        for (int w = 0; w < 4; w++) {
+            batch->s[w][l] = splitmix64(&sm);
+        }
+    }
+}
+
+void* random_batch_alloc(size_t count, size_t size) {
+    size_t bytes = count * size;
+    bytes = (bytes + RANDOM_BATCH_ALIGN - 1) & ~(size_t)(RANDOM_BATCH_ALIGN - 1);
+    return aligned_alloc(RANDOM_BATCH_ALIGN, bytes ? bytes : RANDOM_BATCH_ALIGN);
+}
+
+// Advance lane 0 alone; used for the few words the slow paths need
+static uint64_t batch_next_scalar(void* ctx) {
+    RandomBatch* batch = (RandomBatch*)ctx;
+    uint64_t* s0 = &batch->s[0][0];
+    uint64_t* s1 = &batch->s[1][0];
+    uint64_t* s2 = &batch->s[2][0];
+    uint64_t* s3 = &batch->s[3][0];
+
+    uint64_t result = *s0 + *s3;
+    uint64_t t = *s1 << 17;
+    *s2 ^= *s0;
+    *s3 ^= *s1;
+    *s1 ^= *s2;
+    *s0 ^= *s3;
+    *s2 ^= t;
+    *s3 = rotl(*s3, 45);
+    return result;
+}
+
+// One step of all lanes, written to out[0..LANES)
+static inline void batch_step(uint64_t* restrict s0, uint64_t* restrict s1,
+                              uint64_t* restrict s2, uint64_t* restrict s3,
+                              uint64_t* restrict out) {
+#pragma omp simd aligned(s0, s1, s2, s3 : RANDOM_BATCH_ALIGN)
+    for (int l = 0; l < RANDOM_BATCH_LANES; l++) {
+        out[l] = s0[l] + s3[l];
+        uint64_t t = s1[l] << 17;
+        s2[l] ^= s0[l];
+        s3[l] ^= s1[l];
+        s1[l] ^= s2[l];
+        s0[l] ^= s3[l];
+        s2[l] ^= t;
+        s3[l] = (s3[l] << 45) | (s3[l] >> 19);
+    }
+}
+
+void random_batch_bits(RandomBatch* batch, uint64_t* out, size_t count) {
+    uint64_t* s0 = batch->s[0];
+    uint64_t* s1 = batch->s[1];
+    uint64_t* s2 = batch->s[2];
+    uint64_t* s3 = batch->s[3];
+
+    size_t full = count - count % RANDOM_BATCH_LANES;
+    for (size_t b = 0; b < full; b += RANDOM_BATCH_LANES) {
+        batch_step(s0, s1, s2, s3, out + b);
+    }
+
+    if (full < count) {
+        uint64_t tail[RANDOM_BATCH_LANES]
+            __attribute__((aligned(RANDOM_BATCH_ALIGN)));
+        batch_step(s0, s1, s2, s3, tail);
+        for (size_t i = full; i < count; i++) out[i] = tail[i - full];
+    }
+}
+
+void random_batch_uniform(RandomBatch* batch, double* out, size_t count) {
+    uint64_t bits[BATCH_CHUNK] __attribute__((aligned(RANDOM_BATCH_ALIGN)));
+
+    for (size_t base = 0; base < count; base += BATCH_CHUNK) {
+        size_t n = count - base < BATCH_CHUNK ? count - base : BATCH_CHUNK;
+        random_batch_bits(batch, bits, n);
+
+        double* dst = out + base;
+#pragma omp simd
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = (double)(bits[i] >> 11) * 0x1.0p-53;
+        }
+    }
+}
+
+void random_batch_normal(RandomBatch* batch, double* out, size_t count) {
+    uint64_t bits[BATCH_CHUNK] __attribute__((aligned(RANDOM_BATCH_ALIGN)));
+    unsigned char reject[BATCH_CHUNK];
+
+    for (size_t base = 0; base < count; base += BATCH_CHUNK) {
+        size_t n = count - base < BATCH_CHUNK ? count - base : BATCH_CHUNK;
+        random_batch_bits(batch, bits, n);
+
+        // Fast path across the whole chunk; about 1% of samples miss it
+        double* dst = out + base;
+#pragma omp simd
+        for (size_t i = 0; i < n; i++) {
+            int layer = zig_layer(bits[i]);
+            double x = (2.0 * zig_unit(bits[i]) - 1.0) * zig_norm_x[layer];
+            dst[i] = x;
+            reject[i] = fabs(x) >= zig_norm_x[layer + 1];
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            if (reject[i]) {
+                dst[i] = zig_normal_slow(bits[i], batch_next_scalar, batch);
+            }
+        }
+    }
+}
+
+void random_batch_exponential(RandomBatch* batch, double* out,
+                              size_t count) {
+    uint64_t bits[BATCH_CHUNK] __attribute__((aligned(RANDOM_BATCH_ALIGN)));
+    unsigned char reject[BATCH_CHUNK];
+
+    for (size_t base = 0; base < count; base += BATCH_CHUNK) {
+        size_t n = count - base < BATCH_CHUNK ? count - base : BATCH_CHUNK;
+        random_batch_bits(batch, bits, n);
+
+        double* dst = out + base;
+#pragma omp simd
+        for (size_t i = 0; i < n; i++) {
+            int layer = zig_layer(bits[i]);
+            double x = zig_unit(bits[i]) * zig_exp_x[layer];
+            dst[i] = x;
+            reject[i] = x >= zig_exp_x[layer + 1];
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            if (reject[i]) {
+                dst[i] = zig_exponential_slow(bits[i], batch_next_scalar,
+                                              batch);
+            }
+        }
+    }
+}
+
+static uint64_t pcg_next64(void* ctx) {
+    RandomState* state = (RandomState*)ctx;
+    uint64_t hi = pcg32(state);
+    return (hi << 32) | pcg32(state);
+}
+
+double random_normal_ziggurat(RandomState* state) {
+    ensure_ziggurat_tables();
+    return zig_normal_slow(pcg_next64(state), pcg_next64, state);
+}
+
+double random_exponential_ziggurat(RandomState* state, double lambda) {
+    ensure_ziggurat_tables();
+    return zig_exponential_slow(pcg_next64(state), pcg_next64, state) /
+           lambda;
+}
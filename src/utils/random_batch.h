@@ -0,0 +1,38 @@
+#ifndef NEURAL_RANDOM_BATCH_H
+#define NEURAL_RANDOM_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/random.h"
+
+// Number of independent generator lanes advanced together. Eight 64-bit
+// lanes fill one AVX-512 register or two AVX2 registers.
+#ifndef RANDOM_BATCH_LANES
+#define RANDOM_BATCH_LANES 8
+#endif
+
+#define RANDOM_BATCH_ALIGN 64
+
+// xoshiro256+ in structure-of-arrays form: word k of every lane is
+// contiguous, so one generator step is a handful of vector shifts, xors
+// and adds across all lanes.
+typedef struct {
+    uint64_t s[4][RANDOM_BATCH_LANES] __attribute__((aligned(RANDOM_BATCH_ALIGN)));
+} RandomBatch;
+
+void init_random_batch(RandomBatch* batch, uint64_t seed);
+void* random_batch_alloc(size_t count, size_t size);
+
+// Buffer fills; count may be any size, buffers from random_batch_alloc()
+void random_batch_bits(RandomBatch* batch, uint64_t* out, size_t count);
+void random_batch_uniform(RandomBatch* batch, double* out, size_t count);
+void random_batch_normal(RandomBatch* batch, double* out, size_t count);
+void random_batch_exponential(RandomBatch* batch, double* out,
+                              size_t count);
+
+// Scalar Ziggurat samplers on the PCG generator
+double random_normal_ziggurat(RandomState* state);
+double random_exponential_ziggurat(RandomState* state, double lambda);
+
+#endif
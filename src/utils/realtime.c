@@ -0,0 +1,152 @@
+#include "utils/realtime.h"
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define NS_PER_SECOND 1000000000LL
+
+static int latency_bucket(long long ns) {
+    if (ns < LATENCY_SUB_BUCKETS) return ns > 0 ? (int)ns : 0;
+    int octave = 63 - __builtin_clzll((unsigned long long)ns);
+    int sub = (int)(ns >> (octave - LATENCY_SUB_BITS)) - LATENCY_SUB_BUCKETS;
+    int bucket = (octave - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS + sub;
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+// Smallest latency of a bucket
+static long long bucket_floor(int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) return bucket;
+    int octave = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+    long long mantissa = LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS;
+    return mantissa << (octave - LATENCY_SUB_BITS);
+}
+
+void latency_histogram_add(LatencyHistogram* histogram, long long ns) {
+    histogram->counts[latency_bucket(ns)]++;
+    histogram->samples++;
+    if (ns > histogram->max) histogram->max = ns;
+}
+
+long long latency_histogram_percentile(const LatencyHistogram* histogram,
+                                       double q) {
+    if (histogram->samples == 0) return 0;
+    long long rank = (long long)(q * histogram->samples + 0.999999);
+    if (rank < 1) rank = 1;
+    long long seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS - 1; b++) {
+        seen += histogram->counts[b];
+        if (seen >= rank) {
+            long long ceiling = bucket_floor(b + 1) - 1;
+            return ceiling < histogram->max ? ceiling : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+static long long elapsed_ns(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * NS_PER_SECOND +
+           (now.tv_nsec - start->tv_nsec);
+}
+
+static long long fault_count(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_minflt + usage.ru_majflt;
+}
+
+// Touches the stack the run may grow into, so it is mapped while locked
+static void prefault_stack(void) {
+    volatile char stack[REALTIME_PREFAULT_STACK];
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) page = 4096;
+    for (size_t i = 0; i < sizeof(stack); i += (size_t)page) stack[i] = 0;
+}
+
+RealtimePacer* create_realtime_pacer(double period, int warmup,
+                                     bool lock_memory) {
+    if (period <= 0.0 || warmup < 0) {
+        fprintf(stderr, "Invalid real-time pacing\n");
+        return NULL;
+    }
+    RealtimePacer* pacer = calloc(1, sizeof(RealtimePacer));
+    if (!pacer) {
+        fprintf(stderr, "Failed to allocate real-time pacer\n");
+        return NULL;
+    }
+    pacer->period = (long long)(period * NS_PER_SECOND + 0.5);
+    if (pacer->period < 1) pacer->period = 1;
+    pacer->warmup = warmup;
+    pacer->faults_at = -1;
+
+    if (lock_memory) {
+        // Freed heap stays mapped, and large blocks come from the locked
+        // heap instead of fresh mappings
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            fprintf(stderr, "Failed to lock memory: %s\n", strerror(errno));
+            free(pacer);
+            return NULL;
+        }
+        pacer->locked = true;
+        prefault_stack();
+    }
+    return pacer;
+}
+
+void destroy_realtime_pacer(RealtimePacer* pacer) {
+    if (pacer) {
+        if (pacer->locked) munlockall();
+        free(pacer);
+    }
+}
+
+void realtime_start(RealtimePacer* pacer) {
+    // Sleeps of the running thread otherwise end up to 50 us late
+    prctl(PR_SET_TIMERSLACK, 1UL);
+    clock_gettime(CLOCK_MONOTONIC, &pacer->start);
+    pacer->run_steps = 0;
+    if (pacer->steps >= pacer->warmup) pacer->faults_at = fault_count();
+}
+
+void realtime_wait(RealtimePacer* pacer) {
+    pacer->release = pacer->run_steps * pacer->period;
+    struct timespec wake = pacer->start;
+    long long ns = wake.tv_nsec + pacer->release;
+    wake.tv_sec += ns / NS_PER_SECOND;
+    wake.tv_nsec = ns % NS_PER_SECOND;
+    // Returns at once when the simulation is behind the clock
+    int status;
+    do {
+        status = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+    } while (status == EINTR);
+    pacer->started = elapsed_ns(&pacer->start);
+}
+
+void realtime_step_done(RealtimePacer* pacer) {
+    long long done = elapsed_ns(&pacer->start);
+    pacer->run_steps++;
+    if (pacer->steps++ < pacer->warmup) {
+        if (pacer->steps == pacer->warmup) pacer->faults_at = fault_count();
+        return;
+    }
+    latency_histogram_add(&pacer->wakeup, pacer->started - pacer->release);
+    latency_histogram_add(&pacer->latency, done - pacer->release);
+    if (done > pacer->release + pacer->period) pacer->overruns++;
+}
+
+void realtime_finish(RealtimePacer* pacer) {
+    if (pacer->faults_at >= 0) {
+        pacer->page_faults += fault_count() - pacer->faults_at;
+        pacer->faults_at = -1;
+    }
+}
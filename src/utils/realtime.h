@@ -0,0 +1,76 @@
+#ifndef NEURAL_REALTIME_H
+#define NEURAL_REALTIME_H
+
+#include <stdbool.h>
+#include <time.h>
+
+// Paces a run to the wall clock for closed-loop use. Step n of a run is
+// released at start + n * period on CLOCK_MONOTONIC, and the pacer sleeps
+// until then with clock_nanosleep(TIMER_ABSTIME), so sleeping never makes
+// the schedule drift. A step that completes after the next release is an
+// overrun. The schedule is kept, so steps after an overrun run back to
+// back until the simulation has caught up with the clock again.
+//
+// Every step after the warmup records two latencies from its release:
+// the wakeup latency (scheduling jitter) to the start of the step, and the
+// step latency to its completion, which has to stay within the period.
+//
+// Locking memory prefaults everything mapped, future mappings included,
+// and keeps malloc from returning memory to the system for the rest of the
+// process, so that paced steps take no page faults once the warmup has
+// touched their memory.
+
+// Log-linear buckets of nanosecond latencies: LATENCY_SUB_BUCKETS per
+// power of two, so percentiles are within 1/8 of the true value
+#define LATENCY_SUB_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS (LATENCY_SUB_BUCKETS * 40)
+
+// Stack the pacer touches when locking memory
+#define REALTIME_PREFAULT_STACK (256 * 1024)
+
+typedef struct {
+    long long counts[LATENCY_BUCKETS];
+    long long samples;
+    long long max;  // ns
+} LatencyHistogram;
+
+void latency_histogram_add(LatencyHistogram* histogram, long long ns);
+// Latency (ns) below which a fraction q of the samples lie, up to the
+// bucket width; 0 without samples
+long long latency_histogram_percentile(const LatencyHistogram* histogram,
+                                       double q);
+
+typedef struct {
+    long long period;      // ns per step
+    int warmup;            // Steps not recorded
+    bool locked;           // Memory is locked
+    struct timespec start; // Release of the first step of the run
+    long long run_steps;   // Steps released in this run
+    long long release;     // ns from start to the release of this step
+    long long started;     // ns from start to the start of this step
+
+    long long steps;       // Steps paced over all runs
+    long long overruns;
+    long long page_faults; // Taken by the process in paced steps after warmup
+    long long faults_at;   // Fault count when recording last resumed, or -1
+    LatencyHistogram wakeup;
+    LatencyHistogram latency;
+} RealtimePacer;
+
+// Steps of period seconds; lock_memory locks and prefaults the process's
+// memory until the pacer is destroyed
+RealtimePacer* create_realtime_pacer(double period, int warmup,
+                                     bool lock_memory);
+void destroy_realtime_pacer(RealtimePacer* pacer);
+
+// Starts the schedule with a step released now; also after pauses
+void realtime_start(RealtimePacer* pacer);
+// Sleeps until the release of the next step
+void realtime_wait(RealtimePacer* pacer);
+// Records the step started by the last realtime_wait()
+void realtime_step_done(RealtimePacer* pacer);
+// Accounts the faults of the run; call when it ends
+void realtime_finish(RealtimePacer* pacer);
+
+#endif
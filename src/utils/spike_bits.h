@@ -0,0 +1,55 @@
+#ifndef NEURAL_SPIKE_BITS_H
+#define NEURAL_SPIKE_BITS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Spike vectors packed one bit per neuron into 64-bit words, bit i of word
+// w standing for neuron 64 * w + i of the vector. Counting and comparing
+// vectors then costs one popcount per word instead of a pass per neuron.
+
+static inline size_t spike_bits_words(int count) {
+    return ((size_t)count + 63) / 64;
+}
+
+static inline void spike_bits_set(uint64_t* bits, int i) {
+    bits[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+static inline int spike_bits_test(const uint64_t* bits, int i) {
+    return (int)((bits[i >> 6] >> (i & 63)) & 1);
+}
+
+// Neurons set in the vector
+static inline long long spike_bits_count(const uint64_t* bits,
+                                         size_t words) {
+    long long count = 0;
+    for (size_t w = 0; w < words; w++) count += __builtin_popcountll(bits[w]);
+    return count;
+}
+
+// Neurons set in both vectors
+static inline long long spike_bits_count_and(const uint64_t* a,
+                                             const uint64_t* b,
+                                             size_t words) {
+    long long count = 0;
+    for (size_t w = 0; w < words; w++) {
+        count += __builtin_popcountll(a[w] & b[w]);
+    }
+    return count;
+}
+
+// Writes the indices of the set bits to ids in ascending order, each plus
+// offset; returns their number
+static inline int spike_bits_ids(const uint64_t* bits, size_t words,
+                                 int offset, int* ids) {
+    int count = 0;
+    for (size_t w = 0; w < words; w++) {
+        for (uint64_t word = bits[w]; word; word &= word - 1) {
+            ids[count++] = offset + (int)(w * 64) + __builtin_ctzll(word);
+        }
+    }
+    return count;
+}
+
+#endif
@@ -0,0 +1,810 @@
+#include "utils/sweep.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "core/mean_field.h"
+#include "neural_sim.h"
+#include "utils/config.h"
+#include "utils/random.h"
+
+// Grids larger than this are almost certainly a mistake in the spec
+#define MAX_SWEEP_RUNS 100000
+
+static char* trim(char* text) {
+    while (isspace((unsigned char)*text)) text++;
+    char* end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1])) *--end = '\0';
+    return text;
+}
+
+// "low : high" with both ends numbers
+static bool parse_range(const char* value, double* low, double* high) {
+    const char* colon = strchr(value, ':');
+    if (!colon) return false;
+    char* end;
+    *low = strtod(value, &end);
+    while (isspace((unsigned char)*end)) end++;
+    if (end == value || end != colon) return false;
+    *high = strtod(colon + 1, &end);
+    while (isspace((unsigned char)*end)) end++;
+    return end != colon + 1 && *end == '\0';
+}
+
+static int parse_param(SweepParam* param, const char* key, char* value) {
+    snprintf(param->key, sizeof(param->key), "%s", key);
+    if (parse_range(value, &param->low, &param->high)) {
+        param->range = true;
+        return 0;
+    }
+    char* saveptr = NULL;
+    for (char* item = strtok_r(value, ",", &saveptr); item;
+         item = strtok_r(NULL, ",", &saveptr)) {
+        item = trim(item);
+        if (item[0] == '\0') continue;
+        if (param->num_values == MAX_SWEEP_VALUES) {
+            fprintf(stderr, "Too many sweep values for %s\n", key);
+            return -1;
+        }
+        param->values[param->num_values++] = strdup(item);
+    }
+    if (param->num_values == 0) {
+        fprintf(stderr, "No sweep values for %s\n", key);
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_spec_line(SweepSpec* spec, char* line) {
+    char* comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+    char* value = strchr(line, '=');
+    if (!value) return 0;
+    *value++ = '\0';
+    char* key = trim(line);
+    value = trim(value);
+
+    if (strcmp(key, "mode") == 0) {
+        if (strcmp(value, "grid") == 0) {
+            spec->mode = SWEEP_GRID;
+        } else if (strcmp(value, "random") == 0) {
+            spec->mode = SWEEP_RANDOM;
+        } else {
+            fprintf(stderr, "Unknown sweep mode: %s\n", value);
+            return -1;
+        }
+    } else if (strcmp(key, "engine") == 0) {
+        if (strcmp(value, "spiking") == 0) {
+            spec->engine = SWEEP_SPIKING;
+        } else if (strcmp(value, "mean_field") == 0) {
+            spec->engine = SWEEP_MEAN_FIELD;
+        } else if (strcmp(value, "compare") == 0) {
+            spec->engine = SWEEP_COMPARE;
+        } else {
+            fprintf(stderr, "Unknown sweep engine: %s\n", value);
+            return -1;
+        }
+    } else if (strcmp(key, "samples") == 0) {
+        spec->samples = atoi(value);
+    } else if (strcmp(key, "seed") == 0) {
+        spec->seed = (unsigned int)strtoul(value, NULL, 10);
+    } else if (strcmp(key, "workers") == 0) {
+        spec->workers = atoi(value);
+    } else if (strcmp(key, "threads") == 0) {
+        spec->threads = atoi(value);
+    } else {
+        if (spec->num_params == MAX_SWEEP_PARAMS) {
+            fprintf(stderr, "Too many sweep parameters\n");
+            return -1;
+        }
+        if (strlen(key) >= MAX_SWEEP_KEY) {
+            fprintf(stderr, "Sweep parameter name too long: %s\n", key);
+            return -1;
+        }
+        if (!config_key_has_effect(key)) {
+            fprintf(stderr, "Sweep parameter %s has no effect on runs\n", key);
+            return -1;
+        }
+        return parse_param(&spec->params[spec->num_params++], key, value);
+    }
+    return 0;
+}
+
+static int validate_sweep_spec(const SweepSpec* spec) {
+    if (spec->num_params == 0) {
+        fprintf(stderr, "Sweep spec sets no parameters\n");
+        return -1;
+    }
+    if (spec->threads < 1 || spec->workers < 0) {
+        fprintf(stderr, "Invalid sweep workers or threads\n");
+        return -1;
+    }
+    if (spec->mode == SWEEP_RANDOM) {
+        if (spec->samples < 1 || spec->samples > MAX_SWEEP_RUNS) {
+            fprintf(stderr, "Invalid number of sweep samples: %d\n",
+                    spec->samples);
+            return -1;
+        }
+        return 0;
+    }
+    long long runs = 1;
+    for (int p = 0; p < spec->num_params; p++) {
+        if (spec->params[p].range) {
+            fprintf(stderr, "Ranges need mode = random: %s\n",
+                    spec->params[p].key);
+            return -1;
+        }
+        runs *= spec->params[p].num_values;
+        if (runs > MAX_SWEEP_RUNS) {
+            fprintf(stderr, "Sweep grid has more than %d runs\n",
+                    MAX_SWEEP_RUNS);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+SweepSpec* parse_sweep_spec(const char* text) {
+    SweepSpec* spec = (SweepSpec*)calloc(1, sizeof(SweepSpec));
+    char* copy = strdup(text);
+    if (!spec || !copy) {
+        free(copy);
+        free(spec);
+        return NULL;
+    }
+    spec->mode = SWEEP_GRID;
+    spec->engine = SWEEP_SPIKING;
+    spec->samples = 10;
+    spec->seed = 1;
+    spec->workers = 0;
+    spec->threads = 1;
+
+    int status = 0;
+    char* saveptr = NULL;
+    for (char* line = strtok_r(copy, "\n", &saveptr); line && status == 0;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        status = parse_spec_line(spec, line);
+    }
+    free(copy);
+    if (status != 0 || validate_sweep_spec(spec) != 0) {
+        destroy_sweep_spec(spec);
+        return NULL;
+    }
+    return spec;
+}
+
+static char* read_file(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return NULL;
+    char* text = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long size = ftell(file);
+        rewind(file);
+        text = size >= 0 ? (char*)malloc(size + 1) : NULL;
+        if (text && fread(text, 1, size, file) != (size_t)size) {
+            free(text);
+            text = NULL;
+        } else if (text) {
+            text[size] = '\0';
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+SweepSpec* load_sweep_spec(const char* filename) {
+    char* text = read_file(filename);
+    if (!text) {
+        fprintf(stderr, "Failed to open sweep spec: %s\n", filename);
+        return NULL;
+    }
+    SweepSpec* spec = parse_sweep_spec(text);
+    free(text);
+    return spec;
+}
+
+void destroy_sweep_spec(SweepSpec* spec) {
+    if (spec) {
+        for (int p = 0; p < spec->num_params; p++) {
+            for (int v = 0; v < spec->params[p].num_values; v++) {
+                free(spec->params[p].values[v]);
+            }
+        }
+        free(spec);
+    }
+}
+
+// Appends "key=value\n" to the run's lines
+static void append_line(char* lines, const char* key, const char* value) {
+    strcat(lines, key);
+    strcat(lines, "=");
+    strcat(lines, value);
+    strcat(lines, "\n");
+}
+
+char** sweep_runs(const SweepSpec* spec, int* num_runs) {
+    int count = 1;
+    if (spec->mode == SWEEP_RANDOM) {
+        count = spec->samples;
+    } else {
+        for (int p = 0; p < spec->num_params; p++) {
+            count *= spec->params[p].num_values;
+        }
+    }
+    // Longest line of every parameter, a drawn number at most 32 bytes
+    size_t size = 1;
+    for (int p = 0; p < spec->num_params; p++) {
+        const SweepParam* param = &spec->params[p];
+        size_t longest = 32;
+        for (int v = 0; v < param->num_values; v++) {
+            size_t length = strlen(param->values[v]);
+            if (length > longest) longest = length;
+        }
+        size += strlen(param->key) + longest + 2;
+    }
+
+    char** runs = (char**)calloc(count, sizeof(char*));
+    if (!runs) return NULL;
+    RandomState rng;
+    init_random(&rng, spec->seed);
+    for (int r = 0; r < count; r++) {
+        runs[r] = (char*)calloc(size, 1);
+        if (!runs[r]) {
+            for (int i = 0; i < r; i++) free(runs[i]);
+            free(runs);
+            return NULL;
+        }
+        // Grid runs count through the values with the last key fastest
+        int index = r;
+        int choice[MAX_SWEEP_PARAMS];
+        for (int p = spec->num_params - 1; p >= 0; p--) {
+            int n = spec->params[p].num_values;
+            choice[p] = spec->mode == SWEEP_GRID ? index % n : 0;
+            if (spec->mode == SWEEP_GRID) index /= n;
+        }
+        for (int p = 0; p < spec->num_params; p++) {
+            const SweepParam* param = &spec->params[p];
+            char number[32];
+            const char* value;
+            if (spec->mode == SWEEP_GRID) {
+                value = param->values[choice[p]];
+            } else if (param->range) {
+                snprintf(number, sizeof(number), "%.9g",
+                         param->low + (param->high - param->low) *
+                                          random_uniform(&rng));
+                value = number;
+            } else {
+                int v = (int)(random_uniform(&rng) * param->num_values);
+                value = param->values[v < param->num_values
+                                          ? v
+                                          : param->num_values - 1];
+            }
+            append_line(runs[r], param->key, value);
+        }
+    }
+    *num_runs = count;
+    return runs;
+}
+
+// Statistics of a run, written by the run's process into memory shared
+// with the driver
+typedef struct {
+    double init_seconds;
+    double run_seconds;
+    long long spikes_pyramidal;
+    long long spikes_inhibitory;
+    double rate_pyramidal;
+    double rate_inhibitory;
+    double mean_v;
+    double mean_weight;
+} SweepResult;
+
+// Mean-field solution of a run, solved by the driver
+typedef struct {
+    MeanFieldResult result;
+    double seconds;
+    int status;  // 0 when solved
+} MeanFieldRun;
+
+typedef struct {
+    int threads;
+    char** texts;          // Full configuration of every run
+    int* group;            // Connectome of every run
+    NetworkConfig* nets;   // Network configuration of every connectome
+    char** connectomes;    // Connectome file of every connectome
+    char** run_dirs;
+    SweepResult* results;  // Shared mapping, one per run
+    MeanFieldRun* mean_field;  // One per run, NULL for spiking sweeps
+} SweepContext;
+
+typedef int (*SweepJob)(const SweepContext* context, int job);
+
+// Runs count jobs in child processes, at most workers at once, starting
+// them in order; status[job] gets each job's exit status, -1 if it did
+// not exit normally. Returns the number of failed jobs.
+static int run_in_processes(int count, const int* order, int workers,
+                            SweepJob job, const SweepContext* context,
+                            int* status) {
+    pid_t* pids = (pid_t*)calloc(count > 0 ? count : 1, sizeof(pid_t));
+    if (!pids) return count;
+    int next = 0;
+    int running = 0;
+    int failed = 0;
+    while (next < count || running > 0) {
+        if (next < count && running < workers) {
+            int j = order[next++];
+            fflush(NULL);
+            pid_t pid = fork();
+            if (pid == 0) _exit(job(context, j));
+            if (pid < 0) {
+                fprintf(stderr, "Failed to start sweep process\n");
+                status[j] = -1;
+                failed++;
+            } else {
+                pids[j] = pid;
+                running++;
+            }
+            continue;
+        }
+        int child_status;
+        pid_t pid = wait(&child_status);
+        if (pid < 0) break;
+        for (int j = 0; j < count; j++) {
+            if (pids[j] != pid) continue;
+            status[j] = WIFEXITED(child_status) ? WEXITSTATUS(child_status)
+                                                : -1;
+            if (status[j] != 0) failed++;
+            pids[j] = 0;
+            running--;
+            break;
+        }
+    }
+    free(pids);
+    return failed;
+}
+
+static int build_job(const SweepContext* context, int group) {
+    return save_network_connectome(context->nets[group],
+                                   context->connectomes[group]) == 0
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+}
+
+static int run_job(const SweepContext* context, int run) {
+    omp_set_num_threads(context->threads);
+
+    // Keep the run's own output off the driver's terminal
+    char path[4096];
+    mkdir(context->run_dirs[run], 0755);
+    snprintf(path, sizeof(path), "%s/log.txt", context->run_dirs[run]);
+    if (!freopen(path, "w", stdout)) return EXIT_FAILURE;
+
+    SweepResult* result = &context->results[run];
+    double start = omp_get_wtime();
+    NeuralSimulation* sim = ns_init_from_string(context->texts[run], NULL);
+    if (!sim) {
+        fprintf(stderr, "Sweep run %d: %s\n", run, ns_get_last_error());
+        return EXIT_FAILURE;
+    }
+    result->init_seconds = omp_get_wtime() - start;
+    start = omp_get_wtime();
+    NeuralSimError error = ns_run(sim, -1);
+    result->run_seconds = omp_get_wtime() - start;
+    NetworkStatistics stats;
+    if (error == NS_SUCCESS) error = ns_calculate_statistics(sim, &stats);
+    if (error == NS_SUCCESS) {
+        result->spikes_pyramidal = stats.spikes_pyramidal;
+        result->spikes_inhibitory = stats.spikes_inhibitory;
+        result->rate_pyramidal = stats.mean_rate_pyramidal;
+        result->rate_inhibitory = stats.mean_rate_inhibitory;
+        result->mean_v = stats.mean_membrane_potential;
+        result->mean_weight = stats.mean_weight;
+    } else {
+        fprintf(stderr, "Sweep run %d: %s\n", run, ns_get_last_error());
+    }
+    ns_stop(sim);
+    return error == NS_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Solves the mean field of every run in the driver; returns the number of
+// runs outside the approximation
+static int solve_mean_field(const SweepContext* context, int num_runs) {
+    int failed = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : failed)
+    for (int r = 0; r < num_runs; r++) {
+        MeanFieldRun* run = &context->mean_field[r];
+        SimulationConfig* config = parse_config_string(context->texts[r]);
+        double start = omp_get_wtime();
+        run->status =
+            config ? mean_field_rates(&config->network, &run->result) : -1;
+        run->seconds = omp_get_wtime() - start;
+        if (run->status != 0) {
+            fprintf(stderr, "Sweep run %d has no mean field\n", r);
+            failed++;
+        }
+        destroy_config(config);
+    }
+    return failed;
+}
+
+static bool same_connectome(const NetworkConfig* a, const NetworkConfig* b) {
+    return a->num_pyramidal == b->num_pyramidal &&
+           a->num_inhibitory == b->num_inhibitory && a->seed == b->seed &&
+           a->reorder == b->reorder &&
+           a->connection_rate == b->connection_rate;
+}
+
+// Relative cost of a run: steps times neuron and synapse updates
+static double run_cost(const NetworkConfig* net) {
+    double n = net->num_pyramidal + net->num_inhibitory;
+    return net->simulation_time / net->dt * n *
+           (1.0 + n * net->connection_rate);
+}
+
+typedef struct {
+    double cost;
+    int job;
+} JobCost;
+
+static int by_cost_descending(const void* a, const void* b) {
+    double ca = ((const JobCost*)a)->cost;
+    double cb = ((const JobCost*)b)->cost;
+    return (ca < cb) - (ca > cb);
+}
+
+// Job order longest first, so the last jobs to start are short ones
+static void order_by_cost(JobCost* costs, int count, int* order) {
+    qsort(costs, count, sizeof(JobCost), by_cost_descending);
+    for (int i = 0; i < count; i++) order[i] = costs[i].job;
+}
+
+// Values of a run's parameters, comma separated after each other column
+static void write_values(FILE* file, const char* run) {
+    // The run's lines are key=value in parameter order
+    for (const char* line = run; *line;) {
+        const char* value = strchr(line, '=') + 1;
+        const char* end = strchr(value, '\n');
+        fprintf(file, ",%.*s", (int)(end - value), value);
+        line = end + 1;
+    }
+}
+
+static void write_summary(FILE* file, const SweepSpec* spec, char** runs,
+                          int num_runs, const SweepContext* context,
+                          const int* status) {
+    fprintf(file, "run");
+    for (int p = 0; p < spec->num_params; p++) {
+        fprintf(file, ",%s", spec->params[p].key);
+    }
+    if (spec->engine == SWEEP_MEAN_FIELD) {
+        fprintf(file,
+                ",status,seconds,rate_pyramidal,rate_inhibitory,"
+                "population_freq_p,population_freq_i,mu_pyramidal,"
+                "mu_inhibitory,sigma_pyramidal,sigma_inhibitory,"
+                "converged\n");
+        for (int r = 0; r < num_runs; r++) {
+            const MeanFieldRun* run = &context->mean_field[r];
+            const MeanFieldResult* mf = &run->result;
+            fprintf(file, "%d", r);
+            write_values(file, runs[r]);
+            fprintf(file,
+                    ",%s,%.6f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d\n",
+                    run->status == 0 ? "ok" : "failed", run->seconds,
+                    mf->rate[POP_PYRAMIDAL], mf->rate[POP_INHIBITORY],
+                    mf->population_freq[POP_PYRAMIDAL],
+                    mf->population_freq[POP_INHIBITORY],
+                    mf->mu[POP_PYRAMIDAL], mf->mu[POP_INHIBITORY],
+                    mf->sigma[POP_PYRAMIDAL], mf->sigma[POP_INHIBITORY],
+                    mf->converged);
+        }
+        return;
+    }
+
+    fprintf(file,
+            ",connectome,status,init_seconds,run_seconds,spikes_pyramidal,"
+            "spikes_inhibitory,rate_pyramidal,rate_inhibitory,mean_v,"
+            "mean_weight");
+    if (spec->engine == SWEEP_COMPARE) {
+        fprintf(file,
+                ",mf_status,mf_seconds,mf_rate_pyramidal,mf_rate_inhibitory,"
+                "error_pyramidal,error_inhibitory");
+    }
+    fprintf(file, "\n");
+    for (int r = 0; r < num_runs; r++) {
+        const SweepResult* result = &context->results[r];
+        fprintf(file, "%d", r);
+        write_values(file, runs[r]);
+        fprintf(file, ",%d,%s,%.3f,%.3f,%lld,%lld,%.4f,%.4f,%.4f,%.6f",
+                context->group[r], status[r] == 0 ? "ok" : "failed",
+                result->init_seconds, result->run_seconds,
+                result->spikes_pyramidal, result->spikes_inhibitory,
+                result->rate_pyramidal, result->rate_inhibitory,
+                result->mean_v, result->mean_weight);
+        if (spec->engine == SWEEP_COMPARE) {
+            const MeanFieldRun* run = &context->mean_field[r];
+            const MeanFieldResult* mf = &run->result;
+            fprintf(file, ",%s,%.6f,%.4f,%.4f,%.4f,%.4f",
+                    run->status == 0 ? "ok" : "failed", run->seconds,
+                    mf->rate[POP_PYRAMIDAL], mf->rate[POP_INHIBITORY],
+                    mf->rate[POP_PYRAMIDAL] - result->rate_pyramidal,
+                    mf->rate[POP_INHIBITORY] - result->rate_inhibitory);
+        }
+        fprintf(file, "\n");
+    }
+}
+
+// Full configuration of every run and its connectome group; the network
+// configuration of the first run of each group goes to nets. Returns the
+// number of groups, -1 if a run's configuration is invalid.
+static int prepare_runs(const char* base, char** runs, int num_runs,
+                        const char* output_dir, SweepContext* context,
+                        JobCost* run_costs, JobCost* build_costs) {
+    int groups = 0;
+    for (int r = 0; r < num_runs; r++) {
+        size_t size = strlen(base) + strlen(runs[r]) + 64;
+        char* text = (char*)malloc(size);
+        if (!text) return -1;
+        snprintf(text, size, "%s\n%sranks=1\nrank=0\n", base, runs[r]);
+        SimulationConfig* config = parse_config_string(text);
+        if (!config) {
+            fprintf(stderr, "Sweep run %d has an invalid configuration:\n%s",
+                    r, runs[r]);
+            free(text);
+            return -1;
+        }
+
+        int g = 0;
+        while (g < groups &&
+               !same_connectome(&context->nets[g], &config->network)) {
+            g++;
+        }
+        if (g == groups) {
+            context->nets[g] = config->network;
+            context->nets[g].output_dir = NULL;
+            context->nets[g].connectome_file = NULL;
+            build_costs[g].cost = run_cost(&config->network) /
+                                  config->network.simulation_time;
+            build_costs[g].job = g;
+            size_t length = strlen(output_dir) + 64;
+            context->connectomes[g] = (char*)malloc(length);
+            if (!context->connectomes[g]) {
+                free(text);
+                destroy_config(config);
+                return -1;
+            }
+            snprintf(context->connectomes[g], length,
+                     "%s/connectomes/connectome_%d.bin", output_dir, g);
+            groups++;
+        }
+        context->group[r] = g;
+        run_costs[r].cost = run_cost(&config->network);
+        run_costs[r].job = r;
+        destroy_config(config);
+
+        size_t length = strlen(output_dir) + 32;
+        context->run_dirs[r] = (char*)malloc(length);
+        size += length + strlen(context->connectomes[g]) + 64;
+        context->texts[r] = (char*)malloc(size);
+        if (!context->run_dirs[r] || !context->texts[r]) {
+            free(text);
+            return -1;
+        }
+        snprintf(context->run_dirs[r], length, "%s/run_%d", output_dir, r);
+        snprintf(context->texts[r], size,
+                 "%soutput_dir=%s\nconnectome_file=%s\n", text,
+                 context->run_dirs[r], context->connectomes[g]);
+        free(text);
+    }
+    return groups;
+}
+
+static void print_summary(const SweepSpec* spec, char** runs, int num_runs,
+                          const SweepContext* context, const int* status) {
+    bool spiking = spec->engine != SWEEP_MEAN_FIELD;
+    bool mean_field = spec->engine != SWEEP_SPIKING;
+    printf("\n%-5s", "run");
+    for (int p = 0; p < spec->num_params; p++) {
+        printf(" %14.14s", spec->params[p].key);
+    }
+    if (spiking) printf(" %9s %9s %8s", "pyr (Hz)", "inh (Hz)", "time (s)");
+    if (mean_field) {
+        printf(" %9s %9s %8s", "mf pyr", "mf inh", "mf (ms)");
+    }
+    printf("\n");
+
+    // Mean-field error over the runs both engines finished
+    int compared = 0;
+    double error_sum[NUM_POPULATIONS] = {0.0, 0.0};
+    double error_max[NUM_POPULATIONS] = {0.0, 0.0};
+    double spiking_seconds = 0.0;
+    double mean_field_seconds = 0.0;
+    for (int r = 0; r < num_runs; r++) {
+        printf("%-5d", r);
+        for (const char* line = runs[r]; *line;) {
+            const char* value = strchr(line, '=') + 1;
+            const char* end = strchr(value, '\n');
+            printf(" %14.*s", (int)(end - value < 14 ? end - value : 14),
+                   value);
+            line = end + 1;
+        }
+        const SweepResult* result = &context->results[r];
+        if (spiking && status[r] == 0) {
+            printf(" %9.3f %9.3f %8.2f", result->rate_pyramidal,
+                   result->rate_inhibitory,
+                   result->init_seconds + result->run_seconds);
+        } else if (spiking) {
+            printf(" %9s %9s %8s", "failed", "", "");
+        }
+        const MeanFieldRun* run = mean_field ? &context->mean_field[r] : NULL;
+        if (run && run->status == 0) {
+            printf(" %9.3f %9.3f %8.3f%s", run->result.rate[POP_PYRAMIDAL],
+                   run->result.rate[POP_INHIBITORY], run->seconds * 1000.0,
+                   run->result.converged ? "" : " (not converged)");
+        } else if (run) {
+            printf(" %9s", "failed");
+        }
+        printf("\n");
+
+        if (!spiking || !run || status[r] != 0 || run->status != 0) continue;
+        const double measured[NUM_POPULATIONS] = {result->rate_pyramidal,
+                                                  result->rate_inhibitory};
+        for (int p = 0; p < NUM_POPULATIONS; p++) {
+            double error = fabs(run->result.rate[p] - measured[p]);
+            error_sum[p] += error;
+            if (error > error_max[p]) error_max[p] = error;
+        }
+        spiking_seconds += result->init_seconds + result->run_seconds;
+        mean_field_seconds += run->seconds;
+        compared++;
+    }
+
+    if (compared > 0) {
+        printf("\nMean field against spiking over %d runs:\n", compared);
+        printf("  |error| pyramidal  mean %.3f Hz, max %.3f Hz\n",
+               error_sum[POP_PYRAMIDAL] / compared,
+               error_max[POP_PYRAMIDAL]);
+        printf("  |error| inhibitory mean %.3f Hz, max %.3f Hz\n",
+               error_sum[POP_INHIBITORY] / compared,
+               error_max[POP_INHIBITORY]);
+        if (mean_field_seconds > 0.0) {
+            printf("  %.0fx faster than simulating\n",
+                   spiking_seconds / mean_field_seconds);
+        }
+    }
+}
+
+int run_sweep(const SweepSpec* spec, const char* base_file,
+              const char* output_dir) {
+    char* base = read_file(base_file);
+    if (!base) {
+        fprintf(stderr, "Failed to open config file: %s\n", base_file);
+        return -1;
+    }
+    int num_runs = 0;
+    char** runs = sweep_runs(spec, &num_runs);
+    bool spiking = spec->engine != SWEEP_MEAN_FIELD;
+    char connectome_dir[4096];
+    snprintf(connectome_dir, sizeof(connectome_dir), "%s/connectomes",
+             output_dir);
+    if (!runs || (mkdir(output_dir, 0755) != 0 && errno != EEXIST) ||
+        (spiking && mkdir(connectome_dir, 0755) != 0 && errno != EEXIST)) {
+        fprintf(stderr, "Failed to prepare sweep in %s\n", output_dir);
+        free(base);
+        free(runs);
+        return -1;
+    }
+
+    SweepContext context = {0};
+    context.threads = spec->threads;
+    context.texts = (char**)calloc(num_runs, sizeof(char*));
+    context.group = (int*)calloc(num_runs, sizeof(int));
+    context.nets = (NetworkConfig*)calloc(num_runs, sizeof(NetworkConfig));
+    context.connectomes = (char**)calloc(num_runs, sizeof(char*));
+    context.run_dirs = (char**)calloc(num_runs, sizeof(char*));
+    context.results = (SweepResult*)mmap(
+        NULL, num_runs * sizeof(SweepResult), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (spec->engine != SWEEP_SPIKING) {
+        context.mean_field =
+            (MeanFieldRun*)calloc(num_runs, sizeof(MeanFieldRun));
+    }
+    JobCost* run_costs = (JobCost*)calloc(num_runs, sizeof(JobCost));
+    JobCost* build_costs = (JobCost*)calloc(num_runs, sizeof(JobCost));
+    int* order = (int*)calloc(num_runs, sizeof(int));
+    int* status = (int*)calloc(num_runs, sizeof(int));
+    int* build_status = (int*)calloc(num_runs, sizeof(int));
+
+    int groups = -1;
+    if (context.texts && context.group && context.nets &&
+        context.connectomes && context.run_dirs &&
+        context.results != MAP_FAILED && run_costs && build_costs && order &&
+        status && build_status &&
+        (context.mean_field || spec->engine == SWEEP_SPIKING)) {
+        groups = prepare_runs(base, runs, num_runs, output_dir, &context,
+                              run_costs, build_costs);
+    } else {
+        fprintf(stderr, "Failed to allocate sweep\n");
+    }
+
+    int failed = -1;
+    if (groups > 0 && !spiking) {
+        printf("Sweep: %d mean-field runs\n", num_runs);
+        failed = solve_mean_field(&context, num_runs);
+    } else if (groups > 0) {
+        int workers = spec->workers > 0
+                          ? spec->workers
+                          : omp_get_num_procs() / spec->threads;
+        if (workers < 1) workers = 1;
+        printf("Sweep: %d runs over %d connectomes, %d workers of %d "
+               "threads\n",
+               num_runs, groups, workers, spec->threads);
+
+        // Every connectome once, then the runs mapping them
+        order_by_cost(build_costs, groups, order);
+        if (run_in_processes(groups, order, workers, build_job, &context,
+                             build_status) != 0) {
+            fprintf(stderr, "Failed to build sweep connectomes\n");
+        } else {
+            order_by_cost(run_costs, num_runs, order);
+            failed = run_in_processes(num_runs, order, workers, run_job,
+                                      &context, status);
+        }
+        // A compared run fails with either engine
+        if (failed >= 0 && spec->engine == SWEEP_COMPARE) {
+            solve_mean_field(&context, num_runs);
+            failed = 0;
+            for (int r = 0; r < num_runs; r++) {
+                failed += status[r] != 0 || context.mean_field[r].status != 0;
+            }
+        }
+    }
+
+    if (failed >= 0) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/sweep.csv", output_dir);
+        FILE* file = fopen(path, "w");
+        if (file) {
+            write_summary(file, spec, runs, num_runs, &context, status);
+            fclose(file);
+        } else {
+            fprintf(stderr, "Failed to write %s\n", path);
+            failed = num_runs;
+        }
+        print_summary(spec, runs, num_runs, &context, status);
+        printf("%d of %d runs succeeded, summary in %s\n", num_runs - failed,
+               num_runs, path);
+    }
+
+    for (int r = 0; r < num_runs; r++) {
+        free(runs[r]);
+        if (context.texts) free(context.texts[r]);
+        if (context.connectomes) free(context.connectomes[r]);
+        if (context.run_dirs) free(context.run_dirs[r]);
+    }
+    free(runs);
+    free(base);
+    free(context.texts);
+    free(context.group);
+    free(context.nets);
+    free(context.connectomes);
+    free(context.run_dirs);
+    free(context.mean_field);
+    if (context.results != MAP_FAILED && context.results) {
+        munmap(context.results, num_runs * sizeof(SweepResult));
+    }
+    free(run_costs);
+    free(build_costs);
+    free(order);
+    free(status);
+    free(build_status);
+    return failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,75 @@
+#ifndef NEURAL_SWEEP_H
+#define NEURAL_SWEEP_H
+
+#include <stdbool.h>
+
+// Parameter sweeps over a base configuration. A sweep spec sets any
+// configuration key to a list of values or, in random search, a range:
+//
+//   mode = grid                        # or random
+//   samples = 20                       # random: number of runs
+//   seed = 1                           # random: generator seed
+//   workers = 0                        # concurrent runs, 0 fills the cores
+//   threads = 1                        # threads of each run
+//   engine = spiking                   # or mean_field, compare
+//   connection_rate = 0.02, 0.05, 0.1  # values
+//   dt = 0.05 : 0.2                    # random: uniform in the range
+//
+// A grid runs every combination of the listed values; random search draws
+// every key of every run, uniformly from its range or its values. Runs
+// whose networks have the same connectome (sizes, seed, connection rate
+// and neuron order) map one connectome file, built once, instead of each
+// building it.
+//
+// The mean_field engine solves each run's stationary population rates
+// (see core/mean_field.h) in the driver instead of simulating it. compare
+// does both and reports the mean field's error against the spiking rates,
+// which validates the approximation over the sweep's parameters.
+
+#define MAX_SWEEP_PARAMS 16
+#define MAX_SWEEP_VALUES 64
+#define MAX_SWEEP_KEY 64
+
+typedef enum { SWEEP_GRID = 0, SWEEP_RANDOM } SweepMode;
+
+typedef enum {
+    SWEEP_SPIKING = 0,
+    SWEEP_MEAN_FIELD,
+    SWEEP_COMPARE
+} SweepEngine;
+
+typedef struct {
+    char key[MAX_SWEEP_KEY];
+    char* values[MAX_SWEEP_VALUES];
+    int num_values;
+    bool range;  // Uniform in [low, high] instead of values
+    double low;
+    double high;
+} SweepParam;
+
+typedef struct {
+    SweepMode mode;
+    SweepEngine engine;
+    int samples;
+    unsigned int seed;
+    int workers;
+    int threads;
+    SweepParam params[MAX_SWEEP_PARAMS];
+    int num_params;
+} SweepSpec;
+
+SweepSpec* parse_sweep_spec(const char* text);
+SweepSpec* load_sweep_spec(const char* filename);
+void destroy_sweep_spec(SweepSpec* spec);
+
+// Configuration lines (key=value) of every run, in run order; free each
+// and the array
+char** sweep_runs(const SweepSpec* spec, int* num_runs);
+
+// Runs the sweep on the configuration in base_file, run n writing to
+// <output_dir>/run_<n>, and collects each run's statistics into
+// <output_dir>/sweep.csv. Returns 0 if every run succeeded.
+int run_sweep(const SweepSpec* spec, const char* base_file,
+              const char* output_dir);
+
+#endif
@@ -0,0 +1,176 @@
+#include "utils/trace_pyramid.h"
+
+#include <errno.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static void reset_accumulator(TraceAccumulator* acc) {
+    acc->min = DBL_MAX;
+    acc->max = -DBL_MAX;
+    acc->sum = 0.0;
+    acc->count = 0;
+}
+
+TracePyramid* create_trace_pyramid(const char* directory,
+                                   const char* const* channel_names,
+                                   int num_channels, double dt) {
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create trace directory %s\n", directory);
+        return NULL;
+    }
+
+    TracePyramid* pyramid = calloc(1, sizeof(TracePyramid));
+    if (!pyramid) {
+        fprintf(stderr, "Failed to allocate trace pyramid\n");
+        return NULL;
+    }
+    pyramid->directory = strdup(directory);
+    pyramid->num_channels = num_channels;
+    pyramid->dt = dt;
+    pyramid->channel_names = calloc(num_channels, sizeof(char*));
+    pyramid->acc = malloc((size_t)TRACE_PYRAMID_MAX_LEVELS * num_channels *
+                          sizeof(TraceAccumulator));
+    pyramid->record = malloc((size_t)num_channels * 3 * sizeof(float));
+    if (!pyramid->directory || !pyramid->channel_names || !pyramid->acc ||
+        !pyramid->record) {
+        fprintf(stderr, "Failed to allocate trace pyramid buffers\n");
+        destroy_trace_pyramid(pyramid);
+        return NULL;
+    }
+    for (int c = 0; c < num_channels; c++) {
+        pyramid->channel_names[c] = strdup(channel_names[c]);
+    }
+    for (int i = 0; i < TRACE_PYRAMID_MAX_LEVELS * num_channels; i++) {
+        reset_accumulator(&pyramid->acc[i]);
+    }
+    return pyramid;
+}
+
+static FILE* level_file(TracePyramid* pyramid, int level) {
+    if (!pyramid->files[level]) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/level_%02d.bin", pyramid->directory,
+                 level);
+        pyramid->files[level] = fopen(path, "wb");
+        if (!pyramid->files[level]) {
+            fprintf(stderr, "Failed to open trace level %s\n", path);
+            return NULL;
+        }
+        if (level >= pyramid->num_levels) pyramid->num_levels = level + 1;
+    }
+    return pyramid->files[level];
+}
+
+static void write_record(TracePyramid* pyramid, int level, size_t floats) {
+    FILE* file = level_file(pyramid, level);
+    if (file) fwrite(pyramid->record, sizeof(float), floats, file);
+}
+
+void trace_pyramid_push(TracePyramid* pyramid, const double* values) {
+    int channels = pyramid->num_channels;
+    for (int c = 0; c < channels; c++) {
+        pyramid->record[c] = (float)values[c];
+    }
+    write_record(pyramid, 0, channels);
+    pyramid->num_samples++;
+
+    // Fold the sample into level 1 and carry every completed bucket up.
+    // Both halves of a bucket cover equally many samples, so the mean of
+    // the two means is exact.
+    for (int c = 0; c < channels; c++) {
+        TraceAccumulator* acc = &pyramid->acc[channels + c];
+        if (values[c] < acc->min) acc->min = values[c];
+        if (values[c] > acc->max) acc->max = values[c];
+        acc->sum += values[c];
+        acc->count++;
+    }
+    for (int level = 1; level < TRACE_PYRAMID_MAX_LEVELS; level++) {
+        TraceAccumulator* acc = &pyramid->acc[level * channels];
+        if (acc[0].count < 2) break;
+
+        for (int c = 0; c < channels; c++) {
+            double mean = acc[c].sum / acc[c].count;
+            pyramid->record[3 * c] = (float)acc[c].min;
+            pyramid->record[3 * c + 1] = (float)acc[c].max;
+            pyramid->record[3 * c + 2] = (float)mean;
+            if (level + 1 < TRACE_PYRAMID_MAX_LEVELS) {
+                TraceAccumulator* up = &acc[channels + c];
+                if (acc[c].min < up->min) up->min = acc[c].min;
+                if (acc[c].max > up->max) up->max = acc[c].max;
+                up->sum += mean;
+                up->count++;
+            }
+            reset_accumulator(&acc[c]);
+        }
+        write_record(pyramid, level, (size_t)channels * 3);
+        if (level == TRACE_PYRAMID_FLUSH_LEVEL) trace_pyramid_flush(pyramid);
+    }
+}
+
+void trace_pyramid_flush(TracePyramid* pyramid) {
+    for (int level = 0; level < pyramid->num_levels; level++) {
+        if (pyramid->files[level]) fflush(pyramid->files[level]);
+    }
+
+    // Written aside and renamed so readers never see a partial index
+    char path[512], tmp[520];
+    snprintf(path, sizeof(path), "%s/index.txt", pyramid->directory);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* file = fopen(tmp, "w");
+    if (!file) return;
+    fprintf(file, "dt %.17g\n", pyramid->dt);
+    fprintf(file, "samples %llu\n", (unsigned long long)pyramid->num_samples);
+    fprintf(file, "levels %d\n", pyramid->num_levels);
+    fprintf(file, "channels %d\n", pyramid->num_channels);
+    for (int c = 0; c < pyramid->num_channels; c++) {
+        fprintf(file, "channel %s\n", pyramid->channel_names[c]);
+    }
+    fclose(file);
+    rename(tmp, path);
+}
+
+void destroy_trace_pyramid(TracePyramid* pyramid) {
+    if (!pyramid) return;
+    if (pyramid->directory && pyramid->record) trace_pyramid_flush(pyramid);
+    for (int level = 0; level < TRACE_PYRAMID_MAX_LEVELS; level++) {
+        if (pyramid->files[level]) fclose(pyramid->files[level]);
+    }
+    if (pyramid->channel_names) {
+        for (int c = 0; c < pyramid->num_channels; c++) {
+            free(pyramid->channel_names[c]);
+        }
+    }
+    free(pyramid->channel_names);
+    free(pyramid->acc);
+    free(pyramid->record);
+    free(pyramid->directory);
+    free(pyramid);
+}
+
+int trace_pyramid_level_for(uint64_t window_samples, int max_points) {
+    if (max_points < 1) max_points = 1;
+    int level = 0;
+    while (level + 1 < TRACE_PYRAMID_MAX_LEVELS &&
+           (window_samples >> level) > (uint64_t)max_points) {
+        level++;
+    }
+    return level;
+}
+
+long trace_pyramid_read(const char* directory, int level, long first,
+                        long count, int num_channels, float* out) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/level_%02d.bin", directory, level);
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+
+    size_t record = (size_t)num_channels * (level == 0 ? 1 : 3);
+    long read = -1;
+    if (fseek(file, first * (long)(record * sizeof(float)), SEEK_SET) == 0) {
+        read = (long)(fread(out, record * sizeof(float), count, file));
+    }
+    fclose(file);
+    return read;
+}
@@ -0,0 +1,65 @@
+#ifndef NEURAL_TRACE_PYRAMID_H
+#define NEURAL_TRACE_PYRAMID_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Multi-resolution record of scalar traces (population rates, probed
+// voltages) built incrementally while the simulation runs.
+//
+// Level 0 holds the raw samples, one float per channel. Level L >= 1 holds
+// one bucket per 2^L samples with the min, max and mean of every channel,
+// stored as num_channels * 3 floats (min, max, mean). Each level is an
+// append-only file <dir>/level_NN.bin, so bucket k of level L is at offset
+// k * record_size and any window can be served at screen resolution by
+// reading from the coarsest level that still gives enough points.
+// <dir>/index.txt describes the channels and how many samples were written.
+
+#define TRACE_PYRAMID_MAX_LEVELS 32
+
+// Files are flushed whenever a bucket of this level completes, so readers
+// never lag by more than 2^TRACE_PYRAMID_FLUSH_LEVEL samples
+#define TRACE_PYRAMID_FLUSH_LEVEL 12
+
+typedef struct {
+    double min;
+    double max;
+    double sum;  // Sum of bucket means of the level below
+    int count;   // Buckets of the level below folded in so far
+} TraceAccumulator;
+
+typedef struct TracePyramid {
+    char* directory;
+    int num_channels;
+    char** channel_names;
+    double dt;
+    uint64_t num_samples;
+    int num_levels;  // Levels with at least one record
+    FILE* files[TRACE_PYRAMID_MAX_LEVELS];
+    // acc[level * num_channels + channel] for levels 1..MAX_LEVELS-1
+    TraceAccumulator* acc;
+    float* record;  // Scratch record of num_channels * 3 floats
+} TracePyramid;
+
+TracePyramid* create_trace_pyramid(const char* directory,
+                                   const char* const* channel_names,
+                                   int num_channels, double dt);
+void destroy_trace_pyramid(TracePyramid* pyramid);
+
+// Append one sample of every channel
+void trace_pyramid_push(TracePyramid* pyramid, const double* values);
+
+// Flush level files and rewrite the index
+void trace_pyramid_flush(TracePyramid* pyramid);
+
+// Finest level that covers window_samples samples with at most max_points
+// buckets
+int trace_pyramid_level_for(uint64_t window_samples, int max_points);
+
+// Read count records of a level starting at bucket first from a pyramid
+// directory. Level 0 yields num_channels floats per record, higher levels
+// num_channels * 3. Returns the number of records read or -1.
+long trace_pyramid_read(const char* directory, int level, long first,
+                        long count, int num_channels, float* out);
+
+#endif
@@ -0,0 +1,506 @@
+#include "utils/transport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils/spike_bits.h"
+
+static const char* kind_names[NUM_TRANSPORTS] = {"shm", "socket"};
+
+int transport_kind_from_name(const char* name) {
+    for (int k = 0; k < NUM_TRANSPORTS; k++) {
+        if (strcasecmp(name, kind_names[k]) == 0) return k;
+    }
+    return -1;
+}
+
+const char* transport_kind_name(TransportKind kind) {
+    return kind >= 0 && kind < NUM_TRANSPORTS ? kind_names[kind] : "unknown";
+}
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Spins briefly, then yields, then sleeps, so ranks on oversubscribed
+// cores do not starve the one they wait for
+static void backoff(int attempt) {
+    if (attempt < 100) return;
+    if (attempt < 1000) {
+        sched_yield();
+        return;
+    }
+    struct timespec pause = {0, 50000};
+    nanosleep(&pause, NULL);
+}
+
+// ---------------------------------------------------------------------------
+// Window format
+
+_Static_assert(sizeof(SpikeRecord) == sizeof(uint64_t),
+               "bit blocks pack one word per record");
+
+int transport_pack_spikes(const SpikeRecord* spikes, int count, int begin,
+                          int end, SpikeRecord* packed) {
+    size_t words = spike_bits_words(end - begin);
+    int out = 0;
+    for (int first = 0; first < count;) {
+        int last = first;
+        while (last < count && spikes[last].step == spikes[first].step) {
+            last++;
+        }
+        if ((size_t)(last - first) <= 2 + words) {
+            memcpy(packed + out, spikes + first,
+                   (last - first) * sizeof(SpikeRecord));
+            out += last - first;
+        } else {
+            packed[out++] = (SpikeRecord){SPIKE_BITS_MARK, spikes[first].step};
+            packed[out++] = (SpikeRecord){begin, end};
+            uint64_t* bits = (uint64_t*)(packed + out);
+            memset(bits, 0, words * sizeof(uint64_t));
+            for (int s = first; s < last; s++) {
+                spike_bits_set(bits, spikes[s].id - begin);
+            }
+            out += (int)words;
+        }
+        first = last;
+    }
+    return out;
+}
+
+// Without ids, counts each step's spikes into offsets[step + 1]; with ids,
+// writes them from offsets[step] on and advances it. Returns the number
+// of spikes, -1 if the records are malformed.
+static int scan_packed(const SpikeRecord* packed, int count, int steps,
+                       int* offsets, int* ids) {
+    int total = 0;
+    for (int r = 0; r < count;) {
+        int step = packed[r].step;
+        if (step < 0 || step >= steps) return -1;
+        if (packed[r].id != SPIKE_BITS_MARK) {
+            if (ids) ids[offsets[step]++] = packed[r].id;
+            else offsets[step + 1]++;
+            total++;
+            r++;
+            continue;
+        }
+        if (r + 2 > count) return -1;
+        int begin = packed[r + 1].id;
+        int end = packed[r + 1].step;
+        size_t words = spike_bits_words(end - begin);
+        if (begin < 0 || end < begin || (size_t)(count - r - 2) < words) {
+            return -1;
+        }
+        const uint64_t* bits = (const uint64_t*)(packed + r + 2);
+        int n;
+        if (ids) {
+            n = spike_bits_ids(bits, words, begin, ids + offsets[step]);
+            offsets[step] += n;
+        } else {
+            n = (int)spike_bits_count(bits, words);
+            offsets[step + 1] += n;
+        }
+        total += n;
+        r += 2 + (int)words;
+    }
+    return total;
+}
+
+int transport_unpack_spikes(const SpikeRecord* packed, int count, int steps,
+                            int* offsets, int* ids) {
+    memset(offsets, 0, (steps + 1) * sizeof(int));
+    if (scan_packed(packed, count, steps, offsets, NULL) < 0) return -1;
+    for (int j = 0; j < steps; j++) offsets[j + 1] += offsets[j];
+    int total = scan_packed(packed, count, steps, offsets, ids);
+    // Filling advanced every start to the next bucket
+    for (int j = steps; j > 0; j--) offsets[j] = offsets[j - 1];
+    offsets[0] = 0;
+    return total;
+}
+
+// ---------------------------------------------------------------------------
+// Shared memory: one segment holding every rank's send buffer, twice, so a
+// rank may fill the next round's buffer while slower ranks still read the
+// current one
+
+#define SHM_MAGIC 0x4e535850u  // "NSXP"
+
+typedef struct {
+    uint32_t magic;  // Written last by rank 0
+    int32_t num_ranks;
+    int32_t capacity;
+    uint32_t arrived;     // Ranks at the barrier
+    uint32_t generation;  // Barrier rounds completed
+} ShmHeader;
+
+typedef struct {
+    ShmHeader* header;
+    size_t size;
+    int32_t* counts;       // [2][num_ranks]
+    SpikeRecord* records;  // [2][num_ranks][capacity]
+    unsigned round;
+} ShmTransport;
+
+static size_t shm_counts_offset(void) {
+    return (sizeof(ShmHeader) + 63) & ~(size_t)63;
+}
+
+static size_t shm_records_offset(int num_ranks) {
+    return (shm_counts_offset() + 2 * num_ranks * sizeof(int32_t) + 63) &
+           ~(size_t)63;
+}
+
+static int shm_barrier(ShmHeader* header, int num_ranks) {
+    uint32_t generation = __atomic_load_n(&header->generation, __ATOMIC_ACQUIRE);
+    if (__atomic_add_fetch(&header->arrived, 1, __ATOMIC_ACQ_REL) ==
+        (uint32_t)num_ranks) {
+        __atomic_store_n(&header->arrived, 0, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&header->generation, 1, __ATOMIC_RELEASE);
+        return 0;
+    }
+    double deadline = monotonic_seconds() + TRANSPORT_TIMEOUT;
+    for (int attempt = 0;; attempt++) {
+        if (__atomic_load_n(&header->generation, __ATOMIC_ACQUIRE) !=
+            generation) {
+            return 0;
+        }
+        backoff(attempt);
+        if ((attempt & 1023) == 1023 && monotonic_seconds() > deadline) {
+            return -1;
+        }
+    }
+}
+
+static int shm_exchange(SpikeTransport* transport, const SpikeRecord* send,
+                        int count, SpikeRecord* recv) {
+    ShmTransport* shm = transport->impl;
+    int ranks = transport->num_ranks;
+    size_t capacity = transport->capacity;
+    if (count > transport->capacity) return -1;
+
+    int parity = shm->round++ & 1;
+    int32_t* counts = shm->counts + parity * ranks;
+    SpikeRecord* records = shm->records + (size_t)parity * ranks * capacity;
+    memcpy(records + transport->rank * capacity, send,
+           count * sizeof(SpikeRecord));
+    counts[transport->rank] = count;
+    if (shm_barrier(shm->header, ranks) != 0) {
+        fprintf(stderr, "Rank %d timed out waiting for spike exchange\n",
+                transport->rank);
+        return -1;
+    }
+
+    int total = 0;
+    for (int r = 0; r < ranks; r++) {
+        memcpy(recv + total, records + r * capacity,
+               counts[r] * sizeof(SpikeRecord));
+        total += counts[r];
+    }
+    return total;
+}
+
+static void shm_destroy(SpikeTransport* transport) {
+    ShmTransport* shm = transport->impl;
+    if (shm && shm->header) munmap(shm->header, shm->size);
+    free(shm);
+}
+
+static int shm_connect(SpikeTransport* transport, const char* name) {
+    ShmTransport* shm = calloc(1, sizeof(ShmTransport));
+    if (!shm) return -1;
+    transport->impl = shm;
+    int ranks = transport->num_ranks;
+    shm->size = shm_records_offset(ranks) +
+                2 * (size_t)ranks * transport->capacity * sizeof(SpikeRecord);
+
+    int fd;
+    if (transport->rank == 0) {
+        shm_unlink(name);
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, (off_t)shm->size) != 0) {
+            fprintf(stderr, "Failed to create shared memory %s\n", name);
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+    } else {
+        // Wait for rank 0 to create and size the segment
+        double deadline = monotonic_seconds() + TRANSPORT_TIMEOUT;
+        struct stat st;
+        for (int attempt = 0;; attempt++) {
+            fd = shm_open(name, O_RDWR, 0600);
+            if (fd >= 0 && fstat(fd, &st) == 0 &&
+                (size_t)st.st_size >= shm->size) {
+                break;
+            }
+            if (fd >= 0) close(fd);
+            if (monotonic_seconds() > deadline) {
+                fprintf(stderr, "Rank %d found no shared memory %s\n",
+                        transport->rank, name);
+                return -1;
+            }
+            backoff(attempt + 1000);
+        }
+    }
+    void* segment =
+        mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        fprintf(stderr, "Failed to map shared memory %s\n", name);
+        return -1;
+    }
+    shm->header = segment;
+    shm->counts = (int32_t*)((char*)segment + shm_counts_offset());
+    shm->records = (SpikeRecord*)((char*)segment + shm_records_offset(ranks));
+
+    ShmHeader* header = shm->header;
+    if (transport->rank == 0) {
+        header->num_ranks = ranks;
+        header->capacity = transport->capacity;
+        __atomic_store_n(&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    } else {
+        double deadline = monotonic_seconds() + TRANSPORT_TIMEOUT;
+        for (int attempt = 0;
+             __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC;
+             attempt++) {
+            if (monotonic_seconds() > deadline) return -1;
+            backoff(attempt + 1000);
+        }
+        if (header->num_ranks != ranks ||
+            header->capacity != transport->capacity) {
+            fprintf(stderr, "Rank %d disagrees on the layout of %s\n",
+                    transport->rank, name);
+            return -1;
+        }
+    }
+
+    // Once everyone is mapped the name is no longer needed
+    if (shm_barrier(header, ranks) != 0) {
+        fprintf(stderr, "Rank %d timed out waiting for its peers\n",
+                transport->rank);
+        return -1;
+    }
+    if (transport->rank == 0) shm_unlink(name);
+    transport->exchange = shm_exchange;
+    transport->destroy = shm_destroy;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// UNIX sockets: every rank sends its spikes to rank 0, which concatenates
+// them in rank order and sends the result back to all
+
+typedef struct {
+    int* fds;  // Rank 0: connection of each rank (fds[0] unused)
+    int fd;    // Other ranks: connection to rank 0
+} SocketTransport;
+
+static int write_full(int fd, const void* data, size_t size) {
+    const char* p = data;
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void* data, size_t size) {
+    char* p = data;
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static int socket_exchange(SpikeTransport* transport, const SpikeRecord* send,
+                           int count, SpikeRecord* recv) {
+    SocketTransport* sock = transport->impl;
+    if (count > transport->capacity) return -1;
+    int32_t total = count;
+
+    if (transport->rank != 0) {
+        int32_t n = count;
+        if (write_full(sock->fd, &n, sizeof(n)) != 0 ||
+            write_full(sock->fd, send, count * sizeof(SpikeRecord)) != 0 ||
+            read_full(sock->fd, &total, sizeof(total)) != 0 || total < 0 ||
+            total > transport->num_ranks * transport->capacity ||
+            read_full(sock->fd, recv, total * sizeof(SpikeRecord)) != 0) {
+            fprintf(stderr, "Rank %d lost its connection to rank 0\n",
+                    transport->rank);
+            return -1;
+        }
+        return total;
+    }
+
+    memcpy(recv, send, count * sizeof(SpikeRecord));
+    for (int r = 1; r < transport->num_ranks; r++) {
+        int32_t n;
+        if (read_full(sock->fds[r], &n, sizeof(n)) != 0 || n < 0 ||
+            n > transport->capacity ||
+            read_full(sock->fds[r], recv + total, n * sizeof(SpikeRecord)) !=
+                0) {
+            fprintf(stderr, "Rank 0 lost its connection to rank %d\n", r);
+            return -1;
+        }
+        total += n;
+    }
+    for (int r = 1; r < transport->num_ranks; r++) {
+        if (write_full(sock->fds[r], &total, sizeof(total)) != 0 ||
+            write_full(sock->fds[r], recv, total * sizeof(SpikeRecord)) != 0) {
+            fprintf(stderr, "Rank 0 lost its connection to rank %d\n", r);
+            return -1;
+        }
+    }
+    return total;
+}
+
+static void socket_destroy(SpikeTransport* transport) {
+    SocketTransport* sock = transport->impl;
+    if (!sock) return;
+    if (sock->fds) {
+        for (int r = 1; r < transport->num_ranks; r++) {
+            if (sock->fds[r] >= 0) close(sock->fds[r]);
+        }
+        free(sock->fds);
+    }
+    if (sock->fd >= 0) close(sock->fd);
+    free(sock);
+}
+
+static int socket_connect(SpikeTransport* transport, const char* path) {
+    SocketTransport* sock = calloc(1, sizeof(SocketTransport));
+    if (!sock) return -1;
+    sock->fd = -1;
+    transport->impl = sock;
+    transport->destroy = socket_destroy;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    double deadline = monotonic_seconds() + TRANSPORT_TIMEOUT;
+
+    if (transport->rank != 0) {
+        for (int attempt = 0;; attempt++) {
+            sock->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (sock->fd < 0) return -1;
+            if (connect(sock->fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+                break;
+            }
+            close(sock->fd);
+            sock->fd = -1;
+            if (monotonic_seconds() > deadline) {
+                fprintf(stderr, "Rank %d could not connect to %s\n",
+                        transport->rank, path);
+                return -1;
+            }
+            backoff(attempt + 1000);
+        }
+        int32_t rank = transport->rank;
+        if (write_full(sock->fd, &rank, sizeof(rank)) != 0) return -1;
+        transport->exchange = socket_exchange;
+        return 0;
+    }
+
+    sock->fds = malloc(transport->num_ranks * sizeof(int));
+    if (!sock->fds) return -1;
+    for (int r = 0; r < transport->num_ranks; r++) sock->fds[r] = -1;
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listener, transport->num_ranks) != 0) {
+        fprintf(stderr, "Failed to listen on %s\n", path);
+        if (listener >= 0) close(listener);
+        return -1;
+    }
+
+    // Peers identify themselves, so they may connect in any order
+    int status = 0;
+    for (int accepted = 1; accepted < transport->num_ranks && status == 0;
+         accepted++) {
+        struct pollfd pfd = {listener, POLLIN, 0};
+        int wait_ms = (int)((deadline - monotonic_seconds()) * 1000.0);
+        int32_t rank = -1;
+        int fd = -1;
+        if (wait_ms <= 0 || poll(&pfd, 1, wait_ms) <= 0 ||
+            (fd = accept(listener, NULL, NULL)) < 0 ||
+            read_full(fd, &rank, sizeof(rank)) != 0 || rank <= 0 ||
+            rank >= transport->num_ranks || sock->fds[rank] >= 0) {
+            fprintf(stderr, "Rank 0 timed out waiting for its peers\n");
+            if (fd >= 0) close(fd);
+            status = -1;
+        } else {
+            sock->fds[rank] = fd;
+        }
+    }
+    close(listener);
+    unlink(path);
+    transport->exchange = socket_exchange;
+    return status;
+}
+
+SpikeTransport* create_transport(TransportKind kind, const char* name,
+                                 int rank, int num_ranks, int capacity) {
+    if (num_ranks < 1 || rank < 0 || rank >= num_ranks || capacity < 0) {
+        fprintf(stderr, "Invalid transport rank %d of %d\n", rank, num_ranks);
+        return NULL;
+    }
+    SpikeTransport* transport = calloc(1, sizeof(SpikeTransport));
+    if (!transport) {
+        fprintf(stderr, "Failed to allocate spike transport\n");
+        return NULL;
+    }
+    transport->kind = kind;
+    transport->rank = rank;
+    transport->num_ranks = num_ranks;
+    transport->capacity = capacity;
+
+    int status;
+    switch (kind) {
+        case TRANSPORT_SHM:
+            transport->destroy = shm_destroy;
+            status = shm_connect(transport, name);
+            break;
+        case TRANSPORT_SOCKET:
+            status = socket_connect(transport, name);
+            break;
+        default:
+            fprintf(stderr, "Unknown transport %d\n", kind);
+            status = -1;
+    }
+    if (status != 0) {
+        destroy_transport(transport);
+        return NULL;
+    }
+    return transport;
+}
+
+void destroy_transport(SpikeTransport* transport) {
+    if (!transport) return;
+    if (transport->destroy) transport->destroy(transport);
+    free(transport);
+}
@@ -0,0 +1,73 @@
+#ifndef NEURAL_TRANSPORT_H
+#define NEURAL_TRANSPORT_H
+
+#include <stdint.h>
+
+// Spike exchange between the ranks of a partitioned simulation. Every rank
+// contributes the spikes of its own neurons for one exchange window and
+// receives the spikes of all ranks, concatenated in rank order. The
+// exchange is collective: it returns once every rank has contributed.
+//
+// Backends implement the two operations below; shared memory and UNIX
+// sockets are built in, and anything that can move bytes between hosts
+// fits the same interface.
+
+typedef enum {
+    TRANSPORT_SHM = 0,  // One POSIX shared memory segment and a spin barrier
+    TRANSPORT_SOCKET,   // UNIX stream sockets gathered at rank 0
+    NUM_TRANSPORTS
+} TransportKind;
+
+typedef struct {
+    int32_t id;    // Global (storage) id of the neuron
+    int32_t step;  // Step within the exchange window
+} SpikeRecord;
+
+typedef struct SpikeTransport {
+    TransportKind kind;
+    int rank;
+    int num_ranks;
+    int capacity;  // Records a single rank may send per exchange
+
+    // Sends count records and fills recv (num_ranks * capacity records)
+    // with everyone's; returns the number received or -1 on failure
+    int (*exchange)(struct SpikeTransport* transport, const SpikeRecord* send,
+                    int count, SpikeRecord* recv);
+    void (*destroy)(struct SpikeTransport* transport);
+    void* impl;
+} SpikeTransport;
+
+// Format of a rank's spikes of a window. Each step's spikes are either
+// records {id, step} in ascending id order or, where that is shorter, a
+// bit block: a record {SPIKE_BITS_MARK, step}, a record {begin, end} with
+// the rank's neuron range, and one bit per neuron of the range, 64
+// neurons to a record. Dense steps thus cost (end - begin) / 64 records
+// instead of one per spike.
+#define SPIKE_BITS_MARK (-1)
+
+// Packs count records of neurons [begin, end), ordered by step, into
+// packed; returns the packed count, which is at most count
+int transport_pack_spikes(const SpikeRecord* spikes, int count, int begin,
+                          int end, SpikeRecord* packed);
+
+// Sorts count packed records of a window of steps steps by step: ids
+// receives them with step j's in [offsets[j], offsets[j + 1]), in the
+// order they were packed. Returns the number of ids, -1 if the records
+// are malformed.
+int transport_unpack_spikes(const SpikeRecord* packed, int count, int steps,
+                            int* offsets, int* ids);
+
+int transport_kind_from_name(const char* name);
+const char* transport_kind_name(TransportKind kind);
+
+// Connects rank to the others under name (a shared memory name for
+// TRANSPORT_SHM, a socket path for TRANSPORT_SOCKET). Rank 0 creates the
+// rendezvous; the other ranks wait up to TRANSPORT_TIMEOUT seconds for it.
+SpikeTransport* create_transport(TransportKind kind, const char* name,
+                                 int rank, int num_ranks, int capacity);
+void destroy_transport(SpikeTransport* transport);
+
+// Seconds a rank waits for its peers before giving up
+#define TRANSPORT_TIMEOUT 30.0
+
+#endif
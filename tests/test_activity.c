@@ -0,0 +1,71 @@
+#include <unity.h>
+#include "../src/core/activity.h"
+#include "../src/utils/random.h"
+
+#define GROUP 200
+#define WINDOWS 400
+
+static const int first_id[2] = {0, GROUP};
+static const int count[2] = {GROUP, GROUP};
+static ActivityMonitor* monitor;
+
+void setUp(void) {
+    monitor = create_activity_monitor(first_id, count, 2, 5);
+    TEST_ASSERT_NOT_NULL(monitor);
+}
+
+void tearDown(void) {
+    destroy_activity_monitor(monitor);
+}
+
+// One window of neurons firing in its middle step, the rest silent
+static void record_window(const int* ids, int n) {
+    for (int step = 0; step < monitor->window_steps; step++) {
+        activity_record(monitor, ids, step == 2 ? n : 0);
+    }
+}
+
+void test_independent_firing(void) {
+    RandomState rng;
+    init_random(&rng, 3);
+    int ids[2 * GROUP];
+    for (int w = 0; w < WINDOWS; w++) {
+        int n = 0;
+        for (int i = 0; i < 2 * GROUP; i++) {
+            if (random_uniform(&rng) < 0.1) ids[n++] = i;
+        }
+        record_window(ids, n);
+    }
+    TEST_ASSERT_EQUAL_INT(WINDOWS, (int)monitor->totals.windows);
+    for (int g = 0; g < 2; g++) {
+        TEST_ASSERT_DOUBLE_WITHIN(0.2, 0.9, activity_synchrony(monitor, g));
+        TEST_ASSERT_DOUBLE_WITHIN(0.03, 0.1, activity_overlap(monitor, g));
+    }
+    TEST_ASSERT_DOUBLE_WITHIN(0.15, 0.0, activity_correlation(monitor, 0, 1));
+}
+
+void test_synchronous_assembly(void) {
+    // The same 50 neurons of each group fire together every other window
+    int ids[100];
+    for (int i = 0; i < 50; i++) {
+        ids[i] = i;
+        ids[50 + i] = GROUP + i;
+    }
+    for (int w = 0; w < WINDOWS; w++) record_window(ids, w % 2 ? 0 : 100);
+
+    // Counts alternate between 0 and 50: variance 625 over mean 25
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 25.0, activity_synchrony(monitor, 0));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 1.0, activity_correlation(monitor, 0, 1));
+    // Successive windows never share neurons here; every window does
+    // once the assembly fires each time
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, activity_overlap(monitor, 0));
+    for (int w = 0; w < WINDOWS; w++) record_window(ids, 100);
+    TEST_ASSERT_TRUE(activity_overlap(monitor, 0) > 0.99);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_independent_firing);
+    RUN_TEST(test_synchronous_assembly);
+    return UNITY_END();
+}
@@ -0,0 +1,781 @@
+#include <unity.h>
+#include <fcntl.h>
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../include/neural_sim.h"
+#include "../src/core/network.h"
+#include "../src/utils/live_view.h"
+#include "../src/utils/npy.h"
+#include "../src/utils/probe.h"
+
+static const char* test_config =
+    "num_pyramidal = 40\n"
+    "num_inhibitory = 10\n"
+    "dt = 0.1\n"
+    "simulation_time = 20.0\n"
+    "connection_rate = 0.1\n"
+    "random_seed = 7\n"
+    "save_interval = 0\n"
+    "background_sources = 100\n"
+    "background_rate = 10.0\n"
+    "background_weight = 2.0\n"
+    "output_dir = test_output\n";
+
+static int progress_calls;
+
+void setUp(void) { progress_calls = 0; }
+
+void tearDown(void) {}
+
+static void count_progress(double progress, void* user_data) {
+    (void)progress;
+    (void)user_data;
+    progress_calls++;
+}
+
+static void stop_in_callback(const NeuralSimulation* sim, void* user_data) {
+    (void)user_data;
+    ns_stop((NeuralSimulation*)sim);
+}
+
+void test_run_advances_time(void) {
+    SimulationCallbacks callbacks = {0};
+    callbacks.progress_cb = count_progress;
+    callbacks.progress_interval = 1.0;
+
+    NeuralSimulation* sim = ns_init_from_string(test_config, &callbacks);
+    TEST_ASSERT_NOT_NULL(sim);
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_run(sim, 5.0));
+    TEST_ASSERT_EQUAL_INT(50, (int)sim->step_count);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 5.0, sim->current_time);
+    TEST_ASSERT_EQUAL_INT(5, progress_calls);
+
+    // -1 runs to the configured end
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_run(sim, -1));
+    TEST_ASSERT_EQUAL_INT(200, (int)sim->step_count);
+    ns_stop(sim);
+}
+
+// Copies a file without its last cut bytes
+static void copy_cut(const char* from, const char* to, long cut) {
+    FILE* in = fopen(from, "rb");
+    FILE* out = fopen(to, "wb");
+    TEST_ASSERT_NOT_NULL(in);
+    TEST_ASSERT_NOT_NULL(out);
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    rewind(in);
+    for (long k = 0; k < size - cut; k++) fputc(fgetc(in), out);
+    fclose(in);
+    fclose(out);
+}
+
+static char* network_state(const Network* net, size_t* size) {
+    char* data = NULL;
+    FILE* file = open_memstream(&data, size);
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_INT(0, save_network_checkpoint(net, file));
+    fclose(file);
+    return data;
+}
+
+// A load that fails must leave the whole network as it was
+static void assert_load_fails(NeuralSimulation* sim, const char* path,
+                              int error) {
+    size_t before_size, after_size;
+    char* before = network_state(sim->network, &before_size);
+    double time = sim->current_time;
+    TEST_ASSERT_EQUAL_INT(error, ns_load_state(sim, path));
+    char* after = network_state(sim->network, &after_size);
+    TEST_ASSERT_EQUAL_INT((int)before_size, (int)after_size);
+    TEST_ASSERT_EQUAL_MEMORY(before, after, before_size);
+    TEST_ASSERT_EQUAL_DOUBLE(time, sim->current_time);
+    free(before);
+    free(after);
+}
+
+void test_state_roundtrip_is_deterministic(void) {
+    NeuralSimulation* a = ns_init_from_string(test_config, NULL);
+    NeuralSimulation* b = ns_init_from_string(test_config, NULL);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+
+    ns_run(a, 5.0);
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_save_state(a, "test_output/api.bin"));
+    copy_cut("test_output/api.bin", "test_output/api_cut.bin", 1000);
+    assert_load_fails(b, "test_output/api_cut.bin", NS_ERROR_FILE);
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_load_state(b, "test_output/api.bin"));
+    TEST_ASSERT_EQUAL_DOUBLE(a->current_time, b->current_time);
+
+    ns_run(a, 5.0);
+    ns_run(b, 5.0);
+    NetworkStatistics sa, sb;
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_calculate_statistics(a, &sa));
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_calculate_statistics(b, &sb));
+    TEST_ASSERT_EQUAL_INT((int)sa.spikes_pyramidal, (int)sb.spikes_pyramidal);
+    TEST_ASSERT_EQUAL_DOUBLE(sa.mean_membrane_potential,
+                             sb.mean_membrane_potential);
+    TEST_ASSERT_EQUAL_DOUBLE(sa.synchrony_pyramidal, sb.synchrony_pyramidal);
+    TEST_ASSERT_EQUAL_DOUBLE(sa.overlap_pyramidal, sb.overlap_pyramidal);
+    ns_stop(a);
+    ns_stop(b);
+}
+
+void test_periodic_checkpoints_restore(void) {
+    char config[1024];
+    snprintf(config, sizeof(config),
+             "%scheckpoint_interval = 5.0\ncheckpoint_incremental = true\n",
+             test_config);
+    NeuralSimulation* a = ns_init_from_string(config, NULL);
+    NeuralSimulation* b = ns_init_from_string(test_config, NULL);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_run(a, 20.0));
+    NetworkStatistics sa, sb;
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_calculate_statistics(a, &sa));
+    TEST_ASSERT_EQUAL_INT(4, (int)sa.checkpoints);
+
+    // The last checkpoint is a delta on the earlier ones
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS,
+                          ns_load_state(b, "test_output/checkpoint_200.bin"));
+    TEST_ASSERT_EQUAL_DOUBLE(a->current_time, b->current_time);
+    ns_run(a, 5.0);
+    ns_run(b, 5.0);
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_calculate_statistics(a, &sa));
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_calculate_statistics(b, &sb));
+    TEST_ASSERT_EQUAL_DOUBLE(sa.mean_membrane_potential,
+                             sb.mean_membrane_potential);
+    ns_stop(a);
+    ns_stop(b);
+}
+
+void test_dendritic_state_roundtrip(void) {
+    char config[1024];
+    snprintf(config, sizeof(config),
+             "%snum_dendrites = 3\ndendrite_compartments = 5\n"
+             "dendrite_soma_ratio = 0.05\n",
+             test_config);
+    NeuralSimulation* a = ns_init_from_string(config, NULL);
+    NeuralSimulation* b = ns_init_from_string(config, NULL);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL_INT(15, a->network->morphology->num_compartments);
+
+    ns_run(a, 5.0);
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_save_state(a, "test_output/dend.bin"));
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_load_state(b, "test_output/dend.bin"));
+    ns_run(a, 5.0);
+    ns_run(b, 5.0);
+
+    // The cables load the somata, so they must be restored too
+    const CableState* ca = a->network->cable;
+    const CableState* cb = b->network->cable;
+    for (int i = 0; i < 15; i++) {
+        TEST_ASSERT_EQUAL_DOUBLE(*cable_voltage(ca, i, 7),
+                                 *cable_voltage(cb, i, 7));
+    }
+    TEST_ASSERT_TRUE(*cable_voltage(ca, 0, 7) != *cable_voltage(ca, 4, 7));
+    NetworkStatistics sa, sb;
+    ns_calculate_statistics(a, &sa);
+    ns_calculate_statistics(b, &sb);
+    TEST_ASSERT_EQUAL_DOUBLE(sa.mean_membrane_potential,
+                             sb.mean_membrane_potential);
+    ns_stop(a);
+    ns_stop(b);
+}
+
+void test_rewired_state_roundtrip(void) {
+    char config[1024];
+    snprintf(config, sizeof(config),
+             "%sstdp = true\nreward_learning = true\n"
+             "structural_plasticity = true\nstructural_interval = 1.0\n"
+             "structural_prune_weight = 0.02\nstructural_prune_checks = 1\n"
+             "structural_formation_rate = 200.0\n",
+             test_config);
+    NeuralSimulation* a = ns_init_from_string(config, NULL);
+    NeuralSimulation* b = ns_init_from_string(config, NULL);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+
+    // The checkpoint carries a layout that differs from b's
+    ns_run(a, 5.0);
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_save_state(a, "test_output/wire.bin"));
+
+    // A checkpoint cut short after its layout leaves b as it was
+    copy_cut("test_output/wire.bin", "test_output/wire_cut.bin", 8);
+    const Connectivity* conn = b->network->connectivity;
+    assert_load_fails(b, "test_output/wire_cut.bin", NS_ERROR_FILE);
+    TEST_ASSERT_TRUE(conn == b->network->connectivity);
+
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_load_state(b, "test_output/wire.bin"));
+    TEST_ASSERT_TRUE(conn != b->network->connectivity);
+    ns_run(a, 5.0);
+    ns_run(b, 5.0);
+    const StructuralState* structural = a->network->structural;
+    TEST_ASSERT_GREATER_THAN(0, (int)structural->pruned);
+    TEST_ASSERT_GREATER_THAN(0, (int)structural->formed);
+    TEST_ASSERT_EQUAL_INT((int)structural->formed,
+                          (int)b->network->structural->formed);
+
+    NetworkStatistics sa, sb;
+    ns_calculate_statistics(a, &sa);
+    ns_calculate_statistics(b, &sb);
+    TEST_ASSERT_EQUAL_INT(sa.num_synapses, sb.num_synapses);
+    TEST_ASSERT_EQUAL_INT((int)sa.spikes_pyramidal, (int)sb.spikes_pyramidal);
+    TEST_ASSERT_EQUAL_DOUBLE(sa.mean_weight, sb.mean_weight);
+    ns_stop(a);
+    ns_stop(b);
+}
+
+void test_stop_from_callback(void) {
+    SimulationCallbacks callbacks = {0};
+    callbacks.state_cb = stop_in_callback;
+    callbacks.save_interval = 2.0;
+
+    NeuralSimulation* sim = ns_init_from_string(test_config, &callbacks);
+    TEST_ASSERT_NOT_NULL(sim);
+    // The simulation is released when ns_run returns
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_run(sim, -1));
+}
+
+static void check_live_view(const char* blocking) {
+    char config[1024];
+    snprintf(config, sizeof(config),
+             "%slive_view = /ns_test_live\ntemporal_blocking = %s\n",
+             test_config, blocking);
+    NeuralSimulation* sim = ns_init_from_string(config, NULL);
+    TEST_ASSERT_NOT_NULL(sim);
+    ns_run(sim, 10.0);
+
+    int fd = shm_open("/ns_test_live", O_RDONLY, 0);
+    TEST_ASSERT_TRUE(fd >= 0);
+    const LiveViewHeader* shared =
+        mmap(NULL, sizeof(LiveViewHeader), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    LiveViewHeader header;
+    TEST_ASSERT_EQUAL_INT(0, live_view_read_header(shared, &header, 100));
+    TEST_ASSERT_EQUAL_UINT64(LIVE_VIEW_MAGIC, header.magic);
+    TEST_ASSERT_EQUAL_INT(100, (int)header.step);
+    TEST_ASSERT_EQUAL_INT(0, (int)(header.sequence & 1));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 10.0, header.time);
+    TEST_ASSERT_EQUAL_INT(50, (int)header.num_neurons);
+
+    NetworkStatistics stats;
+    ns_calculate_statistics(sim, &stats);
+    TEST_ASSERT_EQUAL_INT((int)stats.spikes_pyramidal,
+                          (int)header.total_spikes[0]);
+
+    munmap((void*)shared, sizeof(LiveViewHeader));
+    ns_stop(sim);
+}
+
+void test_live_view_publishes_snapshots(void) {
+    check_live_view("false");
+    // Every step of a block is published
+    check_live_view("true");
+}
+
+static long file_size(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+void test_probe_records_selected_columns(void) {
+    NeuralSimulation* sim = ns_init_from_string(test_config, NULL);
+    TEST_ASSERT_NOT_NULL(sim);
+    int ids[3] = {0, 5, 45};
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS,
+                          ns_add_probe(sim, "few", ids, 3,
+                                       NS_PROBE_V | NS_PROBE_CALCIUM, 1.0));
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS,
+                          ns_add_probe_spec(sim, "inh inhibitory V 0.5"));
+    TEST_ASSERT_NOT_EQUAL(NS_SUCCESS,
+                          ns_add_probe_spec(sim, "bad 0-99 V 1.0"));
+    ns_run(sim, 10.0);
+
+    // 10 samples of 3 neurons, 20 samples of 10 neurons, after the header
+    const long h = NPY_HEADER_SIZE;
+    TEST_ASSERT_EQUAL_INT(h + 10 * 8, file_size("test_output/probes/few_time.npy"));
+    TEST_ASSERT_EQUAL_INT(h + 10 * 3 * 4, file_size("test_output/probes/few_V.npy"));
+    TEST_ASSERT_EQUAL_INT(h + 10 * 3 * 4, file_size("test_output/probes/few_Ca.npy"));
+    TEST_ASSERT_EQUAL_INT(-1, file_size("test_output/probes/few_adaptation.npy"));
+    TEST_ASSERT_EQUAL_INT(h + 20 * 10 * 4, file_size("test_output/probes/inh_V.npy"));
+
+    char header[NPY_HEADER_SIZE + 1] = {0};
+    FILE* file = fopen("test_output/probes/few_V.npy", "rb");
+    TEST_ASSERT_EQUAL_INT(1, (int)fread(header, NPY_HEADER_SIZE, 1, file));
+    fclose(file);
+    TEST_ASSERT_NOT_NULL(strstr(header + 10, "'descr': '<f4'"));
+    TEST_ASSERT_NOT_NULL(strstr(header + 10, "'shape': (10, 3)"));
+    TEST_ASSERT_EQUAL_INT('\n', header[NPY_HEADER_SIZE - 1]);
+
+    float last[3];
+    file = fopen("test_output/probes/few_V.npy", "rb");
+    fseek(file, -(long)sizeof(last), SEEK_END);
+    TEST_ASSERT_EQUAL_INT(3, (int)fread(last, sizeof(float), 3, file));
+    fclose(file);
+    const Neuron* probed = network_neuron(sim->network, 45);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, probed->membrane_potential, last[2]);
+    ns_stop(sim);
+}
+
+void test_probe_slices_match_neurons(void) {
+    // Large enough for one slice per thread
+    enum { COUNT = PROBE_PARALLEL_MIN + 100 };
+    static Neuron neurons[COUNT];
+    static int ids[COUNT];
+    Network net;
+    memset(&net, 0, sizeof(net));
+    net.config.num_pyramidal = COUNT;
+    net.config.dt = 0.1;
+    net.pyramidal_neurons = neurons;
+    for (int i = 0; i < COUNT; i++) {
+        neurons[i].membrane_potential = i;
+        ids[i] = COUNT - 1 - i;
+    }
+
+    ProbeSet* set = create_probe_set("test_output", 4, false);
+    TEST_ASSERT_NOT_NULL(set);
+    TEST_ASSERT_EQUAL_INT(0, probe_set_add(set, &net, "slices", ids, COUNT,
+                                           PROBE_VARIABLE_BIT(PROBE_V), 0.1));
+    TEST_ASSERT_EQUAL_INT(4, set->probes[0].num_slices);
+    probe_set_sample(set, &net, 0, 0.0);
+    destroy_probe_set(set);
+
+    static float row[COUNT];
+    FILE* file = fopen("test_output/slices_V.npy", "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, NPY_HEADER_SIZE, SEEK_SET);
+    TEST_ASSERT_EQUAL_INT(COUNT, (int)fread(row, sizeof(float), COUNT, file));
+    fclose(file);
+    for (int i = 0; i < COUNT; i++) {
+        TEST_ASSERT_EQUAL_DOUBLE((double)ids[i], row[i]);
+    }
+}
+
+void test_probe_traces_follow_samples(void) {
+    static Neuron neurons[3];
+    const int ids[2] = {2, 0};
+    Network net;
+    memset(&net, 0, sizeof(net));
+    net.config.num_pyramidal = 3;
+    net.config.dt = 0.1;
+    net.pyramidal_neurons = neurons;
+
+    ProbeSet* set = create_probe_set("test_output", 1, true);
+    TEST_ASSERT_NOT_NULL(set);
+    unsigned variables =
+        PROBE_VARIABLE_BIT(PROBE_V) | PROBE_VARIABLE_BIT(PROBE_CALCIUM);
+    TEST_ASSERT_EQUAL_INT(0, probe_set_add(set, &net, "traced", ids, 2,
+                                           variables, 0.2));
+    for (int step = 0; step < 16; step++) {
+        for (int i = 0; i < 3; i++) {
+            neurons[i].membrane_potential = step * 10 + i;
+            neurons[i].calcium_concentration = -step;
+        }
+        probe_set_sample(set, &net, step, step * 0.1);
+    }
+    destroy_probe_set(set);
+
+    // Channels V_2, V_0, Ca_2, Ca_0 of the eight samples (every 2nd step)
+    float raw[8 * 4];
+    TEST_ASSERT_EQUAL_INT(8, trace_pyramid_read("test_output/traced_traces",
+                                                0, 0, 8, 4, raw));
+    TEST_ASSERT_EQUAL_DOUBLE(42.0, raw[4 * 2 + 0]);
+    TEST_ASSERT_EQUAL_DOUBLE(40.0, raw[4 * 2 + 1]);
+    TEST_ASSERT_EQUAL_DOUBLE(-4.0, raw[4 * 2 + 3]);
+
+    // The top bucket: min, max and mean of V_2 over the whole recording
+    float top[4 * 3];
+    TEST_ASSERT_EQUAL_INT(1, trace_pyramid_read("test_output/traced_traces",
+                                                3, 0, 1, 4, top));
+    TEST_ASSERT_EQUAL_DOUBLE(2.0, top[0]);
+    TEST_ASSERT_EQUAL_DOUBLE(142.0, top[1]);
+    TEST_ASSERT_EQUAL_DOUBLE(72.0, top[2]);
+}
+
+void test_export_npz_members(void) {
+    char config[1024];
+    snprintf(config, sizeof(config), "%srecord_spikes = true\n", test_config);
+    NeuralSimulation* sim = ns_init_from_string(config, NULL);
+    TEST_ASSERT_NOT_NULL(sim);
+    ns_add_probe_spec(sim, "exc pyramidal V 1.0");
+    ns_run(sim, 5.0);
+
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS,
+                          ns_export_data(sim, "npz", "test_output/run.npz"));
+    TEST_ASSERT_EQUAL_INT(NS_ERROR_PARAM,
+                          ns_export_data(sim, "hdf5", "test_output/run.h5"));
+
+    // End of central directory: 10 members (4 weight arrays, sizes, two
+    // spike columns, three probe columns)
+    unsigned char end[22];
+    FILE* file = fopen("test_output/run.npz", "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, -(long)sizeof(end), SEEK_END);
+    TEST_ASSERT_EQUAL_INT(1, (int)fread(end, sizeof(end), 1, file));
+    fclose(file);
+    TEST_ASSERT_EQUAL_INT(0x06054b50, end[0] | end[1] << 8 | end[2] << 16 |
+                                          (unsigned)end[3] << 24);
+    TEST_ASSERT_EQUAL_INT(10, end[10] | end[11] << 8);
+    ns_stop(sim);
+}
+
+static int files_equal(const char* a, const char* b) {
+    FILE* fa = fopen(a, "rb");
+    FILE* fb = fopen(b, "rb");
+    int equal = fa && fb;
+    while (equal) {
+        int ca = fgetc(fa), cb = fgetc(fb);
+        if (ca != cb) equal = 0;
+        if (ca == EOF || cb == EOF) break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return equal;
+}
+
+void test_async_output_matches_inline(void) {
+    const char* modes[2] = {"true", "false"};
+    const char* dirs[2] = {"test_output/async", "test_output/inline"};
+    NetworkStatistics stats[2];
+    for (int m = 0; m < 2; m++) {
+        char config[1024];
+        snprintf(config, sizeof(config),
+                 "%srecord_spikes = true\nrecord_traces = true\n"
+                 "save_interval = 10\nasync_output = %s\noutput_dir = %s\n",
+                 test_config, modes[m], dirs[m]);
+        NeuralSimulation* sim = ns_init_from_string(config, NULL);
+        TEST_ASSERT_NOT_NULL(sim);
+        ns_run(sim, 10.0);
+        ns_calculate_statistics(sim, &stats[m]);
+        ns_stop(sim);
+    }
+
+    TEST_ASSERT_TRUE(files_equal("test_output/async/spike_ids.npy",
+                                 "test_output/inline/spike_ids.npy"));
+    TEST_ASSERT_TRUE(files_equal("test_output/async/spike_times.npy",
+                                 "test_output/inline/spike_times.npy"));
+    TEST_ASSERT_TRUE(files_equal("test_output/async/traces/level_00.bin",
+                                 "test_output/inline/traces/level_00.bin"));
+    TEST_ASSERT_TRUE(files_equal("test_output/async/network_state_9.000.txt",
+                                 "test_output/inline/network_state_9.000.txt"));
+    // Writing inline blocks the simulation on every step
+    TEST_ASSERT_EQUAL_INT(100, (int)stats[1].output_stalls);
+    TEST_ASSERT_TRUE(stats[0].output_stalls <= 100);
+}
+
+void test_reordered_export_uses_creation_order(void) {
+    const char* methods[2] = {"none", "rcm"};
+    const char* dirs[2] = {"test_output/plain", "test_output/rcm"};
+    for (int m = 0; m < 2; m++) {
+        char config[1024];
+        snprintf(config, sizeof(config), "%sreorder = %s\noutput_dir = %s\n",
+                 test_config, methods[m], dirs[m]);
+        NeuralSimulation* sim = ns_init_from_string(config, NULL);
+        TEST_ASSERT_NOT_NULL(sim);
+        TEST_ASSERT_EQUAL_INT(m == 1, sim->network->external_id != NULL);
+        char path[256];
+        snprintf(path, sizeof(path), "%s/export", dirs[m]);
+        TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_export_data(sim, "npy", path));
+        ns_stop(sim);
+    }
+
+    const char* members[4] = {"weights_indptr", "weights_indices",
+                              "weights_data", "weights"};
+    for (int i = 0; i < 4; i++) {
+        char a[256], b[256];
+        snprintf(a, sizeof(a), "test_output/plain/export/%s.npy", members[i]);
+        snprintf(b, sizeof(b), "test_output/rcm/export/%s.npy", members[i]);
+        TEST_ASSERT_TRUE(files_equal(a, b));
+    }
+}
+
+void test_results_independent_of_thread_count(void) {
+    const int threads[2] = {1, 4};
+    const char* dirs[2] = {"test_output/serial", "test_output/parallel"};
+    int saved = omp_get_max_threads();
+    for (int m = 0; m < 2; m++) {
+        char config[1024];
+        snprintf(config, sizeof(config),
+                 "%srecord_spikes = true\nnum_dendrites = 3\n"
+                 "stdp = true\noutput_dir = %s\n",
+                 test_config, dirs[m]);
+        omp_set_num_threads(threads[m]);
+        NeuralSimulation* sim = ns_init_from_string(config, NULL);
+        omp_set_num_threads(saved);
+        TEST_ASSERT_NOT_NULL(sim);
+        TEST_ASSERT_EQUAL_INT(NS_SUCCESS,
+                              ns_add_probe_spec(sim, "dend 0-1,45 dendritic 1.0"));
+        ns_run(sim, 10.0);
+
+        double busy[4], idle[4];
+        TEST_ASSERT_EQUAL_INT(threads[m],
+                              ns_get_thread_times(sim, busy, idle, 4));
+        TEST_ASSERT_TRUE(busy[0] > 0.0);
+        NetworkStatistics stats;
+        ns_calculate_statistics(sim, &stats);
+        TEST_ASSERT_TRUE(stats.load_imbalance >= 1.0);
+        ns_stop(sim);
+    }
+
+    TEST_ASSERT_TRUE(files_equal("test_output/serial/spike_ids.npy",
+                                 "test_output/parallel/spike_ids.npy"));
+    TEST_ASSERT_TRUE(files_equal("test_output/serial/probes/dend_dendritic.npy",
+                                 "test_output/parallel/probes/dend_dendritic.npy"));
+
+    // Pyramidal neurons carry dendrites, inhibitory ones do not
+    float last[3];
+    FILE* file = fopen("test_output/serial/probes/dend_dendritic.npy", "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, -(long)sizeof(last), SEEK_END);
+    TEST_ASSERT_EQUAL_INT(3, (int)fread(last, sizeof(float), 3, file));
+    fclose(file);
+    TEST_ASSERT_FALSE(isnan(last[0]));
+    TEST_ASSERT_FALSE(isnan(last[1]));
+    TEST_ASSERT_TRUE(isnan(last[2]));
+}
+
+void test_temporal_blocking_matches_single_steps(void) {
+    const char* modes[2] = {"false", "true"};
+    const char* dirs[2] = {"test_output/steps", "test_output/blocks"};
+    for (int m = 0; m < 2; m++) {
+        char config[1024];
+        snprintf(config, sizeof(config),
+                 "%srecord_spikes = true\nsave_interval = 3\nstdp = true\n"
+                 "temporal_blocking = %s\noutput_dir = %s\n",
+                 test_config, modes[m], dirs[m]);
+        NeuralSimulation* sim = ns_init_from_string(config, NULL);
+        TEST_ASSERT_NOT_NULL(sim);
+        TEST_ASSERT_EQUAL_INT(NS_SUCCESS,
+                              ns_add_probe_spec(sim, "v 0-9,45 V 0.7"));
+        // Run ends and probe samples cut blocks short of the delay
+        TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_run(sim, 4.5));
+        TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_run(sim, 5.5));
+        TEST_ASSERT_EQUAL_INT(100, (int)sim->step_count);
+        char path[256];
+        snprintf(path, sizeof(path), "%s/export", dirs[m]);
+        TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_export_data(sim, "npy", path));
+        ns_stop(sim);
+    }
+
+    TEST_ASSERT_TRUE(files_equal("test_output/steps/spike_ids.npy",
+                                 "test_output/blocks/spike_ids.npy"));
+    TEST_ASSERT_TRUE(files_equal("test_output/steps/spike_times.npy",
+                                 "test_output/blocks/spike_times.npy"));
+    TEST_ASSERT_TRUE(files_equal("test_output/steps/probes/v_V.npy",
+                                 "test_output/blocks/probes/v_V.npy"));
+    TEST_ASSERT_TRUE(files_equal("test_output/steps/network_state_9.000.txt",
+                                 "test_output/blocks/network_state_9.000.txt"));
+    TEST_ASSERT_TRUE(files_equal("test_output/steps/export/weights_data.npy",
+                                 "test_output/blocks/export/weights_data.npy"));
+}
+
+// Array data of a 1-d .npy file, count receives its length
+static void* read_npy(const char* path, size_t item, int* count) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file) - NPY_HEADER_SIZE;
+    fseek(file, NPY_HEADER_SIZE, SEEK_SET);
+    void* data = malloc(size > 0 ? size : 1);
+    *count = (int)(size / (long)item);
+    if (fread(data, item, *count, file) != (size_t)*count) *count = -1;
+    fclose(file);
+    return data;
+}
+
+static void drive_last_trial(int trial, double* current, int num_neurons,
+                             void* user_data) {
+    (void)user_data;
+    for (int id = 0; trial == 3 && id < 10 && id < num_neurons; id++) {
+        current[id] = 5.0;
+    }
+}
+
+void test_batched_trials_match_single_run(void) {
+    char config[1024];
+    snprintf(config, sizeof(config),
+             "%srecord_spikes = true\noutput_dir = test_output/batch\n",
+             test_config);
+    NeuralSimulation* sim = ns_init_from_string(config, NULL);
+    TEST_ASSERT_NOT_NULL(sim);
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS,
+                          ns_run_trials(sim, 4, 10.0, drive_last_trial, NULL));
+    TEST_ASSERT_EQUAL_INT(0, (int)sim->step_count);
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_run(sim, 10.0));
+    ns_stop(sim);
+
+    int n_trials, n_ids, n_times, n_run, n_run_times;
+    int32_t* trials = read_npy("test_output/batch/trials/spike_trials.npy",
+                               sizeof(int32_t), &n_trials);
+    int32_t* ids = read_npy("test_output/batch/trials/spike_ids.npy",
+                            sizeof(int32_t), &n_ids);
+    double* times = read_npy("test_output/batch/trials/spike_times.npy",
+                             sizeof(double), &n_times);
+    int32_t* run_ids = read_npy("test_output/batch/spike_ids.npy",
+                                sizeof(int32_t), &n_run);
+    double* run_times = read_npy("test_output/batch/spike_times.npy",
+                                 sizeof(double), &n_run_times);
+    TEST_ASSERT_EQUAL_INT(n_trials, n_ids);
+    TEST_ASSERT_EQUAL_INT(n_trials, n_times);
+    TEST_ASSERT_EQUAL_INT(n_run, n_run_times);
+    TEST_ASSERT_TRUE(n_run > 0);
+
+    // Trial 0 draws the configured seed's noise, so it is the plain run
+    int matched = 0, driven[4] = {0}, per_trial[4] = {0};
+    for (int s = 0; s < n_trials; s++) {
+        per_trial[trials[s]]++;
+        if (ids[s] < 10) driven[trials[s]]++;
+        if (trials[s] != 0) continue;
+        TEST_ASSERT_TRUE(matched < n_run);
+        TEST_ASSERT_EQUAL_INT(run_ids[matched], ids[s]);
+        TEST_ASSERT_EQUAL_DOUBLE(run_times[matched], times[s]);
+        matched++;
+    }
+    TEST_ASSERT_EQUAL_INT(n_run, matched);
+
+    // Trial 1 draws other noise
+    bool same = per_trial[1] == per_trial[0];
+    for (int s = 0, k = 0; same && s < n_trials; s++) {
+        if (trials[s] != 1) continue;
+        same = run_ids[k] == ids[s] && run_times[k] == times[s];
+        k++;
+    }
+    TEST_ASSERT_FALSE(same);
+    TEST_ASSERT_TRUE(driven[3] > driven[0]);
+    TEST_ASSERT_EQUAL_INT(NPY_HEADER_SIZE + 4 * 2 * 8,
+                          file_size("test_output/batch/trials/rates.npy"));
+    free(trials);
+    free(ids);
+    free(times);
+    free(run_ids);
+    free(run_times);
+}
+
+void test_batched_trials_reject_plasticity(void) {
+    char config[1024];
+    snprintf(config, sizeof(config), "%sstdp = true\n", test_config);
+    NeuralSimulation* sim = ns_init_from_string(config, NULL);
+    TEST_ASSERT_NOT_NULL(sim);
+    TEST_ASSERT_EQUAL_INT(NS_ERROR_CONFIG,
+                          ns_run_trials(sim, 2, 1.0, NULL, NULL));
+    ns_stop(sim);
+}
+
+void test_crc32_reference(void) {
+    TEST_ASSERT_EQUAL_UINT64(0xcbf43926u, crc32_update(0, "123456789", 9));
+    uint32_t crc = crc32_update(0, "1234", 4);
+    TEST_ASSERT_EQUAL_UINT64(0xcbf43926u, crc32_update(crc, "56789", 5));
+}
+
+void test_invalid_config_reports_error(void) {
+    TEST_ASSERT_NULL(ns_init_from_string("dt = -1\n", NULL));
+    TEST_ASSERT_TRUE(strlen(ns_get_last_error()) > 0);
+}
+
+// Runs rank `rank` of two over shared memory `name`, or the whole
+// network for rank -1
+static NetworkStatistics run_split(const char* base, int rank,
+                                   const char* name) {
+    char config[1536];
+    int length = snprintf(config, sizeof(config), "%s", base);
+    if (rank >= 0) {
+        snprintf(config + length, sizeof(config) - length,
+                 "ranks = 2\nrank = %d\ntransport_name = %s\n", rank, name);
+    }
+    NetworkStatistics stats;
+    memset(&stats, 0, sizeof(stats));
+    NeuralSimulation* sim = ns_init_from_string(config, NULL);
+    if (sim) {
+        ns_run(sim, 10.0);
+        ns_calculate_statistics(sim, &stats);
+        ns_stop(sim);
+    }
+    return stats;
+}
+
+void test_ranks_own_their_synapses(void) {
+    char base[1024];
+    snprintf(base, sizeof(base),
+             "%sstdp = true\nstructural_plasticity = true\n"
+             "structural_interval = 1.0\nstructural_prune_weight = 0.02\n"
+             "structural_prune_checks = 1\n"
+             "structural_formation_rate = 200.0\n",
+             test_config);
+    NetworkStatistics whole = run_split(base, -1, NULL);
+    char name[64];
+    snprintf(name, sizeof(name), "/neuralsim_split_%d", (int)getpid());
+
+    int channel[2];
+    TEST_ASSERT_EQUAL_INT(0, pipe(channel));
+    pid_t child = fork();
+    if (child == 0) {
+        NetworkStatistics stats = run_split(base, 1, name);
+        ssize_t written = write(channel[1], &stats, sizeof(stats));
+        _exit(written == (ssize_t)sizeof(stats) ? 0 : 1);
+    }
+    NetworkStatistics ranks[2];
+    ranks[0] = run_split(base, 0, name);
+    TEST_ASSERT_EQUAL_INT(sizeof(ranks[1]),
+                          read(channel[0], &ranks[1], sizeof(ranks[1])));
+    int status = -1;
+    waitpid(child, &status, 0);
+    close(channel[0]);
+    close(channel[1]);
+    TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // Together the ranks hold the synapses of the whole network, each
+    // exactly once, with the same weights
+    TEST_ASSERT_GREATER_THAN(0, ranks[0].num_synapses);
+    TEST_ASSERT_GREATER_THAN(0, ranks[1].num_synapses);
+    TEST_ASSERT_EQUAL_INT(whole.num_synapses,
+                          ranks[0].num_synapses + ranks[1].num_synapses);
+    TEST_ASSERT_EQUAL_INT((int)whole.spikes_pyramidal,
+                          (int)(ranks[0].spikes_pyramidal +
+                                ranks[1].spikes_pyramidal));
+    TEST_ASSERT_EQUAL_INT((int)whole.spikes_inhibitory,
+                          (int)(ranks[0].spikes_inhibitory +
+                                ranks[1].spikes_inhibitory));
+    double split = ranks[0].mean_weight * ranks[0].num_synapses +
+                   ranks[1].mean_weight * ranks[1].num_synapses;
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9 * whole.num_synapses,
+                              whole.mean_weight * whole.num_synapses, split);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_run_advances_time);
+    RUN_TEST(test_state_roundtrip_is_deterministic);
+    RUN_TEST(test_periodic_checkpoints_restore);
+    RUN_TEST(test_dendritic_state_roundtrip);
+    RUN_TEST(test_rewired_state_roundtrip);
+    RUN_TEST(test_stop_from_callback);
+    RUN_TEST(test_live_view_publishes_snapshots);
+    RUN_TEST(test_probe_records_selected_columns);
+    RUN_TEST(test_probe_slices_match_neurons);
+    RUN_TEST(test_probe_traces_follow_samples);
+    RUN_TEST(test_export_npz_members);
+    RUN_TEST(test_async_output_matches_inline);
+    RUN_TEST(test_reordered_export_uses_creation_order);
+    RUN_TEST(test_results_independent_of_thread_count);
+    RUN_TEST(test_temporal_blocking_matches_single_steps);
+    RUN_TEST(test_ranks_own_their_synapses);
+    RUN_TEST(test_batched_trials_match_single_run);
+    RUN_TEST(test_batched_trials_reject_plasticity);
+    RUN_TEST(test_crc32_reference);
+    RUN_TEST(test_invalid_config_reports_error);
+    return UNITY_END();
+}
@@ -0,0 +1,54 @@
+#include <unity.h>
+#include "../src/core/background.h"
+#include "../src/utils/random.h"
+
+static RandomState rng;
+
+void setUp(void) { init_random(&rng, 12345); }
+void tearDown(void) {}
+
+void test_poisson_samplers(void) {
+    // Table method below the PTRS threshold, rejection above it
+    double rates[] = {0.05, 3.0, 25.0, 4000.0};
+    int n = 20000;
+
+    for (int r = 0; r < 4; r++) {
+        PoissonSampler sampler;
+        TEST_ASSERT_EQUAL_INT(0, init_poisson_sampler(&sampler, rates[r]));
+
+        double sum = 0.0, sum_sq = 0.0;
+        for (int i = 0; i < n; i++) {
+            int k = sample_poisson(&sampler, &rng);
+            TEST_ASSERT_GREATER_OR_EQUAL(0, k);
+            sum += k;
+            sum_sq += (double)k * k;
+        }
+        free_poisson_sampler(&sampler);
+
+        double mean = sum / n;
+        double var = sum_sq / n - mean * mean;
+        TEST_ASSERT_FLOAT_WITHIN(0.05 * rates[r] + 0.01, rates[r], mean);
+        TEST_ASSERT_FLOAT_WITHIN(0.1 * rates[r] + 0.01, rates[r], var);
+    }
+}
+
+void test_background_current_mean(void) {
+    // 100 sources at 10 Hz over 0.1 ms: 0.1 spikes per step of 2 mV each
+    BackgroundParams params = {100, 10.0, 2.0};
+    BackgroundInput* bg = create_background_input(params, 0.1);
+    TEST_ASSERT_NOT_NULL(bg);
+    TEST_ASSERT_FLOAT_WITHIN(1e-12, 20.0, bg->current_per_spike);
+
+    int n = 100000;
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += background_current(bg, &rng);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 2.0, sum / n);
+    destroy_background_input(bg);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_poisson_samplers);
+    RUN_TEST(test_background_current_mean);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include <unity.h>
+#include <math.h>
+#include "../src/core/cable.h"
+
+#define CELLS 11
+#define N 7
+
+// Soma - 0 - 1 - 2 with 3 and 4 on 1, and a second root 5 - 6
+static const int parent[N] = {-1, 0, 1, 1, 3, -1, 5};
+static const double g_axial[N] = {0.8, 0.5, 0.3, 0.4, 0.2, 0.6, 0.7};
+
+static Morphology* test_morphology;
+static CableState* test_cable;
+
+void setUp(void) {
+    test_morphology =
+        create_morphology(parent, g_axial, N, 10.0, -70.0, 0.1);
+    morphology_prepare(test_morphology, 0.1);
+    test_cable = create_cable_state(test_morphology, CELLS);
+}
+
+void tearDown(void) {
+    destroy_cable_state(test_cable);
+    destroy_morphology(test_morphology);
+}
+
+// Backward Euler step of one cell by Gaussian elimination of the dense
+// system
+static void dense_step(const double* v_old, const double* inject,
+                       double v_soma, double dt, double* v_new) {
+    double a[N][N + 1] = {{0}};
+    for (int i = 0; i < N; i++) {
+        a[i][i] = 1.0 / dt + 1.0 / 10.0;
+        a[i][N] = v_old[i] / dt - 70.0 / 10.0 + inject[i];
+        int p = parent[i];
+        a[i][i] += g_axial[i];
+        if (p < 0) {
+            a[i][N] += g_axial[i] * v_soma;
+        } else {
+            a[i][p] -= g_axial[i];
+            a[p][p] += g_axial[i];
+            a[p][i] -= g_axial[i];
+        }
+    }
+    for (int k = 0; k < N; k++) {
+        for (int r = k + 1; r < N; r++) {
+            double f = a[r][k] / a[k][k];
+            for (int c = k; c <= N; c++) a[r][c] -= f * a[k][c];
+        }
+    }
+    for (int k = N - 1; k >= 0; k--) {
+        double sum = a[k][N];
+        for (int c = k + 1; c < N; c++) sum -= a[k][c] * v_new[c];
+        v_new[k] = sum / a[k][k];
+    }
+}
+
+void test_rejects_parent_after_child(void) {
+    const int bad[3] = {-1, 2, 0};
+    TEST_ASSERT_NULL(create_morphology(bad, g_axial, 3, 10.0, -70.0, 0.1));
+}
+
+void test_hines_matches_dense_solve(void) {
+    double v_soma[CELLS], current[CELLS] = {0};
+    double expected[CELLS][N];
+    for (int c = 0; c < CELLS; c++) {
+        v_soma[c] = -65.0 + c;
+        double v_old[N], inject[N];
+        for (int i = 0; i < N; i++) {
+            v_old[i] = -70.0 + 0.5 * i - 0.3 * c;
+            inject[i] = (i + c) % 3 == 0 ? 2.0 : 0.0;
+            *cable_voltage(test_cable, i, c) = v_old[i];
+            *cable_inject(test_cable, i, c) = inject[i];
+        }
+        dense_step(v_old, inject, v_soma[c], 0.1, expected[c]);
+    }
+
+    // Two ranges, as two chunks of a step would
+    cable_solve(test_cable, 0, 5, v_soma, current);
+    cable_solve(test_cable, 5, CELLS, v_soma, current);
+    for (int c = 0; c < CELLS; c++) {
+        for (int i = 0; i < N; i++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1e-9, expected[c][i],
+                                      *cable_voltage(test_cable, i, c));
+            TEST_ASSERT_EQUAL_DOUBLE(0.0, *cable_inject(test_cable, i, c));
+        }
+        double soma = 0.1 * (0.8 * (expected[c][0] - v_soma[c]) +
+                             0.6 * (expected[c][5] - v_soma[c]));
+        TEST_ASSERT_DOUBLE_WITHIN(1e-9, soma, current[c]);
+    }
+}
+
+void test_settles_to_cable_steady_state(void) {
+    // One compartment driven by a constant current against the soma
+    const int root[1] = {-1};
+    const double g[1] = {0.5};
+    Morphology* single = create_morphology(root, g, 1, 10.0, -70.0, 1.0);
+    morphology_prepare(single, 0.1);
+    CableState* cable = create_cable_state(single, 1);
+    double v_soma = -70.0, current = 0.0;
+    for (int s = 0; s < 2000; s++) {
+        *cable_inject(cable, 0, 0) = 3.0;
+        current = 0.0;
+        cable_solve(cable, 0, 1, &v_soma, &current);
+    }
+    // 0 = -(V - E) / tau - g (V - V_soma) + I
+    double v = -70.0 + 3.0 / (0.1 + 0.5);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, v, *cable_voltage(cable, 0, 0));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 0.5 * (v + 70.0), current);
+    destroy_cable_state(cable);
+    destroy_morphology(single);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rejects_parent_after_child);
+    RUN_TEST(test_hines_matches_dense_solve);
+    RUN_TEST(test_settles_to_cable_steady_state);
+    return UNITY_END();
+}
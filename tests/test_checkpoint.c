@@ -0,0 +1,105 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "../src/utils/checkpoint.h"
+
+// Three and a half blocks, so the last one is short
+#define STATE_SIZE (3 * CHECKPOINT_BLOCK_SIZE + CHECKPOINT_BLOCK_SIZE / 2)
+
+static char state[STATE_SIZE];
+
+static int write_state(const void* context, FILE* file) {
+    const char* data = context;
+    return fwrite(data, 1, STATE_SIZE, file) == STATE_SIZE ? 0 : -1;
+}
+
+static void assert_image_holds_state(const char* path) {
+    char* data = NULL;
+    size_t size = 0;
+    TEST_ASSERT_TRUE(checkpoint_is_image(path));
+    TEST_ASSERT_EQUAL_INT(0, checkpoint_read_image(path, &data, &size));
+    TEST_ASSERT_EQUAL_INT(STATE_SIZE, (int)size);
+    TEST_ASSERT_EQUAL_MEMORY(state, data, STATE_SIZE);
+    free(data);
+}
+
+void setUp(void) {
+    mkdir("test_output", 0755);
+    for (int i = 0; i < STATE_SIZE; i++) state[i] = (char)(i * 7 + i / 251);
+}
+
+void tearDown(void) {}
+
+void test_deltas_write_changed_blocks(void) {
+    Checkpointer* cp = create_checkpointer(CHECKPOINT_BLOCKING, true);
+    TEST_ASSERT_NOT_NULL(cp);
+
+    TEST_ASSERT_EQUAL_INT(0, checkpoint_start(cp, "test_output/cp_0.bin",
+                                              write_state, state));
+    TEST_ASSERT_TRUE(cp->result.ok);
+    TEST_ASSERT_TRUE(cp->result.full);
+    TEST_ASSERT_EQUAL_INT(4, (int)cp->result.blocks);
+    TEST_ASSERT_EQUAL_INT(4, (int)cp->result.blocks_written);
+
+    // One byte in the short last block and one in the second
+    state[3 * CHECKPOINT_BLOCK_SIZE + 10] ^= 1;
+    state[CHECKPOINT_BLOCK_SIZE + 5] ^= 1;
+    TEST_ASSERT_EQUAL_INT(0, checkpoint_start(cp, "test_output/cp_1.bin",
+                                              write_state, state));
+    TEST_ASSERT_FALSE(cp->result.full);
+    TEST_ASSERT_EQUAL_INT(2, (int)cp->result.blocks_written);
+
+    TEST_ASSERT_EQUAL_INT(0, checkpoint_start(cp, "test_output/cp_2.bin",
+                                              write_state, state));
+    TEST_ASSERT_FALSE(cp->result.full);
+    TEST_ASSERT_EQUAL_INT(0, (int)cp->result.blocks_written);
+    TEST_ASSERT_EQUAL_INT(3, (int)cp->completed);
+    assert_image_holds_state("test_output/cp_2.bin");
+
+    // The chain is cut by a full image
+    for (int i = 3; i <= CHECKPOINT_MAX_CHAIN + 1; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "test_output/cp_%d.bin", i);
+        state[i] ^= 1;
+        TEST_ASSERT_EQUAL_INT(0, checkpoint_start(cp, path, write_state,
+                                                  state));
+    }
+    TEST_ASSERT_TRUE(cp->result.full);
+    assert_image_holds_state("test_output/cp_17.bin");
+    destroy_checkpointer(cp);
+
+    char* data = NULL;
+    size_t size = 0;
+    TEST_ASSERT_FALSE(checkpoint_is_image("test_output/missing.bin"));
+    TEST_ASSERT_NOT_EQUAL(0, checkpoint_read_image("test_output/missing.bin",
+                                                   &data, &size));
+}
+
+void test_forked_writer_snapshots_state(void) {
+    Checkpointer* cp = create_checkpointer(CHECKPOINT_FORK, true);
+    TEST_ASSERT_NOT_NULL(cp);
+    TEST_ASSERT_EQUAL_INT(0, checkpoint_start(cp, "test_output/fork.bin",
+                                              write_state, state));
+
+    // The child writes the state as it was at the fork
+    char snapshot[64];
+    memcpy(snapshot, state, sizeof(snapshot));
+    memset(state, 0, sizeof(snapshot));
+    TEST_ASSERT_EQUAL_INT(1, checkpoint_collect(cp, true));
+    TEST_ASSERT_TRUE(cp->result.ok);
+    TEST_ASSERT_EQUAL_INT(0, checkpoint_collect(cp, true));
+    memcpy(state, snapshot, sizeof(snapshot));
+    assert_image_holds_state("test_output/fork.bin");
+    destroy_checkpointer(cp);
+
+    TEST_ASSERT_EQUAL_INT(CHECKPOINT_FORK, checkpoint_mode_from_name("fork"));
+    TEST_ASSERT_EQUAL_INT(-1, checkpoint_mode_from_name("async"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_deltas_write_changed_blocks);
+    RUN_TEST(test_forked_writer_snapshots_state);
+    return UNITY_END();
+}
@@ -0,0 +1,44 @@
+#include <unity.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "../src/utils/config.h"
+
+void setUp(void) { mkdir("test_output", 0755); }
+void tearDown(void) {}
+
+void test_saved_models_round_trip(void) {
+    SimulationConfig* config = parse_config_string(
+        "pyramidal_model = adex\n"
+        "pyramidal_adex_a = 0.3\n"
+        "pyramidal_adex_tau_w = 150.0\n"
+        "inhibitory_model = izhikevich\n"
+        "inhibitory_izh_d = 0.05\n"
+        "e_inh = -75.5\n"
+        "stdp_w_min = 0.125\n");
+    TEST_ASSERT_NOT_NULL(config);
+    save_config(config, "test_output/saved.ini");
+
+    SimulationConfig* loaded = load_config("test_output/saved.ini");
+    TEST_ASSERT_NOT_NULL(loaded);
+    const PopulationConfig* a[2] = {&config->network.pyramidal,
+                                    &config->network.inhibitory};
+    const PopulationConfig* b[2] = {&loaded->network.pyramidal,
+                                    &loaded->network.inhibitory};
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL_INT(a[i]->model, b[i]->model);
+        TEST_ASSERT_EQUAL_MEMORY(&a[i]->params, &b[i]->params,
+                                 sizeof(ModelParams));
+    }
+    TEST_ASSERT_EQUAL_INT(MODEL_ADEX, loaded->network.pyramidal.model);
+    TEST_ASSERT_EQUAL_DOUBLE(0.3, loaded->network.pyramidal.params.adex_a);
+    TEST_ASSERT_EQUAL_DOUBLE(-75.5, loaded->network.pyramidal.params.e_inh);
+    TEST_ASSERT_EQUAL_DOUBLE(0.125, loaded->network.stdp.w_min);
+    destroy_config(config);
+    destroy_config(loaded);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_saved_models_round_trip);
+    return UNITY_END();
+}
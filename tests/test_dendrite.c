@@ -15,16 +15,50 @@ void test_dendrite_creation(void) {
     TEST_ASSERT_NOT_NULL(test_dendrite);
     TEST_ASSERT_EQUAL_INT(10, test_dendrite->num_synapses);
     TEST_ASSERT_NOT_NULL(test_dendrite->synapses);
+    TEST_ASSERT_EQUAL_INT(0, test_dendrite->num_active);
 }
 
 void test_local_potential(void) {
     // Set up test synapses
     test_dendrite->synapses[0].weight = 1.0;
-    test_dendrite->synapses[0].conductance = 0.5;
-    test_dendrite->synapses[0].is_active = true;
+    dendrite_receive_spike(test_dendrite, 0, 0.5);
     
     double potential = compute_local_potential(test_dendrite);
     TEST_ASSERT_GREATER_THAN(0.0, potential);
+    TEST_ASSERT_EQUAL_INT(1, test_dendrite->num_active);
+    TEST_ASSERT_TRUE(test_dendrite->synapses[0].is_active);
+}
+
+void test_active_set_tracks_decay(void) {
+    test_dendrite->synapses[2].weight = 1.0;
+    test_dendrite->synapses[7].weight = 2.0;
+    dendrite_receive_spike(test_dendrite, 2, 1.0);
+    dendrite_receive_spike(test_dendrite, 7, 1e-3);
+    dendrite_receive_spike(test_dendrite, 2, 1.0);
+    TEST_ASSERT_EQUAL_INT(2, test_dendrite->num_active);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 2.002,
+                              compute_local_potential(test_dendrite));
+
+    // The running sum matches a full scan after every step
+    for (int step = 0; step < 200; step++) {
+        update_dendrite(test_dendrite, 0.1);
+        double sum = 0.0;
+        for (int i = 0; i < test_dendrite->num_synapses; i++) {
+            const Synapse* s = &test_dendrite->synapses[i];
+            if (s->is_active) sum += s->weight * s->conductance;
+        }
+        TEST_ASSERT_DOUBLE_WITHIN(1e-12, sum,
+                                  compute_local_potential(test_dendrite));
+    }
+    // The weak synapse fell silent long before the strong one
+    TEST_ASSERT_FALSE(test_dendrite->synapses[7].is_active);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, test_dendrite->synapses[7].conductance);
+
+    for (int step = 0; step < 1000; step++) {
+        update_dendrite(test_dendrite, 0.1);
+    }
+    TEST_ASSERT_EQUAL_INT(0, test_dendrite->num_active);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, compute_local_potential(test_dendrite));
 }
 
 void test_calcium_dynamics(void) {
@@ -37,6 +71,7 @@ int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_dendrite_creation);
     RUN_TEST(test_local_potential);
+    RUN_TEST(test_active_set_tracks_decay);
     RUN_TEST(test_calcium_dynamics);
     return UNITY_END();
 }
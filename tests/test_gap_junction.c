@@ -0,0 +1,139 @@
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include "../src/core/gap_junction.h"
+#include "../src/core/network.h"
+#include "../src/utils/config.h"
+#include "../src/utils/random.h"
+
+#define ROWS 150
+#define PAIRS 600
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_sliced_product_matches_dense(void) {
+    // Row lengths vary widely, some rows have no partners, and the row
+    // count is neither a multiple of the slice nor of the sort window
+    static int a[PAIRS], b[PAIRS];
+    static double dense[ROWS][ROWS];
+    RandomState rng;
+    init_random(&rng, 11);
+    for (int k = 0; k < PAIRS; k++) {
+        a[k] = random_int(&rng, 0, ROWS / 3 - 1);
+        b[k] = random_int(&rng, 0, ROWS - 11);
+        dense[a[k]][b[k]] += 0.2;
+        dense[b[k]][a[k]] += 0.2;
+    }
+    GapJunctions* gap = create_gap_junctions(10, ROWS, a, b, PAIRS, 0.2);
+    TEST_ASSERT_NOT_NULL(gap);
+
+    double x[ROWS], y[ROWS];
+    for (int r = 0; r < ROWS; r++) x[r] = random_normal(&rng);
+    gap_junction_multiply(gap, x, y);
+    for (int r = 0; r < ROWS; r++) {
+        double expected = 0.0;
+        double total = 0.0;
+        for (int c = 0; c < ROWS; c++) {
+            expected += dense[r][c] * x[c];
+            total += dense[r][c];
+        }
+        TEST_ASSERT_DOUBLE_WITHIN(1e-12, expected, y[r]);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-12, total, gap->g_total[r]);
+    }
+    destroy_gap_junctions(gap);
+
+    const int outside[1] = {4};
+    TEST_ASSERT_NULL(create_gap_junctions(0, 4, a, outside, 1, 0.2));
+}
+
+void test_relaxation_is_stable(void) {
+    // Two neurons whose coupling is strong for the step: dt g = 4
+    const int a[1] = {0};
+    const int b[1] = {1};
+    const double dt = 0.1;
+    GapJunctions* gap = create_gap_junctions(0, 2, a, b, 1, 40.0);
+    TEST_ASSERT_NOT_NULL(gap);
+
+    gap->v[0] = -50.0;
+    gap->v[1] = -70.0;
+    gap_junction_currents(gap, dt, 0);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, -800.0, gap->current[0]);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 800.0, gap->current[1]);
+
+    // Converged relaxation is the backward Euler step: the difference
+    // shrinks by 1 + 2 dt g and the mean is kept
+    gap_junction_currents(gap, dt, 200);
+    double u0 = gap->v[0] + dt * gap->current[0];
+    double u1 = gap->v[1] + dt * gap->current[1];
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 20.0 / 9.0, u0 - u1);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, -60.0, 0.5 * (u0 + u1));
+
+    // Explicit steps overshoot and grow, relaxed ones decay whatever the
+    // number of iterations
+    for (int iterations = 0; iterations <= 3; iterations++) {
+        gap->v[0] = 1.0;
+        gap->v[1] = -1.0;
+        for (int step = 0; step < 20; step++) {
+            gap_junction_currents(gap, dt, iterations);
+            gap->v[0] += dt * gap->current[0];
+            gap->v[1] += dt * gap->current[1];
+        }
+        double spread = fabs(gap->v[0] - gap->v[1]);
+        if (iterations == 0) {
+            TEST_ASSERT_TRUE(spread > 1e6);
+        } else {
+            TEST_ASSERT_TRUE(spread <= 2.0);
+            TEST_ASSERT_DOUBLE_WITHIN(1e-9, 0.0, gap->v[0] + gap->v[1]);
+        }
+    }
+    destroy_gap_junctions(gap);
+}
+
+// Spread of the inhibitory potentials after some steps
+static double inhibitory_spread(SimulationConfig* config, double rate) {
+    config->network.gap_junction_rate = rate;
+    Network* net = create_network(config->network);
+    TEST_ASSERT_NOT_NULL(net);
+    TEST_ASSERT_EQUAL_INT(rate > 0.0, net->gap_junctions != NULL);
+    for (int step = 0; step < 500; step++) {
+        update_network(net, step * config->network.dt);
+    }
+    if (rate > 0.0) {
+        // Coupling within every step rules out blocks
+        TEST_ASSERT_EQUAL_INT(1, update_network_block(net, 50.0, 10, NULL,
+                                                      NULL));
+    }
+    const Population* pop = &net->populations[POP_INHIBITORY];
+    double sum = 0.0, sum_sq = 0.0;
+    for (int i = 0; i < pop->count; i++) {
+        double v = pop->neurons[i].membrane_potential;
+        sum += v;
+        sum_sq += v * v;
+    }
+    double mean = sum / pop->count;
+    double variance = sum_sq / pop->count - mean * mean;
+    destroy_network(net);
+    return sqrt(variance);
+}
+
+void test_coupling_pulls_potentials_together(void) {
+    SimulationConfig* config = create_default_config();
+    config->network.gap_junction_conductance = 0.05;
+    double uncoupled = inhibitory_spread(config, 0.0);
+    double coupled = inhibitory_spread(config, 0.2);
+    TEST_ASSERT_TRUE(coupled < 0.5 * uncoupled);
+
+    // Junctions follow their neurons when the network is reordered
+    config->network.reorder = REORDER_RCM;
+    TEST_ASSERT_TRUE(inhibitory_spread(config, 0.2) < 0.5 * uncoupled);
+    destroy_config(config);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sliced_product_matches_dense);
+    RUN_TEST(test_relaxation_is_stable);
+    RUN_TEST(test_coupling_pulls_potentials_together);
+    return UNITY_END();
+}
@@ -0,0 +1,88 @@
+#include <unity.h>
+#include <math.h>
+#include "../src/core/mean_field.h"
+#include "../src/utils/config.h"
+
+static SimulationConfig* test_config;
+
+void setUp(void) {
+    test_config = create_default_config();
+    NetworkConfig* net = &test_config->network;
+    net->num_pyramidal = 400;
+    net->num_inhibitory = 100;
+    net->num_dendrites = 0;
+    net->background.num_sources = 1000;
+    net->background.rate = 5.0;
+    net->background.weight = 0.1;
+    net->tau_syn = 2.0;
+}
+
+void tearDown(void) {
+    destroy_config(test_config);
+}
+
+void test_transfer_limits(void) {
+    ModelParams params;
+    default_model_params(&params, false);
+    const NeuronParams* p = &params.base;
+
+    // Without noise a suprathreshold neuron charges from reset each time
+    double mu = -50.0;
+    double expected =
+        1.0 / (p->refractory_period +
+               p->tau_m * log((mu - p->v_reset) / (mu - p->v_threshold)));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, expected,
+                              lif_rate(&params, mu, 0.0, 0.0, 5.0, 0.1));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, lif_rate(&params, -60.0, 0.0, 0.0, 5.0, 0.1));
+
+    // Weak noise approaches it, and noise lets subthreshold neurons fire
+    TEST_ASSERT_DOUBLE_WITHIN(0.02 * expected, expected,
+                              lif_rate(&params, mu, 0.05, 0.0, 5.0, 0.001));
+    double last = 0.0;
+    for (double v = -70.0; v <= -45.0; v += 1.0) {
+        double rate = lif_rate(&params, v, 3.0, 2.0, 5.0, 0.1);
+        TEST_ASSERT_TRUE(rate > last);
+        last = rate;
+    }
+    TEST_ASSERT_TRUE(last < 1.0 / p->refractory_period);
+}
+
+void test_rates_match_simulation(void) {
+    NetworkConfig* config = &test_config->network;
+    MeanFieldResult result;
+    TEST_ASSERT_EQUAL_INT(0, mean_field_rates(config, &result));
+    TEST_ASSERT_TRUE(result.converged);
+
+    config->simulation_time = 500.0;
+    Network* net = create_network(*config);
+    TEST_ASSERT_NOT_NULL(net);
+    int steps = (int)(config->simulation_time / config->dt);
+    for (int step = 0; step < steps; step++) {
+        update_network(net, step * config->dt);
+    }
+    const int sizes[NUM_POPULATIONS] = {config->num_pyramidal,
+                                        config->num_inhibitory};
+    for (int p = 0; p < NUM_POPULATIONS; p++) {
+        double rate = 1000.0 * net->total_spikes[p] /
+                      (sizes[p] * config->simulation_time);
+        TEST_ASSERT_DOUBLE_WITHIN(0.05 * rate, rate, result.rate[p]);
+    }
+    destroy_network(net);
+}
+
+void test_rejects_other_networks(void) {
+    MeanFieldResult result;
+    test_config->network.inhibitory.model = MODEL_ADEX;
+    TEST_ASSERT_EQUAL_INT(-1, mean_field_rates(&test_config->network, &result));
+    test_config->network.inhibitory.model = MODEL_LIF;
+    test_config->network.num_dendrites = 2;
+    TEST_ASSERT_EQUAL_INT(-1, mean_field_rates(&test_config->network, &result));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_transfer_limits);
+    RUN_TEST(test_rates_match_simulation);
+    RUN_TEST(test_rejects_other_networks);
+    return UNITY_END();
+}
@@ -0,0 +1,105 @@
+#include <unity.h>
+#include "../src/core/neuron_models.h"
+
+#define TEST_COUNT 8
+
+static Neuron test_neurons[TEST_COUNT];
+static double input_exc[TEST_COUNT];
+static double input_inh[TEST_COUNT];
+static KernelContext test_ctx;
+
+void setUp(void) {
+    for (int i = 0; i < TEST_COUNT; i++) {
+        init_neuron(&test_neurons[i], false);
+        input_exc[i] = 0.0;
+        input_inh[i] = 0.0;
+    }
+    test_ctx = (KernelContext){
+        .dt = 0.1,
+        .time = 0.0,
+        .syn_decay = 0.9,
+        .input_exc = input_exc,
+        .input_inh = input_inh
+    };
+}
+
+void tearDown(void) {}
+
+static int run_until_spike(Population* pop, double drive, int max_steps) {
+    int spikes[TEST_COUNT];
+    for (int step = 0; step < max_steps; step++) {
+        for (int i = 0; i < TEST_COUNT; i++) pop->neurons[i].input_current = drive;
+        test_ctx.time = step * test_ctx.dt;
+        if (pop->kernel(pop, 0, TEST_COUNT, &test_ctx, spikes) > 0) return step;
+    }
+    return -1;
+}
+
+void test_model_registry(void) {
+    for (int m = 0; m < NUM_NEURON_MODELS; m++) {
+        TEST_ASSERT_EQUAL_INT(m, neuron_model_from_name(neuron_model_name(m)));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, neuron_model_from_name("hodgkin_huxley"));
+}
+
+void test_every_model_fires_under_drive(void) {
+    for (int m = 0; m < NUM_NEURON_MODELS; m++) {
+        PopulationConfig config = {.model = m};
+        default_model_params(&config.params, false);
+
+        Population pop;
+        setUp();
+        TEST_ASSERT_EQUAL_INT(0, init_population(&pop, "test", test_neurons,
+                                                 TEST_COUNT, 0, &config));
+        TEST_ASSERT_GREATER_OR_EQUAL(0, run_until_spike(&pop, 20.0, 10000));
+        TEST_ASSERT_EQUAL_INT(-1, run_until_spike(&pop, 0.0, 1));
+        free_population(&pop);
+    }
+}
+
+void test_lif_uses_population_threshold(void) {
+    PopulationConfig config = {.model = MODEL_LIF};
+    default_model_params(&config.params, false);
+    Population low, high;
+
+    config.params.base.v_threshold = -60.0;
+    init_population(&low, "low", test_neurons, TEST_COUNT, 0, &config);
+    int low_step = run_until_spike(&low, 1.0, 10000);
+
+    setUp();
+    config.params.base.v_threshold = -50.0;
+    init_population(&high, "high", test_neurons, TEST_COUNT, 0, &config);
+    int high_step = run_until_spike(&high, 1.0, 10000);
+
+    TEST_ASSERT_GREATER_OR_EQUAL(0, low_step);
+    TEST_ASSERT_GREATER_THAN(low_step, high_step);
+
+    free_population(&low);
+    free_population(&high);
+}
+
+void test_synaptic_input_is_consumed(void) {
+    PopulationConfig config = {.model = MODEL_LIF};
+    default_model_params(&config.params, false);
+    Population pop;
+    int spikes[TEST_COUNT];
+
+    init_population(&pop, "test", test_neurons, TEST_COUNT, 0, &config);
+    input_exc[3] = 1.0;
+    pop.kernel(&pop, 0, TEST_COUNT, &test_ctx, spikes);
+
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, input_exc[3]);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, pop.syn_exc[3]);
+    TEST_ASSERT_GREATER_THAN(test_neurons[2].membrane_potential,
+                             test_neurons[3].membrane_potential);
+    free_population(&pop);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_model_registry);
+    RUN_TEST(test_every_model_fires_under_drive);
+    RUN_TEST(test_lif_uses_population_threshold);
+    RUN_TEST(test_synaptic_input_is_consumed);
+    return UNITY_END();
+}
@@ -0,0 +1,83 @@
+#include <unity.h>
+#include <stdlib.h>
+#include "../src/utils/random.h"
+#include "../src/utils/random_batch.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_batch_ziggurat_moments(void) {
+    RandomBatch batch;
+    size_t n = 100003;  // Not a multiple of the lane count
+    double* normal = random_batch_alloc(n, sizeof(double));
+    double* expo = random_batch_alloc(n, sizeof(double));
+    TEST_ASSERT_NOT_NULL(normal);
+    TEST_ASSERT_NOT_NULL(expo);
+
+    init_random_batch(&batch, 12345);
+    random_batch_normal(&batch, normal, n);
+    random_batch_exponential(&batch, expo, n);
+
+    double sum_n = 0.0, sq_n = 0.0, sum_e = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sum_n += normal[i];
+        sq_n += normal[i] * normal[i];
+        TEST_ASSERT_GREATER_OR_EQUAL(0.0, expo[i]);
+        sum_e += expo[i];
+    }
+    free(normal);
+    free(expo);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 0.0, sum_n / n);
+    TEST_ASSERT_FLOAT_WITHIN(0.03, 1.0, sq_n / n);
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 1.0, sum_e / n);
+}
+
+void test_batch_uniform_is_reproducible(void) {
+    RandomBatch a, b;
+    size_t n = 1001;
+    double* x = random_batch_alloc(n, sizeof(double));
+    double* y = random_batch_alloc(n, sizeof(double));
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_NOT_NULL(y);
+
+    init_random_batch(&a, 7);
+    init_random_batch(&b, 7);
+    random_batch_uniform(&a, x, n);
+    random_batch_uniform(&b, y, n);
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_DOUBLE(x[i], y[i]);
+        TEST_ASSERT_GREATER_OR_EQUAL(0.0, x[i]);
+        TEST_ASSERT_LESS_THAN(1.0, x[i]);
+        sum += x[i];
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 0.5, sum / n);
+    free(x);
+    free(y);
+}
+
+void test_scalar_ziggurat_moments(void) {
+    RandomState rng;
+    init_random(&rng, 99);
+    int n = 100000;
+    double sum_n = 0.0, sq_n = 0.0, sum_e = 0.0;
+    for (int i = 0; i < n; i++) {
+        double v = random_normal_ziggurat(&rng);
+        sum_n += v;
+        sq_n += v * v;
+        // Rate 2: mean 1/2
+        sum_e += random_exponential_ziggurat(&rng, 2.0);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 0.0, sum_n / n);
+    TEST_ASSERT_FLOAT_WITHIN(0.03, 1.0, sq_n / n);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0.5, sum_e / n);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_ziggurat_moments);
+    RUN_TEST(test_batch_uniform_is_reproducible);
+    RUN_TEST(test_scalar_ziggurat_moments);
+    return UNITY_END();
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+#include <stdio.h>
+#include <time.h>
+#include "../include/neural_sim.h"
+#include "../src/utils/realtime.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void busy_wait(double seconds) {
+    double end = now_seconds() + seconds;
+    while (now_seconds() < end) {
+    }
+}
+
+void test_histogram_percentiles(void) {
+    static LatencyHistogram histogram;
+    TEST_ASSERT_EQUAL_INT(0, (int)latency_histogram_percentile(&histogram,
+                                                               0.5));
+    // Small latencies have buckets of their own
+    for (int ns = 1; ns <= 5; ns++) latency_histogram_add(&histogram, ns);
+    TEST_ASSERT_EQUAL_INT(3, (int)latency_histogram_percentile(&histogram,
+                                                               0.5));
+    TEST_ASSERT_EQUAL_INT(5, (int)latency_histogram_percentile(&histogram,
+                                                               1.0));
+
+    // Larger ones within a bucket width of 1/8
+    static LatencyHistogram spread;
+    for (long long us = 1; us <= 1000; us++) {
+        latency_histogram_add(&spread, us * 1000);
+    }
+    long long p50 = latency_histogram_percentile(&spread, 0.5);
+    long long p99 = latency_histogram_percentile(&spread, 0.99);
+    TEST_ASSERT_TRUE(p50 >= 500000 && p50 <= 500000 * 9 / 8);
+    TEST_ASSERT_TRUE(p99 >= 990000 && p99 <= 1000000);
+    TEST_ASSERT_EQUAL_INT(1000000,
+                          (int)latency_histogram_percentile(&spread, 1.0));
+    TEST_ASSERT_EQUAL_INT(1000, (int)spread.samples);
+}
+
+void test_pacer_keeps_schedule(void) {
+    const double period = 0.002;
+    RealtimePacer* pacer = create_realtime_pacer(period, 2, false);
+    TEST_ASSERT_NOT_NULL(pacer);
+    double start = now_seconds();
+    realtime_start(pacer);
+    for (int step = 0; step < 10; step++) {
+        realtime_wait(pacer);
+        // One step takes longer than two periods
+        if (step == 5) busy_wait(2.5 * period);
+        realtime_step_done(pacer);
+    }
+    realtime_finish(pacer);
+
+    // Ten releases, the last after nine periods; how long the run takes
+    // beyond that depends on the scheduler
+    TEST_ASSERT_TRUE(now_seconds() - start >= 9 * period);
+    TEST_ASSERT_EQUAL_INT(10, (int)pacer->steps);
+    TEST_ASSERT_EQUAL_INT(8, (int)pacer->latency.samples);
+    TEST_ASSERT_TRUE(pacer->overruns >= 1);
+    TEST_ASSERT_TRUE(pacer->latency.max >= (long long)(2.5 * period * 1e9));
+    destroy_realtime_pacer(pacer);
+
+    TEST_ASSERT_NULL(create_realtime_pacer(0.0, 0, false));
+}
+
+void test_paced_run_follows_clock(void) {
+    // 20 ms of simulated time at half speed
+    const char* config =
+        "num_pyramidal = 40\n"
+        "num_inhibitory = 10\n"
+        "dt = 0.1\n"
+        "output_dir = test_output\n"
+        "save_interval = 0\n"
+        "temporal_blocking = true\n"
+        "realtime = true\n"
+        "realtime_factor = 2.0\n"
+        "realtime_warmup = 10\n";
+    NeuralSimulation* sim = ns_init_from_string(config, NULL);
+    TEST_ASSERT_NOT_NULL(sim);
+    double start = now_seconds();
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_run(sim, 20.0));
+    TEST_ASSERT_TRUE(now_seconds() - start >= 0.0399);
+
+    NetworkStatistics stats;
+    TEST_ASSERT_EQUAL_INT(NS_SUCCESS, ns_calculate_statistics(sim, &stats));
+    TEST_ASSERT_EQUAL_INT(200, (int)stats.step_count);
+    TEST_ASSERT_TRUE(stats.realtime_latency_p50 > 0.0);
+    TEST_ASSERT_TRUE(stats.realtime_latency_p50 <= stats.realtime_latency_p99);
+    TEST_ASSERT_TRUE(stats.realtime_latency_p99 <= stats.realtime_latency_max);
+    // Steps after the warmup that took longer than the 0.2 ms period
+    TEST_ASSERT_TRUE(stats.realtime_overruns <= 190);
+    TEST_ASSERT_EQUAL_INT(stats.realtime_latency_max > 0.0002,
+                          stats.realtime_overruns > 0);
+    ns_stop(sim);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_percentiles);
+    RUN_TEST(test_pacer_keeps_schedule);
+    RUN_TEST(test_paced_run_follows_clock);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+#include <unity.h>
+#include <stdlib.h>
+#include "../src/core/connectivity.h"
+#include "../src/core/reorder.h"
+
+#define N 200
+#define BAND 2
+
+static bool matrix[N * N];
+static int label[N];
+static Connectivity* test_conn;
+
+// Band graph (|i - j| <= BAND) under a shuffled numbering
+void setUp(void) {
+    RandomState rng;
+    init_random(&rng, 3);
+    for (int i = 0; i < N; i++) label[i] = i;
+    for (int i = N - 1; i > 0; i--) {
+        int j = (int)(random_uniform(&rng) * (i + 1));
+        if (j > i) j = i;
+        int t = label[i];
+        label[i] = label[j];
+        label[j] = t;
+    }
+    for (int i = 0; i < N * N; i++) matrix[i] = false;
+    for (int i = 0; i < N; i++) {
+        for (int j = i - BAND; j <= i + BAND; j++) {
+            if (j >= 0 && j < N && j != i) {
+                matrix[label[i] * N + label[j]] = true;
+            }
+        }
+    }
+    test_conn = create_connectivity(matrix, N, 1.0, &rng);
+}
+
+void tearDown(void) {
+    destroy_connectivity(test_conn);
+}
+
+static int* new_ids(const int* order) {
+    int* id = malloc(N * sizeof(int));
+    for (int i = 0; i < N; i++) id[order[i]] = i;
+    return id;
+}
+
+void test_rcm_recovers_band(void) {
+    TEST_ASSERT_GREATER_THAN(N / 2, connectivity_bandwidth(test_conn));
+
+    int group_end[1] = {N};
+    int* order = reverse_cuthill_mckee(test_conn, group_end, 1);
+    TEST_ASSERT_NOT_NULL(order);
+    int* id = new_ids(order);
+    Connectivity* permuted = permute_connectivity(test_conn, id);
+    TEST_ASSERT_NOT_NULL(permuted);
+    TEST_ASSERT_LESS_OR_EQUAL(2 * BAND, connectivity_bandwidth(permuted));
+
+    destroy_connectivity(permuted);
+    free(id);
+    free(order);
+}
+
+void test_rcm_keeps_groups(void) {
+    int group_end[2] = {N / 4, N};
+    int* order = reverse_cuthill_mckee(test_conn, group_end, 2);
+    TEST_ASSERT_NOT_NULL(order);
+
+    int seen[N] = {0};
+    for (int i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL_INT(i < N / 4, order[i] < N / 4);
+        seen[order[i]]++;
+    }
+    for (int i = 0; i < N; i++) TEST_ASSERT_EQUAL_INT(1, seen[i]);
+    free(order);
+}
+
+void test_permute_preserves_synapses(void) {
+    int group_end[1] = {N};
+    int* order = reverse_cuthill_mckee(test_conn, group_end, 1);
+    int* id = new_ids(order);
+    Connectivity* permuted = permute_connectivity(test_conn, id);
+    TEST_ASSERT_EQUAL_INT(test_conn->num_synapses, permuted->num_synapses);
+
+    for (int i = 0; i < N; i++) {
+        int r = id[i];
+        TEST_ASSERT_EQUAL_INT(conn_row_end(test_conn, i) -
+                                  conn_row_begin(test_conn, i),
+                              conn_row_end(permuted, r) -
+                                  conn_row_begin(permuted, r));
+        for (int k = conn_row_begin(test_conn, i);
+             k < conn_row_end(test_conn, i); k++) {
+            int target = id[test_conn->targets[k]];
+            int found = -1;
+            for (int m = conn_row_begin(permuted, r);
+                 m < conn_row_end(permuted, r); m++) {
+                if (m > conn_row_begin(permuted, r)) {
+                    TEST_ASSERT_LESS_THAN(permuted->targets[m],
+                                          permuted->targets[m - 1]);
+                }
+                if (permuted->targets[m] == target) found = m;
+            }
+            TEST_ASSERT_TRUE(found >= 0);
+            TEST_ASSERT_EQUAL_DOUBLE(test_conn->weights[k],
+                                     permuted->weights[found]);
+        }
+    }
+
+    destroy_connectivity(permuted);
+    free(id);
+    free(order);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rcm_recovers_band);
+    RUN_TEST(test_rcm_keeps_groups);
+    RUN_TEST(test_permute_preserves_synapses);
+    return UNITY_END();
+}
@@ -0,0 +1,87 @@
+#include <unity.h>
+#include <omp.h>
+#include "../src/core/scheduler.h"
+
+#define NUM_TASKS 500
+
+static int runs[NUM_TASKS];
+static TaskScheduler* test_scheduler;
+
+void setUp(void) {
+    for (int i = 0; i < NUM_TASKS; i++) runs[i] = 0;
+    test_scheduler = create_task_scheduler(4);
+}
+
+void tearDown(void) {
+    destroy_task_scheduler(test_scheduler);
+}
+
+// Spins for cost[task] microseconds when given costs
+static void count_task(void* context, int task, int thread) {
+    (void)thread;
+    const double* cost = context;
+    double start = omp_get_wtime();
+    if (cost) {
+        while (omp_get_wtime() - start < cost[task] * 1e-6) {
+        }
+    }
+    __atomic_fetch_add(&runs[task], 1, __ATOMIC_RELAXED);
+}
+
+void test_every_task_runs_once(void) {
+    double elapsed[NUM_TASKS];
+    scheduler_run(test_scheduler, NUM_TASKS, NULL, elapsed, count_task, NULL);
+    for (int i = 0; i < NUM_TASKS; i++) {
+        TEST_ASSERT_EQUAL_INT(1, runs[i]);
+        TEST_ASSERT_TRUE(elapsed[i] >= 0.0);
+    }
+    scheduler_run(test_scheduler, 1, NULL, NULL, count_task, NULL);
+    TEST_ASSERT_EQUAL_INT(2, runs[0]);
+}
+
+void test_split_follows_cost(void) {
+    // All the cost sits in the last quarter of the tasks
+    static double cost[NUM_TASKS];
+    for (int i = 0; i < NUM_TASKS; i++) cost[i] = i < 3 * NUM_TASKS / 4;
+    for (int i = 3 * NUM_TASKS / 4; i < NUM_TASKS; i++) cost[i] = 100.0;
+    scheduler_run(test_scheduler, NUM_TASKS, cost, NULL, count_task, cost);
+
+    const int* split = test_scheduler->split;
+    TEST_ASSERT_EQUAL_INT(0, split[0]);
+    TEST_ASSERT_EQUAL_INT(NUM_TASKS, split[4]);
+    TEST_ASSERT_GREATER_OR_EQUAL(3 * NUM_TASKS / 4, split[1]);
+    for (int i = 0; i < NUM_TASKS; i++) TEST_ASSERT_EQUAL_INT(1, runs[i]);
+}
+
+void test_zero_cost_splits_evenly(void) {
+    static double cost[NUM_TASKS];
+    scheduler_run(test_scheduler, NUM_TASKS, cost, NULL, count_task, NULL);
+    for (int t = 0; t <= 4; t++) {
+        TEST_ASSERT_EQUAL_INT(NUM_TASKS * t / 4, test_scheduler->split[t]);
+    }
+}
+
+void test_stats_accumulate(void) {
+    scheduler_run(test_scheduler, NUM_TASKS, NULL, NULL, count_task, NULL);
+    double busy = 0.0;
+    for (int t = 0; t < test_scheduler->num_threads; t++) {
+        TEST_ASSERT_TRUE(test_scheduler->busy_time[t] >= 0.0);
+        TEST_ASSERT_TRUE(test_scheduler->idle_time[t] >= 0.0);
+        busy += test_scheduler->busy_time[t];
+    }
+    TEST_ASSERT_TRUE(busy > 0.0);
+    TEST_ASSERT_TRUE(scheduler_imbalance(test_scheduler) >= 1.0);
+
+    scheduler_reset_stats(test_scheduler);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, test_scheduler->busy_time[0]);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, scheduler_imbalance(test_scheduler));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_every_task_runs_once);
+    RUN_TEST(test_split_follows_cost);
+    RUN_TEST(test_zero_cost_splits_evenly);
+    RUN_TEST(test_stats_accumulate);
+    return UNITY_END();
+}
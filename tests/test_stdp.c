@@ -0,0 +1,114 @@
+#include <unity.h>
+#include "../src/core/connectivity.h"
+#include "../src/mechanisms/stdp.h"
+
+// 0 -> 1, 0 -> 2, 1 -> 2
+static const bool test_matrix[9] = {
+    false, true,  true,
+    false, false, true,
+    false, false, false
+};
+
+static Connectivity* test_conn;
+static STDPState* test_stdp;
+
+void setUp(void) {
+    STDPParams params = {
+        .a_plus = 0.1,
+        .a_minus = 0.1,
+        .tau_plus = 20.0,
+        .tau_minus = 20.0,
+        .w_min = 0.0,
+        .w_max = 1.0
+    };
+
+    RandomState rng;
+    init_random(&rng, 1);
+    test_conn = create_connectivity(test_matrix, 3, 0.0, &rng);
+    for (int k = 0; k < test_conn->num_synapses; k++) {
+        test_conn->weights[k] = 0.5;
+    }
+    test_stdp = create_stdp_state(3, params, 1.0);
+}
+
+void tearDown(void) {
+    destroy_stdp_state(test_stdp);
+    destroy_connectivity(test_conn);
+}
+
+void test_transposed_index(void) {
+    TEST_ASSERT_EQUAL_INT(3, test_conn->num_synapses);
+    TEST_ASSERT_EQUAL_INT(0, conn_col_end(test_conn, 0) - conn_col_begin(test_conn, 0));
+    TEST_ASSERT_EQUAL_INT(2, conn_col_end(test_conn, 2) - conn_col_begin(test_conn, 2));
+
+    for (int j = 0; j < 3; j++) {
+        for (int e = conn_col_begin(test_conn, j); e < conn_col_end(test_conn, j); e++) {
+            TEST_ASSERT_EQUAL_INT(j, test_conn->targets[test_conn->col_synapse[e]]);
+        }
+    }
+}
+
+void test_pre_then_post_potentiates(void) {
+    int pre = 0, post = 1;
+    stdp_process_spikes(test_stdp, test_conn, &pre, 1, NULL);
+    stdp_decay_traces(test_stdp);
+    stdp_process_spikes(test_stdp, test_conn, &post, 1, NULL);
+
+    // Synapse 0 -> 1 is the first entry of row 0
+    TEST_ASSERT_GREATER_THAN(0.5, test_conn->weights[conn_row_begin(test_conn, 0)]);
+}
+
+void test_post_then_pre_depresses(void) {
+    int pre = 0, post = 1;
+    stdp_process_spikes(test_stdp, test_conn, &post, 1, NULL);
+    stdp_decay_traces(test_stdp);
+    stdp_process_spikes(test_stdp, test_conn, &pre, 1, NULL);
+
+    TEST_ASSERT_LESS_THAN(0.5, test_conn->weights[conn_row_begin(test_conn, 0)]);
+}
+
+void test_silent_synapses_untouched(void) {
+    int post = 1;
+    stdp_process_spikes(test_stdp, test_conn, &post, 1, NULL);
+
+    // 1 -> 2 and 0 -> 2 carry no spike activity
+    TEST_ASSERT_EQUAL_DOUBLE(0.5, test_conn->weights[conn_row_begin(test_conn, 1)]);
+    TEST_ASSERT_EQUAL_DOUBLE(0.5, test_conn->weights[conn_row_begin(test_conn, 0) + 1]);
+}
+
+void test_reward_gates_weight_change(void) {
+    EligibilityParams params = {
+        .tau = 100.0,
+        .learning_rate = 1.0,
+        .baseline_rate = 0.0
+    };
+    EligibilityState* elig = create_eligibility_state(test_conn->num_synapses, params, 1.0);
+    test_stdp->eligibility = elig;
+
+    int pre = 0, post = 1;
+    stdp_process_spikes(test_stdp, test_conn, &pre, 1, NULL);
+    stdp_decay_traces(test_stdp);
+    eligibility_advance(elig);
+    stdp_process_spikes(test_stdp, test_conn, &post, 1, NULL);
+
+    // Pairing only tags the synapse
+    int k = conn_row_begin(test_conn, 0);
+    TEST_ASSERT_EQUAL_DOUBLE(0.5, test_conn->weights[k]);
+    TEST_ASSERT_GREATER_THAN(0.0, elig->trace[k]);
+
+    eligibility_commit_reward(elig, test_conn, 1.0, 0.0, 1.0);
+    TEST_ASSERT_GREATER_THAN(0.5, test_conn->weights[k]);
+
+    test_stdp->eligibility = NULL;
+    destroy_eligibility_state(elig);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_transposed_index);
+    RUN_TEST(test_pre_then_post_potentiates);
+    RUN_TEST(test_post_then_pre_depresses);
+    RUN_TEST(test_silent_synapses_untouched);
+    RUN_TEST(test_reward_gates_weight_change);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+#include <unity.h>
+#include "../src/core/connectivity.h"
+#include "../src/mechanisms/structural.h"
+
+#define N 50
+
+static bool matrix[N * N];
+static Connectivity* test_conn;
+
+static StructuralParams test_params(void) {
+    StructuralParams params = {
+        .interval = 1.0,
+        .prune_weight = 0.01,
+        .prune_checks = 2,
+        .formation_rate = 0.0,
+        .initial_weight = 0.05,
+        .slack = 0.1,
+    };
+    return params;
+}
+
+void setUp(void) {
+    RandomState rng;
+    init_random(&rng, 5);
+    for (int i = 0; i < N * N; i++) {
+        matrix[i] = i / N != i % N && random_uniform(&rng) < 0.2;
+    }
+    Connectivity* packed = create_connectivity(matrix, N, 0.1, &rng);
+    test_conn = connectivity_with_slack(packed, 0.1, NULL);
+    destroy_connectivity(packed);
+}
+
+void tearDown(void) {
+    destroy_connectivity(test_conn);
+}
+
+// Every synapse sits in its target's column and nowhere else
+static void check_index(const Connectivity* conn) {
+    int entries = 0;
+    for (int t = 0; t < conn->num_neurons; t++) {
+        entries += conn_col_end(conn, t) - conn_col_begin(conn, t);
+    }
+    TEST_ASSERT_EQUAL_INT(conn->num_synapses, entries);
+    for (int i = 0; i < conn->num_neurons; i++) {
+        for (int k = conn_row_begin(conn, i); k < conn_row_end(conn, i); k++) {
+            int t = conn->targets[k];
+            int e = conn->synapse_col[k];
+            TEST_ASSERT_TRUE(e >= conn_col_begin(conn, t) &&
+                             e < conn_col_end(conn, t));
+            TEST_ASSERT_EQUAL_INT(i, conn->col_sources[e]);
+            TEST_ASSERT_EQUAL_INT(k, conn->col_synapse[e]);
+        }
+    }
+}
+
+void test_add_and_remove_keep_index(void) {
+    int synapses = test_conn->num_synapses;
+    TEST_ASSERT_GREATER_THAN(synapses, conn_num_slots(test_conn));
+    check_index(test_conn);
+
+    // Remove every other synapse of row 0, then refill it until it is full
+    int row = conn_row_end(test_conn, 0) - conn_row_begin(test_conn, 0);
+    int begin = conn_row_begin(test_conn, 0);
+    for (int k = conn_row_end(test_conn, 0) - 2; k >= begin; k -= 2) {
+        connectivity_remove_synapse(test_conn, 0, k);
+    }
+    check_index(test_conn);
+    TEST_ASSERT_EQUAL_INT(synapses - row / 2, test_conn->num_synapses);
+
+    int added = 0;
+    for (int t = 1; t < N; t++) {
+        bool present = false;
+        for (int k = conn_row_begin(test_conn, 0);
+             k < conn_row_end(test_conn, 0); k++) {
+            present |= test_conn->targets[k] == t;
+        }
+        if (present) continue;
+        if (connectivity_add_synapse(test_conn, 0, t, 0.5) < 0) break;
+        added++;
+    }
+    check_index(test_conn);
+    TEST_ASSERT_EQUAL_INT(test_conn->row_ptr[1], conn_row_end(test_conn, 0));
+    TEST_ASSERT_EQUAL_INT(synapses - row / 2 + added, test_conn->num_synapses);
+}
+
+void test_silent_synapses_are_pruned(void) {
+    StructuralParams params = test_params();
+    StructuralState* structural = create_structural_state(
+        N, conn_num_slots(test_conn), params, 1.0, 1);
+    TEST_ASSERT_NOT_NULL(structural);
+
+    int silent = 0;
+    for (int i = 0; i < N; i++) {
+        for (int k = conn_row_begin(test_conn, i);
+             k < conn_row_end(test_conn, i); k++) {
+            silent += test_conn->weights[k] < params.prune_weight;
+        }
+    }
+    int synapses = test_conn->num_synapses;
+    TEST_ASSERT_GREATER_THAN(0, silent);
+
+    // One silent rewiring is not enough, the second prunes
+    TEST_ASSERT_TRUE(structural_record_spikes(structural, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(0, structural_rewire(structural, &test_conn, NULL));
+    TEST_ASSERT_EQUAL_INT(synapses, test_conn->num_synapses);
+    structural_record_spikes(structural, NULL, 0);
+    TEST_ASSERT_EQUAL_INT(0, structural_rewire(structural, &test_conn, NULL));
+    TEST_ASSERT_EQUAL_INT(synapses - silent, test_conn->num_synapses);
+    TEST_ASSERT_EQUAL_INT(silent, structural->pruned);
+    check_index(test_conn);
+    for (int i = 0; i < N; i++) {
+        for (int k = conn_row_begin(test_conn, i);
+             k < conn_row_end(test_conn, i); k++) {
+            TEST_ASSERT_TRUE(test_conn->weights[k] >= params.prune_weight);
+        }
+    }
+    destroy_structural_state(structural);
+}
+
+void test_active_neurons_wire_together(void) {
+    StructuralParams params = test_params();
+    params.prune_weight = 0.0;
+    params.formation_rate = 20000.0;  // 1000 attempts per rewiring
+    StructuralState* structural = create_structural_state(
+        N, conn_num_slots(test_conn), params, 1.0, 1);
+    EligibilityParams elig_params = {1000.0, 1.0, 0.1};
+    EligibilityState* elig =
+        create_eligibility_state(conn_num_slots(test_conn), elig_params, 1.0);
+    TEST_ASSERT_NOT_NULL(structural);
+    TEST_ASSERT_NOT_NULL(elig);
+
+    // Only neurons 0..9 spike; they end up all-to-all, which overflows
+    // the slack of their rows and forces a new layout
+    const int active[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    int synapses = test_conn->num_synapses;
+    for (int r = 0; r < 3; r++) {
+        structural_record_spikes(structural, active, 10);
+        TEST_ASSERT_EQUAL_INT(0,
+                              structural_rewire(structural, &test_conn, elig));
+    }
+    TEST_ASSERT_GREATER_THAN(0, structural->relayouts);
+    check_index(test_conn);
+    TEST_ASSERT_EQUAL_INT(conn_num_slots(test_conn), elig->num_synapses);
+    TEST_ASSERT_EQUAL_INT(synapses + structural->formed,
+                          test_conn->num_synapses);
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < 10; j++) {
+            bool present = false;
+            for (int k = conn_row_begin(test_conn, i);
+                 k < conn_row_end(test_conn, i); k++) {
+                present |= test_conn->targets[k] == j;
+            }
+            TEST_ASSERT_EQUAL_INT(i != j, present);
+        }
+    }
+    destroy_eligibility_state(elig);
+    destroy_structural_state(structural);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_add_and_remove_keep_index);
+    RUN_TEST(test_silent_synapses_are_pruned);
+    RUN_TEST(test_active_neurons_wire_together);
+    return UNITY_END();
+}
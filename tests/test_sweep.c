@@ -0,0 +1,112 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "../src/core/network.h"
+#include "../src/utils/config.h"
+#include "../src/utils/sweep.h"
+
+#define CONNECTOME_PATH "test_output/connectome.bin"
+
+void setUp(void) {
+    mkdir("test_output", 0755);
+}
+
+void tearDown(void) {
+    remove(CONNECTOME_PATH);
+}
+
+static void free_runs(char** runs, int num_runs) {
+    for (int r = 0; r < num_runs; r++) free(runs[r]);
+    free(runs);
+}
+
+void test_grid_runs_every_combination(void) {
+    SweepSpec* spec = parse_sweep_spec(
+        "mode = grid\n"
+        "random_seed = 1, 2   # connectomes\n"
+        "dt = 0.1, 0.05, 0.025\n");
+    TEST_ASSERT_NOT_NULL(spec);
+    TEST_ASSERT_EQUAL_INT(2, spec->num_params);
+
+    int num_runs = 0;
+    char** runs = sweep_runs(spec, &num_runs);
+    TEST_ASSERT_EQUAL_INT(6, num_runs);
+    TEST_ASSERT_EQUAL_STRING("random_seed=1\ndt=0.1\n", runs[0]);
+    TEST_ASSERT_EQUAL_STRING("random_seed=1\ndt=0.05\n", runs[1]);
+    TEST_ASSERT_EQUAL_STRING("random_seed=2\ndt=0.025\n", runs[5]);
+
+    free_runs(runs, num_runs);
+    destroy_sweep_spec(spec);
+    // Keys the simulation does not read would give identical runs
+    TEST_ASSERT_NULL(parse_sweep_spec("baseline_dopamine = 0.1, 0.2\n"));
+}
+
+void test_random_search_draws_in_range(void) {
+    SweepSpec* spec = parse_sweep_spec(
+        "mode = random\nsamples = 50\nseed = 3\n"
+        "w_exc = 0.5 : 1.5\nneuron_model = lif, adex\n");
+    TEST_ASSERT_NOT_NULL(spec);
+    TEST_ASSERT_TRUE(spec->params[0].range);
+
+    int num_runs = 0;
+    char** runs = sweep_runs(spec, &num_runs);
+    TEST_ASSERT_EQUAL_INT(50, num_runs);
+    for (int r = 0; r < num_runs; r++) {
+        double w = 0.0;
+        char model[16];
+        TEST_ASSERT_EQUAL_INT(2, sscanf(runs[r], "w_exc=%lf\nneuron_model=%15s",
+                                        &w, model));
+        TEST_ASSERT_TRUE(w >= 0.5 && w <= 1.5);
+        TEST_ASSERT_TRUE(strcmp(model, "lif") == 0 ||
+                         strcmp(model, "adex") == 0);
+    }
+
+    free_runs(runs, num_runs);
+    destroy_sweep_spec(spec);
+    // Grids only take value lists
+    TEST_ASSERT_NULL(parse_sweep_spec("w_exc = 0.5 : 1.5\n"));
+}
+
+void test_mapped_connectome_matches_built(void) {
+    SimulationConfig* config = create_default_config();
+    config->network.num_pyramidal = 80;
+    config->network.num_inhibitory = 20;
+    config->network.reorder = REORDER_RCM;
+    TEST_ASSERT_EQUAL_INT(0, save_network_connectome(config->network,
+                                                     CONNECTOME_PATH));
+
+    Network* built = create_network(config->network);
+    config->network.connectome_file = strdup(CONNECTOME_PATH);
+    Network* mapped = create_network(config->network);
+    TEST_ASSERT_NOT_NULL(built);
+    TEST_ASSERT_NOT_NULL(mapped);
+
+    const Connectivity* a = built->connectivity;
+    const Connectivity* b = mapped->connectivity;
+    TEST_ASSERT_NOT_NULL(b->mapping);
+    TEST_ASSERT_EQUAL_INT(a->num_synapses, b->num_synapses);
+    TEST_ASSERT_EQUAL_INT_ARRAY(a->row_ptr, b->row_ptr, a->num_neurons + 1);
+    TEST_ASSERT_EQUAL_INT_ARRAY(a->targets, b->targets, a->num_synapses);
+    TEST_ASSERT_EQUAL_INT_ARRAY(a->col_sources, b->col_sources,
+                                a->num_synapses);
+    TEST_ASSERT_EQUAL_INT_ARRAY(built->internal_id, mapped->internal_id, 100);
+    for (int k = 0; k < a->num_synapses; k++) {
+        TEST_ASSERT_EQUAL_DOUBLE(a->weights[k], b->weights[k]);
+    }
+    destroy_network(built);
+    destroy_network(mapped);
+
+    // A file built for another network is refused
+    config->network.seed++;
+    TEST_ASSERT_NULL(create_network(config->network));
+    destroy_config(config);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_grid_runs_every_combination);
+    RUN_TEST(test_random_search_draws_in_range);
+    RUN_TEST(test_mapped_connectome_matches_built);
+    return UNITY_END();
+}
@@ -0,0 +1,44 @@
+#include <unity.h>
+#include "../src/utils/trace_pyramid.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_trace_pyramid_buckets(void) {
+    const char* names[2] = {"ramp", "square"};
+    TracePyramid* pyramid = create_trace_pyramid("test_traces", names, 2, 0.1);
+    TEST_ASSERT_NOT_NULL(pyramid);
+    for (int i = 0; i < 16; i++) {
+        double values[2] = {i, (i & 1) ? 1.0 : -1.0};
+        trace_pyramid_push(pyramid, values);
+    }
+    trace_pyramid_flush(pyramid);
+    TEST_ASSERT_EQUAL_INT(5, pyramid->num_levels);
+
+    // Level 2: buckets of four samples, (min, max, mean) per channel
+    float records[4 * 6];
+    TEST_ASSERT_EQUAL_INT(4, trace_pyramid_read("test_traces", 2, 0, 4, 2,
+                                                records));
+    TEST_ASSERT_EQUAL_DOUBLE(4.0, records[6 + 0]);
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, records[6 + 1]);
+    TEST_ASSERT_EQUAL_DOUBLE(5.5, records[6 + 2]);
+    TEST_ASSERT_EQUAL_DOUBLE(-1.0, records[6 + 3]);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, records[6 + 4]);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, records[6 + 5]);
+
+    // The top level summarises the whole run
+    TEST_ASSERT_EQUAL_INT(1, trace_pyramid_read("test_traces", 4, 0, 4, 2,
+                                                records));
+    TEST_ASSERT_EQUAL_DOUBLE(7.5, records[2]);
+
+    TEST_ASSERT_EQUAL_INT(0, trace_pyramid_level_for(16, 16));
+    TEST_ASSERT_EQUAL_INT(2, trace_pyramid_level_for(16, 4));
+    TEST_ASSERT_EQUAL_INT(3, trace_pyramid_level_for(1000, 125));
+    destroy_trace_pyramid(pyramid);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_trace_pyramid_buckets);
+    return UNITY_END();
+}
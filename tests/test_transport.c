@@ -0,0 +1,124 @@
+#include <unity.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../src/utils/transport.h"
+
+#define RANKS 4
+#define CAPACITY 8
+#define ROUNDS 50
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Rank r sends (r + round) % 4 records {r, k}; returns 0 if every round
+// received everyone's records in rank order
+static int run_rank(TransportKind kind, const char* name, int rank) {
+    SpikeTransport* transport =
+        create_transport(kind, name, rank, RANKS, CAPACITY);
+    if (!transport) return 1;
+    SpikeRecord send[CAPACITY], recv[RANKS * CAPACITY];
+    int status = 0;
+    for (int round = 0; round < ROUNDS && status == 0; round++) {
+        int count = (rank + round) % 4;
+        for (int k = 0; k < count; k++) {
+            send[k].id = rank;
+            send[k].step = k;
+        }
+        int total = transport->exchange(transport, send, count, recv);
+        int n = 0;
+        for (int r = 0; r < RANKS; r++) {
+            for (int k = 0; k < (r + round) % 4; k++, n++) {
+                if (n >= total || recv[n].id != r || recv[n].step != k) {
+                    status = 2;
+                }
+            }
+        }
+        if (total != n) status = 3;
+    }
+    destroy_transport(transport);
+    return status;
+}
+
+static void check_exchange(TransportKind kind, const char* name) {
+    pid_t children[RANKS];
+    for (int r = 1; r < RANKS; r++) {
+        children[r] = fork();
+        if (children[r] == 0) _exit(run_rank(kind, name, r));
+    }
+    TEST_ASSERT_EQUAL_INT(0, run_rank(kind, name, 0));
+    for (int r = 1; r < RANKS; r++) {
+        int status = -1;
+        waitpid(children[r], &status, 0);
+        TEST_ASSERT_TRUE(WIFEXITED(status));
+        TEST_ASSERT_EQUAL_INT(0, WEXITSTATUS(status));
+    }
+}
+
+void test_shm_exchange_in_rank_order(void) {
+    char name[64];
+    snprintf(name, sizeof(name), "/neuralsim_test_%d", (int)getpid());
+    check_exchange(TRANSPORT_SHM, name);
+}
+
+void test_socket_exchange_in_rank_order(void) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/neuralsim_test_%d.sock", (int)getpid());
+    check_exchange(TRANSPORT_SOCKET, path);
+}
+
+void test_rejects_oversized_send(void) {
+    SpikeTransport* transport =
+        create_transport(TRANSPORT_SHM, "/neuralsim_test_single", 0, 1, 2);
+    TEST_ASSERT_NOT_NULL(transport);
+    SpikeRecord send[3] = {{0, 0}, {1, 0}, {2, 0}}, recv[2];
+    TEST_ASSERT_EQUAL_INT(-1, transport->exchange(transport, send, 3, recv));
+    TEST_ASSERT_EQUAL_INT(2, transport->exchange(transport, send, 2, recv));
+    TEST_ASSERT_EQUAL_INT(1, recv[1].id);
+    destroy_transport(transport);
+}
+
+void test_dense_steps_pack_as_bits(void) {
+    // Two ranks' windows of 3 steps: rank 0 owns 0..199 and fires 40
+    // neurons in step 1, rank 1 owns 200..299 and fires sparsely
+    SpikeRecord spikes[64], packed[128];
+    int count = 0;
+    spikes[count++] = (SpikeRecord){7, 0};
+    for (int i = 0; i < 40; i++) spikes[count++] = (SpikeRecord){i * 5, 1};
+    spikes[count++] = (SpikeRecord){3, 2};
+    spikes[count++] = (SpikeRecord){150, 2};
+    int n = transport_pack_spikes(spikes, count, 0, 200, packed);
+    TEST_ASSERT_EQUAL_INT(1 + 2 + 4 + 2, n);
+    TEST_ASSERT_EQUAL_INT(SPIKE_BITS_MARK, packed[1].id);
+
+    SpikeRecord other[2] = {{201, 1}, {299, 2}};
+    n += transport_pack_spikes(other, 2, 200, 300, packed + n);
+    TEST_ASSERT_EQUAL_INT(11, n);
+
+    int offsets[4], ids[64];
+    TEST_ASSERT_EQUAL_INT(count + 2,
+                          transport_unpack_spikes(packed, n, 3, offsets, ids));
+    TEST_ASSERT_EQUAL_INT(0, offsets[0]);
+    TEST_ASSERT_EQUAL_INT(1, offsets[1]);
+    TEST_ASSERT_EQUAL_INT(42, offsets[2]);
+    TEST_ASSERT_EQUAL_INT(45, offsets[3]);
+    TEST_ASSERT_EQUAL_INT(7, ids[0]);
+    for (int i = 0; i < 40; i++) TEST_ASSERT_EQUAL_INT(i * 5, ids[1 + i]);
+    TEST_ASSERT_EQUAL_INT(201, ids[41]);
+    TEST_ASSERT_EQUAL_INT(3, ids[42]);
+    TEST_ASSERT_EQUAL_INT(150, ids[43]);
+    TEST_ASSERT_EQUAL_INT(299, ids[44]);
+
+    // A block cut short is refused
+    TEST_ASSERT_EQUAL_INT(-1, transport_unpack_spikes(packed, 5, 3, offsets,
+                                                      ids));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_shm_exchange_in_rank_order);
+    RUN_TEST(test_socket_exchange_in_rank_order);
+    RUN_TEST(test_rejects_oversized_send);
+    RUN_TEST(test_dense_steps_pack_as_bits);
+    return UNITY_END();
+}
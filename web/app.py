@@ -5,16 +5,28 @@ import os
 from threading import Thread
 import numpy as np
 
+import neuralsim
+from live_view import LiveView
+import trace_pyramid
+
 app = Flask(__name__)
 
 # Proje kök dizinini belirle
 PROJECT_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
 NEURAL_SIM_PATH = os.path.join(PROJECT_ROOT, 'build', 'neural_sim')
 OUTPUT_DIR = os.path.join(PROJECT_ROOT, 'output')
+TRACES_DIR = os.path.join(OUTPUT_DIR, 'traces')
+
+# Kütüphane derlendiyse simülasyon süreç başlatmadan aynı süreçte çalışır
+NEURAL_SIM_LIB = neuralsim.load_library(os.path.join(PROJECT_ROOT, 'build'))
 
 simulation_running = False
 current_progress = 0
 
+# Simülatörün canlı durumu yayınladığı paylaşımlı bellek
+LIVE_VIEW_NAME = f'/neuralsim_{os.getpid()}'
+live_view = None
+
 def read_network_state(filename):
     data = {}
     try:
@@ -27,11 +39,38 @@ def read_network_state(filename):
         pass
     return data
 
-def run_simulation(config):
+def run_simulation_in_process(config):
     global simulation_running, current_progress
+
+    def on_progress(progress):
+        global current_progress
+        current_progress = progress * 100.0
+
+    simulation_running = True
+    sim = None
+    try:
+        config = dict(config, output_dir=OUTPUT_DIR)
+        sim = neuralsim.Simulation(NEURAL_SIM_LIB, config, on_progress)
+        sim.run()
+    except RuntimeError as e:
+        print(f"Simulation failed: {e}")
+    finally:
+        if sim:
+            sim.stop()
+        simulation_running = False
+
+def run_simulation(config):
+    global simulation_running, current_progress, live_view
     
     # Çıktı dizinini oluştur
     os.makedirs(OUTPUT_DIR, exist_ok=True)
+    if live_view:
+        live_view.close()
+        live_view = None
+    config = dict(config, live_view=LIVE_VIEW_NAME, record_traces='true')
+    if NEURAL_SIM_LIB:
+        run_simulation_in_process(config)
+        return
     
     # Geçici config dosyasını proje kök dizinine kaydet
     config_path = os.path.join(PROJECT_ROOT, 'temp_config.ini')
@@ -66,7 +105,7 @@ def index():
 
 @app.route('/start_simulation', methods=['POST'])
 def start_simulation():
-    if not os.path.exists(NEURAL_SIM_PATH):
+    if not NEURAL_SIM_LIB and not os.path.exists(NEURAL_SIM_PATH):
         return jsonify({
             'status': 'error',
             'message': 'Neural simulation executable not found. Please build the project first.'
@@ -83,6 +122,46 @@ def simulation_status():
         'progress': current_progress
     })
 
+@app.route('/live_state')
+def live_state():
+    global live_view
+    if not live_view:
+        try:
+            live_view = LiveView(LIVE_VIEW_NAME)
+        except (OSError, ValueError):
+            return jsonify({'available': False})
+
+    state = live_view.snapshot()
+    if not state:
+        return jsonify({'available': False})
+    steps = int(request.args.get('steps', live_view.tile_steps))
+    times, ids = live_view.raster(steps)
+    state.update({
+        'available': True,
+        'spike_times': times.tolist(),
+        'spike_ids': ids.tolist(),
+    })
+    return jsonify(state)
+
+@app.route('/traces')
+def traces():
+    # İstenen zaman aralığı ekran çözünürlüğünde döner; probe=<name>
+    # seçilirse o probe'un izleri okunur
+    directory = TRACES_DIR
+    probe = request.args.get('probe')
+    if probe:
+        if '/' in probe or probe.startswith('.'):
+            return jsonify({'available': False})
+        directory = os.path.join(OUTPUT_DIR, 'probes', probe + '_traces')
+    if not os.path.exists(os.path.join(directory, 'index.txt')):
+        return jsonify({'available': False})
+    t0 = float(request.args.get('t0', 0.0))
+    t1 = float(request.args.get('t1', float('inf')))
+    points = int(request.args.get('points', 1000))
+    result = trace_pyramid.query(directory, t0, t1, points)
+    result['available'] = True
+    return jsonify(result)
+
 @app.route('/get_results')
 def get_results():
     states = []
@@ -0,0 +1,85 @@
+"""Reader for the simulator's shared-memory live view (src/utils/live_view.h)."""
+import mmap
+import os
+import struct
+
+import numpy as np
+
+MAGIC = 0x315657564c534e00
+STATIC_FORMAT = '<QIIIIIIII'
+
+
+class LiveView:
+    def __init__(self, name):
+        path = os.path.join('/dev/shm', name.lstrip('/'))
+        with open(path, 'rb') as f:
+            self.mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        (magic, self.version, self.header_size, self.num_neurons,
+         self.num_populations, self.num_phases, self.tile_steps,
+         self.num_tiles, self.words_per_row) = struct.unpack_from(
+            STATIC_FORMAT, self.mm, 0)
+        if magic != MAGIC:
+            self.mm.close()
+            raise ValueError(f"{name} is not a live view")
+
+        offset = struct.calcsize(STATIC_FORMAT)
+        pops = self.num_populations
+        self.population_size = struct.unpack_from(f'<{pops}I', self.mm, offset)
+        offset += 4 * pops
+        offset += -offset % 8
+        (self.dt,) = struct.unpack_from('<d', self.mm, offset)
+        self.sequence_offset = offset + 8
+        self.dynamic_format = f'<QQd{pops}d{pops}Q{self.num_phases}d'
+        self.rows = self.num_tiles * self.tile_steps
+
+    def close(self):
+        self.mm.close()
+
+    def snapshot(self, retries=10000):
+        """Consistent copy of the header fields, or None if never settled."""
+        for _ in range(retries):
+            values = struct.unpack_from(self.dynamic_format, self.mm,
+                                        self.sequence_offset)
+            (after,) = struct.unpack_from('<Q', self.mm, self.sequence_offset)
+            if values[0] % 2 == 0 and values[0] == after:
+                return self._decode(values)
+        return None
+
+    def _decode(self, values):
+        pops, phases = self.num_populations, self.num_phases
+        rates = values[3:3 + pops]
+        totals = values[3 + pops:3 + 2 * pops]
+        return {
+            'step': values[1],
+            'time': values[2],
+            'rates': list(rates),
+            'total_spikes': list(totals),
+            'phase_time': list(values[3 + 2 * pops:3 + 2 * pops + phases]),
+        }
+
+    def raster(self, steps):
+        """(times, ids) of spikes in up to `steps` most recent steps."""
+        first = self.snapshot()
+        if not first or first['step'] == 0:
+            return np.empty(0), np.empty(0, dtype=np.int64)
+        end = first['step']
+        begin = max(0, end - min(steps, self.rows))
+        row_bytes = self.words_per_row * 8
+        rows = []
+        for step in range(begin, end):
+            start = self.header_size + (step % self.rows) * row_bytes
+            rows.append(np.frombuffer(self.mm, np.uint8, row_bytes, start).copy())
+
+        # Rows the writer reached again while we were copying are stale
+        last = self.snapshot()
+        if last:
+            begin = max(begin, last['step'] - self.rows + 1)
+            rows = rows[len(rows) - (end - begin):] if end > begin else []
+        if not rows:
+            return np.empty(0), np.empty(0, dtype=np.int64)
+
+        bits = np.unpackbits(np.stack(rows), axis=1, bitorder='little')
+        step_index, ids = np.nonzero(bits[:, :self.num_neurons])
+        # Step s is simulated at time[end] - (end - s) * dt
+        times = first['time'] - (end - (begin + step_index)) * self.dt
+        return times, ids
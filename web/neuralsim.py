@@ -0,0 +1,77 @@
+"""ctypes binding to libneuralsim, the embeddable simulation library."""
+import ctypes
+import os
+
+ProgressCallback = ctypes.CFUNCTYPE(None, ctypes.c_double, ctypes.c_void_p)
+StateCallback = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_void_p)
+ErrorCallback = ctypes.CFUNCTYPE(None, ctypes.c_int, ctypes.c_char_p,
+                                 ctypes.c_void_p)
+
+
+class SimulationCallbacks(ctypes.Structure):
+    _fields_ = [
+        ('progress_cb', ProgressCallback),
+        ('state_cb', StateCallback),
+        ('error_cb', ErrorCallback),
+        ('user_data', ctypes.c_void_p),
+        ('progress_interval', ctypes.c_double),
+        ('save_interval', ctypes.c_double),
+    ]
+
+
+class NeuralSimLibrary:
+    def __init__(self, path):
+        lib = ctypes.CDLL(path)
+        lib.ns_init_from_string.restype = ctypes.c_void_p
+        lib.ns_init_from_string.argtypes = [
+            ctypes.c_char_p, ctypes.POINTER(SimulationCallbacks)]
+        lib.ns_run.restype = ctypes.c_int
+        lib.ns_run.argtypes = [ctypes.c_void_p, ctypes.c_double]
+        for name in ('ns_pause', 'ns_resume', 'ns_stop'):
+            getattr(lib, name).restype = ctypes.c_int
+            getattr(lib, name).argtypes = [ctypes.c_void_p]
+        lib.ns_get_last_error.restype = ctypes.c_char_p
+        self.lib = lib
+
+    def last_error(self):
+        return self.lib.ns_get_last_error().decode()
+
+
+class Simulation:
+    """One simulation instance; several may run in the same process."""
+
+    def __init__(self, library, config, on_progress=None,
+                 progress_interval=0.0):
+        self.library = library
+        text = ''.join(f"{key} = {value}\n" for key, value in config.items())
+        # Keep the ctypes callback alive as long as the simulation
+        self._progress = (
+            ProgressCallback(lambda progress, _: on_progress(progress))
+            if on_progress else ProgressCallback())
+        self._callbacks = SimulationCallbacks(
+            progress_cb=self._progress, progress_interval=progress_interval)
+        self.handle = library.lib.ns_init_from_string(
+            text.encode(), ctypes.byref(self._callbacks))
+        if not self.handle:
+            raise RuntimeError(library.last_error())
+
+    def run(self, duration=-1.0):
+        # ctypes releases the GIL for the duration of the call
+        if self.library.lib.ns_run(self.handle, duration) != 0:
+            raise RuntimeError(self.library.last_error())
+
+    def pause(self):
+        self.library.lib.ns_pause(self.handle)
+
+    def resume(self):
+        self.library.lib.ns_resume(self.handle)
+
+    def stop(self):
+        if self.handle:
+            self.library.lib.ns_stop(self.handle)
+            self.handle = None
+
+
+def load_library(build_dir):
+    path = os.path.join(build_dir, 'libneuralsim.so')
+    return NeuralSimLibrary(path) if os.path.exists(path) else None
@@ -41,6 +41,7 @@ document.getElementById('simulation-form').addEventListener('submit', async (e)
         
         document.getElementById('progress').style.width = `${status.progress}%`;
         document.getElementById('progress-text').textContent = `${status.progress.toFixed(1)}%`;
+        updateLiveView();
         
         if (!status.running) {
             clearInterval(statusInterval);
@@ -51,7 +52,85 @@ document.getElementById('simulation-form').addEventListener('submit', async (e)
     }, 1000);
 });
 
+async function updateLiveView() {
+    const response = await fetch('/live_state');
+    const live = await response.json();
+    if (!live.available) {
+        return;
+    }
+
+    Plotly.react('live-plot', [{
+        x: live.spike_times,
+        y: live.spike_ids,
+        type: 'scattergl',
+        mode: 'markers',
+        marker: {size: 3, color: '#333'}
+    }], {
+        title: `t = ${live.time.toFixed(1)} ms, ` +
+               `pyramidal ${live.rates[0].toFixed(1)} Hz, ` +
+               `inhibitory ${live.rates[1].toFixed(1)} Hz`,
+        xaxis: {title: 'Time (ms)'},
+        yaxis: {title: 'Neuron'},
+        paper_bgcolor: 'white',
+        plot_bgcolor: 'white',
+        showlegend: false
+    });
+}
+
+// Rate traces at screen resolution from the min/max/mean pyramid; zooming
+// refetches the visible window at the finer level
+async function plotTraces(t0, t1) {
+    const points = document.getElementById('activity-plot').clientWidth || 1000;
+    const range = t1 === undefined ? '' : `&t0=${t0}&t1=${t1}`;
+    const response = await fetch(`/traces?points=${points}${range}`);
+    const data = await response.json();
+    if (!data.available) {
+        return false;
+    }
+
+    const colors = {rate_pyramidal: '#1f77b4', rate_inhibitory: '#ff7f0e'};
+    const traces = [];
+    for (const [name, channel] of Object.entries(data.channels)) {
+        const color = colors[name] || '#333';
+        traces.push({x: data.time, y: channel.max, mode: 'lines',
+                     line: {width: 0}, showlegend: false, hoverinfo: 'skip'});
+        traces.push({x: data.time, y: channel.min, mode: 'lines',
+                     line: {width: 0}, fill: 'tonexty', fillcolor: color + '40',
+                     showlegend: false, hoverinfo: 'skip'});
+        traces.push({x: data.time, y: channel.mean, name: name, mode: 'lines',
+                     line: {color: color}});
+    }
+
+    const layout = {
+        title: 'Neural Activity Over Time',
+        xaxis: {title: 'Time (ms)', gridcolor: '#eee'},
+        yaxis: {title: 'Firing Rate (Hz)', gridcolor: '#eee'},
+        paper_bgcolor: 'white',
+        plot_bgcolor: 'white'
+    };
+    if (t1 !== undefined) {
+        layout.xaxis.range = [t0, t1];
+    }
+    const plot = document.getElementById('activity-plot');
+    await Plotly.react(plot, traces, layout);
+    if (!plot.tracesZoomHandler) {
+        plot.tracesZoomHandler = true;
+        plot.on('plotly_relayout', (e) => {
+            if (e['xaxis.range[0]'] !== undefined) {
+                plotTraces(e['xaxis.range[0]'], e['xaxis.range[1]']);
+            } else if (e['xaxis.autorange']) {
+                plotTraces();
+            }
+        });
+    }
+    return true;
+}
+
 async function updateResults() {
+    if (await plotTraces()) {
+        return;
+    }
+
     const response = await fetch('/get_results');
     const data = await response.json();
     
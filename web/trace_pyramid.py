@@ -0,0 +1,68 @@
+"""Reader for the multi-resolution traces in <output_dir>/traces
+(src/utils/trace_pyramid.h)."""
+import os
+
+import numpy as np
+
+MAX_LEVELS = 32
+
+
+def read_index(directory):
+    index = {'channels': []}
+    with open(os.path.join(directory, 'index.txt')) as f:
+        for line in f:
+            key, value = line.split(None, 1)
+            value = value.strip()
+            if key == 'channel':
+                index['channels'].append(value)
+            elif key == 'channels':
+                index['num_channels'] = int(value)
+            elif key == 'dt':
+                index['dt'] = float(value)
+            else:
+                index[key] = int(value)
+    return index
+
+
+def level_for(window_samples, max_points):
+    """Finest level covering the window with at most max_points buckets."""
+    level = 0
+    while level + 1 < MAX_LEVELS and (window_samples >> level) > max_points:
+        level += 1
+    return level
+
+
+def query(directory, t0, t1, max_points):
+    """min/max/mean of every channel over [t0, t1) ms at screen resolution."""
+    index = read_index(directory)
+    dt, channels = index['dt'], len(index['channels'])
+    first_sample = max(0, int(t0 / dt))
+    last_sample = int(np.ceil(min(t1 / dt, index['samples'])))
+    if last_sample <= first_sample:
+        return {'level': 0, 'time': [], 'channels': {}}
+
+    level = min(level_for(last_sample - first_sample, max(1, max_points)),
+                index['levels'] - 1)
+    first = first_sample >> level
+    count = max(0, (last_sample >> level) - first)
+    width = channels if level == 0 else channels * 3
+    path = os.path.join(directory, f'level_{level:02d}.bin')
+    data = np.fromfile(path, dtype=np.float32, count=count * width,
+                       offset=first * width * 4)
+    data = data[:len(data) - len(data) % width].reshape(-1, width)
+
+    bucket = 1 << level
+    # Buckets are plotted at their centre
+    times = (np.arange(first, first + len(data)) + 0.5) * bucket * dt
+    result = {}
+    for c, name in enumerate(index['channels']):
+        if level == 0:
+            values = data[:, c].tolist()
+            result[name] = {'min': values, 'max': values, 'mean': values}
+        else:
+            result[name] = {
+                'min': data[:, 3 * c].tolist(),
+                'max': data[:, 3 * c + 1].tolist(),
+                'mean': data[:, 3 * c + 2].tolist(),
+            }
+    return {'level': level, 'time': times.tolist(), 'channels': result}